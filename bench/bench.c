@@ -0,0 +1,561 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/ast.h"
+#include "tinyc/diag.h"
+#include "tinyc/jit.h"
+#include "tinyc/lexer.h"
+#include "tinyc/parser.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/span.h"
+#include "tinyc/string.h"
+#include "tinyc/symtab.h"
+#include "tinyc/token.h"
+#include "tinyc/type.h"
+#include "tinyc/utf8.h"
+
+static const char usage[] =
+    "usage: tinyc-bench [--repeat n] [--scale n] [name...]\n"
+    "Results are printed to stdout in JSON Lines.\n";
+
+/// Synthetic inputs shared by benchmarks, generated with fixed seed.
+struct corpus {
+    size_t scale;                // Multiplier of input sizes.
+    struct tinyc_string header;  // Generated header with many short lines.
+    struct tinyc_string longs;   // Few very long lines.
+    struct tinyc_string program;  // Generated functions with statements.
+    char dir[32];                // Directory holds many small files.
+    size_t nfiles;
+};
+
+/// Benchmark runs operations n times, and returns number of bytes
+/// processed, or 0 if not meaningful.
+struct bench {
+    const char *name;
+    size_t (*run)(const struct corpus *corpus, size_t n);
+    size_t n;  // Number of operations in a run at scale 1.
+};
+
+static uint64_t seed = 88172645463325252ULL;
+
+/// Xorshift generator, so corpora are the same every run.
+static uint64_t next_random(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t started;
+
+/// Start timer of current run. Benchmarks call this again after setup so
+/// that setup is not measured.
+static void start_timer(void) {
+    started = now_ns();
+}
+
+static void append(struct tinyc_string *s, const char *cstr) {
+    if (!tinyc_string_append(s, cstr, strlen(cstr))) abort();
+}
+
+static void generate_header(struct tinyc_string *res, size_t nlines) {
+    if (!tinyc_string_init(res)) abort();
+    char line[128];
+    for (size_t i = 0; i < nlines; ++i) {
+        switch (next_random() % 4) {
+            case 0:
+                sprintf(line, "#define MACRO_%zu (%zu + 1)\n", i, i);
+                break;
+            case 1:
+                sprintf(line, "extern int function_%zu(int a, char *b);\n", i);
+                break;
+            case 2:
+                sprintf(line, "    /* comment %zu */\n", i);
+                break;
+            default:
+                sprintf(line, "typedef struct s%zu { int x; } s%zu;\n", i, i);
+                break;
+        }
+        append(res, line);
+    }
+}
+
+static void generate_longs(struct tinyc_string *res, size_t nlines) {
+    if (!tinyc_string_init(res)) abort();
+    for (size_t i = 0; i < nlines; ++i) {
+        for (size_t j = 0; j < 4096; ++j) append(res, "x+1, ");
+        append(res, "\n");
+    }
+}
+
+static void generate_program(struct tinyc_string *res, size_t nlines) {
+    if (!tinyc_string_init(res)) abort();
+    char line[128];
+    for (size_t i = 0; i + 8 <= nlines; i += 8) {
+        sprintf(line, "int function_%zu(int a, char *b) {\n", i);
+        append(res, line);
+        sprintf(line, "    int x = a * 2 + %zu;\n", i);
+        append(res, line);
+        append(res, "    if (x > b[0]) {\n");
+        append(res, "        x = x - 1;\n");
+        append(res, "    }\n");
+        append(res, "    for (int i = 0; i < a; i++) x += b[i];\n");
+        append(res, "    return x;\n");
+        append(res, "}\n");
+    }
+}
+
+static void generate_files(struct corpus *corpus) {
+    strcpy(corpus->dir, "/tmp/tinyc-bench-XXXXXX");
+    if (!mkdtemp(corpus->dir)) abort();
+    for (size_t i = 0; i < corpus->nfiles; ++i) {
+        char path[64];
+        sprintf(path, "%s/%zu.h", corpus->dir, i);
+        FILE *fp = fopen(path, "w");
+        if (!fp) abort();
+        fprintf(fp, "#pragma once\nint small_%zu;\nint other_%zu;\n", i, i);
+        fclose(fp);
+    }
+}
+
+static void corpus_init(struct corpus *this, size_t scale) {
+    this->scale = scale;
+    this->nfiles = 1000 * scale;
+    generate_header(&this->header, 50000 * scale);
+    generate_longs(&this->longs, 16 * scale);
+    generate_program(&this->program, 50000 * scale);
+    generate_files(this);
+}
+
+static void corpus_free(struct corpus *this) {
+    for (size_t i = 0; i < this->nfiles; ++i) {
+        char path[64];
+        sprintf(path, "%s/%zu.h", this->dir, i);
+        remove(path);
+    }
+    remove(this->dir);
+    tinyc_string_free(&this->header);
+    tinyc_string_free(&this->longs);
+    tinyc_string_free(&this->program);
+}
+
+static size_t string_push(const struct corpus *corpus, size_t n) {
+    (void)corpus;
+    struct tinyc_string s;
+    if (!tinyc_string_init(&s)) abort();
+    for (size_t i = 0; i < n; ++i) {
+        if (!tinyc_string_push(&s, 'a' + i % 26)) abort();
+    }
+    tinyc_string_free(&s);
+    return n;
+}
+
+static size_t source_from_str(
+    const struct corpus *corpus,
+    const struct tinyc_string *content,
+    size_t n
+) {
+    (void)corpus;
+    for (size_t i = 0; i < n; ++i) {
+        struct tinyc_source source;
+        if (!tinyc_source_from_str(&source, "bench.h", content->cstr)) abort();
+        tinyc_source_free(&source);
+    }
+    return content->len * n;
+}
+
+static size_t source_header(const struct corpus *corpus, size_t n) {
+    return source_from_str(corpus, &corpus->header, n);
+}
+
+static size_t source_long_lines(const struct corpus *corpus, size_t n) {
+    return source_from_str(corpus, &corpus->longs, n);
+}
+
+static size_t utf8_validate(const struct corpus *corpus, size_t n) {
+    const struct tinyc_string *content = &corpus->header;
+    for (size_t i = 0; i < n; ++i) {
+        const size_t valid = tinyc_utf8_validate(content->cstr, content->len);
+        if (valid != content->len) abort();
+    }
+    return content->len * n;
+}
+
+static size_t source_small_files(const struct corpus *corpus, size_t n) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; ++i) {
+        char path[64];
+        sprintf(path, "%s/%zu.h", corpus->dir, i % corpus->nfiles);
+        FILE *fp = fopen(path, "r");
+        if (!fp) abort();
+        struct tinyc_source source;
+        if (!tinyc_source_from_fs(&source, path, fp)) abort();
+        bytes += ftell(fp);
+        fclose(fp);
+        tinyc_source_free(&source);
+    }
+    return bytes;
+}
+
+static size_t source_at_deep(const struct corpus *corpus, size_t n) {
+    struct tinyc_source source;
+    if (!tinyc_source_from_str(&source, "a.h", corpus->header.cstr)) abort();
+    const size_t nlines = 50000 * corpus->scale;
+    start_timer();
+    for (size_t i = 0; i < n; ++i) {
+        const size_t row = nlines - 1 - next_random() % 1000;
+        if (!tinyc_source_at(&source, row)) abort();
+    }
+    tinyc_source_free(&source);
+    return 0;
+}
+
+static size_t repo_query(const struct corpus *corpus, size_t n) {
+    (void)corpus;
+    const size_t nentries = 10000;
+    struct tinyc_repo repo;
+    struct tinyc_source source;
+    if (!tinyc_repo_init(&repo)) abort();
+    if (!tinyc_source_from_str(&source, "a.h", "")) abort();
+    for (size_t i = 0; i < nentries; ++i) {
+        if (tinyc_repo_registory(&repo, &source) < 0) abort();
+    }
+    start_timer();
+    for (size_t i = 0; i < n; ++i) {
+        if (!tinyc_repo_query(&repo, next_random() % nentries)) abort();
+    }
+    tinyc_repo_free(&repo);
+    tinyc_source_free(&source);
+    return 0;
+}
+
+/// Release all tokens in list except list itself.
+static void release_after(struct tinyc_token *list) {
+    for (struct tinyc_token *token = list->next; token != list;) {
+        struct tinyc_token *next = token->next;
+        tinyc_free(token);
+        token = next;
+    }
+    list->next = list->prev = list;
+}
+
+static size_t token_churn(const struct corpus *corpus, size_t n) {
+    (void)corpus;
+    const struct tinyc_span span = {
+        0,
+        {0, 0},
+        {0, 0}
+    };
+    struct tinyc_string value;
+    tinyc_string_from(&value, "identifier");
+    struct tinyc_token *list = tinyc_token_create_punct(
+        &span,
+        TINYC_TOKEN_PUNCT_SEMICOLON
+    );
+    if (!list) abort();
+    for (size_t i = 0; i < n; ++i) {
+        struct tinyc_token *token =
+            i % 2 ? tinyc_token_create_ident(&span, &value)
+                  : tinyc_token_create_punct(&span, TINYC_TOKEN_PUNCT_PLUS);
+        if (!token) abort();
+        tinyc_token_insert(list->prev, token);
+
+        // Release tokens in batch, as a pass over token list would.
+        if (i % 64 == 63) release_after(list);
+    }
+    release_after(list);
+    tinyc_free(list);
+    return 0;
+}
+
+static size_t parse(const struct corpus *corpus, size_t n) {
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    const char *content = corpus->program.cstr;
+    if (!tinyc_source_from_str(&source, "bench.c", content)) abort();
+    if (!tinyc_lexer_init(&lexer, &source, 0)) abort();
+    start_timer();
+    for (size_t i = 0; i < n; ++i) {
+        struct tinyc_ast ast;
+        struct tinyc_parse_error error;
+        if (!tinyc_ast_init(&ast)) abort();
+        if (!tinyc_parse(&ast, &lexer, &error)) abort();
+        tinyc_ast_free(&ast);
+    }
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+    return corpus->program.len * n;
+}
+
+/// Small program as edited and run over and over in test-driven workflow.
+static const char small_program[] =
+    "int fib(int n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }\n"
+    "int sum(const int *a, int n) {\n"
+    "    int s = 0;\n"
+    "    for (int i = 0; i < n; ++i) s += a[i];\n"
+    "    return s;\n"
+    "}\n"
+    "int main(int argc, char **argv) {\n"
+    "    int a[8] = {1, 2, 3, 4, 5, 6, 7, 8};\n"
+    "    switch (argc) {\n"
+    "        case 0: return 1;\n"
+    "        default: break;\n"
+    "    }\n"
+    "    if (fib(10) != 55 || sum(a, 8) != 36) return 1;\n"
+    "    return strlen(argv[0]) == 0;\n"
+    "}\n";
+
+/// Load, lex, parse, compile into memory and run small program.
+static size_t jit_run(const struct corpus *corpus, size_t n) {
+    (void)corpus;
+    char arg0[] = "bench";
+    char *argv[] = {arg0, NULL};
+    for (size_t i = 0; i < n; ++i) {
+        struct tinyc_source source;
+        struct tinyc_lexer lexer;
+        struct tinyc_ast ast;
+        struct tinyc_parse_error parse_error;
+        struct tinyc_jit jit;
+        struct tinyc_jit_error jit_error;
+        int status;
+        if (!tinyc_source_from_str(&source, "bench.c", small_program)) abort();
+        if (!tinyc_lexer_init(&lexer, &source, 0)) abort();
+        if (!tinyc_ast_init(&ast)) abort();
+        if (!tinyc_parse(&ast, &lexer, &parse_error)) abort();
+        if (!tinyc_jit_init(&jit)) abort();
+        if (!tinyc_jit_compile(&jit, &ast, &jit_error)) abort();
+        if (!tinyc_jit_run(&jit, 1, argv, &status) || status != 0) abort();
+        tinyc_jit_free(&jit);
+        tinyc_ast_free(&ast);
+        tinyc_lexer_free(&lexer);
+        tinyc_source_free(&source);
+    }
+    return sizeof(small_program) * n;
+}
+
+/// Enter scope declaring a few names and look them up, unwinding all scopes
+/// at fixed depth as generated code nests deeply.
+static size_t symtab_nested(const struct corpus *corpus, size_t n) {
+    (void)corpus;
+    const size_t depth = 1000;
+    char names[8][8];
+    struct tinyc_string keys[8];
+    for (size_t i = 0; i < 8; ++i) {
+        sprintf(names[i], "v%zu", i);
+        tinyc_string_from(&keys[i], names[i]);
+    }
+    struct tinyc_symtab symtab;
+    if (!tinyc_symtab_init(&symtab)) abort();
+    start_timer();
+    for (size_t i = 0; i < n; ++i) {
+        if (symtab.depth == depth) {
+            while (symtab.depth) tinyc_symtab_pop(&symtab);
+        }
+        if (!tinyc_symtab_push(&symtab)) abort();
+        for (size_t j = 0; j < 4; ++j) {
+            struct tinyc_string *key = &keys[(i + j) % 8];
+            const bool ok = tinyc_symtab_declare(
+                &symtab,
+                TINYC_SYMTAB_ORDINARY,
+                key,
+                key
+            );
+            if (!ok) abort();
+        }
+        for (size_t j = 0; j < 4; ++j) {
+            const struct tinyc_symtab_symbol *symbol = tinyc_symtab_lookup(
+                &symtab,
+                TINYC_SYMTAB_ORDINARY,
+                &keys[(i + 3 - j) % 8]
+            );
+            if (!symbol) abort();
+        }
+    }
+    tinyc_symtab_free(&symtab);
+    return 0;
+}
+
+/// Build prototypes of a few signatures again and again, as headers declare
+/// many functions sharing them, and compare each with its declaration
+/// without prototype.
+static size_t type_intern(const struct corpus *corpus, size_t n) {
+    (void)corpus;
+    struct tinyc_types types;
+    if (!tinyc_types_init(&types)) abort();
+    const struct tinyc_type *basic[] = {
+        tinyc_type_basic(&types, TINYC_TYPE_INT),
+        tinyc_type_basic(&types, TINYC_TYPE_LONG),
+        tinyc_type_basic(&types, TINYC_TYPE_CHAR),
+        tinyc_type_basic(&types, TINYC_TYPE_DOUBLE),
+    };
+    start_timer();
+    for (size_t i = 0; i < n; ++i) {
+        const struct tinyc_type *params[4];
+        for (size_t j = 0; j < 4; ++j) {
+            params[j] = basic[(i >> j) % 4];
+            if (j % 2 == 0) continue;
+            params[j] = tinyc_type_pointer(
+                &types,
+                tinyc_type_qualified(&types, params[j], TINYC_TYPE_CONST)
+            );
+        }
+        const struct tinyc_type *ret = basic[i % 4], *res;
+        const struct tinyc_type *f = tinyc_type_function(
+            &types,
+            ret,
+            params,
+            4,
+            TINYC_TYPE_PROTOTYPE
+        );
+        const struct tinyc_type *g = tinyc_type_function(
+            &types,
+            ret,
+            NULL,
+            0,
+            0
+        );
+        if (!tinyc_type_composite(&types, f, g, &res) || res != f) abort();
+    }
+    tinyc_types_free(&types);
+    return 0;
+}
+
+static size_t diag_fs(const struct corpus *corpus, size_t n) {
+    struct tinyc_repo repo;
+    struct tinyc_source source;
+    if (!tinyc_repo_init(&repo)) abort();
+    if (!tinyc_source_from_str(&source, "a.h", corpus->header.cstr)) abort();
+    const tinyc_repo_id id = tinyc_repo_registory(&repo, &source);
+    if (id < 0) abort();
+    FILE *fp = fopen("/dev/null", "w");
+    if (!fp) abort();
+    start_timer();
+    for (size_t i = 0; i < n; ++i) {
+        const size_t row = next_random() % 1000;
+        const struct tinyc_span span = {
+            id,
+            {row, 2},
+            {row, 8}
+        };
+        tinyc_diag_fs(fp, TINYC_DIAG_ERROR, &repo, &span, "bench", "message");
+    }
+    fclose(fp);
+    tinyc_repo_free(&repo);
+    tinyc_source_free(&source);
+    return 0;
+}
+
+static const struct bench benches[] = {
+    {"string_push",        string_push,        10000000},
+    {"source_header",      source_header,      5       },
+    {"source_long_lines",  source_long_lines,  5       },
+    {"utf8_validate",      utf8_validate,      100     },
+    {"source_small_files", source_small_files, 1000    },
+    {"source_at_deep",     source_at_deep,     1000    },
+    {"repo_query",         repo_query,         100000  },
+    {"token_churn",        token_churn,        1000000 },
+    {"diag_fs",            diag_fs,            100000  },
+    {"parse",              parse,              5       },
+    {"symtab_nested",      symtab_nested,      1000000 },
+    {"type_intern",        type_intern,        1000000 },
+    {"jit_run",            jit_run,            1000    },
+};
+
+static bool selected(const char *name, char **names, size_t n) {
+    if (n == 0) return true;
+    for (size_t i = 0; i < n; ++i) {
+        if (strcmp(name, names[i]) == 0) return true;
+    }
+    return false;
+}
+
+/// Run bench repeat times, and print the fastest run.
+static void run(
+    const struct bench *bench,
+    const struct corpus *corpus,
+    size_t repeat
+) {
+    const size_t n = bench->n * corpus->scale;
+    uint64_t best = UINT64_MAX;
+    size_t bytes = 0;
+    for (size_t i = 0; i < repeat; ++i) {
+        start_timer();
+        bytes = bench->run(corpus, n);
+        const uint64_t elapsed = now_ns() - started;
+        if (elapsed < best) best = elapsed;
+    }
+    printf(
+        "{\"name\":\"%s\",\"ops\":%zu,\"repeat\":%zu,\"ns\":%llu,"
+        "\"ns_per_op\":%.3f,\"mb_per_s\":%.3f}\n",
+        bench->name,
+        n,
+        repeat,
+        (unsigned long long)best,
+        (double)best / n,
+        bytes ? bytes / 1e6 / (best / 1e9) : 0.0
+    );
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    size_t repeat = 5, scale = 1, nnames = 0;
+    char **names = argv + 1;
+    for (int i = 1; i < argc; ++i) {
+        char *end;
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = strtoul(argv[++i], &end, 10);
+            if (*end || repeat == 0) break;
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = strtoul(argv[++i], &end, 10);
+            if (*end || scale == 0) break;
+        } else if (argv[i][0] == '-') {
+            fputs(usage, stderr);
+            return EXIT_FAILURE;
+        } else {
+            names[nnames++] = argv[i];
+        }
+    }
+    if (repeat == 0 || scale == 0) {
+        fputs(usage, stderr);
+        return EXIT_FAILURE;
+    }
+
+    struct corpus corpus;
+    corpus_init(&corpus, scale);
+    for (size_t i = 0; i < sizeof(benches) / sizeof(*benches); ++i) {
+        if (!selected(benches[i].name, names, nnames)) continue;
+        run(&benches[i], &corpus, repeat);
+    }
+    corpus_free(&corpus);
+    return EXIT_SUCCESS;
+}
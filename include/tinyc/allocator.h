@@ -0,0 +1,97 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TINYC_ALLOCATOR_H_
+#define TINYC_ALLOCATOR_H_
+
+#include <stddef.h>
+
+#include "tinyc/stats.h"
+
+/// Memory allocator used by the library.
+///
+/// Each function receives ctx as its first argument. Functions must behave
+/// like malloc, realloc and free respectively, and must be thread-safe if
+/// the library is used from multiple threads.
+struct tinyc_allocator {
+    void *(*alloc)(void *ctx, size_t size);
+    void *(*realloc)(void *ctx, void *ptr, size_t size);
+    void (*free)(void *ctx, void *ptr);
+    void *ctx;
+};
+
+/// Allocator backed by malloc, realloc and free. This is the default.
+extern const struct tinyc_allocator tinyc_allocator_libc;
+
+/// Make library allocate memory from allocator, or libc if it's NULL, on
+/// every thread without scoped allocator. Memory must be released by the
+/// allocator which allocated it, so this must be called while no object
+/// created by the library is alive and no other thread uses the library.
+/// Returns previously used allocator.
+const struct tinyc_allocator *tinyc_allocator_set(
+    const struct tinyc_allocator *allocator
+);
+
+/// Make library allocate memory from allocator only on calling thread, or
+/// from the one set by tinyc_allocator_set if it's NULL. Objects created
+/// while allocator is scoped must be freed before it's changed again, except
+/// that session always uses the one set by tinyc_allocator_set, so a warm
+/// session survives a per-request arena.
+/// Returns previously scoped allocator, or NULL if none.
+const struct tinyc_allocator *tinyc_allocator_scope(
+    const struct tinyc_allocator *allocator
+);
+
+/// Allocate size bytes from current allocator.
+void *tinyc_alloc(size_t size);
+
+/// Allocate n zero-filled objects of size bytes from current allocator.
+void *tinyc_calloc(size_t n, size_t size);
+
+/// Resize memory allocated by current allocator.
+void *tinyc_realloc(void *ptr, size_t size);
+
+/// Release memory allocated by current allocator. ptr may be NULL.
+void tinyc_free(void *ptr);
+
+#ifdef TINYC_STATS
+/// Same as tinyc_alloc, but count allocation for subsystem.
+void *tinyc_alloc_for(enum tinyc_stats_subsystem subsystem, size_t size);
+
+/// Same as tinyc_calloc, but count allocation for subsystem.
+void *tinyc_calloc_for(
+    enum tinyc_stats_subsystem subsystem,
+    size_t n,
+    size_t size
+);
+
+/// Same as tinyc_realloc, but count allocation for subsystem if ptr is NULL.
+void *tinyc_realloc_for(
+    enum tinyc_stats_subsystem subsystem,
+    void *ptr,
+    size_t size
+);
+
+// Source files define TINYC_STATS_SUBSYSTEM before including this header to
+// count their allocations for it.
+#ifdef TINYC_STATS_SUBSYSTEM
+#define tinyc_alloc(size) tinyc_alloc_for(TINYC_STATS_SUBSYSTEM, size)
+#define tinyc_calloc(n, size) tinyc_calloc_for(TINYC_STATS_SUBSYSTEM, n, size)
+#define tinyc_realloc(ptr, size) \
+    tinyc_realloc_for(TINYC_STATS_SUBSYSTEM, ptr, size)
+#endif
+#endif
+
+#endif  // TINYC_ALLOCATOR_H_
@@ -0,0 +1,216 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TINYC_AST_H_
+#define TINYC_AST_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tinyc/span.h"
+#include "tinyc/string.h"
+
+/// Index of node in tree. Node 0 is reserved for absence of node.
+typedef uint32_t tinyc_ast_ref;
+
+enum tinyc_ast_kind {
+    TINYC_AST_NONE,  // Absent node, only used as node 0.
+
+    // Declarations. Name is declared identifier, or 0 if abstract.
+    TINYC_AST_UNIT,        // Children: declarations and functions.
+    TINYC_AST_FUNC,        // Children: type, body. Flags: storage.
+    TINYC_AST_DECL,        // Children: type, initializer. Flags: storage.
+    TINYC_AST_PARAM,       // Children: type.
+    TINYC_AST_FIELD,       // Children: type, bit width.
+    TINYC_AST_ENUMERATOR,  // Children: value.
+    TINYC_AST_INIT_LIST,   // Children: initializers.
+
+    // Types. Flags of each type have its qualifiers.
+    TINYC_AST_TYPE_BASE,     // Flags: specifiers.
+    TINYC_AST_TYPE_NAME,     // Name: typedef name.
+    TINYC_AST_TYPE_STRUCT,   // Name: tag. Children: fields.
+    TINYC_AST_TYPE_ENUM,     // Name: tag. Children: enumerators.
+    TINYC_AST_TYPE_POINTER,  // Children: pointee.
+    TINYC_AST_TYPE_ARRAY,    // Children: element, length.
+    TINYC_AST_TYPE_FUNC,     // Children: return type, parameters.
+
+    // Statements.
+    TINYC_AST_BLOCK,     // Children: statements and declarations.
+    TINYC_AST_IF,        // Children: condition, then, else.
+    TINYC_AST_SWITCH,    // Children: condition, body.
+    TINYC_AST_CASE,      // Children: value, statement.
+    TINYC_AST_DEFAULT,   // Children: statement.
+    TINYC_AST_WHILE,     // Children: condition, body.
+    TINYC_AST_DO,        // Children: body, condition.
+    TINYC_AST_FOR,       // Children: init, condition, step, body.
+    TINYC_AST_GOTO,      // Name: label.
+    TINYC_AST_LABEL,     // Name: label. Children: statement.
+    TINYC_AST_BREAK,
+    TINYC_AST_CONTINUE,
+    TINYC_AST_RETURN,  // Children: value.
+
+    // Expressions.
+    TINYC_AST_IDENT,     // Name: identifier.
+    TINYC_AST_INT,       // Value: constant. Flags: suffix as specifiers.
+    TINYC_AST_STRING,    // Name: content. Value: length of content.
+    TINYC_AST_CALL,      // Children: callee, arguments.
+    TINYC_AST_INDEX,     // Children: array, index.
+    TINYC_AST_MEMBER,    // Name: member. Children: object.
+    TINYC_AST_ARROW,     // Name: member. Children: pointer.
+    TINYC_AST_POST_INC,  // Children: operand, same for unary below.
+    TINYC_AST_POST_DEC,
+    TINYC_AST_PRE_INC,
+    TINYC_AST_PRE_DEC,
+    TINYC_AST_ADDR,
+    TINYC_AST_DEREF,
+    TINYC_AST_PLUS,
+    TINYC_AST_NEG,
+    TINYC_AST_NOT,
+    TINYC_AST_LNOT,
+    TINYC_AST_SIZEOF,  // Children: type or expression.
+    TINYC_AST_CAST,    // Children: type, operand.
+    TINYC_AST_MUL,     // Children: lhs, rhs, same for binary below.
+    TINYC_AST_DIV,
+    TINYC_AST_MOD,
+    TINYC_AST_ADD,
+    TINYC_AST_SUB,
+    TINYC_AST_SHL,
+    TINYC_AST_SHR,
+    TINYC_AST_LT,
+    TINYC_AST_GT,
+    TINYC_AST_LE,
+    TINYC_AST_GE,
+    TINYC_AST_EQ,
+    TINYC_AST_NE,
+    TINYC_AST_AND,
+    TINYC_AST_XOR,
+    TINYC_AST_OR,
+    TINYC_AST_LAND,
+    TINYC_AST_LOR,
+    TINYC_AST_COND,    // Children: condition, then, else.
+    TINYC_AST_ASSIGN,  // Children: lhs, rhs. Flags: kind of compound op.
+    TINYC_AST_COMMA,   // Children: lhs, rhs.
+};
+
+// Qualifiers of types.
+#define TINYC_AST_QUAL_CONST    (1u << 0)
+#define TINYC_AST_QUAL_VOLATILE (1u << 1)
+#define TINYC_AST_QUAL_RESTRICT (1u << 2)
+
+// Specifiers of base types, and suffixes of integer constants.
+#define TINYC_AST_SPEC_VOID      (1u << 3)
+#define TINYC_AST_SPEC_BOOL      (1u << 4)
+#define TINYC_AST_SPEC_CHAR      (1u << 5)
+#define TINYC_AST_SPEC_SHORT     (1u << 6)
+#define TINYC_AST_SPEC_INT       (1u << 7)
+#define TINYC_AST_SPEC_LONG      (1u << 8)
+#define TINYC_AST_SPEC_LONG_LONG (1u << 9)
+#define TINYC_AST_SPEC_SIGNED    (1u << 10)
+#define TINYC_AST_SPEC_UNSIGNED  (1u << 11)
+#define TINYC_AST_SPEC_FLOAT     (1u << 12)
+#define TINYC_AST_SPEC_DOUBLE    (1u << 13)
+
+// Other flags of types.
+#define TINYC_AST_UNION     (1u << 14)  // Struct type is union.
+#define TINYC_AST_COMPLETE  (1u << 15)  // Struct or enum has body.
+#define TINYC_AST_PROTOTYPE (1u << 16)  // Function has parameter list.
+#define TINYC_AST_VARIADIC  (1u << 17)  // Function takes "...".
+
+// Storage classes of declarations.
+#define TINYC_AST_STORAGE_TYPEDEF (1u << 0)
+#define TINYC_AST_STORAGE_EXTERN  (1u << 1)
+#define TINYC_AST_STORAGE_STATIC  (1u << 2)
+#define TINYC_AST_STORAGE_INLINE  (1u << 3)
+
+/// Node of tree. Children of a node are contiguous in refs of tree, and an
+/// absent child is 0.
+struct tinyc_ast_node {
+    enum tinyc_ast_kind kind;
+    uint32_t children;   // Index of first child in refs.
+    uint32_t nchildren;  // Number of children.
+    uint32_t name;       // Offset of identifier or string in strings.
+    uint32_t flags;      // Meaning depends on kind.
+    uint64_t value;
+};
+
+/// Syntax tree of a translation unit, stored in a few arrays.
+///
+/// Nodes refer each other by index, so arrays can grow without fixing
+/// references, and whole tree is released at once. Spans are held apart
+/// from nodes as they are rarely needed during traversal.
+struct tinyc_ast {
+    struct tinyc_ast_node *nodes;
+    struct tinyc_span *spans;  // Span of each node.
+    size_t len, cap;
+    tinyc_ast_ref *refs;  // Children of all nodes.
+    size_t nrefs, refs_cap;
+    struct tinyc_string strings;  // Names and contents of strings.
+    tinyc_ast_ref root;           // 0 until parsed.
+};
+
+/// Initialize empty tree.
+/// Returns false if failed to allocate memory.
+bool tinyc_ast_init(struct tinyc_ast *this);
+
+/// Add node of kind with n children, and set its name and flags to 0.
+/// Returns 0 if failed to allocate memory.
+tinyc_ast_ref tinyc_ast_add(
+    struct tinyc_ast *this,
+    enum tinyc_ast_kind kind,
+    const struct tinyc_span *span,
+    const tinyc_ast_ref *children,
+    size_t n
+);
+
+/// Make tree be able to hold n more nodes and as many children without
+/// moving them.
+/// Returns false if failed to allocate memory.
+bool tinyc_ast_reserve(struct tinyc_ast *this, size_t n);
+
+/// Copy n characters from s into strings, and set its offset to res.
+/// Returns false if failed to allocate memory.
+bool tinyc_ast_add_string(
+    struct tinyc_ast *this,
+    const char *s,
+    size_t n,
+    uint32_t *res
+);
+
+/// Get i-th child of node, or 0 if it doesn't have such child.
+tinyc_ast_ref tinyc_ast_child(
+    const struct tinyc_ast *this,
+    tinyc_ast_ref node,
+    size_t i
+);
+
+/// Get name of node, which is empty if it has no name.
+const char *tinyc_ast_name(const struct tinyc_ast *this, tinyc_ast_ref node);
+
+/// Get name of kind, e.g. "func" for TINYC_AST_FUNC.
+const char *tinyc_ast_kind_name(enum tinyc_ast_kind kind);
+
+/// Append node as s-expression to out.
+/// Returns false if failed to allocate memory.
+bool tinyc_ast_dump(
+    const struct tinyc_ast *this,
+    tinyc_ast_ref node,
+    struct tinyc_string *out
+);
+
+/// Release memory owned by tree.
+void tinyc_ast_free(struct tinyc_ast *this);
+
+#endif  // TINYC_AST_H_
@@ -15,8 +15,14 @@
 #ifndef TINYC_DIAG_H_
 #define TINYC_DIAG_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
 #include "tinyc/repo.h"
+#include "tinyc/source.h"
 #include "tinyc/span.h"
+#include "tinyc/string.h"
 
 enum tinyc_diag_severity {
     TINYC_DIAG_INFO,
@@ -24,6 +30,35 @@ enum tinyc_diag_severity {
     TINYC_DIAG_ERROR,
 };
 
+#define TINYC_DIAG_CACHE_SIZE 8
+
+/// Source line recently shown in diagnostic.
+struct tinyc_diag_cache_line {
+    const struct tinyc_repo *repo;
+    tinyc_repo_id id;
+    size_t row;
+    const struct tinyc_source *source;
+    const struct tinyc_string *line;  // Row of source.
+    size_t width;                     // Display width of the line.
+    struct tinyc_string header;       // Numbered line followed by gutter.
+};
+
+/// Lines recently shown in diagnostics, keyed by (repo, id, row).
+///
+/// Diagnostics are usually clustered on few lines, so with cache each line
+/// is looked up from repository and formatted only once.
+struct tinyc_diag_cache {
+    size_t len;   // Number of valid lines.
+    size_t next;  // Index of line replaced on next miss.
+    struct tinyc_diag_cache_line lines[TINYC_DIAG_CACHE_SIZE];
+};
+
+/// Initialize empty cache.
+void tinyc_diag_cache_init(struct tinyc_diag_cache *this);
+
+/// Release memory owned by cache.
+void tinyc_diag_cache_free(struct tinyc_diag_cache *this);
+
 /// Show diagnostic to stdout.
 void tinyc_diag(
     enum tinyc_diag_severity severity,
@@ -44,4 +79,19 @@ void tinyc_diag_fs(
     const char *message
 );
 
+/// Append diagnostic to buf, same as what tinyc_diag_fs writes, or
+/// tinyc_diag if color is true. cache may be NULL, otherwise lines in it are
+/// reused, so it must not outlive repo.
+/// Returns false if failed to allocate memory.
+bool tinyc_diag_render(
+    struct tinyc_string *buf,
+    struct tinyc_diag_cache *cache,
+    bool color,
+    enum tinyc_diag_severity severity,
+    const struct tinyc_repo *repo,
+    const struct tinyc_span *span,
+    const char *what,
+    const char *message
+);
+
 #endif  // TINYC_DIAG_H_
@@ -0,0 +1,123 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_DIAG_BUFFER_H_
+#define TINYC_DIAG_BUFFER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "tinyc/diag.h"
+#include "tinyc/diag_json.h"
+#include "tinyc/map.h"
+#include "tinyc/repo.h"
+#include "tinyc/span.h"
+#include "tinyc/string.h"
+
+/// Kind of diagnostic, usually defined as static constant. Its format is
+/// message where %s and %d are replaced by string and int arguments, and
+/// %% by '%'.
+struct tinyc_diag_kind {
+    enum tinyc_diag_severity severity;
+    const char *what;
+    const char *format;
+};
+
+#define TINYC_DIAG_MAX_ARGS 4
+
+/// Argument of diagnostic.
+union tinyc_diag_arg {
+    int i;
+    size_t s;  // Offset of copied string in strings of buffer.
+};
+
+/// Diagnostic not yet formatted nor rendered.
+struct tinyc_diag_record {
+    const struct tinyc_diag_kind *kind;
+    struct tinyc_span span;
+    const struct tinyc_repo *repo;
+    union tinyc_diag_arg args[TINYC_DIAG_MAX_ARGS];
+};
+
+/// Limits applied before diagnostic is recorded.
+struct tinyc_diag_limits {
+    size_t max_errors;       // Maximum number of errors, or 0 for unlimited.
+    size_t max_per_kind;     // Maximum number of same kind, or 0.
+    bool dedup;              // Drop same kind at same location.
+    bool suppress_warnings;  // Drop all warnings.
+};
+
+struct tinyc_diag_seen;
+
+/// Diagnostics recorded in memory instead of written to file stream.
+///
+/// Each thread should own its buffer, so no locking is needed while emitting.
+/// Diagnostics are only recorded when emitted, and rendered when merged.
+/// Diagnostics dropped by limits cost only a few comparisons.
+struct tinyc_diag_buffer {
+    struct tinyc_diag_limits limits;    // Unlimited by default.
+    struct tinyc_diag_record *records;  // In emitted order.
+    size_t len, cap;
+    struct tinyc_string strings;  // String arguments terminated by '\0'.
+    size_t errors;   // Number of recorded errors.
+    size_t dropped;  // Number of diagnostics dropped by limits.
+    struct tinyc_diag_seen *seen;  // Set of recorded (location, kind).
+    size_t seen_len, seen_cap;
+    struct tinyc_map kinds;  // what of kind -> number of recorded ones.
+};
+
+/// Initialize empty buffer without limits.
+/// Returns false if initialization failed.
+bool tinyc_diag_buffer_init(struct tinyc_diag_buffer *this);
+
+/// Record diagnostic of kind into buffer unless limits drop it. Arguments
+/// for format of kind follow span, and strings among them are copied. repo
+/// must be valid until buffer is merged, and kind until buffer is freed.
+/// Returns false if failed to allocate memory.
+bool tinyc_diag_buffer_emit(
+    struct tinyc_diag_buffer *this,
+    const struct tinyc_diag_kind *kind,
+    const struct tinyc_repo *repo,
+    const struct tinyc_span *span,
+    ...
+);
+
+/// Format and render diagnostics in n buffers and write them to fs with
+/// single write, then clear them. Counters and limits of buffers are kept.
+/// Diagnostics are written in order of index of its buffer, then in emitted
+/// order, so output doesn't depend on timing of threads if each buffer is
+/// assigned to fixed part of work. If sort is true, they're sorted by its
+/// source location first.
+/// Returns false if failed to write.
+bool tinyc_diag_buffer_merge(
+    FILE *fs,
+    struct tinyc_diag_buffer *buffers,
+    size_t n,
+    bool sort
+);
+
+/// Same as tinyc_diag_buffer_merge, but write diagnostics into sink.
+/// Returns false if failed to write.
+bool tinyc_diag_buffer_merge_json(
+    struct tinyc_diag_json *sink,
+    struct tinyc_diag_buffer *buffers,
+    size_t n,
+    bool sort
+);
+
+/// Release memory owned by buffer.
+void tinyc_diag_buffer_free(struct tinyc_diag_buffer *this);
+
+#endif  // TINYC_DIAG_BUFFER_H_
@@ -0,0 +1,79 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_DIAG_JSON_H_
+#define TINYC_DIAG_JSON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "tinyc/diag.h"
+#include "tinyc/repo.h"
+#include "tinyc/span.h"
+
+#define TINYC_DIAG_JSON_BUFSIZE (16 * 1024)
+
+enum tinyc_diag_json_format {
+    TINYC_DIAG_JSON_LINES,  // One object per line.
+    TINYC_DIAG_JSON_SARIF,  // Single SARIF 2.1.0 log.
+};
+
+/// Write diagnostics as machine readable JSON instead of text.
+///
+/// In JSON Lines format, each diagnostic is written as one line like
+/// {"severity":"error","file":"a.c","start":{"row":1,"offset":4},
+/// "end":{"row":1,"offset":6},"what":"...","message":"..."}
+/// where positions are same as tinyc_span. Bytes of strings not encoded in
+/// UTF-8 are replaced with U+FFFD.
+///
+/// In SARIF format, each diagnostic becomes one result, whose region is
+/// 1-based and its end column is exclusive as SARIF requires. Columns are
+/// counted in code points, and file is written as percent-encoded URI.
+///
+/// Output is written through fixed size buffer as diagnostics are emitted,
+/// so memory usage doesn't depend on number of diagnostics.
+struct tinyc_diag_json {
+    FILE *fs;
+    enum tinyc_diag_json_format format;
+    size_t count;  // Number of emitted diagnostics.
+    bool ok;       // False once failed to write.
+    size_t len;    // Number of bytes in buf.
+    char buf[TINYC_DIAG_JSON_BUFSIZE];
+};
+
+/// Initialize sink which writes to fs, and write header of format if any.
+/// Returns false if failed to write.
+bool tinyc_diag_json_init(
+    struct tinyc_diag_json *this,
+    FILE *fs,
+    enum tinyc_diag_json_format format
+);
+
+/// Write diagnostic. Arguments are same as tinyc_diag_fs.
+/// Returns false if failed to write.
+bool tinyc_diag_json_emit(
+    struct tinyc_diag_json *this,
+    enum tinyc_diag_severity severity,
+    const struct tinyc_repo *repo,
+    const struct tinyc_span *span,
+    const char *what,
+    const char *message
+);
+
+/// Write trailer of format if any and buffered output to file stream.
+/// Returns false if failed to write.
+bool tinyc_diag_json_finish(struct tinyc_diag_json *this);
+
+#endif  // TINYC_DIAG_JSON_H_
@@ -0,0 +1,84 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_HEADER_SEARCH_H_
+#define TINYC_HEADER_SEARCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "tinyc/map.h"
+#include "tinyc/string.h"
+
+/// Resolve path of #include to file path.
+///
+/// Each directory is listed at most once, when it's first searched, and
+/// result of each lookup is cached. So after warming up, resolving header
+/// doesn't issue any system call. Files created after listing aren't seen
+/// until tinyc_header_search_revalidate is called.
+struct tinyc_header_search {
+    struct tinyc_string *dirs;  // Search directories given by -I, in order.
+    size_t ndirs, cap;
+    struct tinyc_map listings;  // Directory -> map of its entries or NULL.
+    struct tinyc_map paths;     // Interned resolved paths.
+    struct tinyc_map found[2];  // Header path -> resolved path or NULL.
+                                // Indexed by is_std.
+};
+
+/// Initialize header search without any search directory.
+/// Returns false if initialization failed.
+bool tinyc_header_search_init(struct tinyc_header_search *this);
+
+/// Append search directory.
+/// Returns false if failed to allocate memory.
+bool tinyc_header_search_add_dir(
+    struct tinyc_header_search *this,
+    const char *dir
+);
+
+/// Resolve path of header. For "" style header, base is searched at first
+/// unless base is NULL. base is usually directory of including file.
+/// Returns NULL if no such header exists or failed to allocate memory.
+/// Returned string is valid until this is freed.
+const struct tinyc_string *tinyc_header_search_resolve(
+    struct tinyc_header_search *this,
+    const char *base,
+    bool is_std,
+    const struct tinyc_string *path
+);
+
+/// Forget listings and results if any listed directory was modified after
+/// it was listed. Previously resolved paths stay valid.
+/// Returns false if failed to allocate memory.
+bool tinyc_header_search_revalidate(struct tinyc_header_search *this);
+
+/// Find #include directive in line, and set its path to path.
+/// Returns false if line isn't #include or failed to allocate memory.
+bool tinyc_header_search_parse_include(
+    const struct tinyc_string *line,
+    bool *is_std,
+    struct tinyc_string *path
+);
+
+/// Get directory part of path, or "." if path has no directory.
+/// Returns false if failed to allocate memory.
+bool tinyc_header_search_dirname(
+    const struct tinyc_string *path,
+    struct tinyc_string *res
+);
+
+/// Release memory owned by header search.
+void tinyc_header_search_free(struct tinyc_header_search *this);
+
+#endif  // TINYC_HEADER_SEARCH_H_
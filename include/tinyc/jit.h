@@ -0,0 +1,81 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_JIT_H_
+#define TINYC_JIT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "tinyc/ast.h"
+#include "tinyc/span.h"
+#include "tinyc/symtab.h"
+#include "tinyc/type.h"
+
+/// Error found while generating code.
+struct tinyc_jit_error {
+    struct tinyc_span span;
+    const char *message;
+};
+
+struct tinyc_jit_chunk;
+
+/// Translation unit compiled into x86-64 machine code in memory.
+///
+/// Code is generated in one pass over the syntax tree as a stack machine
+/// whose result is held in rax, and written into a buffer which is mapped
+/// executable once all calls are resolved. Functions not defined in unit
+/// are looked up in the running process, so libc can be called directly.
+/// Struct, union, floating types and more than six parameters are not
+/// supported yet.
+struct tinyc_jit {
+    struct tinyc_types types;
+    struct tinyc_symtab symbols;     // File scope is left after compiled.
+    struct tinyc_jit_chunk *chunks;  // Symbols, objects and strings.
+    void *code;                      // Executable mapping, or NULL.
+    size_t size;                     // Size of mapping.
+    void *process;                   // Handle to look up symbols.
+};
+
+/// Initialize empty unit.
+/// Returns false if initialization failed.
+bool tinyc_jit_init(struct tinyc_jit *this);
+
+/// Compile translation unit of ast into memory. Unit can be compiled only
+/// once.
+/// Returns false and set error if failed.
+bool tinyc_jit_compile(
+    struct tinyc_jit *this,
+    const struct tinyc_ast *ast,
+    struct tinyc_jit_error *error
+);
+
+/// Get address of function or object defined in compiled unit.
+/// Returns NULL if it's not defined.
+void *tinyc_jit_lookup(const struct tinyc_jit *this, const char *name);
+
+/// Call main of compiled unit with argc arguments in argv, and set its
+/// return value to status.
+/// Returns false if main is not defined.
+bool tinyc_jit_run(
+    struct tinyc_jit *this,
+    int argc,
+    char **argv,
+    int *status
+);
+
+/// Release code and memory owned by unit.
+void tinyc_jit_free(struct tinyc_jit *this);
+
+#endif  // TINYC_JIT_H_
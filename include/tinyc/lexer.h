@@ -0,0 +1,94 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TINYC_LEXER_H_
+#define TINYC_LEXER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/splice.h"
+#include "tinyc/token.h"
+
+/// State of lexer at beginning of a line.
+enum tinyc_lexer_state {
+    TINYC_LEXER_NORMAL,
+    TINYC_LEXER_COMMENT,  // Inside of block comment.
+    TINYC_LEXER_SPLICED,  // Continuation of previous line.
+};
+
+/// Preprocessing tokens in a physical line. Tokens of logical line are held
+/// by its first physical line.
+struct tinyc_lexer_line {
+    enum tinyc_lexer_state state;  // State at beginning of this line.
+    size_t row;                    // Row spans of tokens currently have.
+    struct tinyc_token *tokens;    // NULL if no token in this line.
+};
+
+/// Lexer which splits source into preprocessing tokens, and keeps them for
+/// each line so that source can be edited without lexing whole of it again.
+///
+/// State at beginning of each line is a checkpoint. After an edit, lexing
+/// restarts at the first edited line and stops at the first following line
+/// whose state is unchanged, as the rest of tokens are the same as before.
+///
+/// Lines are spliced by backslash-newline before lexed. Tokens across
+/// splice have span over multiple rows.
+///
+/// Identifiers are not classified into keywords, and characters which can't
+/// start any token are skipped.
+struct tinyc_lexer {
+    struct tinyc_source *source;
+    struct tinyc_source_index index;
+    struct tinyc_splice splice;  // Logical line being lexed.
+    tinyc_repo_id id;
+    struct tinyc_lexer_line *lines;
+    size_t len, cap;
+    size_t relexed;  // Number of lines lexed by last init or edit.
+};
+
+/// Lex whole of source, whose tokens have id in their span.
+/// source must not be modified except by tinyc_lexer_edit while lexer lives.
+/// Returns false if failed.
+bool tinyc_lexer_init(
+    struct tinyc_lexer *this,
+    struct tinyc_source *source,
+    tinyc_repo_id id
+);
+
+/// Edit source as tinyc_source_edit, and lex changed lines.
+/// Returns false if failed.
+bool tinyc_lexer_edit(
+    struct tinyc_lexer *this,
+    size_t srow,
+    size_t soffset,
+    size_t erow,
+    size_t eoffset,
+    const char *text
+);
+
+/// Get tokens in row, or NULL if no token exists.
+/// Tokens are owned by lexer, and valid until next edit.
+const struct tinyc_token *tinyc_lexer_tokens(
+    struct tinyc_lexer *this,
+    size_t row
+);
+
+/// Release tokens owned by lexer. Source is left as is.
+void tinyc_lexer_free(struct tinyc_lexer *this);
+
+#endif  // TINYC_LEXER_H_
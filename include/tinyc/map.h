@@ -0,0 +1,60 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_MAP_H_
+#define TINYC_MAP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "tinyc/string.h"
+
+struct tinyc_map_entry {
+    bool used;
+    size_t hash;
+    struct tinyc_string key;
+    void *value;
+};
+
+/// Hash map from string to pointer.
+struct tinyc_map {
+    struct tinyc_map_entry *entries;  // Open addressing table.
+    size_t len, cap;
+};
+
+/// Initialize map.
+/// Returns false if initialization failed.
+bool tinyc_map_init(struct tinyc_map *this);
+
+/// Insert value with key, or overwrite value if key already exists.
+/// Key is copied into map.
+/// Returns false if failed to allocate memory.
+bool tinyc_map_insert(
+    struct tinyc_map *this,
+    const struct tinyc_string *key,
+    void *value
+);
+
+/// Try to get value associated with key.
+/// Returns false if no such key exists.
+bool tinyc_map_query(
+    const struct tinyc_map *this,
+    const struct tinyc_string *key,
+    void **value
+);
+
+/// Release memory owned by map. Values are left as is.
+void tinyc_map_free(struct tinyc_map *this);
+
+#endif  // TINYC_MAP_H_
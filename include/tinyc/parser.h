@@ -0,0 +1,41 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TINYC_PARSER_H_
+#define TINYC_PARSER_H_
+
+#include <stdbool.h>
+
+#include "tinyc/ast.h"
+#include "tinyc/lexer.h"
+#include "tinyc/span.h"
+
+/// Syntax error found by parser.
+struct tinyc_parse_error {
+    struct tinyc_span span;
+    const char *message;
+};
+
+/// Parse tokens in lexer as a translation unit, and set it to root of ast.
+/// Preprocessing directives are skipped as no macro is expanded yet, and
+/// identifiers spelled as keywords are treated as keywords.
+/// Returns false and set error if failed.
+bool tinyc_parse(
+    struct tinyc_ast *ast,
+    struct tinyc_lexer *lexer,
+    struct tinyc_parse_error *error
+);
+
+#endif  // TINYC_PARSER_H_
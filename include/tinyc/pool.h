@@ -0,0 +1,77 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_POOL_H_
+#define TINYC_POOL_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef void tinyc_pool_fn(void *arg);
+
+struct tinyc_pool_task {
+    tinyc_pool_fn *fn;
+    void *arg;
+};
+
+struct tinyc_pool;
+
+/// Worker thread and its own queue of tasks.
+struct tinyc_pool_worker {
+    struct tinyc_pool *pool;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    struct tinyc_pool_task *tasks;  // Ring buffer.
+    size_t head, len, cap;
+};
+
+/// Thread pool with work stealing.
+///
+/// Each worker takes tasks from back of its own queue, and steals from front
+/// of other queues when it becomes empty. Tasks submitted from a task are
+/// pushed to queue of running worker, so related work stays on one thread
+/// until others become idle.
+struct tinyc_pool {
+    struct tinyc_pool_worker *workers;
+    size_t nworkers;
+    size_t next;  // Worker receiving next task submitted from outside.
+    pthread_mutex_t lock;
+    pthread_cond_t wake;  // Signaled when task is submitted or stopping.
+    pthread_cond_t done;  // Signaled when pending becomes 0.
+    size_t pending;       // Number of submitted but not finished tasks.
+    size_t queued;        // Number of submitted but not started tasks.
+    size_t sleeping;      // Number of workers waiting for wake.
+    bool stop;
+};
+
+/// Get number of online processors, or 1 if unknown.
+size_t tinyc_pool_ncpus(void);
+
+/// Initialize pool and start nthreads workers.
+/// Returns false if initialization failed.
+bool tinyc_pool_init(struct tinyc_pool *this, size_t nthreads);
+
+/// Submit task which calls fn with arg.
+/// Returns false if failed to allocate memory.
+bool tinyc_pool_submit(struct tinyc_pool *this, tinyc_pool_fn *fn, void *arg);
+
+/// Wait until all submitted tasks, including ones submitted by them, finish.
+/// Must not be called from a task.
+void tinyc_pool_wait(struct tinyc_pool *this);
+
+/// Run queued tasks, then stop workers and release memory owned by pool.
+void tinyc_pool_free(struct tinyc_pool *this);
+
+#endif  // TINYC_POOL_H_
@@ -0,0 +1,125 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_PP_EXPR_H_
+#define TINYC_PP_EXPR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tinyc/span.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+/// Value of #if expression.
+///
+/// Every signed integer acts as intmax_t and every unsigned integer acts as
+/// uintmax_t (C99 6.10.1p4), so only signedness need to be tracked.
+struct tinyc_pp_value {
+    bool is_unsigned;
+    uintmax_t value;  // Two's complement bits if signed.
+};
+
+enum tinyc_pp_expr_status {
+    TINYC_PP_EXPR_OK,
+    TINYC_PP_EXPR_ERROR,   // Invalid expression. See error for its reason.
+    TINYC_PP_EXPR_EXPAND,  // Some macro must be expanded as tokens first.
+};
+
+enum tinyc_pp_macro_kind {
+    TINYC_PP_MACRO_UNDEFINED,  // Not a macro.
+    TINYC_PP_MACRO_VALUE,      // Macro which expands to a single value.
+    TINYC_PP_MACRO_COMPLEX,    // Macro which can't be treated as a value.
+};
+
+/// Query macro table for name.
+/// If value is non-NULL and name is macro expands to a value, set it.
+typedef enum tinyc_pp_macro_kind (*tinyc_pp_expr_lookup)(
+    void *ctx,
+    const struct tinyc_string *name,
+    struct tinyc_pp_value *value
+);
+
+struct tinyc_pp_expr_op;
+
+/// #if expression compiled into postfix form.
+///
+/// Identifiers are kept by name and resolved through tinyc_pp_expr_lookup at
+/// every evaluation, so one compiled expression can be evaluated repeatedly
+/// while macro table changes.
+struct tinyc_pp_expr {
+    struct tinyc_pp_expr_op *ops;
+    size_t len, cap;
+    size_t depth;  // Stack depth required to evaluate.
+    enum tinyc_pp_expr_status status;
+    struct tinyc_span span;  // Span of whole expression.
+    const char *error;       // Reason of failure, or NULL.
+};
+
+/// Compile tokens from first to last (inclusive) into this. If first or last
+/// is NULL, expression is empty and fails to compile.
+/// Returns TINYC_PP_EXPR_EXPAND if function-like macro invocation may exist.
+enum tinyc_pp_expr_status tinyc_pp_expr_compile(
+    struct tinyc_pp_expr *this,
+    const struct tinyc_token *first,
+    const struct tinyc_token *last
+);
+
+/// Evaluate compiled expression, set its value to result.
+/// Returns TINYC_PP_EXPR_EXPAND if lookup returns TINYC_PP_MACRO_COMPLEX.
+/// If evaluation failed, set its reason to error.
+enum tinyc_pp_expr_status tinyc_pp_expr_eval(
+    const struct tinyc_pp_expr *this,
+    tinyc_pp_expr_lookup lookup,
+    void *ctx,
+    struct tinyc_pp_value *result,
+    const char **error
+);
+
+/// Release memory owned by compiled expression.
+void tinyc_pp_expr_free(struct tinyc_pp_expr *this);
+
+struct tinyc_pp_expr_cache_entry {
+    bool used;
+    tinyc_repo_id id;
+    struct tinyc_position position;
+    struct tinyc_pp_expr expr;
+};
+
+/// Compiled #if expressions keyed by location of its directive.
+struct tinyc_pp_expr_cache {
+    struct tinyc_pp_expr_cache_entry *entries;  // Open addressing table.
+    size_t len, cap;
+};
+
+/// Initialize cache.
+/// Returns false if initialization failed.
+bool tinyc_pp_expr_cache_init(struct tinyc_pp_expr_cache *this);
+
+/// Get compiled expression of directive started at span.
+/// Tokens from first to last is compiled only if no cached one exists.
+/// Returns NULL if failed to allocate memory.
+/// Returned expression is valid until next call of this function.
+const struct tinyc_pp_expr *tinyc_pp_expr_cache_get(
+    struct tinyc_pp_expr_cache *this,
+    const struct tinyc_span *directive,
+    const struct tinyc_token *first,
+    const struct tinyc_token *last
+);
+
+/// Release memory owned by cache and its expressions.
+void tinyc_pp_expr_cache_free(struct tinyc_pp_expr_cache *this);
+
+#endif  // TINYC_PP_EXPR_H_
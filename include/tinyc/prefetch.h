@@ -0,0 +1,98 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_PREFETCH_H_
+#define TINYC_PREFETCH_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "tinyc/header_search.h"
+#include "tinyc/map.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+
+struct tinyc_prefetch_entry;
+
+/// Load headers in background before preprocessor reaches its #include.
+///
+/// Sources are scanned for #include lines, and found headers are resolved and
+/// loaded by worker threads. Loaded headers are scanned too, so whole include
+/// tree is loaded ahead. Only tinyc_prefetch_take touches repository, so
+/// repository needs no locking.
+struct tinyc_prefetch {
+    struct tinyc_header_search *search;  // Guarded by lock.
+    pthread_t *threads;
+    size_t nthreads;
+    pthread_mutex_t lock;
+    pthread_cond_t queued;  // Signaled when entry is queued or stopping.
+    pthread_cond_t loaded;  // Signaled when entry is loaded or failed.
+    struct tinyc_map entries;  // Resolved path -> entry.
+    struct tinyc_prefetch_entry *head, *tail;  // Queue of entries to load.
+    bool stop;
+};
+
+/// Initialize prefetcher and start nthreads worker threads.
+/// Returns false if initialization failed.
+bool tinyc_prefetch_init(
+    struct tinyc_prefetch *this,
+    struct tinyc_header_search *search,
+    size_t nthreads
+);
+
+/// Queue headers included from source. base is directory of source.
+/// Returns false if failed to allocate memory.
+bool tinyc_prefetch_scan(
+    struct tinyc_prefetch *this,
+    const struct tinyc_source *source,
+    const char *base
+);
+
+/// Resolve header and register it into repository, waiting for it if it's
+/// still loading. If it's not queued, it's loaded on this thread.
+/// Arguments are same as tinyc_header_search_resolve, which must not be called
+/// directly while prefetcher is alive. Same id is returned for same header.
+/// Returns negative value if no such header exists or failed to load it.
+tinyc_repo_id tinyc_prefetch_take(
+    struct tinyc_prefetch *this,
+    const char *base,
+    bool is_std,
+    const struct tinyc_string *path,
+    struct tinyc_repo *repo
+);
+
+/// Take source of header at resolved path, waiting for it if it's still
+/// loading. Source is moved to caller, and mtime and size are set to those
+/// of file when it was read. Each header is taken at most once.
+/// Returns false if path wasn't queued, failed to load, or was already taken.
+bool tinyc_prefetch_take_source(
+    struct tinyc_prefetch *this,
+    const char *path,
+    struct tinyc_source *source,
+    struct timespec *mtime,
+    long long *size
+);
+
+/// Revalidate header search used by prefetcher.
+/// Returns false if failed to allocate memory.
+bool tinyc_prefetch_revalidate(struct tinyc_prefetch *this);
+
+/// Stop worker threads and release memory owned by prefetcher.
+/// Sources registered into repository are left as is.
+void tinyc_prefetch_free(struct tinyc_prefetch *this);
+
+#endif  // TINYC_PREFETCH_H_
@@ -0,0 +1,69 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_PRINTER_H_
+#define TINYC_PRINTER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "tinyc/repo.h"
+#include "tinyc/span.h"
+#include "tinyc/token.h"
+
+#define TINYC_PRINTER_BUFSIZE (64 * 1024)
+
+/// Write tokens as preprocessed output, like `cc -E`.
+///
+/// Tokens are placed on the line they came from. Line markers such as
+/// `# 10 "file.c"` are emitted when source changes or many lines are skipped.
+/// Between tokens on same line, at most one space is inserted.
+struct tinyc_printer {
+    FILE *fs;
+    const struct tinyc_repo *repo;
+    tinyc_repo_id id;  // Source of current output line, or -1.
+    size_t row;        // Row of current output line.
+
+    // Last token on current output line.
+    bool has_prev;
+    enum tinyc_token_kind prev_kind;
+    enum tinyc_token_punct_kind prev_punct;  // Valid if prev_kind is punct.
+    char prev_last;                          // Last character of its spelling.
+    struct tinyc_position prev_end;
+
+    size_t len;  // Number of bytes in buf.
+    char buf[TINYC_PRINTER_BUFSIZE];
+};
+
+/// Initialize printer which writes to fs.
+/// Returns false if initialization failed.
+bool tinyc_printer_init(
+    struct tinyc_printer *this,
+    FILE *fs,
+    const struct tinyc_repo *repo
+);
+
+/// Print a token.
+/// Returns false if token can't be printed or failed to write.
+bool tinyc_printer_print(
+    struct tinyc_printer *this,
+    const struct tinyc_token *token
+);
+
+/// Terminate last line and write buffered output to file stream.
+/// Returns false if failed to write.
+bool tinyc_printer_finish(struct tinyc_printer *this);
+
+#endif  // TINYC_PRINTER_H_
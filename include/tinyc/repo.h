@@ -50,4 +50,16 @@ const struct tinyc_source *tinyc_repo_query(
     tinyc_repo_id id
 );
 
+/// Remove source of id from repository, and move it into source so caller
+/// can release it. Id of removed source is never reused.
+/// Returns false if no such source exists.
+bool tinyc_repo_remove(
+    struct tinyc_repo *this,
+    tinyc_repo_id id,
+    struct tinyc_source *source
+);
+
+/// Release entries of repository. Registered sources are left as is.
+void tinyc_repo_free(struct tinyc_repo *this);
+
 #endif  // TINYC_REPO_H_
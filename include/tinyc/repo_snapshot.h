@@ -0,0 +1,57 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_REPO_SNAPSHOT_H_
+#define TINYC_REPO_SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+
+/// Version of snapshot file format. Increase this when format changes.
+#define TINYC_REPO_SNAPSHOT_VERSION 1
+
+/// Sources of repository saved after processing a common prefix, so another
+/// compilation can start from them without reading the files again.
+///
+/// Sources are restored with same ids, and their lines are static strings
+/// pointing into mapped file. Snapshot files are written in native byte
+/// order for the machine using it.
+struct tinyc_repo_snapshot {
+    void *map;    // Mapped snapshot file, or NULL.
+    size_t size;  // Size of map.
+    struct tinyc_source_line **lines;  // Lines of each restored source.
+    size_t nsources;
+};
+
+/// Save all sources in repo into path. File is replaced atomically.
+/// Returns false if failed to write.
+bool tinyc_repo_snapshot_save(const struct tinyc_repo *repo, const char *path);
+
+/// Map snapshot file at path and register its sources into repo, which must
+/// be empty. Registered sources are owned by snapshot, so they must not be
+/// freed by tinyc_source_free, nor used after snapshot is freed.
+/// Returns false if file doesn't exist, is broken or has other version.
+bool tinyc_repo_snapshot_load(
+    struct tinyc_repo_snapshot *this,
+    const char *path,
+    struct tinyc_repo *repo
+);
+
+/// Release sources restored from snapshot and unmap it.
+void tinyc_repo_snapshot_free(struct tinyc_repo_snapshot *this);
+
+#endif  // TINYC_REPO_SNAPSHOT_H_
@@ -0,0 +1,171 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_SESSION_H_
+#define TINYC_SESSION_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "tinyc/diag_json.h"
+#include "tinyc/header_search.h"
+#include "tinyc/map.h"
+#include "tinyc/prefetch.h"
+#include "tinyc/repo.h"
+#include "tinyc/span.h"
+
+/// Cost of a file accumulated over compilations in session.
+struct tinyc_session_cost {
+    size_t includes;        // Number of times included or compiled.
+    size_t lines;           // Number of lines of current content.
+    size_t tokens;          // Number of tokens in current content.
+    bool counted;           // True once lines and tokens are counted.
+    uint64_t inclusive_ns;  // Time spent on file and headers it includes.
+    uint64_t exclusive_ns;  // Time spent on file itself.
+};
+
+/// File loaded into repository of session.
+struct tinyc_session_file {
+    tinyc_repo_id id;  // Negative until first loaded.
+    struct timespec mtime;
+    long long size;
+    uint64_t key;  // Hash of content.
+    bool loading;  // True while a thread is reading it.
+    bool utf8;     // True if content is encoded in UTF-8.
+    struct tinyc_position invalid;  // First invalid byte unless utf8.
+    struct tinyc_session_cost cost;
+};
+
+/// Sources and header lookups kept across compilations.
+///
+/// A file is loaded again only if its modification time or size changed,
+/// and even then its old source is reused if content is same. Header lookups
+/// are dropped when any searched directory is modified. Changed files are
+/// registered as new sources, and old ones are released once no compilation
+/// is running, as diagnostics of running compilations may refer to them.
+///
+/// Session can be shared by threads compiling different files. Each file is
+/// read by only one thread even if many threads request it at once.
+///
+/// If prefetching is enabled, headers included from each loaded source are
+/// read ahead by prefetcher, which has its own header search so it never
+/// waits for lock of session.
+///
+/// Session always allocates from allocator set by tinyc_allocator_set, not
+/// from one scoped to calling thread, so it can be kept across requests
+/// served from per-request arenas.
+struct tinyc_session {
+    pthread_mutex_t lock;   // Guards all members below, except prefetcher.
+    pthread_cond_t ready;   // Signaled when file finished loading.
+    struct tinyc_repo repo;
+    struct tinyc_header_search search;
+    struct tinyc_map files;  // Path -> struct tinyc_session_file.
+    size_t loaded;           // Number of files read from disk.
+    size_t reused;           // Number of files reused without reading.
+    size_t prefetched;       // Number of loaded files read by prefetcher.
+    bool prefetching;        // True if prefetcher is started.
+    struct tinyc_header_search prefetch_search;  // Used only by prefetcher.
+    struct tinyc_prefetch prefetch;
+    struct tinyc_diag_json *json;  // Sink of diagnostics if not NULL.
+    const char *token_cache;       // Directory of token cache, or NULL.
+    size_t active;                 // Number of running compilations.
+    tinyc_repo_id *stale;          // Sources superseded while compiling.
+    size_t stale_len, stale_cap;
+};
+
+/// Initialize session without any search directory.
+/// Returns false if initialization failed.
+bool tinyc_session_init(struct tinyc_session *this);
+
+/// Append search directory for headers.
+/// Returns false if failed to allocate memory.
+bool tinyc_session_add_dir(struct tinyc_session *this, const char *dir);
+
+/// Start nthreads threads which read headers ahead. Search directories must
+/// be added before this.
+/// Returns false if failed to start threads.
+bool tinyc_session_prefetch(struct tinyc_session *this, size_t nthreads);
+
+/// Get source of file at path, loading it if not yet or changed. Once file
+/// changed, source of previous id is released unless compilation is running.
+/// Returns negative value if file can't be read.
+/// While other threads use session, repository must be queried under lock.
+tinyc_repo_id tinyc_session_load(struct tinyc_session *this, const char *path);
+
+/// Compile file at path and write diagnostics to out. Currently this loads
+/// and lexes the file and all headers it includes, and reports missing
+/// headers.
+/// Returns false if any error is reported.
+bool tinyc_session_compile(
+    struct tinyc_session *this,
+    const char *path,
+    FILE *out
+);
+
+/// Compile n files at paths on nthreads threads, or as many threads as
+/// processors if nthreads is 0. Diagnostics are written to out in order of
+/// paths, regardless of which thread compiles which file. Diagnostics of a
+/// file are written in order they're emitted. If json of session is set,
+/// diagnostics are written into it instead, and only unreadable files are
+/// reported to out.
+/// Returns false if any error is reported.
+bool tinyc_session_compile_all(
+    struct tinyc_session *this,
+    char *const *paths,
+    size_t n,
+    size_t nthreads,
+    FILE *out
+);
+
+/// Compile file at path into memory, and run its main with argc arguments
+/// in argv. Diagnostics are written to out, and value main returned is set
+/// to status. Headers are not included, as no macro is expanded yet.
+/// Returns false if any error is reported.
+bool tinyc_session_run(
+    struct tinyc_session *this,
+    const char *path,
+    int argc,
+    char **argv,
+    FILE *out,
+    int *status
+);
+
+/// Write files which cost the most time so far, at most limit files, into
+/// out as a table sorted by inclusive time. Lines and tokens are counted
+/// here only for listed files, so loading files doesn't lex them twice.
+/// If token_cache of session is set, tokens are loaded from cache instead
+/// of lexing file, and files lexed here are saved into it.
+/// Returns false if failed to allocate memory.
+bool tinyc_session_report(
+    struct tinyc_session *this,
+    size_t limit,
+    FILE *out
+);
+
+/// Listen on unix domain socket at path and compile requested files until
+/// shutdown is requested. Each connection sends a line of "compile <path>"
+/// or "shutdown", and receives diagnostics followed by a line of "ok" or
+/// "error". SIGPIPE should be ignored by caller. Existing file at path is
+/// only replaced if it's a socket no server listens on.
+/// Returns false if failed to listen.
+bool tinyc_session_serve(struct tinyc_session *this, const char *path);
+
+/// Release memory owned by session, including all sources.
+void tinyc_session_free(struct tinyc_session *this);
+
+#endif  // TINYC_SESSION_H_
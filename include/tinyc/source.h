@@ -15,6 +15,7 @@
 #ifndef TINYC_SOURCE_H_
 #define TINYC_SOURCE_H_
 
+#include <stddef.h>
 #include <stdio.h>
 
 #include "tinyc/string.h"
@@ -32,6 +33,7 @@ struct tinyc_source_line {
 struct tinyc_source {
     struct tinyc_string name;
     struct tinyc_source_line *lines;  // NULL if no line exists.
+    bool utf8;                        // True if known to be encoded in UTF-8.
 };
 
 /// Construct source from string.
@@ -50,6 +52,9 @@ bool tinyc_source_from_fs(
     FILE *fp
 );
 
+/// Release memory owned by source.
+void tinyc_source_free(struct tinyc_source *this);
+
 /// Get n-th line of this source.
 /// Returns NULL if n exceed number of lines.
 const struct tinyc_source_line *tinyc_source_at(
@@ -57,4 +62,47 @@ const struct tinyc_source_line *tinyc_source_at(
     size_t n
 );
 
+/// Check whether source is encoded in UTF-8. Lines are scanned only if it's
+/// not known yet, as source is validated while loaded.
+/// Returns false and set position of first invalid byte to row and offset if
+/// not.
+bool tinyc_source_validate(
+    const struct tinyc_source *this,
+    size_t *row,
+    size_t *offset
+);
+
+/// Array of lines in source for random access.
+struct tinyc_source_index {
+    struct tinyc_source_line **lines;
+    size_t len, cap;
+};
+
+/// Create index of lines in source.
+/// Returns false if failed.
+bool tinyc_source_index_init(
+    struct tinyc_source_index *this,
+    const struct tinyc_source *source
+);
+
+/// Release memory owned by index.
+void tinyc_source_index_free(struct tinyc_source_index *this);
+
+/// Replace text from (srow, soffset) until (erow, eoffset), exclusive, with
+/// text which may contain '\n'. Only lines from srow to erow are rewritten,
+/// and index is updated to match if non-null.
+/// Empty source is treated as it has an empty line.
+/// Set number of lines now placed from srow to nlines.
+/// Returns false if range is out of source or failed to allocate.
+bool tinyc_source_edit(
+    struct tinyc_source *this,
+    struct tinyc_source_index *index,
+    size_t srow,
+    size_t soffset,
+    size_t erow,
+    size_t eoffset,
+    const char *text,
+    size_t *nlines
+);
+
 #endif  // TINYC_SOURCE_H_
@@ -0,0 +1,70 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TINYC_SPLICE_H_
+#define TINYC_SPLICE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "tinyc/source.h"
+#include "tinyc/span.h"
+#include "tinyc/string.h"
+
+/// Point where a physical line is spliced into logical line.
+struct tinyc_splice_point {
+    size_t offset;  // Logical offset where the physical line begins.
+    size_t row;     // Row of the physical line.
+};
+
+/// Logical line, which is physical lines joined by backslash-newline, with
+/// carriage return before newline dropped.
+///
+/// Most lines contain neither of them, and then the physical line is used
+/// as is. Otherwise lines are joined into buffer, and points where each
+/// following physical line begins are kept to map positions back.
+struct tinyc_splice {
+    const char *cstr;  // Content of logical line, terminated by '\0'.
+    size_t len;
+    size_t row;                         // Row of first physical line.
+    size_t nrows;                       // Number of physical lines.
+    struct tinyc_string buf;            // Holds joined lines if needed.
+    struct tinyc_splice_point *points;  // Lines after first, by offset.
+    size_t npoints, cap;
+};
+
+/// Initialize splice without any line.
+void tinyc_splice_init(struct tinyc_splice *this);
+
+/// Set logical line beginning at row of n lines. Memory of previous logical
+/// line is reused.
+/// Returns false if failed to allocate memory.
+bool tinyc_splice_build(
+    struct tinyc_splice *this,
+    struct tinyc_source_line *const *lines,
+    size_t n,
+    size_t row
+);
+
+/// Get physical position of character at offset in logical line.
+struct tinyc_position tinyc_splice_position(
+    const struct tinyc_splice *this,
+    size_t offset
+);
+
+/// Release memory owned by splice.
+void tinyc_splice_free(struct tinyc_splice *this);
+
+#endif  // TINYC_SPLICE_H_
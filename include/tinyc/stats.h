@@ -0,0 +1,81 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TINYC_STATS_H_
+#define TINYC_STATS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/// Part of library which memory is allocated for.
+enum tinyc_stats_subsystem {
+    TINYC_STATS_STRING,
+    TINYC_STATS_SOURCE,
+    TINYC_STATS_REPO,
+    TINYC_STATS_TOKEN,
+    TINYC_STATS_DIAG,
+    TINYC_STATS_AST,
+    TINYC_STATS_OTHER,
+    TINYC_STATS_COUNT,  // Number of subsystems.
+};
+
+/// Allocation statistics of a subsystem.
+struct tinyc_stats_counter {
+    size_t allocs;         // Number of allocations, including realloc(NULL).
+    size_t reallocs;       // Number of resizes.
+    size_t frees;          // Number of releases.
+    size_t live_bytes;     // Bytes allocated and not yet released.
+    size_t peak_bytes;     // Maximum of live_bytes.
+    size_t realloc_bytes;  // Sum of sizes requested by resizes.
+};
+
+/// Allocation statistics of whole library.
+///
+/// Statistics are collected only if library is built with TINYC_STATS;
+/// otherwise allocations are not instrumented at all.
+struct tinyc_stats {
+    struct tinyc_stats_counter subsystems[TINYC_STATS_COUNT];
+    size_t peak_bytes;  // Maximum of total live bytes.
+};
+
+/// Get name of subsystem, e.g. "string" for TINYC_STATS_STRING.
+const char *tinyc_stats_subsystem_name(enum tinyc_stats_subsystem subsystem);
+
+/// Get current statistics.
+/// Returns false if library is built without TINYC_STATS.
+bool tinyc_stats_query(struct tinyc_stats *res);
+
+/// Reset counters except live bytes, and set peak to current live bytes.
+void tinyc_stats_reset(void);
+
+/// Print current statistics as a table into fs.
+/// Returns false if library is built without TINYC_STATS.
+bool tinyc_stats_dump(FILE *fs);
+
+/// Record allocation of size bytes for subsystem.
+void tinyc_stats_alloc(enum tinyc_stats_subsystem subsystem, size_t size);
+
+/// Record resize of an allocation for subsystem from old_size to size.
+void tinyc_stats_realloc(
+    enum tinyc_stats_subsystem subsystem,
+    size_t old_size,
+    size_t size
+);
+
+/// Record release of size bytes for subsystem.
+void tinyc_stats_free(enum tinyc_stats_subsystem subsystem, size_t size);
+
+#endif  // TINYC_STATS_H_
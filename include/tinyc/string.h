@@ -38,10 +38,21 @@ bool tinyc_string_from(struct tinyc_string *this, char *from);
 /// Returns false if initialization failed.
 bool tinyc_string_from_copy(struct tinyc_string *this, const char *from);
 
+/// Release memory owned by string. Static string is left as is.
+void tinyc_string_free(struct tinyc_string *this);
+
 /// Push character to string.
 /// Returns false if operation failed.
 bool tinyc_string_push(struct tinyc_string *this, char c);
 
+/// Append n characters of s to string.
+/// Returns false if operation failed.
+bool tinyc_string_append(struct tinyc_string *this, const char *s, size_t n);
+
+/// Append n copies of c to string.
+/// Returns false if operation failed.
+bool tinyc_string_fill(struct tinyc_string *this, char c, size_t n);
+
 /// Compare two string. Semantics is same as strcmp.
 /// Use strcmp unless string may contains null character until its terminate.
 int tinyc_string_cmp(
@@ -49,4 +60,7 @@ int tinyc_string_cmp(
     const struct tinyc_string *s2
 );
 
+/// Calculate hash value of string.
+size_t tinyc_string_hash(const struct tinyc_string *this);
+
 #endif  // TINYC_STRING_H_
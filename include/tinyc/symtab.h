@@ -0,0 +1,103 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TINYC_SYMTAB_H_
+#define TINYC_SYMTAB_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tinyc/string.h"
+
+/// Name spaces of identifiers. Labels have function scope, so they should be
+/// kept in another table whose only scope is the function.
+enum tinyc_symtab_ns {
+    TINYC_SYMTAB_ORDINARY,  // Objects, functions, typedefs and enumerators.
+    TINYC_SYMTAB_TAG,       // Tags of struct, union and enum.
+    TINYC_SYMTAB_LABEL,
+};
+
+/// Identifier in a name space, which is never removed from table.
+struct tinyc_symtab_key {
+    size_t hash;
+    uint32_t name;  // Offset of identifier in names.
+    uint32_t len;
+    enum tinyc_symtab_ns ns;
+    uint32_t top;  // Index of innermost binding plus one, or 0 if unbound.
+};
+
+/// Binding of key in a scope.
+struct tinyc_symtab_symbol {
+    uint32_t key;
+    uint32_t shadowed;  // Index of binding it shadows plus one, or 0.
+    size_t depth;       // Depth of scope declared in.
+    void *value;
+};
+
+/// Table of identifiers in nested scopes.
+///
+/// Keys are interned in one open addressing table, and each key points to
+/// its innermost binding, which points to the one it shadows. Bindings are
+/// pushed in order of declaration, so leaving scope just unwinds bindings
+/// declared in it. Entering and leaving scope cost the number of symbols
+/// declared in it, regardless of how deep it is.
+struct tinyc_symtab {
+    uint32_t *slots;  // Index of key plus one, or 0 if empty.
+    size_t cap;
+    struct tinyc_symtab_key *keys;
+    size_t nkeys, keys_cap;
+    struct tinyc_string names;
+    struct tinyc_symtab_symbol *symbols;  // Bindings in declaration order.
+    size_t len, symbols_cap;
+    size_t *scopes;  // Number of bindings when each open scope began.
+    size_t depth, scopes_cap;
+};
+
+/// Initialize table with file scope, which is depth 0.
+/// Returns false if initialization failed.
+bool tinyc_symtab_init(struct tinyc_symtab *this);
+
+/// Enter new innermost scope.
+/// Returns false if failed to allocate memory.
+bool tinyc_symtab_push(struct tinyc_symtab *this);
+
+/// Leave innermost scope, and drop bindings declared in it. File scope is
+/// never left.
+void tinyc_symtab_pop(struct tinyc_symtab *this);
+
+/// Bind name to value in innermost scope, or overwrite value if name is
+/// already bound in it.
+/// Returns false if failed to allocate memory.
+bool tinyc_symtab_declare(
+    struct tinyc_symtab *this,
+    enum tinyc_symtab_ns ns,
+    const struct tinyc_string *name,
+    void *value
+);
+
+/// Get innermost binding of name visible from current scope, which is valid
+/// until table is modified.
+/// Returns NULL if name is not bound.
+const struct tinyc_symtab_symbol *tinyc_symtab_lookup(
+    const struct tinyc_symtab *this,
+    enum tinyc_symtab_ns ns,
+    const struct tinyc_string *name
+);
+
+/// Release memory owned by table. Values are left as is.
+void tinyc_symtab_free(struct tinyc_symtab *this);
+
+#endif  // TINYC_SYMTAB_H_
@@ -23,6 +23,7 @@ enum tinyc_token_kind {
     TINYC_TOKEN_IDENT,
     TINYC_TOKEN_KEYWORD,
     TINYC_TOKEN_STRING,
+    TINYC_TOKEN_CHAR,
     TINYC_TOKEN_INT,
     TINYC_TOKEN_FLOAT,
 
@@ -150,7 +151,12 @@ struct tinyc_token_keyword {
 
 struct tinyc_token_string {
     struct tinyc_token token;
-    struct tinyc_string value;
+    struct tinyc_string value;  // Characters inside "", escapes kept as is.
+};
+
+struct tinyc_token_char {
+    struct tinyc_token token;
+    struct tinyc_string value;  // Characters inside '', escapes kept as is.
 };
 
 struct tinyc_token_int_value {
@@ -182,6 +188,12 @@ struct tinyc_token_header {
     struct tinyc_string path;  // Path inside <> or "".
 };
 
+/// Get spelling of punctuation, e.g. "->" for TINYC_TOKEN_PUNCT_ARROW.
+const char *tinyc_token_punct_spelling(enum tinyc_token_punct_kind kind);
+
+/// Get spelling of keyword, e.g. "int" for TINYC_TOKEN_KEYWORD_INT.
+const char *tinyc_token_keyword_spelling(enum tinyc_token_keyword_kind kind);
+
 /// Insert tokens after it, returns first token in tokens.
 struct tinyc_token *tinyc_token_insert(
     struct tinyc_token *it,
@@ -219,6 +231,12 @@ struct tinyc_token *tinyc_token_create_string(
     const struct tinyc_string *value
 );
 
+/// Create a character constant token, returns pointer to token.
+struct tinyc_token *tinyc_token_create_char(
+    const struct tinyc_span *span,
+    const struct tinyc_string *value
+);
+
 /// Create a integer token, returns pointer to token.
 struct tinyc_token *tinyc_token_create_int(
     const struct tinyc_span *span,
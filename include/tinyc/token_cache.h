@@ -0,0 +1,101 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TINYC_TOKEN_CACHE_H_
+#define TINYC_TOKEN_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tinyc/lexer.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+/// Version of cache file format. Increase this when format or token kinds
+/// change, so older cache files are never loaded.
+#define TINYC_TOKEN_CACHE_VERSION 2
+
+/// Token stream of a source saved on disk.
+///
+/// A cache file consists of a header, fixed size token records and a string
+/// table. Spans are stored without repository id, and strings are terminated
+/// with '\0' so loaded tokens point into mapped file instead of copying.
+/// All loaded tokens are placed in a single block owned by cache. Cache files
+/// are written in native byte order for the machine using it.
+///
+/// Cache is for a consumer reading whole file once instead of lexing it.
+/// Lexer itself keeps tokens for each line with its state to lex edits
+/// again, so a flat stream can't replace them. Session counts tokens for
+/// its report from cache.
+struct tinyc_token_cache {
+    void *map;     // Mapped cache file, or NULL.
+    size_t size;   // Size of map.
+    void *tokens;  // Block holding loaded tokens, or NULL.
+};
+
+/// Calculate key of source from its content and cache version.
+uint64_t tinyc_token_cache_key(const struct tinyc_source *source);
+
+/// Create path of cache file for key in dir.
+/// Returns false if failed to allocate memory.
+bool tinyc_token_cache_path(
+    struct tinyc_string *res,
+    const char *dir,
+    uint64_t key
+);
+
+/// Save tokens from first to last into path, keyed by key. tokens may be
+/// NULL if there is no token. File is replaced atomically.
+/// Returns false if failed to write, or any span doesn't fit in the format.
+bool tinyc_token_cache_save(
+    const char *path,
+    uint64_t key,
+    const struct tinyc_token *first,
+    const struct tinyc_token *last
+);
+
+/// Save tokens of all rows of lexer into path, keyed by key, in order.
+/// File is replaced atomically.
+/// Returns false if failed to write, or any span doesn't fit in the format.
+bool tinyc_token_cache_save_lexer(
+    const char *path,
+    uint64_t key,
+    struct tinyc_lexer *lexer
+);
+
+/// Map cache file at path and create tokens from it, whose span has id.
+/// Set list of tokens to tokens, or NULL if there is no token.
+/// Tokens are owned by cache and string values in them point into the
+/// mapping, so they must not be freed nor used after cache is freed.
+/// Returns false if file doesn't exist, is broken, or has other key.
+bool tinyc_token_cache_load(
+    struct tinyc_token_cache *this,
+    const char *path,
+    uint64_t key,
+    tinyc_repo_id id,
+    struct tinyc_token **tokens
+);
+
+/// Unmap cache file and release loaded tokens.
+void tinyc_token_cache_free(struct tinyc_token_cache *this);
+
+/// Remove least recently used cache files in dir until their total size
+/// becomes at most max_size. Loading a cache file marks it as used.
+/// Returns false if dir can't be read.
+bool tinyc_token_cache_evict(const char *dir, size_t max_size);
+
+#endif  // TINYC_TOKEN_CACHE_H_
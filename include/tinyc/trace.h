@@ -0,0 +1,45 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TINYC_TRACE_H_
+#define TINYC_TRACE_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/// Start recording begin and end events of phases. Events are buffered per
+/// thread, so threads don't contend while recording.
+/// Returns false if already started.
+bool tinyc_trace_start(void);
+
+/// Returns true if events are being recorded.
+bool tinyc_trace_enabled(void);
+
+/// Record beginning of phase name on this thread. name must be a static
+/// string, and detail, e.g. file name, is copied if non-null.
+/// Does nothing if tracing is not started.
+void tinyc_trace_begin(const char *name, const char *detail);
+
+/// Record end of innermost phase on this thread.
+/// Does nothing if tracing is not started.
+void tinyc_trace_end(void);
+
+/// Stop recording, and write recorded events into fs in Chrome trace event
+/// format, which chrome://tracing and Perfetto can open. Recorded events are
+/// discarded. Other threads must not record events while writing.
+/// Returns false if tracing is not started or failed to write.
+bool tinyc_trace_finish(FILE *fs);
+
+#endif  // TINYC_TRACE_H_
@@ -0,0 +1,167 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TINYC_TYPE_H_
+#define TINYC_TYPE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tinyc/string.h"
+
+enum tinyc_type_kind {
+    TINYC_TYPE_VOID,
+    TINYC_TYPE_BOOL,
+    TINYC_TYPE_CHAR,
+    TINYC_TYPE_SCHAR,
+    TINYC_TYPE_UCHAR,
+    TINYC_TYPE_SHORT,
+    TINYC_TYPE_USHORT,
+    TINYC_TYPE_INT,
+    TINYC_TYPE_UINT,
+    TINYC_TYPE_LONG,
+    TINYC_TYPE_ULONG,
+    TINYC_TYPE_LLONG,
+    TINYC_TYPE_ULLONG,
+    TINYC_TYPE_FLOAT,
+    TINYC_TYPE_DOUBLE,
+    TINYC_TYPE_LDOUBLE,
+    TINYC_TYPE_POINTER,
+    TINYC_TYPE_ARRAY,
+    TINYC_TYPE_FUNCTION,
+    TINYC_TYPE_STRUCT,
+    TINYC_TYPE_UNION,
+    TINYC_TYPE_ENUM,
+};
+
+// Qualifiers of type.
+#define TINYC_TYPE_CONST    (1u << 0)
+#define TINYC_TYPE_VOLATILE (1u << 1)
+#define TINYC_TYPE_RESTRICT (1u << 2)
+#define TINYC_TYPE_QUALS \
+    (TINYC_TYPE_CONST | TINYC_TYPE_VOLATILE | TINYC_TYPE_RESTRICT)
+
+// Flags of function type.
+#define TINYC_TYPE_PROTOTYPE (1u << 3)
+#define TINYC_TYPE_VARIADIC  (1u << 4)
+
+// Length of array whose size is unknown.
+#define TINYC_TYPE_UNKNOWN_LEN SIZE_MAX
+
+/// Interned type. Each distinct type exists only once in a universe, so two
+/// types are the same if and only if they're the same pointer.
+struct tinyc_type {
+    enum tinyc_type_kind kind;
+    uint32_t flags;                   // Qualifiers and flags of function.
+    size_t hash;
+    const struct tinyc_type *unqual;  // Itself if it has no qualifier.
+    const struct tinyc_type *base;    // Pointee, element or return type.
+    size_t len;                       // Length of array or parameters.
+    const struct tinyc_type *const *params;
+};
+
+struct tinyc_type_chunk;
+
+/// Composite type of pair of types, or NULL if they're incompatible.
+struct tinyc_type_composite {
+    const struct tinyc_type *a, *b;  // a is NULL if entry is empty.
+    const struct tinyc_type *res;
+};
+
+/// Types of a compilation, allocated in an arena and released at once.
+///
+/// Derived types are looked up by their kind, qualifiers and the interned
+/// types they're made from, so building a type which already exists costs
+/// one hash lookup and no memory. Struct, union and enum are distinct for
+/// each declaration. Composite types are cached for each pair.
+struct tinyc_types {
+    struct tinyc_type_chunk *chunks;
+    struct tinyc_type **table;  // Open addressing table of interned types.
+    size_t len, cap;
+    struct tinyc_type_composite *composites;  // Open addressing cache.
+    size_t ncomposites, composites_cap;
+    const struct tinyc_type *basic[TINYC_TYPE_LDOUBLE + 1];
+};
+
+/// Initialize universe with basic types.
+/// Returns false if initialization failed.
+bool tinyc_types_init(struct tinyc_types *this);
+
+/// Get unqualified void or arithmetic type of kind.
+const struct tinyc_type *tinyc_type_basic(
+    const struct tinyc_types *this,
+    enum tinyc_type_kind kind
+);
+
+/// Get type with qualifiers quals added.
+/// Returns NULL if failed to allocate memory.
+const struct tinyc_type *tinyc_type_qualified(
+    struct tinyc_types *this,
+    const struct tinyc_type *type,
+    uint32_t quals
+);
+
+/// Get pointer to base.
+/// Returns NULL if failed to allocate memory.
+const struct tinyc_type *tinyc_type_pointer(
+    struct tinyc_types *this,
+    const struct tinyc_type *base
+);
+
+/// Get array of len elements, whose len may be TINYC_TYPE_UNKNOWN_LEN.
+/// Returns NULL if failed to allocate memory.
+const struct tinyc_type *tinyc_type_array(
+    struct tinyc_types *this,
+    const struct tinyc_type *element,
+    size_t len
+);
+
+/// Get function returning ret with n parameters. flags may have
+/// TINYC_TYPE_PROTOTYPE and TINYC_TYPE_VARIADIC. params is copied if the
+/// type is new.
+/// Returns NULL if failed to allocate memory.
+const struct tinyc_type *tinyc_type_function(
+    struct tinyc_types *this,
+    const struct tinyc_type *ret,
+    const struct tinyc_type *const *params,
+    size_t n,
+    uint32_t flags
+);
+
+/// Create new struct, union or enum distinct from any other type.
+/// Returns NULL if failed to allocate memory.
+const struct tinyc_type *tinyc_type_record(
+    struct tinyc_types *this,
+    enum tinyc_type_kind kind
+);
+
+/// Get composite type of a and b, or NULL if they're incompatible.
+/// Returns false if failed to allocate memory.
+bool tinyc_type_composite(
+    struct tinyc_types *this,
+    const struct tinyc_type *a,
+    const struct tinyc_type *b,
+    const struct tinyc_type **res
+);
+
+/// Append S-expression of type to out.
+/// Returns false if failed to allocate memory.
+bool tinyc_type_dump(const struct tinyc_type *type, struct tinyc_string *out);
+
+/// Release all types in universe.
+void tinyc_types_free(struct tinyc_types *this);
+
+#endif  // TINYC_TYPE_H_
@@ -0,0 +1,43 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef TINYC_UTF8_H_
+#define TINYC_UTF8_H_
+
+#include <stddef.h>
+
+/// Number of columns between tab stops.
+#define TINYC_UTF8_TAB_WIDTH 8
+
+/// Get length of longest prefix of s, which has n bytes, encoded in UTF-8.
+/// Returns n if whole of s is valid.
+size_t tinyc_utf8_validate(const char *s, size_t n);
+
+/// Get display column after character at *offset in line s, which has n
+/// bytes and whose character at *offset starts at column, and advance offset
+/// to next character. Tab moves to next tab stop, wide characters take two
+/// columns, and invalid bytes or bytes beyond line take one column each.
+size_t tinyc_utf8_advance(
+    const char *s,
+    size_t n,
+    size_t *offset,
+    size_t column
+);
+
+/// Get display column where character at offset in line s, which has n
+/// bytes, starts.
+size_t tinyc_utf8_column(const char *s, size_t n, size_t offset);
+
+#endif  // TINYC_UTF8_H_
@@ -0,0 +1,177 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "tinyc/allocator.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *libc_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void *libc_realloc(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+static void libc_free(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+const struct tinyc_allocator tinyc_allocator_libc = {
+    libc_alloc,
+    libc_realloc,
+    libc_free,
+    NULL,
+};
+
+static const struct tinyc_allocator *global = &tinyc_allocator_libc;
+
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t scope_key;  // Allocator scoped to this thread.
+static bool has_key;             // False if key couldn't be created.
+
+static void create_key(void) {
+    has_key = pthread_key_create(&scope_key, NULL) == 0;
+}
+
+/// Get allocator used on calling thread.
+static inline const struct tinyc_allocator *current(void) {
+    pthread_once(&key_once, create_key);
+    if (!has_key) return global;
+    const struct tinyc_allocator *scoped = pthread_getspecific(scope_key);
+    return scoped ? scoped : global;
+}
+
+const struct tinyc_allocator *tinyc_allocator_set(
+    const struct tinyc_allocator *allocator
+) {
+    const struct tinyc_allocator *prev = global;
+    global = allocator ? allocator : &tinyc_allocator_libc;
+    return prev;
+}
+
+const struct tinyc_allocator *tinyc_allocator_scope(
+    const struct tinyc_allocator *allocator
+) {
+    pthread_once(&key_once, create_key);
+    if (!has_key) return NULL;
+    const struct tinyc_allocator *prev = pthread_getspecific(scope_key);
+    pthread_setspecific(scope_key, (void *)allocator);
+    return prev;
+}
+
+#ifdef TINYC_STATS
+/// Placed before each allocation to know its size when released.
+struct header {
+    size_t size;
+    size_t subsystem;
+};
+
+// Keeps allocated memory aligned as malloc does.
+#define HEADER_SIZE (sizeof(struct header) < 16 ? 16 : sizeof(struct header))
+
+void *tinyc_alloc_for(enum tinyc_stats_subsystem subsystem, size_t size) {
+    if (size > SIZE_MAX - HEADER_SIZE) return NULL;
+    const struct tinyc_allocator *allocator = current();
+    struct header *header = allocator->alloc(
+        allocator->ctx,
+        HEADER_SIZE + size
+    );
+    if (!header) return NULL;
+    header->size = size;
+    header->subsystem = subsystem;
+    tinyc_stats_alloc(subsystem, size);
+    return (char *)header + HEADER_SIZE;
+}
+
+void *tinyc_calloc_for(
+    enum tinyc_stats_subsystem subsystem,
+    size_t n,
+    size_t size
+) {
+    if (size && n > SIZE_MAX / size) return NULL;
+    void *ptr = tinyc_alloc_for(subsystem, n * size);
+    if (ptr) memset(ptr, 0, n * size);
+    return ptr;
+}
+
+void *tinyc_realloc_for(
+    enum tinyc_stats_subsystem subsystem,
+    void *ptr,
+    size_t size
+) {
+    if (!ptr) return tinyc_alloc_for(subsystem, size);
+    if (size > SIZE_MAX - HEADER_SIZE) return NULL;
+    struct header *header = (void *)((char *)ptr - HEADER_SIZE);
+    const size_t old_size = header->size;
+    const struct tinyc_allocator *allocator = current();
+    header = allocator->realloc(allocator->ctx, header, HEADER_SIZE + size);
+    if (!header) return NULL;
+    header->size = size;
+    tinyc_stats_realloc(header->subsystem, old_size, size);
+    return (char *)header + HEADER_SIZE;
+}
+
+void *tinyc_alloc(size_t size) {
+    return tinyc_alloc_for(TINYC_STATS_OTHER, size);
+}
+
+void *tinyc_calloc(size_t n, size_t size) {
+    return tinyc_calloc_for(TINYC_STATS_OTHER, n, size);
+}
+
+void *tinyc_realloc(void *ptr, size_t size) {
+    return tinyc_realloc_for(TINYC_STATS_OTHER, ptr, size);
+}
+
+void tinyc_free(void *ptr) {
+    if (!ptr) return;
+    struct header *header = (void *)((char *)ptr - HEADER_SIZE);
+    tinyc_stats_free(header->subsystem, header->size);
+    const struct tinyc_allocator *allocator = current();
+    allocator->free(allocator->ctx, header);
+}
+#else
+void *tinyc_alloc(size_t size) {
+    const struct tinyc_allocator *allocator = current();
+    return allocator->alloc(allocator->ctx, size);
+}
+
+void *tinyc_calloc(size_t n, size_t size) {
+    if (size && n > SIZE_MAX / size) return NULL;
+    const struct tinyc_allocator *allocator = current();
+    void *ptr = allocator->alloc(allocator->ctx, n * size);
+    if (ptr) memset(ptr, 0, n * size);
+    return ptr;
+}
+
+void *tinyc_realloc(void *ptr, size_t size) {
+    const struct tinyc_allocator *allocator = current();
+    return allocator->realloc(allocator->ctx, ptr, size);
+}
+
+void tinyc_free(void *ptr) {
+    if (!ptr) return;
+    const struct tinyc_allocator *allocator = current();
+    allocator->free(allocator->ctx, ptr);
+}
+#endif
@@ -0,0 +1,353 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_AST
+
+#include "tinyc/ast.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/span.h"
+#include "tinyc/string.h"
+
+#define DEFAULT_CAP 256
+
+static const char *const kind_names[] = {
+    [TINYC_AST_NONE] = "none",
+    [TINYC_AST_UNIT] = "unit",
+    [TINYC_AST_FUNC] = "func",
+    [TINYC_AST_DECL] = "decl",
+    [TINYC_AST_PARAM] = "param",
+    [TINYC_AST_FIELD] = "field",
+    [TINYC_AST_ENUMERATOR] = "enumerator",
+    [TINYC_AST_INIT_LIST] = "init-list",
+    [TINYC_AST_TYPE_BASE] = "type",
+    [TINYC_AST_TYPE_NAME] = "type-name",
+    [TINYC_AST_TYPE_STRUCT] = "struct",
+    [TINYC_AST_TYPE_ENUM] = "enum",
+    [TINYC_AST_TYPE_POINTER] = "pointer",
+    [TINYC_AST_TYPE_ARRAY] = "array",
+    [TINYC_AST_TYPE_FUNC] = "function",
+    [TINYC_AST_BLOCK] = "block",
+    [TINYC_AST_IF] = "if",
+    [TINYC_AST_SWITCH] = "switch",
+    [TINYC_AST_CASE] = "case",
+    [TINYC_AST_DEFAULT] = "default",
+    [TINYC_AST_WHILE] = "while",
+    [TINYC_AST_DO] = "do",
+    [TINYC_AST_FOR] = "for",
+    [TINYC_AST_GOTO] = "goto",
+    [TINYC_AST_LABEL] = "label",
+    [TINYC_AST_BREAK] = "break",
+    [TINYC_AST_CONTINUE] = "continue",
+    [TINYC_AST_RETURN] = "return",
+    [TINYC_AST_IDENT] = "ident",
+    [TINYC_AST_INT] = "int",
+    [TINYC_AST_STRING] = "string",
+    [TINYC_AST_CALL] = "call",
+    [TINYC_AST_INDEX] = "index",
+    [TINYC_AST_MEMBER] = ".",
+    [TINYC_AST_ARROW] = "->",
+    [TINYC_AST_POST_INC] = "post++",
+    [TINYC_AST_POST_DEC] = "post--",
+    [TINYC_AST_PRE_INC] = "++",
+    [TINYC_AST_PRE_DEC] = "--",
+    [TINYC_AST_ADDR] = "&",
+    [TINYC_AST_DEREF] = "*",
+    [TINYC_AST_PLUS] = "+",
+    [TINYC_AST_NEG] = "-",
+    [TINYC_AST_NOT] = "~",
+    [TINYC_AST_LNOT] = "!",
+    [TINYC_AST_SIZEOF] = "sizeof",
+    [TINYC_AST_CAST] = "cast",
+    [TINYC_AST_MUL] = "*",
+    [TINYC_AST_DIV] = "/",
+    [TINYC_AST_MOD] = "%",
+    [TINYC_AST_ADD] = "+",
+    [TINYC_AST_SUB] = "-",
+    [TINYC_AST_SHL] = "<<",
+    [TINYC_AST_SHR] = ">>",
+    [TINYC_AST_LT] = "<",
+    [TINYC_AST_GT] = ">",
+    [TINYC_AST_LE] = "<=",
+    [TINYC_AST_GE] = ">=",
+    [TINYC_AST_EQ] = "==",
+    [TINYC_AST_NE] = "!=",
+    [TINYC_AST_AND] = "&",
+    [TINYC_AST_XOR] = "^",
+    [TINYC_AST_OR] = "|",
+    [TINYC_AST_LAND] = "&&",
+    [TINYC_AST_LOR] = "||",
+    [TINYC_AST_COND] = "?:",
+    [TINYC_AST_ASSIGN] = "=",
+    [TINYC_AST_COMMA] = ",",
+};
+
+static const char *const flag_names[] = {
+    "const",
+    "volatile",
+    "restrict",
+    "void",
+    "_Bool",
+    "char",
+    "short",
+    "int",
+    "long",
+    "long long",
+    "signed",
+    "unsigned",
+    "float",
+    "double",
+    "union",
+    "complete",
+    "prototype",
+    "...",
+};
+
+static const char *const storage_names[] = {
+    "typedef",
+    "extern",
+    "static",
+    "inline",
+};
+
+/// Resize tree to hold at least cap nodes and refs_cap children.
+static bool resize(struct tinyc_ast *this, size_t cap, size_t refs_cap) {
+    if (cap > this->cap) {
+        struct tinyc_ast_node *nodes = tinyc_realloc(
+            this->nodes,
+            sizeof(struct tinyc_ast_node) * cap
+        );
+        if (!nodes) return false;
+        this->nodes = nodes;
+        struct tinyc_span *spans = tinyc_realloc(
+            this->spans,
+            sizeof(struct tinyc_span) * cap
+        );
+        if (!spans) return false;
+        this->spans = spans;
+        this->cap = cap;
+    }
+    if (refs_cap > this->refs_cap) {
+        tinyc_ast_ref *refs = tinyc_realloc(
+            this->refs,
+            sizeof(tinyc_ast_ref) * refs_cap
+        );
+        if (!refs) return false;
+        this->refs = refs;
+        this->refs_cap = refs_cap;
+    }
+    return true;
+}
+
+/// Make tree be able to hold one more node with n children.
+static bool reserve(struct tinyc_ast *this, size_t n) {
+    const size_t cap = this->len + 1 > this->cap ? this->cap * 2 : this->cap;
+    size_t refs_cap = this->refs_cap;
+    if (this->nrefs + n > refs_cap) {
+        refs_cap *= 2;
+        if (refs_cap < this->nrefs + n) refs_cap = this->nrefs + n;
+    }
+    return resize(this, cap, refs_cap);
+}
+
+bool tinyc_ast_init(struct tinyc_ast *this) {
+    this->len = 0;
+    this->cap = DEFAULT_CAP;
+    this->nrefs = 0;
+    this->refs_cap = DEFAULT_CAP;
+    this->root = 0;
+    this->nodes = tinyc_alloc(sizeof(struct tinyc_ast_node) * this->cap);
+    this->spans = tinyc_alloc(sizeof(struct tinyc_span) * this->cap);
+    this->refs = tinyc_alloc(sizeof(tinyc_ast_ref) * this->refs_cap);
+    const bool ok = this->nodes && this->spans && this->refs &&
+                    tinyc_string_init(&this->strings);
+    if (!ok) {
+        tinyc_free(this->nodes);
+        tinyc_free(this->spans);
+        tinyc_free(this->refs);
+        return false;
+    }
+
+    // Node 0 and name 0 stand for absence.
+    const struct tinyc_span span = {-1, {0, 0}, {0, 0}};
+    tinyc_ast_add(this, TINYC_AST_NONE, &span, NULL, 0);
+    this->strings.len = 1;
+    this->strings.cstr[1] = '\0';
+    return true;
+}
+
+tinyc_ast_ref tinyc_ast_add(
+    struct tinyc_ast *this,
+    enum tinyc_ast_kind kind,
+    const struct tinyc_span *span,
+    const tinyc_ast_ref *children,
+    size_t n
+) {
+    if (this->len > UINT32_MAX - 1 || this->nrefs > UINT32_MAX - n) return 0;
+    if (!reserve(this, n)) return 0;
+    struct tinyc_ast_node *node = &this->nodes[this->len];
+    node->kind = kind;
+    node->children = this->nrefs;
+    node->nchildren = n;
+    node->name = node->flags = 0;
+    node->value = 0;
+    this->spans[this->len] = *span;
+    if (n) memcpy(&this->refs[this->nrefs], children, sizeof(*children) * n);
+    this->nrefs += n;
+    return this->len++;
+}
+
+bool tinyc_ast_reserve(struct tinyc_ast *this, size_t n) {
+    return resize(this, this->len + n, this->nrefs + n);
+}
+
+bool tinyc_ast_add_string(
+    struct tinyc_ast *this,
+    const char *s,
+    size_t n,
+    uint32_t *res
+) {
+    if (this->strings.len > UINT32_MAX - n - 1) return false;
+    *res = this->strings.len;
+    return tinyc_string_append(&this->strings, s, n) &&
+           tinyc_string_push(&this->strings, '\0');
+}
+
+tinyc_ast_ref tinyc_ast_child(
+    const struct tinyc_ast *this,
+    tinyc_ast_ref node,
+    size_t i
+) {
+    const struct tinyc_ast_node *n = &this->nodes[node];
+    return i < n->nchildren ? this->refs[n->children + i] : 0;
+}
+
+const char *tinyc_ast_name(const struct tinyc_ast *this, tinyc_ast_ref node) {
+    return this->strings.cstr + this->nodes[node].name;
+}
+
+const char *tinyc_ast_kind_name(enum tinyc_ast_kind kind) {
+    return kind_names[kind];
+}
+
+static void put(struct tinyc_string *out, const char *s, bool *ok) {
+    if (*ok) *ok = tinyc_string_append(out, s, strlen(s));
+}
+
+static void put_flags(
+    struct tinyc_string *out,
+    uint32_t flags,
+    const char *const *names,
+    size_t n,
+    bool *ok
+) {
+    for (size_t i = 0; i < n; ++i) {
+        if (!(flags & (1u << i))) continue;
+        put(out, " ", ok);
+        put(out, names[i], ok);
+    }
+}
+
+static bool is_declaration(enum tinyc_ast_kind kind) {
+    return kind == TINYC_AST_FUNC || kind == TINYC_AST_DECL;
+}
+
+static bool is_type(enum tinyc_ast_kind kind) {
+    return TINYC_AST_TYPE_BASE <= kind && kind <= TINYC_AST_TYPE_FUNC;
+}
+
+static void dump(
+    const struct tinyc_ast *this,
+    tinyc_ast_ref ref,
+    struct tinyc_string *out,
+    bool *ok
+) {
+    if (ref == 0) {
+        put(out, "()", ok);
+        return;
+    }
+    const struct tinyc_ast_node *node = &this->nodes[ref];
+    put(out, "(", ok);
+    put(out, kind_names[node->kind], ok);
+    if (node->kind == TINYC_AST_STRING) {
+        put(out, " \"", ok);
+        if (*ok) {
+            *ok = tinyc_string_append(
+                out,
+                this->strings.cstr + node->name,
+                node->value
+            );
+        }
+        put(out, "\"", ok);
+    } else if (node->name) {
+        put(out, " ", ok);
+        put(out, this->strings.cstr + node->name, ok);
+    }
+    if (node->kind == TINYC_AST_INT) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), " %llu", (unsigned long long)node->value);
+        put(out, buf, ok);
+    }
+    if (is_declaration(node->kind)) {
+        put_flags(
+            out,
+            node->flags,
+            storage_names,
+            sizeof(storage_names) / sizeof(*storage_names),
+            ok
+        );
+    } else if (is_type(node->kind) || node->kind == TINYC_AST_INT) {
+        put_flags(
+            out,
+            node->flags,
+            flag_names,
+            sizeof(flag_names) / sizeof(*flag_names),
+            ok
+        );
+    } else if (node->kind == TINYC_AST_ASSIGN && node->flags) {
+        put(out, " ", ok);
+        put(out, kind_names[node->flags], ok);
+    }
+    for (uint32_t i = 0; i < node->nchildren; ++i) {
+        put(out, " ", ok);
+        dump(this, this->refs[node->children + i], out, ok);
+    }
+    put(out, ")", ok);
+}
+
+bool tinyc_ast_dump(
+    const struct tinyc_ast *this,
+    tinyc_ast_ref node,
+    struct tinyc_string *out
+) {
+    bool ok = true;
+    dump(this, node, out, &ok);
+    return ok;
+}
+
+void tinyc_ast_free(struct tinyc_ast *this) {
+    tinyc_free(this->nodes);
+    tinyc_free(this->spans);
+    tinyc_free(this->refs);
+    tinyc_string_free(&this->strings);
+    this->nodes = NULL;
+    this->spans = NULL;
+    this->refs = NULL;
+    this->len = this->cap = this->nrefs = this->refs_cap = 0;
+    this->root = 0;
+}
@@ -21,6 +21,28 @@
 
 #include "tinyc/repo.h"
 #include "tinyc/source.h"
+#include "tinyc/string.h"
+#include "tinyc/utf8.h"
+
+/// Output buffer. Once it failed to grow, ok becomes false.
+struct output {
+    struct tinyc_string *buf;
+    bool ok;
+};
+
+static inline void put(struct output *out, const char *s) {
+    if (out->ok) out->ok = tinyc_string_append(out->buf, s, strlen(s));
+}
+
+static inline void put_char(struct output *out, char c) {
+    if (out->ok) out->ok = tinyc_string_push(out->buf, c);
+}
+
+static inline void put_size(struct output *out, const char *format, size_t n) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), format, n);
+    put(out, buf);
+}
 
 static inline void validate_span(const struct tinyc_span *span) {
     assert(span->start.row <= span->end.row);
@@ -54,87 +76,228 @@ static inline const char *color_sequence_by_severity(
 }
 
 static inline void paint(
-    FILE *fs,
+    struct output *out,
     bool color,
     enum tinyc_diag_severity severity,
     const char *s
 ) {
-    if (color) fputs(color_sequence_by_severity(severity), fs);
-    fputs(s, fs);
-    if (color) fputs("\033[0m", fs);
+    if (color) put(out, color_sequence_by_severity(severity));
+    put(out, s);
+    if (color) put(out, "\033[0m");
+}
+
+static inline void fill(struct output *out, char c, size_t n) {
+    if (out->ok) out->ok = tinyc_string_fill(out->buf, c, n);
+}
+
+/// Put line with tabs expanded to spaces, returns display width of it.
+static size_t put_line(struct output *out, const struct tinyc_string *line) {
+    if (!memchr(line->cstr, '\t', line->len)) {
+        put(out, line->cstr);
+        return tinyc_utf8_column(line->cstr, line->len, line->len);
+    }
+
+    size_t offset = 0, column = 0;
+    while (offset < line->len) {
+        const size_t start = offset;
+        const size_t next = tinyc_utf8_advance(
+            line->cstr,
+            line->len,
+            &offset,
+            column
+        );
+        if (line->cstr[start] == '\t') {
+            fill(out, ' ', next - column);
+        } else if (out->ok) {
+            out->ok = tinyc_string_append(
+                out->buf,
+                line->cstr + start,
+                offset - start
+            );
+        }
+        column = next;
+    }
+    return column;
+}
+
+/// Set line of cache to row of source.
+static bool load_line(
+    struct tinyc_diag_cache_line *line,
+    const struct tinyc_repo *repo,
+    tinyc_repo_id id,
+    size_t row
+) {
+    const struct tinyc_source *source = tinyc_repo_query(repo, id);
+    assert(source);
+    const struct tinyc_source_line *src = tinyc_source_at(source, row);
+    assert(src);
+
+    if (line->header.cap == 0 && !tinyc_string_init(&line->header)) {
+        return false;
+    }
+    line->header.len = 0;
+    line->header.cstr[0] = '\0';
+    struct output out = {&line->header, true};
+    put_size(&out, " %5zu | ", row);
+    const size_t width = put_line(&out, &src->line);
+    put(&out, "\n       | ");
+    if (!out.ok) return false;
+
+    line->repo = repo;
+    line->id = id;
+    line->row = row;
+    line->source = source;
+    line->line = &src->line;
+    line->width = width;
+    return true;
+}
+
+/// Get row of source from cache, loading it on miss. Line at keep, if not
+/// NULL, is never evicted, so it stays valid while another row is loaded.
+/// Returns NULL if failed to allocate memory.
+static const struct tinyc_diag_cache_line *lookup_line(
+    struct tinyc_diag_cache *cache,
+    const struct tinyc_repo *repo,
+    tinyc_repo_id id,
+    size_t row,
+    const struct tinyc_diag_cache_line *keep
+) {
+    for (size_t i = 0; i < cache->len; ++i) {
+        const struct tinyc_diag_cache_line *line = &cache->lines[i];
+        if (line->repo == repo && line->id == id && line->row == row) {
+            return line;
+        }
+    }
+
+    if (&cache->lines[cache->next] == keep) {
+        cache->next = (cache->next + 1) % TINYC_DIAG_CACHE_SIZE;
+    }
+    struct tinyc_diag_cache_line *line = &cache->lines[cache->next];
+    cache->next = (cache->next + 1) % TINYC_DIAG_CACHE_SIZE;
+    if (cache->len < TINYC_DIAG_CACHE_SIZE) cache->len++;
+    if (!load_line(line, repo, id, row)) {
+        line->repo = NULL;
+        return NULL;
+    }
+    return line;
 }
 
 static inline void emit_loc_info(
-    FILE *fs,
+    struct output *out,
     bool color,
     const struct tinyc_source *source,
     enum tinyc_diag_severity severity,
     const struct tinyc_span *span,
     const char *what
 ) {
-    const size_t row = span->start.row;
-    const size_t offset = span->start.offset;
+    put(out, source->name.cstr);
+    put_size(out, ":%zu", span->start.row);
+    put_size(out, ":%zu: ", span->start.offset);
+    paint(out, color, severity, severity_string(severity));
+    paint(out, color, severity, ":");
+    put_char(out, ' ');
+    put(out, what);
+}
 
-    fprintf(fs, "%s:%ld:%ld: ", source->name.cstr, row, offset);
-    paint(fs, color, severity, severity_string(severity));
-    paint(fs, color, severity, ":");
-    fprintf(fs, " %s", what);
+static inline void emit_line_header(
+    struct output *out,
+    const struct tinyc_diag_cache_line *line
+) {
+    if (out->ok) {
+        out->ok = tinyc_string_append(
+            out->buf,
+            line->header.cstr,
+            line->header.len
+        );
+    }
 }
 
-static inline void emit_start_line(
-    FILE *fs,
-    const struct tinyc_source *source,
-    const struct tinyc_span *span
+/// Get display column where character at offset in line starts.
+static inline size_t start_column(
+    const struct tinyc_diag_cache_line *line,
+    size_t offset
+) {
+    return tinyc_utf8_column(line->line->cstr, line->line->len, offset);
+}
+
+/// Get display column where character at offset in line ends.
+static inline size_t end_column(
+    const struct tinyc_diag_cache_line *line,
+    size_t offset
 ) {
-    const struct tinyc_source_line *line = tinyc_source_at(
-        source,
-        span->start.row
+    const size_t column = start_column(line, offset);
+    return tinyc_utf8_advance(
+        line->line->cstr,
+        line->line->len,
+        &offset,
+        column
     );
-    assert(line);
+}
 
-    fprintf(fs, " %5ld | %s\n", span->start.row, line->line.cstr);
-    fputs("       | ", fs);
-    for (size_t i = 0; i < span->start.offset; ++i) fputc(' ', fs);
-    for (size_t i = span->start.offset; i < line->line.len; ++i) fputc('^', fs);
+static inline void emit_start_line(
+    struct output *out,
+    const struct tinyc_diag_cache_line *line,
+    const struct tinyc_span *span
+) {
+    const size_t start = start_column(line, span->start.offset);
+    emit_line_header(out, line);
+    fill(out, ' ', start);
+    if (start < line->width) fill(out, '^', line->width - start);
 }
 
 static inline void emit_end_line(
-    FILE *fs,
-    const struct tinyc_source *source,
+    struct output *out,
+    const struct tinyc_diag_cache_line *line,
     const struct tinyc_span *span
 ) {
-    const struct tinyc_source_line *line = tinyc_source_at(
-        source,
-        span->end.row
-    );
-    assert(line);
-
-    fprintf(fs, " %5ld | %s\n", span->end.row, line->line.cstr);
-    fputs("       | ", fs);
-    for (size_t i = 0; i <= span->end.offset; ++i) fputc('^', fs);
+    emit_line_header(out, line);
+    fill(out, '^', end_column(line, span->end.offset));
 }
 
 static inline void emit_single_line(
-    FILE *fs,
-    const struct tinyc_source *source,
+    struct output *out,
+    const struct tinyc_diag_cache_line *line,
     const struct tinyc_span *span
 ) {
-    const struct tinyc_source_line *line = tinyc_source_at(
-        source,
-        span->start.row
-    );
-    assert(line);
+    const size_t start = start_column(line, span->start.offset);
+    emit_line_header(out, line);
+    fill(out, ' ', start);
+    fill(out, '^', end_column(line, span->end.offset) - start);
+}
 
-    fprintf(fs, " %5ld | %s\n", span->start.row, line->line.cstr);
-    fputs("       | ", fs);
-    for (size_t i = 0; i < span->start.offset; ++i) fputc(' ', fs);
-    for (size_t i = span->start.offset; i <= span->end.offset; ++i) {
-        fputc('^', fs);
+static void diagnostic_line(
+    struct output *out,
+    struct tinyc_diag_cache *cache,
+    bool color,
+    enum tinyc_diag_severity severity,
+    const struct tinyc_repo *repo,
+    const struct tinyc_span *span,
+    const char *what,
+    const char *message
+) {
+    const struct tinyc_diag_cache_line *line = lookup_line(
+        cache,
+        repo,
+        span->id,
+        span->start.row,
+        NULL
+    );
+    if (!line) {
+        out->ok = false;
+        return;
     }
+
+    emit_loc_info(out, color, line->source, severity, span, what);
+    put_char(out, '\n');
+    emit_single_line(out, line, span);
+    put_char(out, ' ');
+    put(out, message);
+    put_char(out, '\n');
 }
 
-static inline void diagnostic_line(
-    FILE *fs,
+static void diagnostic_lines(
+    struct output *out,
+    struct tinyc_diag_cache *cache,
     bool color,
     enum tinyc_diag_severity severity,
     const struct tinyc_repo *repo,
@@ -142,16 +305,36 @@ static inline void diagnostic_line(
     const char *what,
     const char *message
 ) {
-    const struct tinyc_source *source = tinyc_repo_query(repo, span->id);
-    assert(source);
+    const struct tinyc_diag_cache_line *start = lookup_line(
+        cache,
+        repo,
+        span->id,
+        span->start.row,
+        NULL
+    );
+    const struct tinyc_diag_cache_line *end = lookup_line(
+        cache,
+        repo,
+        span->id,
+        span->end.row,
+        start
+    );
+    if (!start || !end) {
+        out->ok = false;
+        return;
+    }
 
-    emit_loc_info(fs, color, source, severity, span, what);
-    fputc('\n', fs);
-    emit_single_line(fs, source, span);
-    fprintf(fs, " %s\n", message);
+    emit_loc_info(out, color, start->source, severity, span, what);
+    put_char(out, '\n');
+    emit_start_line(out, start, span);
+    put_char(out, '\n');
+    emit_end_line(out, end, span);
+    put_char(out, ' ');
+    put(out, message);
+    put_char(out, '\n');
 }
 
-static inline void diagnostic_lines(
+static void diagnostic(
     FILE *fs,
     bool color,
     enum tinyc_diag_severity severity,
@@ -160,19 +343,33 @@ static inline void diagnostic_lines(
     const char *what,
     const char *message
 ) {
-    const struct tinyc_source *source = tinyc_repo_query(repo, span->id);
-    assert(source);
+    struct tinyc_string buf;
+    if (!tinyc_string_init(&buf)) return;
+    tinyc_diag_render(&buf, NULL, color, severity, repo, span, what, message);
+    fwrite(buf.cstr, 1, buf.len, fs);
+    tinyc_string_free(&buf);
+}
 
-    emit_loc_info(fs, color, source, severity, span, what);
-    fputc('\n', fs);
-    emit_start_line(fs, source, span);
-    fputc('\n', fs);
-    emit_end_line(fs, source, span);
-    fprintf(fs, " %s\n", message);
+void tinyc_diag_cache_init(struct tinyc_diag_cache *this) {
+    this->len = this->next = 0;
+    for (size_t i = 0; i < TINYC_DIAG_CACHE_SIZE; ++i) {
+        this->lines[i].repo = NULL;
+        this->lines[i].header.cap = this->lines[i].header.len = 0;
+        this->lines[i].header.cstr = NULL;
+    }
 }
 
-static void diagnostic(
-    FILE *fs,
+void tinyc_diag_cache_free(struct tinyc_diag_cache *this) {
+    for (size_t i = 0; i < TINYC_DIAG_CACHE_SIZE; ++i) {
+        tinyc_string_free(&this->lines[i].header);
+        this->lines[i].repo = NULL;
+    }
+    this->len = this->next = 0;
+}
+
+bool tinyc_diag_render(
+    struct tinyc_string *buf,
+    struct tinyc_diag_cache *cache,
     bool color,
     enum tinyc_diag_severity severity,
     const struct tinyc_repo *repo,
@@ -180,12 +377,40 @@ static void diagnostic(
     const char *what,
     const char *message
 ) {
+    struct tinyc_diag_cache local;
+    if (!cache) {
+        tinyc_diag_cache_init(&local);
+        cache = &local;
+    }
+
+    struct output out = {buf, true};
     validate_span(span);
     if (span->start.row == span->end.row) {
-        diagnostic_line(fs, color, severity, repo, span, what, message);
+        diagnostic_line(
+            &out,
+            cache,
+            color,
+            severity,
+            repo,
+            span,
+            what,
+            message
+        );
     } else {
-        diagnostic_lines(fs, color, severity, repo, span, what, message);
+        diagnostic_lines(
+            &out,
+            cache,
+            color,
+            severity,
+            repo,
+            span,
+            what,
+            message
+        );
     }
+
+    if (cache == &local) tinyc_diag_cache_free(&local);
+    return out.ok;
 }
 
 void tinyc_diag(
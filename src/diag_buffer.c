@@ -0,0 +1,418 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_DIAG
+
+#include "tinyc/diag_buffer.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/diag.h"
+#include "tinyc/diag_json.h"
+#include "tinyc/map.h"
+#include "tinyc/string.h"
+#include "tinyc/trace.h"
+
+#define DEFAULT_CAP 16
+#define DEFAULT_SEEN_CAP 64
+
+struct tinyc_diag_seen {
+    bool used;
+    size_t hash;
+    tinyc_repo_id id;
+    struct tinyc_position position;
+    const struct tinyc_diag_kind *kind;
+};
+
+/// Reference to a record while merging.
+struct ref {
+    const struct tinyc_diag_record *record;
+    size_t buffer_index;
+    size_t record_index;
+};
+
+static inline int cmp_size(size_t a, size_t b) {
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static int cmp_ref(const void *lhs, const void *rhs) {
+    const struct ref *r1 = lhs, *r2 = rhs;
+    const struct tinyc_span *s1 = &r1->record->span;
+    const struct tinyc_span *s2 = &r2->record->span;
+    int res;
+    if (s1->id != s2->id) return s1->id < s2->id ? -1 : 1;
+    if ((res = cmp_size(s1->start.row, s2->start.row))) return res;
+    if ((res = cmp_size(s1->start.offset, s2->start.offset))) return res;
+    if ((res = cmp_size(r1->buffer_index, r2->buffer_index))) return res;
+    return cmp_size(r1->record_index, r2->record_index);
+}
+
+static inline size_t hash_seen(
+    const struct tinyc_span *span,
+    const struct tinyc_diag_kind *kind
+) {
+    size_t h = (size_t)14695981039346656037ULL;
+    h = (h ^ (uintptr_t)kind) * (size_t)1099511628211ULL;
+    h = (h ^ (size_t)span->id) * (size_t)1099511628211ULL;
+    h = (h ^ span->start.row) * (size_t)1099511628211ULL;
+    h = (h ^ span->start.offset) * (size_t)1099511628211ULL;
+    return h;
+}
+
+static inline struct tinyc_diag_seen *find_seen(
+    struct tinyc_diag_seen *seen,
+    size_t cap,
+    size_t hash,
+    const struct tinyc_span *span,
+    const struct tinyc_diag_kind *kind
+) {
+    size_t i = hash & (cap - 1);
+    while (seen[i].used) {
+        const struct tinyc_diag_seen *e = &seen[i];
+        if (e->hash == hash && e->kind == kind && e->id == span->id &&
+            e->position.row == span->start.row &&
+            e->position.offset == span->start.offset) {
+            break;
+        }
+        i = (i + 1) & (cap - 1);
+    }
+    return &seen[i];
+}
+
+static bool grow_seen(struct tinyc_diag_buffer *this) {
+    const size_t new_cap = this->seen_cap * 2;
+    struct tinyc_diag_seen *seen = tinyc_calloc(
+        new_cap,
+        sizeof(struct tinyc_diag_seen)
+    );
+    if (!seen) return false;
+    for (size_t i = 0; i < this->seen_cap; ++i) {
+        const struct tinyc_diag_seen *e = &this->seen[i];
+        if (!e->used) continue;
+        size_t j = e->hash & (new_cap - 1);
+        while (seen[j].used) j = (j + 1) & (new_cap - 1);
+        seen[j] = *e;
+    }
+    tinyc_free(this->seen);
+    this->seen = seen;
+    this->seen_cap = new_cap;
+    return true;
+}
+
+/// Check same kind was recorded at same location, recording it if not.
+static bool check_seen(
+    struct tinyc_diag_buffer *this,
+    const struct tinyc_span *span,
+    const struct tinyc_diag_kind *kind,
+    bool *seen
+) {
+    const size_t hash = hash_seen(span, kind);
+    struct tinyc_diag_seen *e = find_seen(
+        this->seen,
+        this->seen_cap,
+        hash,
+        span,
+        kind
+    );
+    *seen = e->used;
+    if (e->used) return true;
+
+    if ((this->seen_len + 1) * 4 > this->seen_cap * 3) {
+        if (!grow_seen(this)) return false;
+        e = find_seen(this->seen, this->seen_cap, hash, span, kind);
+    }
+    e->used = true;
+    e->hash = hash;
+    e->id = span->id;
+    e->position = span->start;
+    e->kind = kind;
+    this->seen_len++;
+    return true;
+}
+
+/// Returns true if diagnostic must be dropped. Cheap checks come first.
+static bool drop(
+    struct tinyc_diag_buffer *this,
+    const struct tinyc_diag_kind *kind,
+    const struct tinyc_span *span,
+    const struct tinyc_string *what,
+    bool *failed
+) {
+    const struct tinyc_diag_limits *limits = &this->limits;
+    const enum tinyc_diag_severity severity = kind->severity;
+    *failed = false;
+    if (severity == TINYC_DIAG_WARN && limits->suppress_warnings) return true;
+    if (severity == TINYC_DIAG_ERROR && limits->max_errors &&
+        this->errors >= limits->max_errors) {
+        return true;
+    }
+    if (limits->max_per_kind) {
+        void *count;
+        if (tinyc_map_query(&this->kinds, what, &count) &&
+            (uintptr_t)count >= limits->max_per_kind) {
+            return true;
+        }
+    }
+    if (limits->dedup) {
+        bool seen;
+        if (!check_seen(this, span, kind, &seen)) {
+            *failed = true;
+            return true;
+        }
+        if (seen) return true;
+    }
+    return false;
+}
+
+static bool count_kind(
+    struct tinyc_diag_buffer *this,
+    const struct tinyc_string *what
+) {
+    if (!this->limits.max_per_kind) return true;
+    void *count = NULL;
+    tinyc_map_query(&this->kinds, what, &count);
+    return tinyc_map_insert(&this->kinds, what, (void *)((uintptr_t)count + 1));
+}
+
+/// Copy arguments for format into args. Strings are appended to strings.
+static bool capture(
+    struct tinyc_diag_buffer *this,
+    const char *format,
+    union tinyc_diag_arg *args,
+    va_list ap
+) {
+    size_t n = 0;
+    for (const char *c = format; *c && n < TINYC_DIAG_MAX_ARGS; ++c) {
+        if (*c != '%' || !*++c) continue;
+        if (*c == 'd') {
+            args[n++].i = va_arg(ap, int);
+        } else if (*c == 's') {
+            const char *s = va_arg(ap, const char *);
+            args[n++].s = this->strings.len;
+            if (!tinyc_string_append(&this->strings, s, strlen(s) + 1)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// Format message of record emitted into buffer, and set it to buf.
+static bool format(
+    struct tinyc_string *buf,
+    const struct tinyc_diag_buffer *buffer,
+    const struct tinyc_diag_record *record
+) {
+    size_t n = 0;
+    buf->len = 0;
+    buf->cstr[0] = '\0';
+    for (const char *c = record->kind->format; *c; ++c) {
+        bool ok;
+        if (*c != '%' || !c[1]) {
+            ok = tinyc_string_push(buf, *c);
+        } else if (*++c == 'd' && n < TINYC_DIAG_MAX_ARGS) {
+            char num[16];
+            const int len = snprintf(
+                num,
+                sizeof(num),
+                "%d",
+                record->args[n++].i
+            );
+            ok = tinyc_string_append(buf, num, len);
+        } else if (*c == 's' && n < TINYC_DIAG_MAX_ARGS) {
+            const char *s = buffer->strings.cstr + record->args[n++].s;
+            ok = tinyc_string_append(buf, s, strlen(s));
+        } else {
+            ok = tinyc_string_push(buf, *c);
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool tinyc_diag_buffer_init(struct tinyc_diag_buffer *this) {
+    memset(&this->limits, 0, sizeof(this->limits));
+    this->len = this->errors = this->dropped = 0;
+    this->cap = DEFAULT_CAP;
+    this->records = tinyc_alloc(sizeof(struct tinyc_diag_record) * this->cap);
+    if (!this->records) return false;
+    if (!tinyc_string_init(&this->strings)) return false;
+    this->seen_len = 0;
+    this->seen_cap = DEFAULT_SEEN_CAP;
+    this->seen = tinyc_calloc(this->seen_cap, sizeof(struct tinyc_diag_seen));
+    if (!this->seen) return false;
+    return tinyc_map_init(&this->kinds);
+}
+
+bool tinyc_diag_buffer_emit(
+    struct tinyc_diag_buffer *this,
+    const struct tinyc_diag_kind *kind,
+    const struct tinyc_repo *repo,
+    const struct tinyc_span *span,
+    ...
+) {
+    struct tinyc_string what;
+    tinyc_string_from(&what, (char *)kind->what);
+    bool failed;
+    if (drop(this, kind, span, &what, &failed)) {
+        this->dropped++;
+        return !failed;
+    }
+
+    if (this->len == this->cap) {
+        const size_t new_cap = this->cap * 2;
+        struct tinyc_diag_record *new_records = tinyc_realloc(
+            this->records,
+            sizeof(struct tinyc_diag_record) * new_cap
+        );
+        if (!new_records) return false;
+        this->records = new_records;
+        this->cap = new_cap;
+    }
+    struct tinyc_diag_record *record = &this->records[this->len];
+    va_list ap;
+    va_start(ap, span);
+    const bool ok = capture(this, kind->format, record->args, ap);
+    va_end(ap);
+    if (!ok || !count_kind(this, &what)) return false;
+
+    record->kind = kind;
+    record->span = *span;
+    record->repo = repo;
+    this->len++;
+    if (kind->severity == TINYC_DIAG_ERROR) this->errors++;
+    return true;
+}
+
+/// Collect references to records of n buffers in order they're merged.
+/// Returns NULL if failed to allocate memory.
+static struct ref *collect(
+    const struct tinyc_diag_buffer *buffers,
+    size_t n,
+    size_t count,
+    bool sort
+) {
+    struct ref *refs = tinyc_alloc(sizeof(struct ref) * count);
+    if (!refs) return NULL;
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < buffers[i].len; ++j) {
+            refs[k++] = (struct ref){&buffers[i].records[j], i, j};
+        }
+    }
+    if (sort) qsort(refs, count, sizeof(struct ref), cmp_ref);
+    return refs;
+}
+
+static void clear(struct tinyc_diag_buffer *buffers, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        buffers[i].len = buffers[i].strings.len = 0;
+        buffers[i].strings.cstr[0] = '\0';
+    }
+}
+
+bool tinyc_diag_buffer_merge(
+    FILE *fs,
+    struct tinyc_diag_buffer *buffers,
+    size_t n,
+    bool sort
+) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) count += buffers[i].len;
+    if (count == 0) return true;
+
+    struct ref *refs = collect(buffers, n, count, sort);
+    if (!refs) return false;
+    tinyc_trace_begin("diagnostics", NULL);
+
+    // Diagnostics on same line are often adjacent, so they share cache.
+    struct tinyc_diag_cache cache;
+    tinyc_diag_cache_init(&cache);
+    struct tinyc_string out, message;
+    bool ok = tinyc_string_init(&out);
+    ok = tinyc_string_init(&message) && ok;
+    for (size_t i = 0; i < count && ok; ++i) {
+        const struct tinyc_diag_record *r = refs[i].record;
+        ok = format(&message, &buffers[refs[i].buffer_index], r) &&
+             tinyc_diag_render(
+                 &out,
+                 &cache,
+                 false,
+                 r->kind->severity,
+                 r->repo,
+                 &r->span,
+                 r->kind->what,
+                 message.cstr
+             );
+    }
+    ok = ok && fwrite(out.cstr, 1, out.len, fs) == out.len;
+
+    if (out.cstr) tinyc_string_free(&out);
+    if (message.cstr) tinyc_string_free(&message);
+    tinyc_diag_cache_free(&cache);
+    tinyc_free(refs);
+    clear(buffers, n);
+    tinyc_trace_end();
+    return ok;
+}
+
+bool tinyc_diag_buffer_merge_json(
+    struct tinyc_diag_json *sink,
+    struct tinyc_diag_buffer *buffers,
+    size_t n,
+    bool sort
+) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) count += buffers[i].len;
+    if (count == 0) return true;
+
+    struct ref *refs = collect(buffers, n, count, sort);
+    if (!refs) return false;
+    tinyc_trace_begin("diagnostics", NULL);
+    struct tinyc_string message;
+    bool ok = tinyc_string_init(&message);
+    for (size_t i = 0; i < count && ok; ++i) {
+        const struct tinyc_diag_record *r = refs[i].record;
+        ok = format(&message, &buffers[refs[i].buffer_index], r) &&
+             tinyc_diag_json_emit(
+                 sink,
+                 r->kind->severity,
+                 r->repo,
+                 &r->span,
+                 r->kind->what,
+                 message.cstr
+             );
+    }
+
+    if (message.cstr) tinyc_string_free(&message);
+    tinyc_free(refs);
+    clear(buffers, n);
+    tinyc_trace_end();
+    return ok;
+}
+
+void tinyc_diag_buffer_free(struct tinyc_diag_buffer *this) {
+    tinyc_free(this->records);
+    tinyc_string_free(&this->strings);
+    tinyc_free(this->seen);
+    this->records = NULL;
+    this->seen = NULL;
+    this->len = this->cap = this->seen_len = this->seen_cap = 0;
+    tinyc_map_free(&this->kinds);
+}
@@ -0,0 +1,271 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tinyc/diag_json.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/utf8.h"
+
+#define SARIF_HEADER                                                     \
+    "{\"version\":\"2.1.0\","                                            \
+    "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","     \
+    "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"tinyc\"}},"             \
+    "\"columnKind\":\"unicodeCodePoints\",\"results\":["
+#define SARIF_TRAILER "]}]}\n"
+
+static void flush(struct tinyc_diag_json *this) {
+    if (this->ok && fwrite(this->buf, 1, this->len, this->fs) != this->len) {
+        this->ok = false;
+    }
+    this->len = 0;
+}
+
+static void put_n(struct tinyc_diag_json *this, const char *s, size_t n) {
+    if (TINYC_DIAG_JSON_BUFSIZE - this->len < n) {
+        flush(this);
+        if (n >= TINYC_DIAG_JSON_BUFSIZE) {
+            if (this->ok && fwrite(s, 1, n, this->fs) != n) this->ok = false;
+            return;
+        }
+    }
+    memcpy(this->buf + this->len, s, n);
+    this->len += n;
+}
+
+static inline void put(struct tinyc_diag_json *this, const char *s) {
+    put_n(this, s, strlen(s));
+}
+
+static inline void put_size(struct tinyc_diag_json *this, size_t n) {
+    char buf[32];
+    put_n(this, buf, snprintf(buf, sizeof(buf), "%zu", n));
+}
+
+/// Write s as JSON string, including quotes. Bytes not encoded in UTF-8 are
+/// replaced with U+FFFD, so output is always valid JSON.
+static void put_string(struct tinyc_diag_json *this, const char *s) {
+    put_n(this, "\"", 1);
+    const char *end = s + strlen(s);
+    const char *run = s;  // Start of characters not yet written.
+    while (*s) {
+        const unsigned char c = *s;
+        if (c >= 0x80) {
+            const size_t len = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : 2;
+            const bool valid = len <= (size_t)(end - s) &&
+                               tinyc_utf8_validate(s, len) == len;
+            if (valid) {
+                s += len;
+                continue;
+            }
+        } else if (c >= 0x20 && c != '"' && c != '\\') {
+            ++s;
+            continue;
+        }
+
+        put_n(this, run, s - run);
+        char esc[8];
+        switch (c) {
+            case '"':
+                put(this, "\\\"");
+                break;
+            case '\\':
+                put(this, "\\\\");
+                break;
+            case '\n':
+                put(this, "\\n");
+                break;
+            case '\t':
+                put(this, "\\t");
+                break;
+            default:
+                if (c >= 0x80) {
+                    put(this, "\\ufffd");
+                } else {
+                    snprintf(esc, sizeof(esc), "\\u%04x", c);
+                    put(this, esc);
+                }
+                break;
+        }
+        run = ++s;
+    }
+    put_n(this, run, s - run);
+    put_n(this, "\"", 1);
+}
+
+/// Write path as URI, percent-encoding all but unreserved characters and
+/// '/'. Absolute path becomes file URI, and relative path stays relative.
+static void put_uri(struct tinyc_diag_json *this, const char *path) {
+    static const char hex[] = "0123456789ABCDEF";
+    put_n(this, "\"", 1);
+    if (path[0] == '/') put(this, "file://");
+    for (const char *s = path; *s; ++s) {
+        const unsigned char c = *s;
+        if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') ||
+            ('0' <= c && c <= '9') || strchr("-._~/", c)) {
+            put_n(this, s, 1);
+        } else {
+            const char esc[3] = {'%', hex[c >> 4], hex[c & 0xf]};
+            put_n(this, esc, 3);
+        }
+    }
+    put_n(this, "\"", 1);
+}
+
+/// Get 1-based column in code points of character at pos, as SARIF requires.
+/// Byte offset is used if no such line exists.
+static size_t column_of(
+    const struct tinyc_source *source,
+    const struct tinyc_position *pos
+) {
+    const struct tinyc_source_line *line = source
+        ? tinyc_source_at(source, pos->row)
+        : NULL;
+    if (!line) return pos->offset + 1;
+    size_t column = 1;
+    for (size_t i = 0; i < pos->offset; ++i) {
+        // Continuation bytes don't start a code point.
+        const unsigned char c = i < line->line.len ? line->line.cstr[i] : 0;
+        column += (c & 0xc0) != 0x80;
+    }
+    return column;
+}
+
+static inline const char *severity_string(enum tinyc_diag_severity severity) {
+    switch (severity) {
+        case TINYC_DIAG_INFO:
+            return "info";
+        case TINYC_DIAG_WARN:
+            return "warning";
+        default:  // TINYC_DIAG_ERROR
+            return "error";
+    }
+}
+
+static inline const char *sarif_level(enum tinyc_diag_severity severity) {
+    switch (severity) {
+        case TINYC_DIAG_INFO:
+            return "note";
+        case TINYC_DIAG_WARN:
+            return "warning";
+        default:  // TINYC_DIAG_ERROR
+            return "error";
+    }
+}
+
+static void put_position(
+    struct tinyc_diag_json *this,
+    const struct tinyc_position *pos
+) {
+    put(this, "{\"row\":");
+    put_size(this, pos->row);
+    put(this, ",\"offset\":");
+    put_size(this, pos->offset);
+    put(this, "}");
+}
+
+static void emit_line(
+    struct tinyc_diag_json *this,
+    enum tinyc_diag_severity severity,
+    const char *file,
+    const struct tinyc_span *span,
+    const char *what,
+    const char *message
+) {
+    put(this, "{\"severity\":\"");
+    put(this, severity_string(severity));
+    put(this, "\",\"file\":");
+    put_string(this, file);
+    put(this, ",\"start\":");
+    put_position(this, &span->start);
+    put(this, ",\"end\":");
+    put_position(this, &span->end);
+    put(this, ",\"what\":");
+    put_string(this, what);
+    put(this, ",\"message\":");
+    put_string(this, message);
+    put(this, "}\n");
+}
+
+static void emit_sarif(
+    struct tinyc_diag_json *this,
+    enum tinyc_diag_severity severity,
+    const struct tinyc_source *source,
+    const char *file,
+    const struct tinyc_span *span,
+    const char *what,
+    const char *message
+) {
+    if (this->count != 0) put(this, ",");
+    put(this, "{\"ruleId\":");
+    put_string(this, what);
+    put(this, ",\"level\":\"");
+    put(this, sarif_level(severity));
+    put(this, "\",\"message\":{\"text\":");
+    put_string(this, message);
+    put(this, "},\"locations\":[{\"physicalLocation\":{");
+    put(this, "\"artifactLocation\":{\"uri\":");
+    put_uri(this, file);
+    put(this, "},\"region\":{\"startLine\":");
+    put_size(this, span->start.row + 1);
+    put(this, ",\"startColumn\":");
+    put_size(this, column_of(source, &span->start));
+    put(this, ",\"endLine\":");
+    put_size(this, span->end.row + 1);
+    put(this, ",\"endColumn\":");
+    put_size(this, column_of(source, &span->end) + 1);
+    put(this, "}}}]}");
+}
+
+bool tinyc_diag_json_init(
+    struct tinyc_diag_json *this,
+    FILE *fs,
+    enum tinyc_diag_json_format format
+) {
+    this->fs = fs;
+    this->format = format;
+    this->count = 0;
+    this->ok = true;
+    this->len = 0;
+    if (format == TINYC_DIAG_JSON_SARIF) put(this, SARIF_HEADER);
+    return this->ok;
+}
+
+bool tinyc_diag_json_emit(
+    struct tinyc_diag_json *this,
+    enum tinyc_diag_severity severity,
+    const struct tinyc_repo *repo,
+    const struct tinyc_span *span,
+    const char *what,
+    const char *message
+) {
+    const struct tinyc_source *source = tinyc_repo_query(repo, span->id);
+    const char *file = source ? source->name.cstr : "";
+    if (this->format == TINYC_DIAG_JSON_SARIF) {
+        emit_sarif(this, severity, source, file, span, what, message);
+    } else {
+        emit_line(this, severity, file, span, what, message);
+    }
+    this->count++;
+    return this->ok;
+}
+
+bool tinyc_diag_json_finish(struct tinyc_diag_json *this) {
+    if (this->format == TINYC_DIAG_JSON_SARIF) put(this, SARIF_TRAILER);
+    flush(this);
+    return this->ok && fflush(this->fs) == 0;
+}
@@ -0,0 +1,356 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "tinyc/header_search.h"
+
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/map.h"
+#include "tinyc/string.h"
+
+#define DEFAULT_CAP 8
+
+static inline const char *skip_space(const char *s) {
+    while (*s == ' ' || *s == '\t') s++;
+    return s;
+}
+
+/// Join dir and path with '/'. If path is absolute, dir is ignored.
+static bool join(
+    const char *dir,
+    const struct tinyc_string *path,
+    struct tinyc_string *res
+) {
+    const bool absolute = path->len && path->cstr[0] == '/';
+    const size_t dir_len = absolute ? 0 : strlen(dir);
+    const size_t sep = dir_len ? 1 : 0;
+    res->len = dir_len + sep + path->len;
+    res->cap = res->len + 1;
+    res->cstr = tinyc_alloc(sizeof(char) * res->cap);
+    if (!res->cstr) return false;
+    memcpy(res->cstr, dir, dir_len);
+    if (sep) res->cstr[dir_len] = '/';
+    memcpy(res->cstr + dir_len + sep, path->cstr, path->len);
+    res->cstr[res->len] = '\0';
+    return true;
+}
+
+/// Entries of directory and its modification time when it's listed.
+struct listing {
+    struct tinyc_map *names;  // NULL if directory can't be read.
+    struct timespec mtime;
+};
+
+/// Convert dir into path terminated with '\0'.
+/// dir may not be terminated with '\0', and empty dir means root.
+static bool dir_path(
+    const struct tinyc_string *dir,
+    struct tinyc_string *res
+) {
+    if (!tinyc_string_init(res)) return false;
+    if (dir->len == 0) tinyc_string_push(res, '/');
+    if (!tinyc_string_append(res, dir->cstr, dir->len)) {
+        tinyc_string_free(res);
+        return false;
+    }
+    return true;
+}
+
+/// Get modification time of path, or zero if it can't be get.
+static struct timespec mtime_of(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        const struct timespec zero = {0, 0};
+        return zero;
+    }
+    return st.st_mtim;
+}
+
+static void free_listing(struct listing *listing) {
+    if (listing->names) tinyc_map_free(listing->names);
+    tinyc_free(listing->names);
+    tinyc_free(listing);
+}
+
+/// Read entries of directory into listing, whose names is NULL if directory
+/// can't be read. dir may not be terminated with '\0'.
+static bool list_dir(const struct tinyc_string *dir, struct listing **res) {
+    struct tinyc_string path;
+    if (!dir_path(dir, &path)) return false;
+    *res = tinyc_alloc(sizeof(struct listing));
+    if (!*res) {
+        tinyc_string_free(&path);
+        return false;
+    }
+    (*res)->names = NULL;
+    (*res)->mtime = mtime_of(path.cstr);
+    DIR *dp = opendir(path.cstr);
+    tinyc_string_free(&path);
+    if (!dp) return true;
+
+    struct tinyc_map *names = tinyc_alloc(sizeof(struct tinyc_map));
+    if (!names || !tinyc_map_init(names)) {
+        tinyc_free(names);
+        tinyc_free(*res);
+        closedir(dp);
+        return false;
+    }
+    (*res)->names = names;
+    struct dirent *entry;
+    while ((entry = readdir(dp))) {
+        struct tinyc_string name;
+        tinyc_string_from(&name, entry->d_name);
+        if (!tinyc_map_insert(names, &name, names)) {
+            free_listing(*res);
+            closedir(dp);
+            return false;
+        }
+    }
+    closedir(dp);
+    return true;
+}
+
+/// Get entries of directory, listing it if not yet.
+static bool get_listing(
+    struct tinyc_header_search *this,
+    const struct tinyc_string *dir,
+    struct tinyc_map **res
+) {
+    void *value;
+    if (tinyc_map_query(&this->listings, dir, &value)) {
+        *res = ((struct listing *)value)->names;
+        return true;
+    }
+    struct listing *listing;
+    if (!list_dir(dir, &listing)) return false;
+    if (!tinyc_map_insert(&this->listings, dir, listing)) {
+        free_listing(listing);
+        return false;
+    }
+    *res = listing->names;
+    return true;
+}
+
+/// Check whether file exists, using only cached listing of directories.
+static bool exists(
+    struct tinyc_header_search *this,
+    const struct tinyc_string *file,
+    bool *res
+) {
+    *res = false;
+    const char *slash = strrchr(file->cstr, '/');
+    struct tinyc_string dir, name;
+    if (slash) {
+        dir.cstr = file->cstr;
+        dir.len = slash - file->cstr;
+        tinyc_string_from(&name, (char *)slash + 1);
+    } else {
+        tinyc_string_from(&dir, ".");
+        tinyc_string_from(&name, file->cstr);
+    }
+    dir.cap = 0;
+
+    struct tinyc_map *names;
+    if (!get_listing(this, &dir, &names)) return false;
+    *res = names && tinyc_map_query(names, &name, NULL);
+    return true;
+}
+
+/// Try to find path in dir. Set interned path to res if found.
+static bool find_in(
+    struct tinyc_header_search *this,
+    const char *dir,
+    const struct tinyc_string *path,
+    const struct tinyc_string **res
+) {
+    *res = NULL;
+    struct tinyc_string file;
+    if (!join(dir, path, &file)) return false;
+
+    bool found;
+    if (!exists(this, &file, &found)) {
+        tinyc_string_free(&file);
+        return false;
+    }
+    if (!found) {
+        tinyc_string_free(&file);
+        return true;
+    }
+
+    void *value;
+    if (tinyc_map_query(&this->paths, &file, &value)) {
+        tinyc_string_free(&file);
+        *res = value;
+        return true;
+    }
+    struct tinyc_string *interned = tinyc_alloc(sizeof(struct tinyc_string));
+    if (!interned || !tinyc_map_insert(&this->paths, &file, interned)) {
+        tinyc_free(interned);
+        tinyc_string_free(&file);
+        return false;
+    }
+    *interned = file;
+    *res = interned;
+    return true;
+}
+
+bool tinyc_header_search_init(struct tinyc_header_search *this) {
+    this->dirs = NULL;
+    this->ndirs = this->cap = 0;
+    if (!tinyc_map_init(&this->listings)) return false;
+    if (!tinyc_map_init(&this->paths)) return false;
+    if (!tinyc_map_init(&this->found[0])) return false;
+    if (!tinyc_map_init(&this->found[1])) return false;
+    return true;
+}
+
+bool tinyc_header_search_add_dir(
+    struct tinyc_header_search *this,
+    const char *dir
+) {
+    if (this->ndirs == this->cap) {
+        const size_t new_cap = this->cap ? this->cap * 2 : DEFAULT_CAP;
+        struct tinyc_string *new_dirs = tinyc_realloc(
+            this->dirs,
+            sizeof(struct tinyc_string) * new_cap
+        );
+        if (!new_dirs) return false;
+        this->dirs = new_dirs;
+        this->cap = new_cap;
+    }
+    if (!tinyc_string_from_copy(&this->dirs[this->ndirs], dir)) return false;
+    this->ndirs++;
+    return true;
+}
+
+const struct tinyc_string *tinyc_header_search_resolve(
+    struct tinyc_header_search *this,
+    const char *base,
+    bool is_std,
+    const struct tinyc_string *path
+) {
+    const struct tinyc_string *res;
+    if (!is_std && base) {
+        if (!find_in(this, base, path, &res)) return NULL;
+        if (res) return res;
+    }
+
+    struct tinyc_map *found = &this->found[is_std];
+    void *value;
+    if (tinyc_map_query(found, path, &value)) return value;
+
+    res = NULL;
+    for (size_t i = 0; i < this->ndirs && !res; ++i) {
+        if (!find_in(this, this->dirs[i].cstr, path, &res)) return NULL;
+    }
+    tinyc_map_insert(found, path, (void *)res);
+    return res;
+}
+
+bool tinyc_header_search_revalidate(struct tinyc_header_search *this) {
+    bool changed = false;
+    for (size_t i = 0; i < this->listings.cap && !changed; ++i) {
+        const struct tinyc_map_entry *e = &this->listings.entries[i];
+        if (!e->used) continue;
+        const struct listing *listing = e->value;
+        struct tinyc_string path;
+        if (!dir_path(&e->key, &path)) return false;
+        const struct timespec mtime = mtime_of(path.cstr);
+        tinyc_string_free(&path);
+        changed = mtime.tv_sec != listing->mtime.tv_sec ||
+                  mtime.tv_nsec != listing->mtime.tv_nsec;
+    }
+    if (!changed) return true;
+
+    // Interned paths are kept, as they may be still referenced.
+    for (size_t i = 0; i < this->listings.cap; ++i) {
+        const struct tinyc_map_entry *e = &this->listings.entries[i];
+        if (e->used) free_listing(e->value);
+    }
+    tinyc_map_free(&this->listings);
+    tinyc_map_free(&this->found[0]);
+    tinyc_map_free(&this->found[1]);
+    return tinyc_map_init(&this->listings) &&
+           tinyc_map_init(&this->found[0]) && tinyc_map_init(&this->found[1]);
+}
+
+void tinyc_header_search_free(struct tinyc_header_search *this) {
+    for (size_t i = 0; i < this->ndirs; ++i) {
+        tinyc_string_free(&this->dirs[i]);
+    }
+    tinyc_free(this->dirs);
+
+    for (size_t i = 0; i < this->listings.cap; ++i) {
+        const struct tinyc_map_entry *e = &this->listings.entries[i];
+        if (e->used) free_listing(e->value);
+    }
+    for (size_t i = 0; i < this->paths.cap; ++i) {
+        const struct tinyc_map_entry *e = &this->paths.entries[i];
+        if (!e->used) continue;
+        tinyc_string_free(e->value);
+        tinyc_free(e->value);
+    }
+    tinyc_map_free(&this->listings);
+    tinyc_map_free(&this->paths);
+    tinyc_map_free(&this->found[0]);
+    tinyc_map_free(&this->found[1]);
+}
+
+bool tinyc_header_search_parse_include(
+    const struct tinyc_string *line,
+    bool *is_std,
+    struct tinyc_string *path
+) {
+    const char *s = skip_space(line->cstr);
+    if (*s != '#') return false;
+    s = skip_space(s + 1);
+    if (strncmp(s, "include", 7) != 0) return false;
+    s = skip_space(s + 7);
+    if (*s != '<' && *s != '"') return false;
+
+    *is_std = *s == '<';
+    const char close = *is_std ? '>' : '"';
+    const char *end = strchr(++s, close);
+    if (!end || end == s) return false;
+    if (!tinyc_string_init(path)) return false;
+    for (; s != end; ++s) {
+        if (!tinyc_string_push(path, *s)) {
+            tinyc_string_free(path);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool tinyc_header_search_dirname(
+    const struct tinyc_string *path,
+    struct tinyc_string *res
+) {
+    const char *slash = strrchr(path->cstr, '/');
+    if (!slash) return tinyc_string_from_copy(res, ".");
+    if (!tinyc_string_init(res)) return false;
+    for (const char *s = path->cstr; s != slash; ++s) {
+        if (!tinyc_string_push(res, *s)) {
+            tinyc_string_free(res);
+            return false;
+        }
+    }
+    return true;
+}
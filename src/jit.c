@@ -0,0 +1,2400 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE  // For MAP_ANONYMOUS.
+
+#include "tinyc/jit.h"
+
+#include <dlfcn.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/ast.h"
+#include "tinyc/string.h"
+#include "tinyc/symtab.h"
+#include "tinyc/type.h"
+
+#define DEFAULT_CAP 4096
+#define CHUNK_SIZE 16384
+
+// Maximum depth of nested expressions, as they're compiled recursively.
+#define MAX_NESTING 4096
+
+// Emit bytes of an instruction.
+#define EMIT(this, ...)                        \
+    emit(                                      \
+        this,                                  \
+        (const uint8_t[]){__VA_ARGS__},        \
+        sizeof((const uint8_t[]){__VA_ARGS__}) \
+    )
+
+// General purpose registers by their number in encoding.
+enum reg { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11 };
+
+// Registers to pass arguments in, in order.
+static const enum reg arg_regs[] = {RDI, RSI, RDX, RCX, R8, R9};
+#define MAX_ARGS (sizeof(arg_regs) / sizeof(*arg_regs))
+
+// Condition codes of setcc and jcc.
+enum cond {
+    CC_B = 0x2,
+    CC_AE = 0x3,
+    CC_E = 0x4,
+    CC_NE = 0x5,
+    CC_BE = 0x6,
+    CC_A = 0x7,
+    CC_L = 0xc,
+    CC_GE = 0xd,
+    CC_LE = 0xe,
+    CC_G = 0xf,
+};
+
+struct tinyc_jit_chunk {
+    struct tinyc_jit_chunk *next;
+    size_t len, cap;  // In bytes.
+    void *data[];     // Aligned for any object in arena.
+};
+
+enum symbol_kind {
+    SYMBOL_LOCAL,
+    SYMBOL_GLOBAL,
+    SYMBOL_FUNCTION,
+    SYMBOL_TYPEDEF,
+    SYMBOL_CONSTANT,
+};
+
+/// What an identifier is bound to.
+struct symbol {
+    enum symbol_kind kind;
+    const struct tinyc_type *type;
+    const char *name;  // Valid while compiling.
+    int64_t value;     // Frame offset of local, offset of function in code
+                       // or -1 if not defined, or value of constant.
+    void *addr;        // Object of global, or NULL if defined outside unit.
+};
+
+/// Place in code to be filled with address of symbol.
+struct fixup {
+    size_t pos;
+    const struct symbol *symbol;
+    tinyc_ast_ref ref;  // Where it's referred.
+};
+
+/// Jump whose destination is resolved later.
+struct jump {
+    size_t pos;  // Position of its displacement.
+    tinyc_ast_ref ref;
+};
+
+struct jumps {
+    struct jump *items;
+    size_t len, cap;
+};
+
+/// Statement which break jumps out of.
+struct target {
+    struct target *outer;
+    bool is_switch;
+    struct jumps breaks, continues;
+    struct jumps cases;   // Jumps to each case of switch.
+    size_t next_case;     // Index of case likely generated next.
+    size_t default_jump;  // Jump to default of switch.
+    bool has_default;
+};
+
+struct compiler {
+    struct tinyc_jit *jit;
+    const struct tinyc_ast *ast;
+    struct tinyc_jit_error *error;
+    bool failed;
+    uint8_t *code;
+    size_t len, cap;
+    struct fixup *fixups;
+    size_t nfixups, fixups_cap;
+    size_t depth;                  // Number of values pushed in function.
+    size_t nesting;                // Depth of expressions being compiled.
+    tinyc_ast_ref *spine;          // Binary operators of chains compiling.
+    size_t nspine, spine_cap;
+    int64_t frame;                 // Size of locals of function.
+    const struct tinyc_type *ret;  // Return type of function.
+    struct target *target;         // Innermost loop or switch.
+    struct jumps labels, gotos;    // In function.
+};
+
+/// Allocate zeroed size bytes in arena of unit.
+static void *allocate(struct tinyc_jit *this, size_t size) {
+    size = (size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+    struct tinyc_jit_chunk *chunk = this->chunks;
+    if (!chunk || chunk->cap - chunk->len < size) {
+        const size_t cap = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+        chunk = tinyc_calloc(1, sizeof(struct tinyc_jit_chunk) + cap);
+        if (!chunk) return NULL;
+        chunk->next = this->chunks;
+        chunk->len = 0;
+        chunk->cap = cap;
+        this->chunks = chunk;
+    }
+    void *p = (char *)chunk->data + chunk->len;
+    chunk->len += size;
+    return p;
+}
+
+/// Record error at node unless already failed.
+static void *fail(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    const char *message
+) {
+    if (!this->failed) {
+        this->failed = true;
+        this->error->span = this->ast->spans[ref];
+        this->error->message = message;
+    }
+    return NULL;
+}
+
+static void emit(struct compiler *this, const uint8_t *bytes, size_t n) {
+    if (this->failed) return;
+    if (this->cap - this->len < n) {
+        size_t cap = this->cap * 2;
+        while (cap - this->len < n) cap *= 2;
+        uint8_t *code = tinyc_realloc(this->code, cap);
+        if (!code) {
+            fail(this, 0, "out of memory");
+            return;
+        }
+        this->code = code;
+        this->cap = cap;
+    }
+    memcpy(this->code + this->len, bytes, n);
+    this->len += n;
+}
+
+static void emit32(struct compiler *this, uint32_t x) {
+    EMIT(this, x, x >> 8, x >> 16, x >> 24);
+}
+
+static void emit64(struct compiler *this, uint64_t x) {
+    emit32(this, x);
+    emit32(this, x >> 32);
+}
+
+/// Overwrite 32 bits at pos.
+static void patch32(struct compiler *this, size_t pos, uint32_t x) {
+    if (this->failed) return;
+    for (size_t i = 0; i < 4; ++i) this->code[pos + i] = x >> (i * 8);
+}
+
+/// Make jump whose displacement is at pos go to dest.
+static void patch(struct compiler *this, size_t pos, size_t dest) {
+    patch32(this, pos, (uint32_t)(dest - (pos + 4)));
+}
+
+static void add_jump(
+    struct compiler *this,
+    struct jumps *jumps,
+    size_t pos,
+    tinyc_ast_ref ref
+) {
+    if (jumps->len == jumps->cap) {
+        const size_t cap = jumps->cap ? jumps->cap * 2 : 8;
+        struct jump *items = tinyc_realloc(
+            jumps->items,
+            sizeof(struct jump) * cap
+        );
+        if (!items) {
+            fail(this, ref, "out of memory");
+            return;
+        }
+        jumps->items = items;
+        jumps->cap = cap;
+    }
+    jumps->items[jumps->len++] = (struct jump){pos, ref};
+}
+
+/// Make all jumps go to dest.
+static void patch_all(
+    struct compiler *this,
+    const struct jumps *jumps,
+    size_t dest
+) {
+    for (size_t i = 0; i < jumps->len; ++i) {
+        patch(this, jumps->items[i].pos, dest);
+    }
+}
+
+/// push rax
+static void push(struct compiler *this) {
+    EMIT(this, 0x50);
+    this->depth++;
+}
+
+/// pop reg
+static void pop(struct compiler *this, enum reg reg) {
+    if (reg >= R8) EMIT(this, 0x41);
+    EMIT(this, 0x58 | (reg & 7));
+    this->depth--;
+}
+
+/// mov rax, value
+static void imm(struct compiler *this, int64_t value) {
+    if (value >= INT32_MIN && value <= INT32_MAX) {
+        EMIT(this, 0x48, 0xc7, 0xc0);
+        emit32(this, (uint32_t)value);
+    } else {
+        EMIT(this, 0x48, 0xb8);
+        emit64(this, (uint64_t)value);
+    }
+}
+
+/// mov rax, address of symbol, which is filled after all code is generated.
+static void address(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    const struct symbol *symbol
+) {
+    if (this->nfixups == this->fixups_cap) {
+        const size_t cap = this->fixups_cap ? this->fixups_cap * 2 : 16;
+        struct fixup *fixups = tinyc_realloc(
+            this->fixups,
+            sizeof(struct fixup) * cap
+        );
+        if (!fixups) {
+            fail(this, ref, "out of memory");
+            return;
+        }
+        this->fixups = fixups;
+        this->fixups_cap = cap;
+    }
+    EMIT(this, 0x48, 0xb8);
+    this->fixups[this->nfixups++] = (struct fixup){this->len, symbol, ref};
+    emit64(this, 0);
+}
+
+/// lea reg, [rbp + offset]
+static void lea_local(struct compiler *this, enum reg reg, int64_t offset) {
+    EMIT(this, 0x48, 0x8d, 0x85 | reg << 3);
+    emit32(this, (uint32_t)offset);
+}
+
+/// test rax, rax
+static void test(struct compiler *this) {
+    EMIT(this, 0x48, 0x85, 0xc0);
+}
+
+/// Set rax to 1 if condition holds, or 0 otherwise.
+static void set(struct compiler *this, enum cond cc) {
+    EMIT(this, 0x0f, 0x90 | cc, 0xc0);  // setcc al
+    EMIT(this, 0x0f, 0xb6, 0xc0);       // movzx eax, al
+}
+
+/// Emit jmp, and return position of its displacement.
+static size_t jmp(struct compiler *this) {
+    EMIT(this, 0xe9);
+    const size_t pos = this->len;
+    emit32(this, 0);
+    return pos;
+}
+
+/// Emit jcc, and return position of its displacement.
+static size_t jcc(struct compiler *this, enum cond cc) {
+    EMIT(this, 0x0f, 0x80 | cc);
+    const size_t pos = this->len;
+    emit32(this, 0);
+    return pos;
+}
+
+/// Return from function with rax.
+static void epilogue(struct compiler *this) {
+    EMIT(this, 0x48, 0x89, 0xec);  // mov rsp, rbp
+    EMIT(this, 0x5d, 0xc3);        // pop rbp; ret
+}
+
+static inline bool is_integer(const struct tinyc_type *type) {
+    return type->kind >= TINYC_TYPE_BOOL && type->kind <= TINYC_TYPE_ULLONG;
+}
+
+static inline bool is_pointer(const struct tinyc_type *type) {
+    return type->kind == TINYC_TYPE_POINTER;
+}
+
+static inline bool is_scalar(const struct tinyc_type *type) {
+    return is_integer(type) || is_pointer(type);
+}
+
+static bool is_signed(const struct tinyc_type *type) {
+    switch (type->kind) {
+        case TINYC_TYPE_CHAR:
+        case TINYC_TYPE_SCHAR:
+        case TINYC_TYPE_SHORT:
+        case TINYC_TYPE_INT:
+        case TINYC_TYPE_LONG:
+        case TINYC_TYPE_LLONG:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// Get size of type, or 0 if it's incomplete.
+static size_t size_of(const struct tinyc_type *type) {
+    switch (type->kind) {
+        case TINYC_TYPE_VOID:
+            return 0;
+        case TINYC_TYPE_BOOL:
+        case TINYC_TYPE_CHAR:
+        case TINYC_TYPE_SCHAR:
+        case TINYC_TYPE_UCHAR:
+        case TINYC_TYPE_FUNCTION:
+            return 1;
+        case TINYC_TYPE_SHORT:
+        case TINYC_TYPE_USHORT:
+            return 2;
+        case TINYC_TYPE_INT:
+        case TINYC_TYPE_UINT:
+        case TINYC_TYPE_ENUM:
+            return 4;
+        case TINYC_TYPE_ARRAY:
+            if (type->len == TINYC_TYPE_UNKNOWN_LEN) return 0;
+            return type->len * size_of(type->base);
+        default:
+            return 8;
+    }
+}
+
+static size_t align_of(const struct tinyc_type *type) {
+    while (type->kind == TINYC_TYPE_ARRAY) type = type->base;
+    const size_t size = size_of(type);
+    return size ? size : 1;
+}
+
+/// Get size of object pointer points to, where void counts as 1 byte.
+static size_t stride(const struct tinyc_type *pointer) {
+    const size_t size = size_of(pointer->base);
+    return size ? size : 1;
+}
+
+/// Convert value of 64 bits to type, as integers are sign or zero extended.
+static int64_t narrow(const struct tinyc_type *type, int64_t value) {
+    switch (type->kind) {
+        case TINYC_TYPE_BOOL:
+            return value != 0;
+        case TINYC_TYPE_CHAR:
+        case TINYC_TYPE_SCHAR:
+            return (int8_t)value;
+        case TINYC_TYPE_UCHAR:
+            return (uint8_t)value;
+        case TINYC_TYPE_SHORT:
+            return (int16_t)value;
+        case TINYC_TYPE_USHORT:
+            return (uint16_t)value;
+        case TINYC_TYPE_INT:
+        case TINYC_TYPE_ENUM:
+            return (int32_t)value;
+        case TINYC_TYPE_UINT:
+            return (uint32_t)value;
+        default:
+            return value;
+    }
+}
+
+static const struct tinyc_type *basic(
+    struct compiler *this,
+    enum tinyc_type_kind kind
+) {
+    return tinyc_type_basic(&this->jit->types, kind);
+}
+
+static const struct tinyc_type *pointer_to(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    const struct tinyc_type *base
+) {
+    const struct tinyc_type *type = tinyc_type_pointer(&this->jit->types, base);
+    return type ? type : fail(this, ref, "out of memory");
+}
+
+/// Apply integer promotion to type.
+static const struct tinyc_type *promote(
+    struct compiler *this,
+    const struct tinyc_type *type
+) {
+    return type->kind < TINYC_TYPE_INT ? basic(this, TINYC_TYPE_INT)
+                                       : type->unqual;
+}
+
+static inline int rank(const struct tinyc_type *type) {
+    return (type->kind - TINYC_TYPE_INT) / 2;
+}
+
+/// Get common type of integers by usual arithmetic conversions.
+static const struct tinyc_type *arith(
+    struct compiler *this,
+    const struct tinyc_type *a,
+    const struct tinyc_type *b
+) {
+    a = promote(this, a);
+    b = promote(this, b);
+    if (a == b) return a;
+    if (rank(a) == rank(b)) return is_signed(a) ? b : a;
+    const struct tinyc_type *hi = rank(a) > rank(b) ? a : b;
+    const struct tinyc_type *lo = hi == a ? b : a;
+    if (!is_signed(hi) || size_of(hi) > size_of(lo)) return hi;
+    return basic(this, hi->kind + 1);
+}
+
+/// Convert rax to type. Integers in rax are always sign or zero extended
+/// from their type, so this only extends again from width of type.
+static void convert(struct compiler *this, const struct tinyc_type *type) {
+    switch (type->kind) {
+        case TINYC_TYPE_BOOL:
+            test(this);
+            set(this, CC_NE);
+            break;
+        case TINYC_TYPE_CHAR:
+        case TINYC_TYPE_SCHAR:
+            EMIT(this, 0x48, 0x0f, 0xbe, 0xc0);  // movsx rax, al
+            break;
+        case TINYC_TYPE_UCHAR:
+            EMIT(this, 0x0f, 0xb6, 0xc0);  // movzx eax, al
+            break;
+        case TINYC_TYPE_SHORT:
+            EMIT(this, 0x48, 0x0f, 0xbf, 0xc0);  // movsx rax, ax
+            break;
+        case TINYC_TYPE_USHORT:
+            EMIT(this, 0x0f, 0xb7, 0xc0);  // movzx eax, ax
+            break;
+        case TINYC_TYPE_INT:
+        case TINYC_TYPE_ENUM:
+            EMIT(this, 0x48, 0x63, 0xc0);  // movsxd rax, eax
+            break;
+        case TINYC_TYPE_UINT:
+            EMIT(this, 0x89, 0xc0);  // mov eax, eax
+            break;
+        default:
+            break;
+    }
+}
+
+/// Load object of type at rax into rax.
+static void load(struct compiler *this, const struct tinyc_type *type) {
+    switch (type->kind) {
+        case TINYC_TYPE_BOOL:
+        case TINYC_TYPE_UCHAR:
+            EMIT(this, 0x0f, 0xb6, 0x00);  // movzx eax, byte [rax]
+            break;
+        case TINYC_TYPE_CHAR:
+        case TINYC_TYPE_SCHAR:
+            EMIT(this, 0x48, 0x0f, 0xbe, 0x00);  // movsx rax, byte [rax]
+            break;
+        case TINYC_TYPE_SHORT:
+            EMIT(this, 0x48, 0x0f, 0xbf, 0x00);  // movsx rax, word [rax]
+            break;
+        case TINYC_TYPE_USHORT:
+            EMIT(this, 0x0f, 0xb7, 0x00);  // movzx eax, word [rax]
+            break;
+        case TINYC_TYPE_INT:
+        case TINYC_TYPE_ENUM:
+            EMIT(this, 0x48, 0x63, 0x00);  // movsxd rax, [rax]
+            break;
+        case TINYC_TYPE_UINT:
+            EMIT(this, 0x8b, 0x00);  // mov eax, [rax]
+            break;
+        default:
+            EMIT(this, 0x48, 0x8b, 0x00);  // mov rax, [rax]
+            break;
+    }
+}
+
+/// Store rax into object of type at rcx.
+static void store(struct compiler *this, const struct tinyc_type *type) {
+    switch (size_of(type)) {
+        case 1:
+            EMIT(this, 0x88, 0x01);  // mov [rcx], al
+            break;
+        case 2:
+            EMIT(this, 0x66, 0x89, 0x01);  // mov [rcx], ax
+            break;
+        case 4:
+            EMIT(this, 0x89, 0x01);  // mov [rcx], eax
+            break;
+        default:
+            EMIT(this, 0x48, 0x89, 0x01);  // mov [rcx], rax
+            break;
+    }
+}
+
+/// Store reg into object of type at offset in frame.
+static void spill(
+    struct compiler *this,
+    enum reg reg,
+    int64_t offset,
+    const struct tinyc_type *type
+) {
+    const uint8_t rex = reg >= R8 ? 0x44 : 0x40;
+    const uint8_t modrm = 0x85 | (reg & 7) << 3;
+    switch (size_of(type)) {
+        case 1:
+            EMIT(this, rex, 0x88, modrm);  // mov [rbp + offset], reg8
+            break;
+        case 2:
+            EMIT(this, 0x66, rex, 0x89, modrm);  // mov [rbp + offset], reg16
+            break;
+        case 4:
+            EMIT(this, rex, 0x89, modrm);  // mov [rbp + offset], reg32
+            break;
+        default:
+            EMIT(this, rex | 0x08, 0x89, modrm);  // mov [rbp + offset], reg
+            break;
+    }
+    emit32(this, (uint32_t)offset);
+}
+
+/// Get innermost binding of name of node.
+static const struct tinyc_symtab_symbol *lookup_binding(
+    struct compiler *this,
+    tinyc_ast_ref ref
+) {
+    struct tinyc_string name;
+    tinyc_string_from(&name, (char *)tinyc_ast_name(this->ast, ref));
+    return tinyc_symtab_lookup(
+        &this->jit->symbols,
+        TINYC_SYMTAB_ORDINARY,
+        &name
+    );
+}
+
+/// Get symbol name of node is bound to, or NULL if it's not declared.
+static struct symbol *lookup(struct compiler *this, tinyc_ast_ref ref) {
+    const struct tinyc_symtab_symbol *binding = lookup_binding(this, ref);
+    return binding ? binding->value : NULL;
+}
+
+/// Get symbol name of node is bound to in innermost scope, or NULL.
+static struct symbol *lookup_here(struct compiler *this, tinyc_ast_ref ref) {
+    const struct tinyc_symtab_symbol *binding = lookup_binding(this, ref);
+    if (!binding || binding->depth != this->jit->symbols.depth) return NULL;
+    return binding->value;
+}
+
+/// Bind name of node to new symbol in innermost scope.
+static struct symbol *declare(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    enum symbol_kind kind,
+    const struct tinyc_type *type
+) {
+    struct symbol *symbol = allocate(this->jit, sizeof(struct symbol));
+    if (!symbol) return fail(this, ref, "out of memory");
+    symbol->kind = kind;
+    symbol->type = type;
+    symbol->name = tinyc_ast_name(this->ast, ref);
+    symbol->value = kind == SYMBOL_FUNCTION ? -1 : 0;
+    symbol->addr = NULL;
+
+    struct tinyc_string name;
+    tinyc_string_from(&name, (char *)symbol->name);
+    const bool ok = tinyc_symtab_declare(
+        &this->jit->symbols,
+        TINYC_SYMTAB_ORDINARY,
+        &name,
+        symbol
+    );
+    return ok ? symbol : fail(this, ref, "out of memory");
+}
+
+static const struct tinyc_type *type_of(
+    struct compiler *this,
+    tinyc_ast_ref ref
+);
+static bool eval(struct compiler *this, tinyc_ast_ref ref, int64_t *value);
+static const struct tinyc_type *expr(struct compiler *this, tinyc_ast_ref ref);
+static const struct tinyc_type *lvalue(
+    struct compiler *this,
+    tinyc_ast_ref ref
+);
+
+static const struct tinyc_type *base_type(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    uint32_t flags
+) {
+    if (flags & (TINYC_AST_SPEC_FLOAT | TINYC_AST_SPEC_DOUBLE)) {
+        return fail(this, ref, "floating types are not supported");
+    }
+    const bool u = flags & TINYC_AST_SPEC_UNSIGNED;
+    enum tinyc_type_kind kind = u ? TINYC_TYPE_UINT : TINYC_TYPE_INT;
+    if (flags & TINYC_AST_SPEC_VOID) {
+        kind = TINYC_TYPE_VOID;
+    } else if (flags & TINYC_AST_SPEC_BOOL) {
+        kind = TINYC_TYPE_BOOL;
+    } else if (flags & TINYC_AST_SPEC_CHAR) {
+        kind = u ? TINYC_TYPE_UCHAR
+                 : (flags & TINYC_AST_SPEC_SIGNED ? TINYC_TYPE_SCHAR
+                                                  : TINYC_TYPE_CHAR);
+    } else if (flags & TINYC_AST_SPEC_SHORT) {
+        kind = u ? TINYC_TYPE_USHORT : TINYC_TYPE_SHORT;
+    } else if (flags & TINYC_AST_SPEC_LONG_LONG) {
+        kind = u ? TINYC_TYPE_ULLONG : TINYC_TYPE_LLONG;
+    } else if (flags & TINYC_AST_SPEC_LONG) {
+        kind = u ? TINYC_TYPE_ULONG : TINYC_TYPE_LONG;
+    }
+    return basic(this, kind);
+}
+
+/// Declare enumerators of enum type if it has body.
+static bool enumerators(struct compiler *this, tinyc_ast_ref ref) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    if (!(node->flags & TINYC_AST_COMPLETE)) return true;
+    int64_t next = 0;
+    for (uint32_t i = 0; i < node->nchildren; ++i) {
+        const tinyc_ast_ref enumerator = this->ast->refs[node->children + i];
+        const tinyc_ast_ref value = tinyc_ast_child(this->ast, enumerator, 0);
+        if (value && !eval(this, value, &next)) return false;
+        struct symbol *symbol = declare(
+            this,
+            enumerator,
+            SYMBOL_CONSTANT,
+            basic(this, TINYC_TYPE_INT)
+        );
+        if (!symbol) return false;
+        symbol->value = next++;
+    }
+    return true;
+}
+
+static const struct tinyc_type *function_type(
+    struct compiler *this,
+    tinyc_ast_ref ref
+) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    const tinyc_ast_ref ret_ref = this->ast->refs[node->children];
+    const struct tinyc_type *ret = type_of(this, ret_ref);
+    if (!ret) return NULL;
+    const size_t n = node->nchildren - 1;
+    const struct tinyc_type **params = tinyc_alloc(
+        sizeof(struct tinyc_type *) * (n ? n : 1)
+    );
+    if (!params) return fail(this, ref, "out of memory");
+    for (size_t i = 0; i < n; ++i) {
+        const tinyc_ast_ref param = this->ast->refs[node->children + 1 + i];
+        const struct tinyc_type *type = type_of(
+            this,
+            tinyc_ast_child(this->ast, param, 0)
+        );
+        if (!type) break;
+
+        // Parameters of array and function are adjusted to pointers.
+        if (type->kind == TINYC_TYPE_ARRAY) {
+            type = pointer_to(this, param, type->base);
+        } else if (type->kind == TINYC_TYPE_FUNCTION) {
+            type = pointer_to(this, param, type);
+        }
+        params[i] = type;
+    }
+
+    uint32_t flags = 0;
+    if (node->flags & TINYC_AST_PROTOTYPE) flags |= TINYC_TYPE_PROTOTYPE;
+    if (node->flags & TINYC_AST_VARIADIC) flags |= TINYC_TYPE_VARIADIC;
+    const struct tinyc_type *type = NULL;
+    if (!this->failed) {
+        type = tinyc_type_function(&this->jit->types, ret, params, n, flags);
+    }
+    tinyc_free(params);
+    return type || this->failed ? type : fail(this, ref, "out of memory");
+}
+
+/// Get type node stands for.
+static const struct tinyc_type *type_of(
+    struct compiler *this,
+    tinyc_ast_ref ref
+) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    struct tinyc_types *types = &this->jit->types;
+    const struct tinyc_type *type, *base;
+    const struct symbol *symbol;
+    int64_t len = -1;
+    switch (node->kind) {
+        case TINYC_AST_TYPE_BASE:
+            type = base_type(this, ref, node->flags);
+            break;
+        case TINYC_AST_TYPE_NAME:
+            symbol = lookup(this, ref);
+            if (!symbol || symbol->kind != SYMBOL_TYPEDEF) {
+                return fail(this, ref, "unknown type name");
+            }
+            type = symbol->type;
+            break;
+        case TINYC_AST_TYPE_STRUCT:
+            return fail(this, ref, "struct and union are not supported");
+        case TINYC_AST_TYPE_ENUM:
+            if (!enumerators(this, ref)) return NULL;
+            type = basic(this, TINYC_TYPE_INT);
+            break;
+        case TINYC_AST_TYPE_POINTER:
+            base = type_of(this, tinyc_ast_child(this->ast, ref, 0));
+            type = base ? tinyc_type_pointer(types, base) : NULL;
+            break;
+        case TINYC_AST_TYPE_ARRAY:
+            base = type_of(this, tinyc_ast_child(this->ast, ref, 0));
+            if (!base) return NULL;
+            if (!size_of(base)) {
+                return fail(this, ref, "array has incomplete element type");
+            }
+            if (tinyc_ast_child(this->ast, ref, 1)) {
+                if (!eval(this, tinyc_ast_child(this->ast, ref, 1), &len)) {
+                    return NULL;
+                }
+                if (len < 0) return fail(this, ref, "array size is negative");
+            }
+            type = tinyc_type_array(
+                types,
+                base,
+                len < 0 ? TINYC_TYPE_UNKNOWN_LEN : (size_t)len
+            );
+            break;
+        case TINYC_AST_TYPE_FUNC:
+            type = function_type(this, ref);
+            break;
+        default:
+            return fail(this, ref, "expected type");
+    }
+    if (this->failed) return NULL;
+
+    uint32_t quals = 0;
+    if (node->flags & TINYC_AST_QUAL_CONST) quals |= TINYC_TYPE_CONST;
+    if (node->flags & TINYC_AST_QUAL_VOLATILE) quals |= TINYC_TYPE_VOLATILE;
+    if (node->flags & TINYC_AST_QUAL_RESTRICT) quals |= TINYC_TYPE_RESTRICT;
+    if (type && quals) type = tinyc_type_qualified(types, type, quals);
+    return type ? type : fail(this, ref, "out of memory");
+}
+
+/// Get type of operand of sizeof without generating code for it.
+static const struct tinyc_type *operand_type(
+    struct compiler *this,
+    tinyc_ast_ref ref
+) {
+    const enum tinyc_ast_kind kind = this->ast->nodes[ref].kind;
+    if (kind >= TINYC_AST_TYPE_BASE && kind <= TINYC_AST_TYPE_FUNC) {
+        return type_of(this, ref);
+    }
+    if (kind == TINYC_AST_STRING) {
+        const struct tinyc_type *type = tinyc_type_array(
+            &this->jit->types,
+            basic(this, TINYC_TYPE_CHAR),
+            this->ast->nodes[ref].value + 1
+        );
+        return type ? type : fail(this, ref, "out of memory");
+    }
+
+    // Generate code to know type, and drop it. Objects aren't converted to
+    // value, so arrays keep their size.
+    const size_t len = this->len, nfixups = this->nfixups;
+    const size_t depth = this->depth;
+    const bool is_object = kind == TINYC_AST_IDENT ||
+                           kind == TINYC_AST_INDEX ||
+                           kind == TINYC_AST_DEREF;
+    const struct tinyc_type *type = is_object ? lvalue(this, ref)
+                                              : expr(this, ref);
+    this->len = len;
+    this->nfixups = nfixups;
+    this->depth = depth;
+    return type;
+}
+
+static inline bool is_binary(enum tinyc_ast_kind kind) {
+    return kind >= TINYC_AST_MUL && kind <= TINYC_AST_OR;
+}
+
+/// Push operators of left-associative chain of binary operators at ref, so
+/// they're walked iteratively instead of being nested. Returns its leftmost
+/// operand, or 0 if failed to allocate memory.
+static tinyc_ast_ref push_spine(struct compiler *this, tinyc_ast_ref ref) {
+    while (is_binary(this->ast->nodes[ref].kind)) {
+        if (this->nspine == this->spine_cap) {
+            const size_t cap = this->spine_cap ? this->spine_cap * 2 : 16;
+            tinyc_ast_ref *spine = tinyc_realloc(
+                this->spine,
+                sizeof(tinyc_ast_ref) * cap
+            );
+            if (!spine) {
+                fail(this, ref, "out of memory");
+                return 0;
+            }
+            this->spine = spine;
+            this->spine_cap = cap;
+        }
+        this->spine[this->nspine++] = ref;
+        ref = tinyc_ast_child(this->ast, ref, 0);
+    }
+    return ref;
+}
+
+/// Enter nested expression at ref. Returns false if nested too deep.
+static bool nest(struct compiler *this, tinyc_ast_ref ref) {
+    if (this->nesting == MAX_NESTING) {
+        fail(this, ref, "nesting too deep");
+        return false;
+    }
+    this->nesting++;
+    return true;
+}
+
+/// Apply binary operator op at ref to a and b.
+static bool fold(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    enum tinyc_ast_kind op,
+    int64_t a,
+    int64_t b,
+    int64_t *value
+) {
+    const uint64_t ua = a, ub = b;
+    switch (op) {
+        case TINYC_AST_MUL:
+            *value = (int64_t)(ua * ub);
+            return true;
+        case TINYC_AST_DIV:
+        case TINYC_AST_MOD:
+            if (b == 0) {
+                fail(this, ref, "division by zero");
+                return false;
+            }
+            if (b == -1) {
+                *value = op == TINYC_AST_DIV ? (int64_t)(0 - ua) : 0;
+            } else {
+                *value = op == TINYC_AST_DIV ? a / b : a % b;
+            }
+            return true;
+        case TINYC_AST_ADD:
+            *value = (int64_t)(ua + ub);
+            return true;
+        case TINYC_AST_SUB:
+            *value = (int64_t)(ua - ub);
+            return true;
+        case TINYC_AST_SHL:
+            *value = (int64_t)(ua << (ub & 63));
+            return true;
+        case TINYC_AST_SHR:
+            *value = a >> (ub & 63);
+            return true;
+        case TINYC_AST_LT:
+            *value = a < b;
+            return true;
+        case TINYC_AST_GT:
+            *value = a > b;
+            return true;
+        case TINYC_AST_LE:
+            *value = a <= b;
+            return true;
+        case TINYC_AST_GE:
+            *value = a >= b;
+            return true;
+        case TINYC_AST_EQ:
+            *value = a == b;
+            return true;
+        case TINYC_AST_NE:
+            *value = a != b;
+            return true;
+        case TINYC_AST_AND:
+            *value = a & b;
+            return true;
+        case TINYC_AST_XOR:
+            *value = a ^ b;
+            return true;
+        case TINYC_AST_OR:
+            *value = a | b;
+            return true;
+        default:
+            fail(this, ref, "expected constant expression");
+            return false;
+    }
+}
+
+/// Evaluate chain of binary operators at ref from its leftmost operand.
+static bool eval_chain(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    int64_t *value
+) {
+    const size_t base = this->nspine;
+    const tinyc_ast_ref first = push_spine(this, ref);
+    bool ok = first && eval(this, first, value);
+    while (ok && this->nspine > base) {
+        const tinyc_ast_ref op = this->spine[--this->nspine];
+        int64_t b;
+        ok = eval(this, tinyc_ast_child(this->ast, op, 1), &b) &&
+             fold(this, op, this->ast->nodes[op].kind, *value, b, value);
+    }
+    this->nspine = base;
+    return ok;
+}
+
+/// Same as eval, but without checking depth of nesting.
+static bool eval_node(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    int64_t *value
+) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    const tinyc_ast_ref x = tinyc_ast_child(this->ast, ref, 0);
+    tinyc_ast_ref y = tinyc_ast_child(this->ast, ref, 1);
+    const struct tinyc_type *type;
+    const struct symbol *symbol;
+    int64_t a = 0, b = 0;
+    switch (node->kind) {
+        case TINYC_AST_INT:
+            *value = (int64_t)node->value;
+            return true;
+        case TINYC_AST_IDENT:
+            symbol = lookup(this, ref);
+            if (!symbol || symbol->kind != SYMBOL_CONSTANT) break;
+            *value = symbol->value;
+            return true;
+        case TINYC_AST_SIZEOF:
+            type = operand_type(this, x);
+            if (!type) return false;
+            *value = (int64_t)size_of(type);
+            return true;
+        case TINYC_AST_CAST:
+            type = type_of(this, x);
+            if (!type || !eval(this, y, &a)) return false;
+            *value = narrow(type, a);
+            return true;
+        case TINYC_AST_PLUS:
+        case TINYC_AST_NEG:
+        case TINYC_AST_NOT:
+        case TINYC_AST_LNOT:
+            if (!eval(this, x, &a)) return false;
+            if (node->kind == TINYC_AST_NEG) {
+                *value = (int64_t)(0 - (uint64_t)a);
+            } else if (node->kind == TINYC_AST_NOT) {
+                *value = ~a;
+            } else {
+                *value = node->kind == TINYC_AST_LNOT ? !a : a;
+            }
+            return true;
+        case TINYC_AST_LAND:
+        case TINYC_AST_LOR:
+            if (!eval(this, x, &a)) return false;
+            if (!a == (node->kind == TINYC_AST_LAND)) {
+                *value = !!a;
+                return true;
+            }
+            if (!eval(this, y, &b)) return false;
+            *value = !!b;
+            return true;
+        case TINYC_AST_COND:
+            if (!eval(this, x, &a)) return false;
+            if (!a) y = tinyc_ast_child(this->ast, ref, 2);
+            return eval(this, y, value);
+        default:
+            if (!is_binary(node->kind)) break;
+            return eval_chain(this, ref, value);
+    }
+    fail(this, ref, "expected constant expression");
+    return false;
+}
+
+/// Evaluate integer constant expression in 64-bit arithmetic.
+static bool eval(struct compiler *this, tinyc_ast_ref ref, int64_t *value) {
+    if (!nest(this, ref)) return false;
+    const bool ok = eval_node(this, ref, value);
+    this->nesting--;
+    return ok;
+}
+
+/// Returns true if ref is null pointer constant, an integer constant
+/// expression of value 0. Error of evaluating it isn't recorded.
+static bool is_null(struct compiler *this, tinyc_ast_ref ref) {
+    const struct tinyc_jit_error error = *this->error;
+    int64_t value;
+    if (eval(this, ref, &value)) return value == 0;
+    this->failed = false;
+    *this->error = error;
+    return false;
+}
+
+/// Check value of type from at ref converts to type as if by assignment.
+/// Pointer and integer don't convert without cast, except that null pointer
+/// constant converts to pointer and pointer converts to _Bool (C99 6.5.16.1).
+/// Returns false after recording error if not.
+static bool assignable(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    const struct tinyc_type *type,
+    const struct tinyc_type *from
+) {
+    if (is_pointer(type) && is_integer(from) && !is_null(this, ref)) {
+        fail(this, ref, "integer converted to pointer without cast");
+        return false;
+    }
+    if (is_integer(type) && type->kind != TINYC_TYPE_BOOL &&
+        is_pointer(from)) {
+        fail(this, ref, "pointer converted to integer without cast");
+        return false;
+    }
+    return true;
+}
+
+/// Convert object of type at rax into value.
+static const struct tinyc_type *rvalue(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    const struct tinyc_type *type
+) {
+    if (!type) return NULL;
+    if (type->kind == TINYC_TYPE_ARRAY) {
+        return pointer_to(this, ref, type->base);
+    }
+    if (type->kind == TINYC_TYPE_FUNCTION) return pointer_to(this, ref, type);
+    if (type->kind != TINYC_TYPE_VOID) load(this, type);
+    return type;
+}
+
+static const struct tinyc_type *binary(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    enum tinyc_ast_kind op,
+    const struct tinyc_type *a,
+    tinyc_ast_ref y
+);
+
+/// Generate address of object into rax, and get its type.
+static const struct tinyc_type *lvalue(
+    struct compiler *this,
+    tinyc_ast_ref ref
+) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    const tinyc_ast_ref x = tinyc_ast_child(this->ast, ref, 0);
+    const struct tinyc_type *type;
+    const struct symbol *symbol;
+    switch (node->kind) {
+        case TINYC_AST_IDENT:
+            symbol = lookup(this, ref);
+            if (!symbol) return fail(this, ref, "undeclared identifier");
+            if (symbol->kind == SYMBOL_LOCAL) {
+                lea_local(this, RAX, symbol->value);
+            } else if (symbol->kind == SYMBOL_GLOBAL ||
+                       symbol->kind == SYMBOL_FUNCTION) {
+                address(this, ref, symbol);
+            } else {
+                return fail(this, ref, "expected object");
+            }
+            return symbol->type;
+        case TINYC_AST_DEREF:
+            type = expr(this, x);
+            if (!type) return NULL;
+            if (!is_pointer(type)) {
+                return fail(this, ref, "operand of '*' is not a pointer");
+            }
+            return type->base;
+        case TINYC_AST_INDEX:
+            type = expr(this, x);
+            if (!type) return NULL;
+            type = binary(
+                this,
+                ref,
+                TINYC_AST_ADD,
+                type,
+                tinyc_ast_child(this->ast, ref, 1)
+            );
+            if (!type) return NULL;
+            if (!is_pointer(type)) {
+                return fail(this, ref, "subscripted value is not a pointer");
+            }
+            return type->base;
+        case TINYC_AST_MEMBER:
+        case TINYC_AST_ARROW:
+            return fail(this, ref, "struct and union are not supported");
+        default:
+            return fail(this, ref, "expression is not assignable");
+    }
+}
+
+/// mov rcx, rax; pop rax
+static void swap_pop(struct compiler *this) {
+    EMIT(this, 0x48, 0x89, 0xc1);
+    pop(this, RAX);
+}
+
+/// Multiply rax by size of object pointer points to.
+static void scale(struct compiler *this, const struct tinyc_type *pointer) {
+    const size_t size = stride(pointer);
+    if (size == 1) return;
+    EMIT(this, 0x48, 0x69, 0xc0);  // imul rax, rax, size
+    emit32(this, (uint32_t)size);
+}
+
+/// Get condition code of comparison.
+static enum cond compare_cond(enum tinyc_ast_kind op, bool is_signed) {
+    switch (op) {
+        case TINYC_AST_LT:
+            return is_signed ? CC_L : CC_B;
+        case TINYC_AST_GT:
+            return is_signed ? CC_G : CC_A;
+        case TINYC_AST_LE:
+            return is_signed ? CC_LE : CC_BE;
+        case TINYC_AST_GE:
+            return is_signed ? CC_GE : CC_AE;
+        case TINYC_AST_EQ:
+            return CC_E;
+        default:
+            return CC_NE;
+    }
+}
+
+/// Apply arithmetic operator to rax and rcx, both of type.
+static void arith_op(
+    struct compiler *this,
+    enum tinyc_ast_kind op,
+    const struct tinyc_type *type
+) {
+    switch (op) {
+        case TINYC_AST_MUL:
+            EMIT(this, 0x48, 0x0f, 0xaf, 0xc1);  // imul rax, rcx
+            break;
+        case TINYC_AST_DIV:
+        case TINYC_AST_MOD:
+            if (is_signed(type)) {
+                EMIT(this, 0x48, 0x99);        // cqo
+                EMIT(this, 0x48, 0xf7, 0xf9);  // idiv rcx
+            } else {
+                EMIT(this, 0x31, 0xd2);        // xor edx, edx
+                EMIT(this, 0x48, 0xf7, 0xf1);  // div rcx
+            }
+            if (op == TINYC_AST_MOD) EMIT(this, 0x48, 0x89, 0xd0);
+            break;
+        case TINYC_AST_ADD:
+            EMIT(this, 0x48, 0x01, 0xc8);  // add rax, rcx
+            break;
+        case TINYC_AST_SUB:
+            EMIT(this, 0x48, 0x29, 0xc8);  // sub rax, rcx
+            break;
+        case TINYC_AST_AND:
+            EMIT(this, 0x48, 0x21, 0xc8);  // and rax, rcx
+            break;
+        case TINYC_AST_XOR:
+            EMIT(this, 0x48, 0x31, 0xc8);  // xor rax, rcx
+            break;
+        case TINYC_AST_OR:
+            EMIT(this, 0x48, 0x09, 0xc8);  // or rax, rcx
+            break;
+        case TINYC_AST_SHL:
+            EMIT(this, 0x48, 0xd3, 0xe0);  // shl rax, cl
+            break;
+        case TINYC_AST_SHR:
+            if (is_signed(type)) {
+                EMIT(this, 0x48, 0xd3, 0xf8);  // sar rax, cl
+            } else {
+                EMIT(this, 0x48, 0xd3, 0xe8);  // shr rax, cl
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/// Apply binary operator op to rax of type a and value of y.
+static const struct tinyc_type *binary(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    enum tinyc_ast_kind op,
+    const struct tinyc_type *a,
+    tinyc_ast_ref y
+) {
+    push(this);
+    const struct tinyc_type *b = expr(this, y);
+    if (!b) return NULL;
+    const bool is_add = op == TINYC_AST_ADD || op == TINYC_AST_SUB;
+    const bool is_compare = op >= TINYC_AST_LT && op <= TINYC_AST_NE;
+
+    if (is_add && is_pointer(a) && is_pointer(b) && op == TINYC_AST_SUB) {
+        swap_pop(this);
+        EMIT(this, 0x48, 0x29, 0xc8);  // sub rax, rcx
+        const size_t size = stride(a);
+        if (size > 1) {
+            EMIT(this, 0xb9);  // mov ecx, size
+            emit32(this, (uint32_t)size);
+            EMIT(this, 0x48, 0x99);        // cqo
+            EMIT(this, 0x48, 0xf7, 0xf9);  // idiv rcx
+        }
+        return basic(this, TINYC_TYPE_LONG);
+    }
+    if (is_add && is_pointer(a) && is_integer(b)) {
+        scale(this, a);
+        swap_pop(this);
+        arith_op(this, op, a);
+        return a;
+    }
+    if (op == TINYC_AST_ADD && is_integer(a) && is_pointer(b)) {
+        swap_pop(this);
+        scale(this, b);
+        arith_op(this, op, b);
+        return b;
+    }
+    if (is_compare && is_scalar(a) && is_scalar(b) &&
+        (is_pointer(a) || is_pointer(b))) {
+        swap_pop(this);
+        EMIT(this, 0x48, 0x39, 0xc8);  // cmp rax, rcx
+        set(this, compare_cond(op, false));
+        return basic(this, TINYC_TYPE_INT);
+    }
+    if (!is_integer(a) || !is_integer(b)) {
+        return fail(this, ref, "invalid operands to binary expression");
+    }
+
+    // Shift has type of its left operand, and others have common type.
+    const bool is_shift = op == TINYC_AST_SHL || op == TINYC_AST_SHR;
+    const struct tinyc_type *type = is_shift ? promote(this, a)
+                                             : arith(this, a, b);
+    if (!is_shift) convert(this, type);
+    swap_pop(this);
+    convert(this, type);
+    if (is_compare) {
+        EMIT(this, 0x48, 0x39, 0xc8);  // cmp rax, rcx
+        set(this, compare_cond(op, is_signed(type)));
+        return basic(this, TINYC_TYPE_INT);
+    }
+    arith_op(this, op, type);
+    convert(this, type);
+    return type;
+}
+
+/// Get type of integer constant. Character constants are negative ints.
+static const struct tinyc_type *int_type(
+    struct compiler *this,
+    const struct tinyc_ast_node *node
+) {
+    const uint64_t value = node->value;
+    const bool u = node->flags & TINYC_AST_SPEC_UNSIGNED;
+    const bool is_long = node->flags &
+                         (TINYC_AST_SPEC_LONG | TINYC_AST_SPEC_LONG_LONG);
+    if (!is_long && !u && (int64_t)value >= INT32_MIN &&
+        (int64_t)value <= INT32_MAX) {
+        return basic(this, TINYC_TYPE_INT);
+    }
+    if (!is_long && u && value <= UINT32_MAX) {
+        return basic(this, TINYC_TYPE_UINT);
+    }
+    if (node->flags & TINYC_AST_SPEC_LONG_LONG) {
+        return basic(
+            this,
+            u || value > INT64_MAX ? TINYC_TYPE_ULLONG : TINYC_TYPE_LLONG
+        );
+    }
+    return basic(
+        this,
+        u || value > INT64_MAX ? TINYC_TYPE_ULONG : TINYC_TYPE_LONG
+    );
+}
+
+/// Copy content of string literal into arena, and terminate it by '\0'.
+static char *string_literal(struct compiler *this, tinyc_ast_ref ref) {
+    const size_t len = this->ast->nodes[ref].value;
+    char *s = allocate(this->jit, len + 1);
+    if (!s) return fail(this, ref, "out of memory");
+    memcpy(s, tinyc_ast_name(this->ast, ref), len);
+    return s;
+}
+
+/// Generate increment or decrement.
+static const struct tinyc_type *step(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    enum tinyc_ast_kind kind
+) {
+    const struct tinyc_type *type = lvalue(
+        this,
+        tinyc_ast_child(this->ast, ref, 0)
+    );
+    if (!type) return NULL;
+    if (!is_scalar(type)) return fail(this, ref, "invalid operand");
+    const int64_t size = is_pointer(type) ? (int64_t)stride(type) : 1;
+    const bool is_dec = kind == TINYC_AST_POST_DEC ||
+                        kind == TINYC_AST_PRE_DEC;
+    push(this);
+    load(this, type);
+    EMIT(this, 0x48, 0x89, 0xc2);  // mov rdx, rax
+    EMIT(this, 0x48, 0x05);        // add rax, delta
+    emit32(this, (uint32_t)(is_dec ? -size : size));
+    convert(this, type);
+    pop(this, RCX);
+    store(this, type);
+    if (kind == TINYC_AST_POST_INC || kind == TINYC_AST_POST_DEC) {
+        EMIT(this, 0x48, 0x89, 0xd0);  // mov rax, rdx
+    }
+    return type;
+}
+
+/// Generate function call. Arguments are pushed and popped into registers
+/// after all of them are evaluated, and stack is aligned to 16 bytes.
+static const struct tinyc_type *call(struct compiler *this, tinyc_ast_ref ref) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    const tinyc_ast_ref callee = tinyc_ast_child(this->ast, ref, 0);
+    const size_t nargs = node->nchildren - 1;
+    if (nargs > MAX_ARGS) return fail(this, ref, "too many arguments");
+
+    // Undeclared function is implicitly declared as returning int.
+    if (this->ast->nodes[callee].kind == TINYC_AST_IDENT &&
+        !lookup(this, callee)) {
+        const struct tinyc_type *type = tinyc_type_function(
+            &this->jit->types,
+            basic(this, TINYC_TYPE_INT),
+            NULL,
+            0,
+            0
+        );
+        if (!type) return fail(this, ref, "out of memory");
+        if (!declare(this, callee, SYMBOL_FUNCTION, type)) return NULL;
+    }
+
+    const struct tinyc_type *type = expr(this, callee);
+    if (!type) return NULL;
+    if (!is_pointer(type) || type->base->kind != TINYC_TYPE_FUNCTION) {
+        return fail(this, callee, "called object is not a function");
+    }
+    type = type->base;
+    const bool is_prototype = type->flags & TINYC_TYPE_PROTOTYPE;
+    const bool is_variadic = type->flags & TINYC_TYPE_VARIADIC;
+    if (is_prototype && (nargs < type->len ||
+                         (nargs > type->len && !is_variadic))) {
+        return fail(this, ref, "wrong number of arguments");
+    }
+
+    push(this);
+    for (size_t i = 0; i < nargs; ++i) {
+        const tinyc_ast_ref arg = this->ast->refs[node->children + 1 + i];
+        const struct tinyc_type *arg_type = expr(this, arg);
+        if (!arg_type) return NULL;
+        if (!is_scalar(arg_type)) return fail(this, arg, "invalid argument");
+        if (is_prototype && i < type->len) {
+            if (!assignable(this, arg, type->params[i], arg_type)) {
+                return NULL;
+            }
+            convert(this, type->params[i]);
+        }
+        push(this);
+    }
+    for (size_t i = nargs; i-- > 0;) pop(this, arg_regs[i]);
+    pop(this, R11);
+
+    const bool pad = this->depth % 2;
+    if (pad) EMIT(this, 0x48, 0x83, 0xec, 0x08);  // sub rsp, 8
+    EMIT(this, 0x31, 0xc0);                       // xor eax, eax
+    EMIT(this, 0x41, 0xff, 0xd3);                 // call r11
+    if (pad) EMIT(this, 0x48, 0x83, 0xc4, 0x08);  // add rsp, 8
+    convert(this, type->base);
+    return type->base;
+}
+
+/// Generate value of x, and test it.
+static bool condition(struct compiler *this, tinyc_ast_ref x) {
+    const struct tinyc_type *type = expr(this, x);
+    if (!type) return false;
+    if (!is_scalar(type)) {
+        fail(this, x, "scalar is required");
+        return false;
+    }
+    test(this);
+    return true;
+}
+
+/// Generate "&&" or "||".
+static const struct tinyc_type *logical(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    bool is_and
+) {
+    const enum cond cc = is_and ? CC_E : CC_NE;
+    if (!condition(this, tinyc_ast_child(this->ast, ref, 0))) return NULL;
+    const size_t lhs = jcc(this, cc);
+    if (!condition(this, tinyc_ast_child(this->ast, ref, 1))) return NULL;
+    const size_t rhs = jcc(this, cc);
+    imm(this, is_and);
+    const size_t end = jmp(this);
+    patch(this, lhs, this->len);
+    patch(this, rhs, this->len);
+    imm(this, !is_and);
+    patch(this, end, this->len);
+    return basic(this, TINYC_TYPE_INT);
+}
+
+/// Generate conditional operator. Value of each branch is already extended
+/// from its own type, so it's converted to common type after they join.
+static const struct tinyc_type *ternary(
+    struct compiler *this,
+    tinyc_ast_ref ref
+) {
+    if (!condition(this, tinyc_ast_child(this->ast, ref, 0))) return NULL;
+    const size_t skip = jcc(this, CC_E);
+    const struct tinyc_type *a = expr(this, tinyc_ast_child(this->ast, ref, 1));
+    const size_t end = jmp(this);
+    patch(this, skip, this->len);
+    const struct tinyc_type *b = expr(this, tinyc_ast_child(this->ast, ref, 2));
+    patch(this, end, this->len);
+    if (!a || !b) return NULL;
+    if (is_integer(a) && is_integer(b)) {
+        const struct tinyc_type *type = arith(this, a, b);
+        convert(this, type);
+        return type;
+    }
+    if (is_pointer(a)) return a;
+    if (is_pointer(b)) return b;
+    if (a->kind == b->kind) return a;
+    return fail(this, ref, "incompatible operands");
+}
+
+/// Generate simple or compound assignment.
+static const struct tinyc_type *assign(
+    struct compiler *this,
+    tinyc_ast_ref ref
+) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    const tinyc_ast_ref y = tinyc_ast_child(this->ast, ref, 1);
+    const struct tinyc_type *type = lvalue(
+        this,
+        tinyc_ast_child(this->ast, ref, 0)
+    );
+    if (!type) return NULL;
+    if (!is_scalar(type)) {
+        return fail(this, ref, "expression is not assignable");
+    }
+    push(this);
+    const struct tinyc_type *value;
+    if (node->flags == TINYC_AST_NONE) {
+        value = expr(this, y);
+    } else {
+        load(this, type);
+        value = binary(this, ref, node->flags, type, y);
+    }
+    if (!value) return NULL;
+    if (!is_scalar(value)) return fail(this, ref, "incompatible types");
+    if (!assignable(this, y, type, value)) return NULL;
+    convert(this, type);
+    pop(this, RCX);
+    store(this, type);
+    return type;
+}
+
+/// Generate chain of binary operators at ref from its leftmost operand.
+static const struct tinyc_type *chain(
+    struct compiler *this,
+    tinyc_ast_ref ref
+) {
+    const size_t base = this->nspine;
+    const tinyc_ast_ref first = push_spine(this, ref);
+    const struct tinyc_type *type = first ? expr(this, first) : NULL;
+    while (type && this->nspine > base) {
+        const tinyc_ast_ref op = this->spine[--this->nspine];
+        const enum tinyc_ast_kind kind = this->ast->nodes[op].kind;
+        type = binary(this, op, kind, type, tinyc_ast_child(this->ast, op, 1));
+    }
+    this->nspine = base;
+    return type;
+}
+
+/// Same as expr, but without checking depth of nesting.
+static const struct tinyc_type *expr_node(
+    struct compiler *this,
+    tinyc_ast_ref ref
+) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    const tinyc_ast_ref x = tinyc_ast_child(this->ast, ref, 0);
+    const tinyc_ast_ref y = tinyc_ast_child(this->ast, ref, 1);
+    const struct tinyc_type *type;
+    const struct symbol *symbol;
+    char *s;
+    switch (node->kind) {
+        case TINYC_AST_INT:
+            imm(this, (int64_t)node->value);
+            return int_type(this, node);
+        case TINYC_AST_STRING:
+            s = string_literal(this, ref);
+            if (!s) return NULL;
+            EMIT(this, 0x48, 0xb8);  // mov rax, s
+            emit64(this, (uint64_t)(uintptr_t)s);
+            return pointer_to(this, ref, basic(this, TINYC_TYPE_CHAR));
+        case TINYC_AST_IDENT:
+            symbol = lookup(this, ref);
+            if (symbol && symbol->kind == SYMBOL_CONSTANT) {
+                imm(this, symbol->value);
+                return symbol->type;
+            }
+            return rvalue(this, ref, lvalue(this, ref));
+        case TINYC_AST_INDEX:
+        case TINYC_AST_DEREF:
+        case TINYC_AST_MEMBER:
+        case TINYC_AST_ARROW:
+            return rvalue(this, ref, lvalue(this, ref));
+        case TINYC_AST_CALL:
+            return call(this, ref);
+        case TINYC_AST_POST_INC:
+        case TINYC_AST_POST_DEC:
+        case TINYC_AST_PRE_INC:
+        case TINYC_AST_PRE_DEC:
+            return step(this, ref, node->kind);
+        case TINYC_AST_ADDR:
+            type = lvalue(this, x);
+            return type ? pointer_to(this, ref, type) : NULL;
+        case TINYC_AST_PLUS:
+        case TINYC_AST_NEG:
+        case TINYC_AST_NOT:
+            type = expr(this, x);
+            if (!type) return NULL;
+            if (!is_integer(type)) return fail(this, ref, "invalid operand");
+            type = promote(this, type);
+            if (node->kind == TINYC_AST_NEG) {
+                EMIT(this, 0x48, 0xf7, 0xd8);  // neg rax
+            } else if (node->kind == TINYC_AST_NOT) {
+                EMIT(this, 0x48, 0xf7, 0xd0);  // not rax
+            }
+            convert(this, type);
+            return type;
+        case TINYC_AST_LNOT:
+            if (!condition(this, x)) return NULL;
+            set(this, CC_E);
+            return basic(this, TINYC_TYPE_INT);
+        case TINYC_AST_SIZEOF:
+            type = operand_type(this, x);
+            if (!type) return NULL;
+            if (!size_of(type)) return fail(this, ref, "incomplete type");
+            imm(this, (int64_t)size_of(type));
+            return basic(this, TINYC_TYPE_ULONG);
+        case TINYC_AST_CAST:
+            type = type_of(this, x);
+            if (!type || !expr(this, y)) return NULL;
+            if (type->kind == TINYC_TYPE_VOID) return type;
+            if (!is_scalar(type)) return fail(this, ref, "invalid cast");
+            convert(this, type);
+            return type;
+        case TINYC_AST_LAND:
+        case TINYC_AST_LOR:
+            return logical(this, ref, node->kind == TINYC_AST_LAND);
+        case TINYC_AST_COND:
+            return ternary(this, ref);
+        case TINYC_AST_ASSIGN:
+            return assign(this, ref);
+        case TINYC_AST_COMMA:
+            if (!expr(this, x)) return NULL;
+            return expr(this, y);
+        default:
+            if (!is_binary(node->kind)) {
+                return fail(this, ref, "expected expression");
+            }
+            return chain(this, ref);
+    }
+}
+
+/// Generate value of expression into rax, and get its type.
+static const struct tinyc_type *expr(struct compiler *this, tinyc_ast_ref ref) {
+    if (!nest(this, ref)) return NULL;
+    const struct tinyc_type *type = expr_node(this, ref);
+    this->nesting--;
+    return type;
+}
+
+static void statement(struct compiler *this, tinyc_ast_ref ref);
+static void declaration(struct compiler *this, tinyc_ast_ref ref);
+
+/// Reserve frame for object of type, and get its offset.
+static int64_t reserve(struct compiler *this, const struct tinyc_type *type) {
+    const int64_t align = (int64_t)align_of(type);
+    this->frame = (this->frame + (int64_t)size_of(type) + align - 1) / align *
+                  align;
+    return -this->frame;
+}
+
+/// Get type of array with unknown length completed by initializer.
+static const struct tinyc_type *complete(
+    struct compiler *this,
+    const struct tinyc_type *type,
+    tinyc_ast_ref init
+) {
+    if (type->kind != TINYC_TYPE_ARRAY ||
+        type->len != TINYC_TYPE_UNKNOWN_LEN) {
+        return type;
+    }
+    const struct tinyc_ast_node *node = &this->ast->nodes[init];
+    size_t len;
+    if (node->kind == TINYC_AST_STRING) {
+        len = node->value + 1;
+    } else if (node->kind == TINYC_AST_INIT_LIST) {
+        len = node->nchildren;
+    } else {
+        return fail(this, init, "invalid initializer");
+    }
+    type = tinyc_type_array(&this->jit->types, type->base, len);
+    return type ? type : fail(this, init, "out of memory");
+}
+
+/// Returns true if array of type is initialized by string literal.
+static bool is_string_init(
+    struct compiler *this,
+    const struct tinyc_type *type,
+    tinyc_ast_ref init
+) {
+    return this->ast->nodes[init].kind == TINYC_AST_STRING &&
+           is_integer(type->base) && size_of(type->base) == 1;
+}
+
+/// Get single initializer of scalar, which may be braced.
+static tinyc_ast_ref scalar_init(struct compiler *this, tinyc_ast_ref init) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[init];
+    if (node->kind != TINYC_AST_INIT_LIST) return init;
+    if (node->nchildren != 1) {
+        fail(this, init, "invalid initializer");
+        return 0;
+    }
+    return this->ast->refs[node->children];
+}
+
+/// Initialize object of type at offset in frame, which is already zeroed if
+/// it's an array.
+static void init_local(
+    struct compiler *this,
+    const struct tinyc_type *type,
+    int64_t offset,
+    tinyc_ast_ref init
+) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[init];
+    if (type->kind == TINYC_TYPE_ARRAY) {
+        if (is_string_init(this, type, init)) {
+            const char *s = tinyc_ast_name(this->ast, init);
+            const size_t len = node->value < type->len ? node->value
+                                                       : type->len;
+            for (size_t i = 0; i < len; ++i) {
+                EMIT(this, 0xc6, 0x85);  // mov byte [rbp + offset + i], s[i]
+                emit32(this, (uint32_t)(offset + (int64_t)i));
+                EMIT(this, s[i]);
+            }
+            return;
+        }
+        if (node->kind != TINYC_AST_INIT_LIST) {
+            fail(this, init, "invalid initializer");
+            return;
+        }
+        if (node->nchildren > type->len) {
+            fail(this, init, "too many initializers");
+            return;
+        }
+        const int64_t size = (int64_t)size_of(type->base);
+        for (uint32_t i = 0; i < node->nchildren && !this->failed; ++i) {
+            init_local(
+                this,
+                type->base,
+                offset + size * i,
+                this->ast->refs[node->children + i]
+            );
+        }
+        return;
+    }
+
+    init = scalar_init(this, init);
+    const struct tinyc_type *value = init ? expr(this, init) : NULL;
+    if (!value) return;
+    if (!is_scalar(value)) {
+        fail(this, init, "invalid initializer");
+        return;
+    }
+    if (!assignable(this, init, type, value)) return;
+    convert(this, type);
+    lea_local(this, RCX, offset);
+    store(this, type);
+}
+
+/// Initialize object of type at addr by constant initializer.
+static void init_global(
+    struct compiler *this,
+    const struct tinyc_type *type,
+    char *addr,
+    tinyc_ast_ref init
+) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[init];
+    if (type->kind == TINYC_TYPE_ARRAY) {
+        if (is_string_init(this, type, init)) {
+            const size_t len = node->value < type->len ? node->value
+                                                       : type->len;
+            memcpy(addr, tinyc_ast_name(this->ast, init), len);
+            return;
+        }
+        if (node->kind != TINYC_AST_INIT_LIST) {
+            fail(this, init, "invalid initializer");
+            return;
+        }
+        if (node->nchildren > type->len) {
+            fail(this, init, "too many initializers");
+            return;
+        }
+        const size_t size = size_of(type->base);
+        for (uint32_t i = 0; i < node->nchildren && !this->failed; ++i) {
+            init_global(
+                this,
+                type->base,
+                addr + size * i,
+                this->ast->refs[node->children + i]
+            );
+        }
+        return;
+    }
+
+    init = scalar_init(this, init);
+    if (!init) return;
+    if (is_pointer(type) && this->ast->nodes[init].kind == TINYC_AST_STRING) {
+        const char *s = string_literal(this, init);
+        if (s) memcpy(addr, &s, sizeof(s));
+        return;
+    }
+    int64_t value;
+    if (!eval(this, init, &value)) return;
+    if (is_pointer(type) && value != 0 &&
+        this->ast->nodes[init].kind != TINYC_AST_CAST) {
+        fail(this, init, "integer converted to pointer without cast");
+        return;
+    }
+    value = narrow(type, value);
+    memcpy(addr, &value, size_of(type));  // Target is little endian.
+}
+
+/// Declare local object, and generate its initializer.
+static void local(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    const struct tinyc_type *type,
+    tinyc_ast_ref init
+) {
+    const int64_t offset = reserve(this, type);
+    struct symbol *symbol = declare(this, ref, SYMBOL_LOCAL, type);
+    if (!symbol) return;
+    symbol->value = offset;
+    if (!init) return;
+    if (type->kind == TINYC_TYPE_ARRAY) {
+        lea_local(this, RDI, offset);
+        EMIT(this, 0xb9);  // mov ecx, size
+        emit32(this, (uint32_t)size_of(type));
+        EMIT(this, 0x31, 0xc0);  // xor eax, eax
+        EMIT(this, 0xf3, 0xaa);  // rep stosb
+    }
+    init_local(this, type, offset, init);
+}
+
+/// Declare names of declaration. Objects with static storage are allocated
+/// in arena, and initialized at compile time.
+static void declaration(struct compiler *this, tinyc_ast_ref ref) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    const tinyc_ast_ref init = tinyc_ast_child(this->ast, ref, 1);
+    const uint32_t storage = node->flags;
+    const struct tinyc_type *type = type_of(
+        this,
+        tinyc_ast_child(this->ast, ref, 0)
+    );
+    if (!type || !node->name) return;
+    if (storage & TINYC_AST_STORAGE_TYPEDEF) {
+        declare(this, ref, SYMBOL_TYPEDEF, type);
+        return;
+    }
+
+    struct symbol *symbol = lookup_here(this, ref);
+    if (type->kind == TINYC_TYPE_FUNCTION) {
+        if (!symbol) declare(this, ref, SYMBOL_FUNCTION, type);
+        return;
+    }
+    if (init) type = complete(this, type, init);
+    if (!type) return;
+    if (!size_of(type) && !(storage & TINYC_AST_STORAGE_EXTERN)) {
+        fail(this, ref, "variable has incomplete type");
+        return;
+    }
+    const bool is_static = this->jit->symbols.depth == 0 ||
+                           (storage & (TINYC_AST_STORAGE_STATIC |
+                                       TINYC_AST_STORAGE_EXTERN));
+    if (!is_static) {
+        local(this, ref, type, init);
+        return;
+    }
+
+    // Object declared extern is looked up in process unless defined.
+    if (!symbol || symbol->kind != SYMBOL_GLOBAL) {
+        symbol = declare(this, ref, SYMBOL_GLOBAL, type);
+        if (!symbol) return;
+    }
+    if ((storage & TINYC_AST_STORAGE_EXTERN) && !init) return;
+    if (!symbol->addr) {
+        symbol->type = type;
+        symbol->addr = allocate(this->jit, size_of(type));
+        if (!symbol->addr) {
+            fail(this, ref, "out of memory");
+            return;
+        }
+    }
+    if (init) init_global(this, symbol->type, symbol->addr, init);
+}
+
+/// Generate statements in block. Scope is not opened unless scoped, as
+/// declarations in init of for are in scope of for.
+static void block(struct compiler *this, tinyc_ast_ref ref, bool scoped) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    if (scoped && !tinyc_symtab_push(&this->jit->symbols)) {
+        fail(this, ref, "out of memory");
+        return;
+    }
+    for (uint32_t i = 0; i < node->nchildren && !this->failed; ++i) {
+        const tinyc_ast_ref child = this->ast->refs[node->children + i];
+        if (this->ast->nodes[child].kind == TINYC_AST_DECL) {
+            declaration(this, child);
+        } else {
+            statement(this, child);
+        }
+    }
+    if (scoped) tinyc_symtab_pop(&this->jit->symbols);
+}
+
+static void enter(
+    struct compiler *this,
+    struct target *target,
+    bool is_switch
+) {
+    memset(target, 0, sizeof(*target));
+    target->outer = this->target;
+    target->is_switch = is_switch;
+    this->target = target;
+}
+
+/// Leave target, and make break and continue in it go to end and cont.
+static void leave(struct compiler *this, struct target *target, size_t cont) {
+    patch_all(this, &target->breaks, this->len);
+    patch_all(this, &target->continues, cont);
+    tinyc_free(target->breaks.items);
+    tinyc_free(target->continues.items);
+    tinyc_free(target->cases.items);
+    this->target = target->outer;
+}
+
+/// Emit comparisons to cases in switch body, which are not in nested switch.
+static void dispatch(
+    struct compiler *this,
+    struct target *target,
+    const struct tinyc_type *type,
+    tinyc_ast_ref ref
+) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    if (node->kind == TINYC_AST_SWITCH) return;
+    if (node->kind == TINYC_AST_CASE) {
+        int64_t value;
+        if (!eval(this, tinyc_ast_child(this->ast, ref, 0), &value)) return;
+        value = narrow(type, value);
+        if (value >= INT32_MIN && value <= INT32_MAX) {
+            EMIT(this, 0x48, 0x3d);  // cmp rax, value
+            emit32(this, (uint32_t)value);
+        } else {
+            EMIT(this, 0x48, 0xb9);  // mov rcx, value
+            emit64(this, (uint64_t)value);
+            EMIT(this, 0x48, 0x39, 0xc8);  // cmp rax, rcx
+        }
+        add_jump(this, &target->cases, jcc(this, CC_E), ref);
+    }
+    for (uint32_t i = 0; i < node->nchildren && !this->failed; ++i) {
+        const tinyc_ast_ref child = this->ast->refs[node->children + i];
+        if (child) dispatch(this, target, type, child);
+    }
+}
+
+static void switch_statement(struct compiler *this, tinyc_ast_ref ref) {
+    const tinyc_ast_ref body = tinyc_ast_child(this->ast, ref, 1);
+    const struct tinyc_type *type = expr(
+        this,
+        tinyc_ast_child(this->ast, ref, 0)
+    );
+    if (!type) return;
+    if (!is_integer(type)) {
+        fail(this, ref, "integer is required");
+        return;
+    }
+    type = promote(this, type);
+
+    struct target target;
+    enter(this, &target, true);
+    if (body) dispatch(this, &target, type, body);
+    target.default_jump = jmp(this);
+    statement(this, body);
+    if (!target.has_default) patch(this, target.default_jump, this->len);
+    leave(this, &target, 0);
+}
+
+/// Get innermost target, which is not switch if continuable.
+static struct target *target_of(struct compiler *this, bool continuable) {
+    struct target *target = this->target;
+    while (target && continuable && target->is_switch) target = target->outer;
+    return target;
+}
+
+/// Make jump to case of innermost switch come here.
+static void case_label(struct compiler *this, tinyc_ast_ref ref) {
+    struct target *target = this->target;
+    while (target && !target->is_switch) target = target->outer;
+    if (!target) {
+        fail(this, ref, "case outside switch");
+        return;
+    }
+
+    // Cases are generated in the order they're dispatched.
+    for (size_t i = 0; i < target->cases.len; ++i) {
+        const size_t j = (target->next_case + i) % target->cases.len;
+        if (target->cases.items[j].ref != ref) continue;
+        patch(this, target->cases.items[j].pos, this->len);
+        target->next_case = j + 1;
+        return;
+    }
+}
+
+static void default_label(struct compiler *this, tinyc_ast_ref ref) {
+    struct target *target = this->target;
+    while (target && !target->is_switch) target = target->outer;
+    if (!target || target->has_default) {
+        fail(this, ref, target ? "multiple default labels"
+                               : "default outside switch");
+        return;
+    }
+    patch(this, target->default_jump, this->len);
+    target->has_default = true;
+}
+
+static void loop(
+    struct compiler *this,
+    tinyc_ast_ref ref,
+    tinyc_ast_ref cond,
+    tinyc_ast_ref step,
+    tinyc_ast_ref body
+) {
+    const size_t start = this->len;
+    struct target target;
+    enter(this, &target, false);
+    if (cond && condition(this, cond)) {
+        add_jump(this, &target.breaks, jcc(this, CC_E), ref);
+    }
+    statement(this, body);
+    const size_t cont = this->len;
+    if (step) expr(this, step);
+    patch(this, jmp(this), start);
+    leave(this, &target, cont);
+}
+
+static void do_statement(struct compiler *this, tinyc_ast_ref ref) {
+    const size_t start = this->len;
+    struct target target;
+    enter(this, &target, false);
+    statement(this, tinyc_ast_child(this->ast, ref, 0));
+    const size_t cont = this->len;
+    if (condition(this, tinyc_ast_child(this->ast, ref, 1))) {
+        patch(this, jcc(this, CC_NE), start);
+    }
+    leave(this, &target, cont);
+}
+
+static void for_statement(struct compiler *this, tinyc_ast_ref ref) {
+    const tinyc_ast_ref init = tinyc_ast_child(this->ast, ref, 0);
+    if (!tinyc_symtab_push(&this->jit->symbols)) {
+        fail(this, ref, "out of memory");
+        return;
+    }
+    if (init && this->ast->nodes[init].kind == TINYC_AST_BLOCK) {
+        block(this, init, false);
+    } else if (init) {
+        expr(this, init);
+    }
+    loop(
+        this,
+        ref,
+        tinyc_ast_child(this->ast, ref, 1),
+        tinyc_ast_child(this->ast, ref, 2),
+        tinyc_ast_child(this->ast, ref, 3)
+    );
+    tinyc_symtab_pop(&this->jit->symbols);
+}
+
+static void if_statement(struct compiler *this, tinyc_ast_ref ref) {
+    const tinyc_ast_ref otherwise = tinyc_ast_child(this->ast, ref, 2);
+    if (!condition(this, tinyc_ast_child(this->ast, ref, 0))) return;
+    const size_t skip = jcc(this, CC_E);
+    statement(this, tinyc_ast_child(this->ast, ref, 1));
+    if (otherwise) {
+        const size_t end = jmp(this);
+        patch(this, skip, this->len);
+        statement(this, otherwise);
+        patch(this, end, this->len);
+    } else {
+        patch(this, skip, this->len);
+    }
+}
+
+static void return_statement(struct compiler *this, tinyc_ast_ref ref) {
+    const tinyc_ast_ref value = tinyc_ast_child(this->ast, ref, 0);
+    if (value) {
+        const struct tinyc_type *type = expr(this, value);
+        if (!type) return;
+        if (is_scalar(this->ret)) {
+            if (!is_scalar(type)) {
+                fail(this, value, "incompatible return type");
+                return;
+            }
+            if (!assignable(this, value, this->ret, type)) return;
+            convert(this, this->ret);
+        }
+    }
+    epilogue(this);
+}
+
+static void statement(struct compiler *this, tinyc_ast_ref ref) {
+    const struct tinyc_ast_node *node = &this->ast->nodes[ref];
+    struct target *target;
+    if (!ref || this->failed) return;
+    switch (node->kind) {
+        case TINYC_AST_BLOCK:
+            block(this, ref, true);
+            break;
+        case TINYC_AST_IF:
+            if_statement(this, ref);
+            break;
+        case TINYC_AST_SWITCH:
+            switch_statement(this, ref);
+            break;
+        case TINYC_AST_CASE:
+            case_label(this, ref);
+            statement(this, tinyc_ast_child(this->ast, ref, 1));
+            break;
+        case TINYC_AST_DEFAULT:
+            default_label(this, ref);
+            statement(this, tinyc_ast_child(this->ast, ref, 0));
+            break;
+        case TINYC_AST_WHILE:
+            loop(
+                this,
+                ref,
+                tinyc_ast_child(this->ast, ref, 0),
+                0,
+                tinyc_ast_child(this->ast, ref, 1)
+            );
+            break;
+        case TINYC_AST_DO:
+            do_statement(this, ref);
+            break;
+        case TINYC_AST_FOR:
+            for_statement(this, ref);
+            break;
+        case TINYC_AST_GOTO:
+            add_jump(this, &this->gotos, jmp(this), ref);
+            break;
+        case TINYC_AST_LABEL:
+            add_jump(this, &this->labels, this->len, ref);
+            statement(this, tinyc_ast_child(this->ast, ref, 0));
+            break;
+        case TINYC_AST_BREAK:
+        case TINYC_AST_CONTINUE:
+            target = target_of(this, node->kind == TINYC_AST_CONTINUE);
+            if (!target) {
+                fail(this, ref, "jump outside loop");
+                break;
+            }
+            add_jump(
+                this,
+                node->kind == TINYC_AST_BREAK ? &target->breaks
+                                              : &target->continues,
+                jmp(this),
+                ref
+            );
+            break;
+        case TINYC_AST_RETURN:
+            return_statement(this, ref);
+            break;
+        default:
+            expr(this, ref);
+            break;
+    }
+}
+
+/// Make each goto jump to its label.
+static void resolve_gotos(struct compiler *this) {
+    for (size_t i = 0; i < this->gotos.len && !this->failed; ++i) {
+        const struct jump *jump = &this->gotos.items[i];
+        const char *name = tinyc_ast_name(this->ast, jump->ref);
+        size_t j = 0;
+        while (j < this->labels.len) {
+            const tinyc_ast_ref label = this->labels.items[j].ref;
+            if (strcmp(name, tinyc_ast_name(this->ast, label)) == 0) break;
+            ++j;
+        }
+        if (j == this->labels.len) {
+            fail(this, jump->ref, "undefined label");
+            return;
+        }
+        patch(this, jump->pos, this->labels.items[j].pos);
+    }
+}
+
+static void function(struct compiler *this, tinyc_ast_ref ref) {
+    const tinyc_ast_ref type_ref = tinyc_ast_child(this->ast, ref, 0);
+    const struct tinyc_ast_node *type_node = &this->ast->nodes[type_ref];
+    const struct tinyc_type *type = type_of(this, type_ref);
+    if (!type) return;
+    if (type_node->nchildren - 1 > MAX_ARGS) {
+        fail(this, ref, "too many parameters");
+        return;
+    }
+    struct symbol *symbol = lookup_here(this, ref);
+    if (symbol && symbol->kind == SYMBOL_FUNCTION && symbol->value >= 0) {
+        fail(this, ref, "redefinition of function");
+        return;
+    }
+    if (!symbol || symbol->kind != SYMBOL_FUNCTION) {
+        symbol = declare(this, ref, SYMBOL_FUNCTION, type);
+        if (!symbol) return;
+    }
+    symbol->type = type;
+    symbol->value = (int64_t)this->len;
+
+    // Size of frame is known after body is generated.
+    EMIT(this, 0x55);              // push rbp
+    EMIT(this, 0x48, 0x89, 0xe5);  // mov rbp, rsp
+    EMIT(this, 0x48, 0x81, 0xec);  // sub rsp, frame
+    const size_t frame = this->len;
+    emit32(this, 0);
+    this->frame = 0;
+    this->depth = 0;
+    this->ret = type->base;
+    this->labels.len = this->gotos.len = 0;
+    if (!tinyc_symtab_push(&this->jit->symbols)) {
+        fail(this, ref, "out of memory");
+        return;
+    }
+
+    // Parameters are spilled to frame.
+    for (size_t i = 0; i < type->len && !this->failed; ++i) {
+        const tinyc_ast_ref param = tinyc_ast_child(this->ast, type_ref, i + 1);
+        if (!this->ast->nodes[param].name) continue;
+        const int64_t offset = reserve(this, type->params[i]);
+        struct symbol *local = declare(
+            this,
+            param,
+            SYMBOL_LOCAL,
+            type->params[i]
+        );
+        if (!local) break;
+        local->value = offset;
+        spill(this, arg_regs[i], offset, type->params[i]);
+    }
+    statement(this, tinyc_ast_child(this->ast, ref, 1));
+    tinyc_symtab_pop(&this->jit->symbols);
+
+    // Falling off end returns 0, as main does.
+    EMIT(this, 0x31, 0xc0);  // xor eax, eax
+    epilogue(this);
+    patch32(this, frame, (uint32_t)((this->frame + 15) / 16 * 16));
+    resolve_gotos(this);
+}
+
+/// Get definition of symbol, which may be declared again in file scope.
+static const struct symbol *definition(
+    const struct tinyc_jit *this,
+    const struct symbol *symbol
+) {
+    const bool defined = symbol->kind == SYMBOL_FUNCTION ? symbol->value >= 0
+                                                         : symbol->addr != NULL;
+    if (defined) return symbol;
+    struct tinyc_string name;
+    tinyc_string_from(&name, (char *)symbol->name);
+    const struct tinyc_symtab_symbol *binding = tinyc_symtab_lookup(
+        &this->symbols,
+        TINYC_SYMTAB_ORDINARY,
+        &name
+    );
+    const struct symbol *other = binding ? binding->value : NULL;
+    return other && other->kind == symbol->kind ? other : symbol;
+}
+
+/// Get address of symbol, looking up process unless it's defined in unit.
+static void *resolve(
+    const struct tinyc_jit *this,
+    const struct symbol *symbol
+) {
+    symbol = definition(this, symbol);
+    if (symbol->kind == SYMBOL_FUNCTION && symbol->value >= 0) {
+        return (char *)this->code + symbol->value;
+    }
+    if (symbol->addr) return symbol->addr;
+    return dlsym(this->process, symbol->name);
+}
+
+/// Copy code into executable mapping, and fill addresses in it.
+static void finish(struct compiler *this) {
+    struct tinyc_jit *jit = this->jit;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t size = (this->len + page - 1) / page * page;
+    void *code = mmap(
+        NULL,
+        size ? size : page,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    if (code == MAP_FAILED) {
+        fail(this, this->ast->root, "failed to map code");
+        return;
+    }
+    jit->code = code;
+    jit->size = size ? size : page;
+    memcpy(code, this->code, this->len);
+    for (size_t i = 0; i < this->nfixups; ++i) {
+        const struct fixup *fixup = &this->fixups[i];
+        void *addr = resolve(jit, fixup->symbol);
+        if (!addr) {
+            fail(this, fixup->ref, "undefined reference");
+            return;
+        }
+        memcpy((char *)code + fixup->pos, &addr, sizeof(addr));
+    }
+    if (mprotect(code, jit->size, PROT_READ | PROT_EXEC) != 0) {
+        fail(this, this->ast->root, "failed to map code");
+    }
+}
+
+bool tinyc_jit_init(struct tinyc_jit *this) {
+    this->chunks = NULL;
+    this->code = NULL;
+    this->size = 0;
+    this->process = dlopen(NULL, RTLD_LAZY);
+    if (!this->process) return false;
+    if (!tinyc_types_init(&this->types)) {
+        dlclose(this->process);
+        return false;
+    }
+    if (!tinyc_symtab_init(&this->symbols)) {
+        tinyc_types_free(&this->types);
+        dlclose(this->process);
+        return false;
+    }
+    return true;
+}
+
+bool tinyc_jit_compile(
+    struct tinyc_jit *this,
+    const struct tinyc_ast *ast,
+    struct tinyc_jit_error *error
+) {
+    struct compiler compiler = {
+        .jit = this,
+        .ast = ast,
+        .error = error,
+        .failed = false,
+        .code = tinyc_alloc(DEFAULT_CAP),
+        .len = 0,
+        .cap = DEFAULT_CAP,
+        .fixups = NULL,
+        .nfixups = 0,
+        .fixups_cap = 0,
+        .depth = 0,
+        .nesting = 0,
+        .spine = NULL,
+        .nspine = 0,
+        .spine_cap = 0,
+        .frame = 0,
+        .ret = NULL,
+        .target = NULL,
+        .labels = {NULL, 0, 0},
+        .gotos = {NULL, 0, 0},
+    };
+#ifndef __x86_64__
+    fail(&compiler, ast->root, "JIT is only supported on x86-64");
+#endif
+    if (!compiler.code) fail(&compiler, ast->root, "out of memory");
+    if (this->code) fail(&compiler, ast->root, "unit is already compiled");
+
+    const struct tinyc_ast_node *root = &ast->nodes[ast->root];
+    for (uint32_t i = 0; i < root->nchildren && !compiler.failed; ++i) {
+        const tinyc_ast_ref child = ast->refs[root->children + i];
+        if (ast->nodes[child].kind == TINYC_AST_FUNC) {
+            function(&compiler, child);
+        } else {
+            declaration(&compiler, child);
+        }
+    }
+    if (!compiler.failed) finish(&compiler);
+
+    tinyc_free(compiler.code);
+    tinyc_free(compiler.fixups);
+    tinyc_free(compiler.spine);
+    tinyc_free(compiler.labels.items);
+    tinyc_free(compiler.gotos.items);
+    return !compiler.failed;
+}
+
+/// Get symbol defined in unit.
+static const struct symbol *find(
+    const struct tinyc_jit *this,
+    const char *name
+) {
+    if (!this->code) return NULL;
+    struct tinyc_string key;
+    tinyc_string_from(&key, (char *)name);
+    const struct tinyc_symtab_symbol *binding = tinyc_symtab_lookup(
+        &this->symbols,
+        TINYC_SYMTAB_ORDINARY,
+        &key
+    );
+    const struct symbol *symbol = binding ? binding->value : NULL;
+    if (!symbol) return NULL;
+    if (symbol->kind == SYMBOL_FUNCTION) {
+        return symbol->value >= 0 ? symbol : NULL;
+    }
+    return symbol->kind == SYMBOL_GLOBAL && symbol->addr ? symbol : NULL;
+}
+
+void *tinyc_jit_lookup(const struct tinyc_jit *this, const char *name) {
+    const struct symbol *symbol = find(this, name);
+    return symbol ? resolve(this, symbol) : NULL;
+}
+
+bool tinyc_jit_run(
+    struct tinyc_jit *this,
+    int argc,
+    char **argv,
+    int *status
+) {
+    const struct symbol *symbol = find(this, "main");
+    if (!symbol || symbol->kind != SYMBOL_FUNCTION) return false;
+
+    // ISO C doesn't convert object pointer to function pointer.
+    void *addr = resolve(this, symbol);
+    int (*main)(int, char **);
+    memcpy(&main, &addr, sizeof(main));
+    *status = main(argc, argv);
+    return true;
+}
+
+void tinyc_jit_free(struct tinyc_jit *this) {
+    if (this->code) munmap(this->code, this->size);
+    struct tinyc_jit_chunk *chunk = this->chunks;
+    while (chunk) {
+        struct tinyc_jit_chunk *next = chunk->next;
+        tinyc_free(chunk);
+        chunk = next;
+    }
+    tinyc_symtab_free(&this->symbols);
+    tinyc_types_free(&this->types);
+    dlclose(this->process);
+}
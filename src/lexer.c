@@ -0,0 +1,433 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_TOKEN
+
+#include "tinyc/lexer.h"
+
+#include <string.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/source.h"
+#include "tinyc/span.h"
+#include "tinyc/splice.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+#include "tinyc/trace.h"
+
+typedef struct tinyc_token *(*create_fn)(
+    const struct tinyc_span *span,
+    const struct tinyc_string *value
+);
+
+static inline bool is_digit(char c) {
+    return '0' <= c && c <= '9';
+}
+
+static inline bool is_ident_start(char c) {
+    return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '_';
+}
+
+static inline bool is_ident_char(char c) {
+    return is_ident_start(c) || is_digit(c);
+}
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r';
+}
+
+/// Returns string value owned by token, or NULL if it doesn't own.
+static struct tinyc_string *value_of(struct tinyc_token *token) {
+    switch (token->kind) {
+        case TINYC_TOKEN_IDENT:
+            return &((struct tinyc_token_ident *)token)->value;
+        case TINYC_TOKEN_STRING:
+            return &((struct tinyc_token_string *)token)->value;
+        case TINYC_TOKEN_CHAR:
+            return &((struct tinyc_token_char *)token)->value;
+        case TINYC_TOKEN_PP_NUMBER:
+            return &((struct tinyc_token_pp_number *)token)->value;
+        case TINYC_TOKEN_HEADER:
+            return &((struct tinyc_token_header *)token)->path;
+        default:
+            return NULL;
+    }
+}
+
+static void free_tokens(struct tinyc_token *tokens) {
+    if (!tokens) return;
+    struct tinyc_token *token = tokens;
+    do {
+        struct tinyc_token *next = token->next;
+        struct tinyc_string *value = value_of(token);
+        if (value) tinyc_string_free(value);
+        tinyc_free(token);
+        token = next;
+    } while (token != tokens);
+}
+
+/// Copy n characters from s into res, without extra capacity.
+static bool copy(struct tinyc_string *res, const char *s, size_t n) {
+    res->cstr = tinyc_alloc(sizeof(char) * (n + 1));
+    if (!res->cstr) return false;
+    memcpy(res->cstr, s, n);
+    res->cstr[n] = '\0';
+    res->len = n;
+    res->cap = n + 1;
+    return true;
+}
+
+/// Create token by create, whose value is n characters from s.
+static struct tinyc_token *create_valued(
+    create_fn create,
+    const struct tinyc_span *span,
+    const char *s,
+    size_t n
+) {
+    struct tinyc_string value;
+    if (!copy(&value, s, n)) return NULL;
+    struct tinyc_token *token = create(span, &value);
+    if (!token) tinyc_string_free(&value);
+    return token;
+}
+
+/// Length of longest punctuation at beginning of s, or 0 if not exists.
+static size_t punct(const char *s, enum tinyc_token_punct_kind *kind) {
+    size_t longest = 0;
+    for (int k = 0; k <= TINYC_TOKEN_PUNCT_SSHARP; ++k) {
+        const char *spelling = tinyc_token_punct_spelling(k);
+        const size_t len = strlen(spelling);
+        if (len > longest && strncmp(s, spelling, len) == 0) {
+            longest = len;
+            *kind = k;
+        }
+    }
+    return longest;
+}
+
+/// Length of pp-number at beginning of s.
+static size_t pp_number(const char *s) {
+    size_t i = s[0] == '.' ? 2 : 1;
+    for (;;) {
+        const char c = s[i], prev = s[i - 1];
+        const bool exponent = prev == 'e' || prev == 'E' || prev == 'p' ||
+                              prev == 'P';
+        if (is_ident_char(c) || c == '.' ||
+            ((c == '+' || c == '-') && exponent)) {
+            ++i;
+        } else {
+            return i;
+        }
+    }
+}
+
+/// Length of sequence quoted by s[0] and close at beginning of s, or 0 if
+/// it isn't closed in s.
+static size_t quoted(const char *s, char close, bool escape) {
+    for (size_t i = 1; s[i]; ++i) {
+        if (escape && s[i] == '\\' && s[i + 1]) {
+            ++i;
+        } else if (s[i] == close) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/// Returns true if tokens is "#" followed by "include".
+static bool is_include(const struct tinyc_token *tokens) {
+    if (!tokens || tokens->kind != TINYC_TOKEN_PUNCT) return false;
+    const struct tinyc_token_punct *sharp = (const void *)tokens;
+    if (sharp->kind != TINYC_TOKEN_PUNCT_SHARP) return false;
+    const struct tinyc_token *next = tokens->next;
+    if (next == tokens || next->next != tokens) return false;
+    if (next->kind != TINYC_TOKEN_IDENT) return false;
+    const struct tinyc_token_ident *ident = (const void *)next;
+    return strcmp(ident->value.cstr, "include") == 0;
+}
+
+/// Create token at beginning of s, and set its length to len.
+/// Set NULL to token if no token starts at s.
+static bool lex_token(
+    const char *s,
+    const struct tinyc_token *tokens,
+    struct tinyc_span *span,
+    struct tinyc_token **token,
+    size_t *len
+) {
+    const char c = s[0];
+    enum tinyc_token_punct_kind kind;
+    *token = NULL;
+    if ((c == '<' || c == '"') && is_include(tokens) &&
+        (*len = quoted(s, c == '<' ? '>' : '"', false))) {
+        struct tinyc_string path;
+        if (!copy(&path, s + 1, *len - 2)) return false;
+        span->end.offset += *len - 1;
+        *token = tinyc_token_create_header(span, c == '<', &path);
+        if (!*token) tinyc_string_free(&path);
+    } else if (is_ident_start(c)) {
+        for (*len = 1; is_ident_char(s[*len]); ++*len) {}
+        span->end.offset += *len - 1;
+        *token = create_valued(tinyc_token_create_ident, span, s, *len);
+    } else if (is_digit(c) || (c == '.' && is_digit(s[1]))) {
+        *len = pp_number(s);
+        span->end.offset += *len - 1;
+        *token = create_valued(tinyc_token_create_pp_number, span, s, *len);
+    } else if (c == '"' || c == '\'') {
+        // Unterminated literal continues until end of line.
+        const size_t closed = quoted(s, c, true);
+        *len = closed ? closed : strlen(s);
+        span->end.offset += *len - 1;
+        *token = create_valued(
+            c == '"' ? tinyc_token_create_string : tinyc_token_create_char,
+            span,
+            s + 1,
+            *len - (closed ? 2 : 1)
+        );
+    } else if ((*len = punct(s, &kind))) {
+        span->end.offset += *len - 1;
+        *token = tinyc_token_create_punct(span, kind);
+    } else {
+        *len = 1;
+        return true;
+    }
+    return *token;
+}
+
+/// Lex a logical line beginning with state, and set state at end of the
+/// line.
+static bool lex_line(
+    const struct tinyc_splice *line,
+    tinyc_repo_id id,
+    enum tinyc_lexer_state *state,
+    struct tinyc_token **tokens
+) {
+    const char *s = line->cstr;
+    const size_t row = line->row;
+    size_t i = 0;
+    *tokens = NULL;
+    if (*state == TINYC_LEXER_COMMENT) {
+        const char *end = strstr(s, "*/");
+        if (!end) return true;
+        i = end - s + 2;
+        *state = TINYC_LEXER_NORMAL;
+    }
+    while (i < line->len) {
+        if (is_space(s[i])) {
+            ++i;
+            continue;
+        } else if (s[i] == '/' && s[i + 1] == '/') {
+            break;
+        } else if (s[i] == '/' && s[i + 1] == '*') {
+            const char *end = strstr(s + i + 2, "*/");
+            if (!end) {
+                *state = TINYC_LEXER_COMMENT;
+                break;
+            }
+            i = end - s + 2;
+            continue;
+        }
+
+        struct tinyc_span span = {
+            id,
+            {row, i},
+            {row, i}
+        };
+        struct tinyc_token *token;
+        size_t len;
+        if (!lex_token(s + i, *tokens, &span, &token, &len)) {
+            free_tokens(*tokens);
+            *tokens = NULL;
+            return false;
+        }
+        if (token && line->npoints) {
+            // Offsets are in logical line, so map them to physical lines.
+            token->span.start = tinyc_splice_position(line, i);
+            token->span.end = tinyc_splice_position(line, i + len - 1);
+        }
+        if (token && *tokens) {
+            tinyc_token_insert((*tokens)->prev, token);
+        } else if (token) {
+            *tokens = token;
+        }
+        i += len;
+    }
+    return true;
+}
+
+/// Lex logical line beginning at row with state, replacing tokens of
+/// physical lines it consists of, and set state at end of the line.
+static bool lex_logical_line(
+    struct tinyc_lexer *this,
+    size_t row,
+    enum tinyc_lexer_state *state
+) {
+    const bool built = tinyc_splice_build(
+        &this->splice,
+        this->index.lines,
+        this->index.len,
+        row
+    );
+    if (!built) return false;
+    for (size_t i = 0; i < this->splice.nrows; ++i) {
+        struct tinyc_lexer_line *line = &this->lines[row + i];
+        free_tokens(line->tokens);
+        line->state = i ? TINYC_LEXER_SPLICED : *state;
+        line->row = row + i;
+        line->tokens = NULL;
+    }
+    return lex_line(&this->splice, this->id, state, &this->lines[row].tokens);
+}
+
+/// Make lexer be able to hold len lines.
+static bool reserve(struct tinyc_lexer *this, size_t len) {
+    if (len <= this->cap) return true;
+    const size_t cap = len > this->cap * 2 ? len : this->cap * 2;
+    struct tinyc_lexer_line *lines = tinyc_realloc(
+        this->lines,
+        sizeof(struct tinyc_lexer_line) * cap
+    );
+    if (!lines) return false;
+    this->lines = lines;
+    this->cap = cap;
+    return true;
+}
+
+bool tinyc_lexer_init(
+    struct tinyc_lexer *this,
+    struct tinyc_source *source,
+    tinyc_repo_id id
+) {
+    this->source = source;
+    this->id = id;
+    this->lines = NULL;
+    this->len = this->cap = this->relexed = 0;
+    tinyc_splice_init(&this->splice);
+    if (!tinyc_source_index_init(&this->index, source)) return false;
+    if (!reserve(this, this->index.cap)) {
+        tinyc_lexer_free(this);
+        return false;
+    }
+    for (size_t row = 0; row < this->index.len; ++row) {
+        this->lines[row].tokens = NULL;
+    }
+    this->len = this->index.len;
+
+    tinyc_trace_begin("lex", source->name.cstr);
+    enum tinyc_lexer_state state = TINYC_LEXER_NORMAL;
+    for (size_t row = 0; row < this->len; row += this->splice.nrows) {
+        if (!lex_logical_line(this, row, &state)) {
+            tinyc_trace_end();
+            tinyc_lexer_free(this);
+            return false;
+        }
+    }
+    tinyc_trace_end();
+    this->relexed = this->len;
+    return true;
+}
+
+bool tinyc_lexer_edit(
+    struct tinyc_lexer *this,
+    size_t srow,
+    size_t soffset,
+    size_t erow,
+    size_t eoffset,
+    const char *text
+) {
+    const size_t len = this->len;
+    if (srow > erow || (len && erow >= len)) return false;
+    const size_t removed = len ? erow - srow + 1 : 0;
+    size_t nlines = 1;
+    for (const char *c = text; *c; ++c) nlines += *c == '\n';
+    if (!reserve(this, len - removed + nlines)) return false;
+    const bool edited = tinyc_source_edit(
+        this->source,
+        &this->index,
+        srow,
+        soffset,
+        erow,
+        eoffset,
+        text,
+        &nlines
+    );
+    if (!edited) return false;
+
+    // Logical line containing srow is lexed again from its beginning.
+    size_t start = srow;
+    while (start < len && this->lines[start].state == TINYC_LEXER_SPLICED) {
+        --start;
+    }
+    enum tinyc_lexer_state state = len ? this->lines[start].state
+                                       : TINYC_LEXER_NORMAL;
+
+    // Replace lines from srow to erow with edited lines.
+    for (size_t row = srow; row < srow + removed; ++row) {
+        free_tokens(this->lines[row].tokens);
+    }
+    memmove(
+        &this->lines[srow + nlines],
+        &this->lines[srow + removed],
+        sizeof(struct tinyc_lexer_line) * (len - srow - removed)
+    );
+    for (size_t row = srow; row < srow + nlines; ++row) {
+        this->lines[row].tokens = NULL;
+    }
+    this->len = len - removed + nlines;
+
+    // Lex until state at beginning of line is the same as before.
+    tinyc_trace_begin("relex", this->source->name.cstr);
+    this->relexed = 0;
+    for (size_t row = start; row < this->len; row += this->splice.nrows) {
+        if (row >= srow + nlines && this->lines[row].state == state) break;
+        if (!lex_logical_line(this, row, &state)) {
+            tinyc_trace_end();
+            return false;
+        }
+        this->relexed += this->splice.nrows;
+    }
+    tinyc_trace_end();
+    return true;
+}
+
+const struct tinyc_token *tinyc_lexer_tokens(
+    struct tinyc_lexer *this,
+    size_t row
+) {
+    if (row >= this->len) return NULL;
+
+    // Rows are fixed lazily, so lines moved by edit are not touched at edit.
+    struct tinyc_lexer_line *line = &this->lines[row];
+    if (line->row != row && line->tokens) {
+        struct tinyc_token *token = line->tokens;
+        do {
+            token->span.start.row = token->span.start.row - line->row + row;
+            token->span.end.row = token->span.end.row - line->row + row;
+            token = token->next;
+        } while (token != line->tokens);
+    }
+    line->row = row;
+    return line->tokens;
+}
+
+void tinyc_lexer_free(struct tinyc_lexer *this) {
+    for (size_t row = 0; row < this->len; ++row) {
+        free_tokens(this->lines[row].tokens);
+    }
+    tinyc_free(this->lines);
+    tinyc_source_index_free(&this->index);
+    tinyc_splice_free(&this->splice);
+    this->lines = NULL;
+    this->len = this->cap = 0;
+}
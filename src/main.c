@@ -0,0 +1,215 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyc/diag_json.h"
+#include "tinyc/session.h"
+#include "tinyc/stats.h"
+#include "tinyc/token_cache.h"
+#include "tinyc/trace.h"
+
+// Number of files listed by --include-report.
+#define REPORT_LIMIT 20
+
+// Number of threads reading headers ahead.
+#define PREFETCH_THREADS 4
+
+// Maximum total size of files in --token-cache directory.
+#define TOKEN_CACHE_SIZE (64 << 20)
+
+static const char usage[] =
+    "usage: tinyc [-I dir]... [-j threads] [--print-stats] [--trace file]\n"
+    "             [--include-report] [--diagnostics-format=json|sarif]\n"
+    "             [--token-cache dir] file...\n"
+    "       tinyc --server socket [-I dir]...\n"
+    "       tinyc --run file [arg]...\n";
+
+/// Command line options.
+struct options {
+    const char *server;  // Socket path if running as server, or NULL.
+    size_t nthreads;     // Number of threads, or 0 for number of processors.
+    bool print_stats;    // Print allocation statistics at exit.
+    const char *trace;   // Path to write trace events, or NULL.
+    bool report;         // Print files which cost the most time.
+    const char *cache;   // Directory of token cache, or NULL.
+    bool run;            // Run the file in process instead of compiling.
+    bool json;           // Write diagnostics to stdout as format below.
+    enum tinyc_diag_json_format format;
+    char **args;         // Arguments to run the file with, from its path.
+    int nargs;
+    char **files;        // Input files.
+    size_t nfiles;
+};
+
+static bool parse_args(
+    int argc,
+    char **argv,
+    struct tinyc_session *session,
+    struct options *options
+) {
+    options->server = NULL;
+    options->nthreads = 0;
+    options->print_stats = false;
+    options->trace = NULL;
+    options->report = false;
+    options->cache = NULL;
+    options->run = false;
+    options->json = false;
+    options->args = NULL;
+    options->nargs = 0;
+    options->files = malloc(sizeof(char *) * argc);
+    options->nfiles = 0;
+    if (!options->files) return false;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--server") == 0 && i + 1 < argc) {
+            options->server = argv[++i];
+        } else if (strcmp(arg, "-j") == 0 && i + 1 < argc) {
+            char *end;
+            options->nthreads = strtoul(argv[++i], &end, 10);
+            if (*end || options->nthreads == 0) return false;
+        } else if (strcmp(arg, "--print-stats") == 0) {
+            options->print_stats = true;
+        } else if (strcmp(arg, "--run") == 0 && i + 1 < argc) {
+            // Rest of arguments are passed to the program.
+            options->run = true;
+            options->args = argv + i + 1;
+            options->nargs = argc - i - 1;
+            options->files[options->nfiles++] = argv[i + 1];
+            break;
+        } else if (strcmp(arg, "--include-report") == 0) {
+            options->report = true;
+        } else if (strcmp(arg, "--token-cache") == 0 && i + 1 < argc) {
+            options->cache = argv[++i];
+        } else if (strcmp(arg, "--diagnostics-format=json") == 0) {
+            options->json = true;
+            options->format = TINYC_DIAG_JSON_LINES;
+        } else if (strcmp(arg, "--diagnostics-format=sarif") == 0) {
+            options->json = true;
+            options->format = TINYC_DIAG_JSON_SARIF;
+        } else if (strcmp(arg, "--trace") == 0 && i + 1 < argc) {
+            options->trace = argv[++i];
+        } else if (strcmp(arg, "-I") == 0 && i + 1 < argc) {
+            if (!tinyc_session_add_dir(session, argv[++i])) return false;
+        } else if (strncmp(arg, "-I", 2) == 0 && arg[2]) {
+            if (!tinyc_session_add_dir(session, arg + 2)) return false;
+        } else if (arg[0] == '-' && arg[1]) {
+            fprintf(stderr, "tinyc: error: unknown option %s\n", arg);
+            return false;
+        } else {
+            options->files[options->nfiles++] = argv[i];
+        }
+    }
+    // Only compiled files report diagnostics in machine readable format.
+    if (options->json && (options->run || options->server)) return false;
+    if (options->run) return !options->server && options->nfiles == 1;
+    return options->server ? options->nfiles == 0 : options->nfiles != 0;
+}
+
+int main(int argc, char **argv) {
+    struct tinyc_session session;
+    struct options options;
+    if (!tinyc_session_init(&session)) {
+        fputs("tinyc: error: failed to initialize\n", stderr);
+        return EXIT_FAILURE;
+    }
+    if (!parse_args(argc, argv, &session, &options)) {
+        fputs(usage, stderr);
+        tinyc_session_free(&session);
+        free(options.files);
+        return EXIT_FAILURE;
+    }
+
+    // File run in process includes no header yet.
+    if (!options.run && !tinyc_session_prefetch(&session, PREFETCH_THREADS)) {
+        fputs("tinyc: error: failed to initialize\n", stderr);
+        tinyc_session_free(&session);
+        free(options.files);
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    int status = EXIT_SUCCESS;
+    if (options.trace) tinyc_trace_start();
+    if (options.server) {
+        signal(SIGPIPE, SIG_IGN);
+        ok = tinyc_session_serve(&session, options.server);
+        if (!ok) {
+            const char *socket = options.server;
+            fprintf(stderr, "tinyc: error: can't listen on %s\n", socket);
+        }
+    } else if (options.run) {
+        fflush(stdout);
+        ok = tinyc_session_run(
+            &session,
+            options.files[0],
+            options.nargs,
+            options.args,
+            stderr,
+            &status
+        );
+    } else {
+        // Sink is large, so it's allocated only if used.
+        struct tinyc_diag_json *json = NULL;
+        if (options.json) {
+            json = malloc(sizeof(struct tinyc_diag_json));
+            ok = json && tinyc_diag_json_init(json, stdout, options.format);
+        }
+        if (ok) {
+            session.json = json;
+            ok = tinyc_session_compile_all(
+                &session,
+                options.files,
+                options.nfiles,
+                options.nthreads,
+                stderr
+            );
+            session.json = NULL;
+        }
+        if (json && !tinyc_diag_json_finish(json)) {
+            fputs("tinyc: error: can't write diagnostics\n", stderr);
+            ok = false;
+        }
+        free(json);
+    }
+
+    if (options.report) {
+        session.token_cache = options.cache;
+        tinyc_session_report(&session, REPORT_LIMIT, stderr);
+    }
+    if (options.cache) {
+        tinyc_token_cache_evict(options.cache, TOKEN_CACHE_SIZE);
+    }
+    if (options.trace) {
+        FILE *fp = fopen(options.trace, "w");
+        if (!fp || !tinyc_trace_finish(fp)) {
+            fprintf(stderr, "tinyc: error: can't write %s\n", options.trace);
+            ok = false;
+        }
+        if (fp) fclose(fp);
+    }
+    if (options.print_stats && !tinyc_stats_dump(stderr)) {
+        fputs("tinyc: error: built without TINYC_STATS\n", stderr);
+    }
+    tinyc_session_free(&session);
+    free(options.files);
+    return ok ? status : EXIT_FAILURE;
+}
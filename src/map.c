@@ -0,0 +1,116 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tinyc/map.h"
+
+#include <string.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/string.h"
+
+#define DEFAULT_CAP 16
+
+static inline struct tinyc_map_entry *find_slot(
+    struct tinyc_map_entry *entries,
+    size_t cap,
+    size_t hash,
+    const struct tinyc_string *key
+) {
+    size_t i = hash & (cap - 1);
+    while (entries[i].used) {
+        const struct tinyc_map_entry *e = &entries[i];
+        if (e->hash == hash && tinyc_string_cmp(&e->key, key) == 0) break;
+        i = (i + 1) & (cap - 1);
+    }
+    return &entries[i];
+}
+
+static bool grow(struct tinyc_map *this) {
+    const size_t new_cap = this->cap * 2;
+    struct tinyc_map_entry *entries = tinyc_calloc(
+        new_cap,
+        sizeof(struct tinyc_map_entry)
+    );
+    if (!entries) return false;
+    for (size_t i = 0; i < this->cap; ++i) {
+        const struct tinyc_map_entry *e = &this->entries[i];
+        if (e->used) *find_slot(entries, new_cap, e->hash, &e->key) = *e;
+    }
+    tinyc_free(this->entries);
+    this->entries = entries;
+    this->cap = new_cap;
+    return true;
+}
+
+static bool copy_key(struct tinyc_string *dst, const struct tinyc_string *src) {
+    dst->cstr = tinyc_alloc(sizeof(char) * (src->len + 1));
+    if (!dst->cstr) return false;
+    memcpy(dst->cstr, src->cstr, src->len);
+    dst->cstr[src->len] = '\0';
+    dst->len = src->len;
+    dst->cap = src->len + 1;
+    return true;
+}
+
+bool tinyc_map_init(struct tinyc_map *this) {
+    this->len = 0;
+    this->cap = DEFAULT_CAP;
+    this->entries = tinyc_calloc(this->cap, sizeof(struct tinyc_map_entry));
+    return this->entries != NULL;
+}
+
+bool tinyc_map_insert(
+    struct tinyc_map *this,
+    const struct tinyc_string *key,
+    void *value
+) {
+    const size_t hash = tinyc_string_hash(key);
+    struct tinyc_map_entry *e = find_slot(this->entries, this->cap, hash, key);
+    if (e->used) {
+        e->value = value;
+        return true;
+    }
+
+    if ((this->len + 1) * 4 > this->cap * 3) {
+        if (!grow(this)) return false;
+        e = find_slot(this->entries, this->cap, hash, key);
+    }
+    if (!copy_key(&e->key, key)) return false;
+    e->used = true;
+    e->hash = hash;
+    e->value = value;
+    this->len++;
+    return true;
+}
+
+bool tinyc_map_query(
+    const struct tinyc_map *this,
+    const struct tinyc_string *key,
+    void **value
+) {
+    const size_t hash = tinyc_string_hash(key);
+    struct tinyc_map_entry *e = find_slot(this->entries, this->cap, hash, key);
+    if (!e->used) return false;
+    if (value) *value = e->value;
+    return true;
+}
+
+void tinyc_map_free(struct tinyc_map *this) {
+    for (size_t i = 0; i < this->cap; ++i) {
+        if (this->entries[i].used) tinyc_string_free(&this->entries[i].key);
+    }
+    tinyc_free(this->entries);
+    this->entries = NULL;
+    this->len = this->cap = 0;
+}
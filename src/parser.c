@@ -0,0 +1,1480 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_AST
+
+#include "tinyc/parser.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/ast.h"
+#include "tinyc/lexer.h"
+#include "tinyc/span.h"
+#include "tinyc/string.h"
+#include "tinyc/symtab.h"
+#include "tinyc/token.h"
+
+// Number of tokens parser can look ahead.
+#define LOOKAHEAD 4
+
+#define DEFAULT_STACK_CAP 64
+
+// Estimated number of nodes in a line. Tree is reserved up front, as growing
+// a large tree costs more than parsing it.
+#define NODES_PER_LINE 8
+// Maximum depth of nested constructs, so deeply nested input fails instead
+// of overflowing stack.
+#define MAX_NESTING 1024
+#define NKEYWORDS (TINYC_TOKEN_KEYWORD__IMAGINARY + 1)
+#define NOT_KEYWORD -1
+
+#define SPECIFIERS                                                   \
+    (TINYC_AST_SPEC_VOID | TINYC_AST_SPEC_BOOL | TINYC_AST_SPEC_CHAR | \
+     TINYC_AST_SPEC_SHORT | TINYC_AST_SPEC_INT | TINYC_AST_SPEC_LONG | \
+     TINYC_AST_SPEC_LONG_LONG | TINYC_AST_SPEC_SIGNED |               \
+     TINYC_AST_SPEC_UNSIGNED | TINYC_AST_SPEC_FLOAT |                 \
+     TINYC_AST_SPEC_DOUBLE)
+
+/// Flags set by each keyword in declaration specifiers.
+static const uint32_t specifier_flags[NKEYWORDS] = {
+    [TINYC_TOKEN_KEYWORD_CONST] = TINYC_AST_QUAL_CONST,
+    [TINYC_TOKEN_KEYWORD_VOLATILE] = TINYC_AST_QUAL_VOLATILE,
+    [TINYC_TOKEN_KEYWORD_RESTRICT] = TINYC_AST_QUAL_RESTRICT,
+    [TINYC_TOKEN_KEYWORD_VOID] = TINYC_AST_SPEC_VOID,
+    [TINYC_TOKEN_KEYWORD__BOOL] = TINYC_AST_SPEC_BOOL,
+    [TINYC_TOKEN_KEYWORD_CHAR] = TINYC_AST_SPEC_CHAR,
+    [TINYC_TOKEN_KEYWORD_SHORT] = TINYC_AST_SPEC_SHORT,
+    [TINYC_TOKEN_KEYWORD_INT] = TINYC_AST_SPEC_INT,
+    [TINYC_TOKEN_KEYWORD_LONG] = TINYC_AST_SPEC_LONG,
+    [TINYC_TOKEN_KEYWORD_SIGNED] = TINYC_AST_SPEC_SIGNED,
+    [TINYC_TOKEN_KEYWORD_UNSIGNED] = TINYC_AST_SPEC_UNSIGNED,
+    [TINYC_TOKEN_KEYWORD_FLOAT] = TINYC_AST_SPEC_FLOAT,
+    [TINYC_TOKEN_KEYWORD_DOUBLE] = TINYC_AST_SPEC_DOUBLE,
+};
+
+/// Storage classes set by each keyword. auto and register have no effect.
+static const uint32_t storage_flags[NKEYWORDS] = {
+    [TINYC_TOKEN_KEYWORD_TYPEDEF] = TINYC_AST_STORAGE_TYPEDEF,
+    [TINYC_TOKEN_KEYWORD_EXTERN] = TINYC_AST_STORAGE_EXTERN,
+    [TINYC_TOKEN_KEYWORD_STATIC] = TINYC_AST_STORAGE_STATIC,
+    [TINYC_TOKEN_KEYWORD_INLINE] = TINYC_AST_STORAGE_INLINE,
+};
+
+// Value bound to typedef names. Other ordinary identifiers are bound to NULL.
+static char typedef_name;
+
+/// Token in lookahead buffer.
+struct lookahead {
+    const struct tinyc_token *token;  // NULL at end of tokens.
+    int keyword;                      // Kind of keyword, or NOT_KEYWORD.
+};
+
+struct parser {
+    struct tinyc_ast *ast;
+    struct tinyc_lexer *lexer;
+    size_t row;                       // Next row to read tokens from.
+    const struct tinyc_token *first;  // First token in current row.
+    const struct tinyc_token *next;   // Next token to read, or NULL.
+    struct lookahead buf[LOOKAHEAD];  // Ring buffer of tokens to see.
+    size_t head, len;
+    struct tinyc_span last;  // Span of last consumed token.
+    tinyc_ast_ref *stack;    // Children of nodes being parsed.
+    size_t stack_len, stack_cap;
+    struct tinyc_symtab symbols;  // Ordinary identifiers in scope.
+    size_t nesting;               // Depth of nested constructs.
+    struct tinyc_parse_error *error;
+    bool failed;
+};
+
+/// Get kind of keyword spelled as s, or NOT_KEYWORD.
+static int keyword_of(const struct tinyc_string *s) {
+    const char c = s->cstr[0];
+    if (s->len < 2 || s->len > 10) return NOT_KEYWORD;
+    if (c == '_') {
+        for (int k = TINYC_TOKEN_KEYWORD__BOOL; k < NKEYWORDS; ++k) {
+            if (strcmp(s->cstr, tinyc_token_keyword_spelling(k)) == 0) {
+                return k;
+            }
+        }
+        return NOT_KEYWORD;
+    }
+    if (c < 'a' || 'w' < c) return NOT_KEYWORD;
+
+    // Keywords from auto to while are sorted.
+    int lo = 0, hi = TINYC_TOKEN_KEYWORD_WHILE + 1;
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        const int cmp = strcmp(s->cstr, tinyc_token_keyword_spelling(mid));
+        if (cmp == 0) return mid;
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NOT_KEYWORD;
+}
+
+static inline bool is_punct_token(
+    const struct tinyc_token *token,
+    enum tinyc_token_punct_kind kind
+) {
+    return token && token->kind == TINYC_TOKEN_PUNCT &&
+           ((const struct tinyc_token_punct *)token)->kind == kind;
+}
+
+/// Read next token from lexer, skipping preprocessing directives.
+static const struct tinyc_token *read_token(struct parser *this) {
+    while (!this->next) {
+        if (this->row >= this->lexer->len) return NULL;
+        const struct tinyc_token *tokens = tinyc_lexer_tokens(
+            this->lexer,
+            this->row++
+        );
+        if (tokens && !is_punct_token(tokens, TINYC_TOKEN_PUNCT_SHARP)) {
+            this->first = this->next = tokens;
+        }
+    }
+    const struct tinyc_token *token = this->next;
+    this->next = token->next == this->first ? NULL : token->next;
+    return token;
+}
+
+/// Get k-th token from current one. k must be less than LOOKAHEAD.
+static const struct lookahead *peek(struct parser *this, size_t k) {
+    while (this->len <= k) {
+        const size_t i = (this->head + this->len++) % LOOKAHEAD;
+        struct lookahead *la = &this->buf[i];
+        la->token = read_token(this);
+        la->keyword = NOT_KEYWORD;
+        if (!la->token) continue;
+        if (la->token->kind == TINYC_TOKEN_KEYWORD) {
+            la->keyword = ((const struct tinyc_token_keyword *)la->token)->kind;
+        } else if (la->token->kind == TINYC_TOKEN_IDENT) {
+            la->keyword = keyword_of(
+                &((const struct tinyc_token_ident *)la->token)->value
+            );
+        }
+    }
+    return &this->buf[(this->head + k) % LOOKAHEAD];
+}
+
+static void advance(struct parser *this) {
+    const struct lookahead *la = peek(this, 0);
+    if (la->token) this->last = la->token->span;
+    this->head = (this->head + 1) % LOOKAHEAD;
+    this->len--;
+}
+
+/// Get span of current token, or end of last token if no more exists.
+static struct tinyc_span current(struct parser *this) {
+    const struct lookahead *la = peek(this, 0);
+    if (la->token) return la->token->span;
+    const struct tinyc_span span = {this->last.id, this->last.end,
+                                    this->last.end};
+    return span;
+}
+
+/// Record error at current token, unless already failed.
+static bool fail(struct parser *this, const char *message) {
+    if (!this->failed) {
+        this->error->span = current(this);
+        this->error->message = message;
+        this->failed = true;
+    }
+    return false;
+}
+
+/// Enter nested construct. Returns false if nested too deep.
+static bool nest(struct parser *this) {
+    if (this->nesting == MAX_NESTING) return fail(this, "nesting too deep");
+    this->nesting++;
+    return true;
+}
+
+/// Leave nested construct, and return ref.
+static inline tinyc_ast_ref unnest(struct parser *this, tinyc_ast_ref ref) {
+    this->nesting--;
+    return ref;
+}
+
+/// Parse nested construct with parse.
+static tinyc_ast_ref nested(
+    struct parser *this,
+    tinyc_ast_ref (*parse)(struct parser *)
+) {
+    return nest(this) ? unnest(this, parse(this)) : 0;
+}
+
+static inline bool is_punct(
+    const struct lookahead *la,
+    enum tinyc_token_punct_kind kind
+) {
+    return is_punct_token(la->token, kind);
+}
+
+static inline bool is_keyword(
+    const struct lookahead *la,
+    enum tinyc_token_keyword_kind kind
+) {
+    return la->keyword == (int)kind;
+}
+
+/// Get identifier of token, or NULL if it isn't an identifier.
+static const struct tinyc_string *ident_of(const struct lookahead *la) {
+    if (!la->token || la->token->kind != TINYC_TOKEN_IDENT) return NULL;
+    if (la->keyword != NOT_KEYWORD) return NULL;
+    return &((const struct tinyc_token_ident *)la->token)->value;
+}
+
+static bool consume_punct(
+    struct parser *this,
+    enum tinyc_token_punct_kind kind
+) {
+    if (!is_punct(peek(this, 0), kind)) return false;
+    advance(this);
+    return true;
+}
+
+static bool expect_punct(
+    struct parser *this,
+    enum tinyc_token_punct_kind kind,
+    const char *message
+) {
+    return !this->failed && (consume_punct(this, kind) || fail(this, message));
+}
+
+/// Copy identifier of current token into tree, and set its offset to name.
+/// Returns false if current token isn't an identifier.
+static bool consume_ident(struct parser *this, uint32_t *name) {
+    const struct tinyc_string *ident = ident_of(peek(this, 0));
+    if (!ident) return false;
+    if (!tinyc_ast_add_string(this->ast, ident->cstr, ident->len, name)) {
+        return fail(this, "out of memory");
+    }
+    advance(this);
+    return true;
+}
+
+static bool is_typedef_name(struct parser *this, const struct lookahead *la) {
+    const struct tinyc_string *ident = ident_of(la);
+    if (!ident) return false;
+    const struct tinyc_symtab_symbol *symbol = tinyc_symtab_lookup(
+        &this->symbols,
+        TINYC_SYMTAB_ORDINARY,
+        ident
+    );
+    return symbol && symbol->value == &typedef_name;
+}
+
+/// Declare name in innermost scope, which shadows typedef name unless it's
+/// also a typedef name.
+static bool bind(struct parser *this, uint32_t name, bool is_typedef) {
+    struct tinyc_string key;
+    tinyc_string_from(&key, this->ast->strings.cstr + name);
+    const bool ok = tinyc_symtab_declare(
+        &this->symbols,
+        TINYC_SYMTAB_ORDINARY,
+        &key,
+        is_typedef ? &typedef_name : NULL
+    );
+    return ok || fail(this, "out of memory");
+}
+
+static bool enter_scope(struct parser *this) {
+    return tinyc_symtab_push(&this->symbols) || fail(this, "out of memory");
+}
+
+static void leave_scope(struct parser *this) {
+    tinyc_symtab_pop(&this->symbols);
+}
+
+/// Returns true if declaration specifiers start at la.
+static bool is_type_start(struct parser *this, const struct lookahead *la) {
+    const int k = la->keyword;
+    if (k != NOT_KEYWORD) {
+        return specifier_flags[k] || storage_flags[k] ||
+               k == TINYC_TOKEN_KEYWORD_AUTO ||
+               k == TINYC_TOKEN_KEYWORD_REGISTER ||
+               k == TINYC_TOKEN_KEYWORD_STRUCT ||
+               k == TINYC_TOKEN_KEYWORD_UNION ||
+               k == TINYC_TOKEN_KEYWORD_ENUM;
+    }
+    return is_typedef_name(this, la);
+}
+
+/// Push child of node being parsed. Fails if parser already failed.
+static bool push(struct parser *this, tinyc_ast_ref ref) {
+    if (this->failed) return false;
+    if (this->stack_len == this->stack_cap) {
+        const size_t cap = this->stack_cap * 2;
+        tinyc_ast_ref *stack = tinyc_realloc(
+            this->stack,
+            sizeof(tinyc_ast_ref) * cap
+        );
+        if (!stack) return fail(this, "out of memory");
+        this->stack = stack;
+        this->stack_cap = cap;
+    }
+    this->stack[this->stack_len++] = ref;
+    return true;
+}
+
+/// Create node of kind from start to last consumed token, whose children are
+/// pushed since begin.
+/// Returns 0 if parser already failed.
+static tinyc_ast_ref node(
+    struct parser *this,
+    enum tinyc_ast_kind kind,
+    const struct tinyc_span *start,
+    size_t begin
+) {
+    if (this->failed) {
+        this->stack_len = begin;
+        return 0;
+    }
+    const struct tinyc_span span = {start->id, start->start, this->last.end};
+    const tinyc_ast_ref ref = tinyc_ast_add(
+        this->ast,
+        kind,
+        &span,
+        this->stack + begin,
+        this->stack_len - begin
+    );
+    this->stack_len = begin;
+    if (!ref) fail(this, "out of memory");
+    return ref;
+}
+
+static tinyc_ast_ref node0(
+    struct parser *this,
+    enum tinyc_ast_kind kind,
+    const struct tinyc_span *start
+) {
+    return node(this, kind, start, this->stack_len);
+}
+
+static tinyc_ast_ref node1(
+    struct parser *this,
+    enum tinyc_ast_kind kind,
+    const struct tinyc_span *start,
+    tinyc_ast_ref a
+) {
+    const size_t begin = this->stack_len;
+    push(this, a);
+    return node(this, kind, start, begin);
+}
+
+static tinyc_ast_ref node2(
+    struct parser *this,
+    enum tinyc_ast_kind kind,
+    const struct tinyc_span *start,
+    tinyc_ast_ref a,
+    tinyc_ast_ref b
+) {
+    const size_t begin = this->stack_len;
+    push(this, a);
+    push(this, b);
+    return node(this, kind, start, begin);
+}
+
+static tinyc_ast_ref node3(
+    struct parser *this,
+    enum tinyc_ast_kind kind,
+    const struct tinyc_span *start,
+    tinyc_ast_ref a,
+    tinyc_ast_ref b,
+    tinyc_ast_ref c
+) {
+    const size_t begin = this->stack_len;
+    push(this, a);
+    push(this, b);
+    push(this, c);
+    return node(this, kind, start, begin);
+}
+
+/// Set name and flags of node if it exists, returns node.
+static tinyc_ast_ref with(
+    struct parser *this,
+    tinyc_ast_ref ref,
+    uint32_t name,
+    uint32_t flags
+) {
+    if (ref) {
+        this->ast->nodes[ref].name = name;
+        this->ast->nodes[ref].flags = flags;
+    }
+    return ref;
+}
+
+/// Create node of binary operator from lhs to last consumed token.
+static tinyc_ast_ref binary_node(
+    struct parser *this,
+    enum tinyc_ast_kind kind,
+    tinyc_ast_ref lhs,
+    tinyc_ast_ref rhs
+) {
+    if (this->failed) return 0;
+    const struct tinyc_span start = this->ast->spans[lhs];
+    return node2(this, kind, &start, lhs, rhs);
+}
+
+/// Get precedence and kind of binary operator, or 0 if la isn't it.
+static int binary_op(const struct lookahead *la, enum tinyc_ast_kind *kind) {
+    if (!la->token || la->token->kind != TINYC_TOKEN_PUNCT) return 0;
+    switch (((const struct tinyc_token_punct *)la->token)->kind) {
+        case TINYC_TOKEN_PUNCT_STAR:
+            return *kind = TINYC_AST_MUL, 10;
+        case TINYC_TOKEN_PUNCT_SLASH:
+            return *kind = TINYC_AST_DIV, 10;
+        case TINYC_TOKEN_PUNCT_PERCENT:
+            return *kind = TINYC_AST_MOD, 10;
+        case TINYC_TOKEN_PUNCT_PLUS:
+            return *kind = TINYC_AST_ADD, 9;
+        case TINYC_TOKEN_PUNCT_MINUS:
+            return *kind = TINYC_AST_SUB, 9;
+        case TINYC_TOKEN_PUNCT_LSHIFT:
+            return *kind = TINYC_AST_SHL, 8;
+        case TINYC_TOKEN_PUNCT_RSHIFT:
+            return *kind = TINYC_AST_SHR, 8;
+        case TINYC_TOKEN_PUNCT_LT:
+            return *kind = TINYC_AST_LT, 7;
+        case TINYC_TOKEN_PUNCT_GT:
+            return *kind = TINYC_AST_GT, 7;
+        case TINYC_TOKEN_PUNCT_LE:
+            return *kind = TINYC_AST_LE, 7;
+        case TINYC_TOKEN_PUNCT_GE:
+            return *kind = TINYC_AST_GE, 7;
+        case TINYC_TOKEN_PUNCT_EQ:
+            return *kind = TINYC_AST_EQ, 6;
+        case TINYC_TOKEN_PUNCT_NE:
+            return *kind = TINYC_AST_NE, 6;
+        case TINYC_TOKEN_PUNCT_AMP:
+            return *kind = TINYC_AST_AND, 5;
+        case TINYC_TOKEN_PUNCT_HAT:
+            return *kind = TINYC_AST_XOR, 4;
+        case TINYC_TOKEN_PUNCT_VERT:
+            return *kind = TINYC_AST_OR, 3;
+        case TINYC_TOKEN_PUNCT_AAMP:
+            return *kind = TINYC_AST_LAND, 2;
+        case TINYC_TOKEN_PUNCT_VVERT:
+            return *kind = TINYC_AST_LOR, 1;
+        default:
+            return 0;
+    }
+}
+
+/// Get kind of compound operator of assignment, which is TINYC_AST_NONE for
+/// "=". Returns false if la isn't assignment.
+static bool assign_op(const struct lookahead *la, enum tinyc_ast_kind *kind) {
+    if (!la->token || la->token->kind != TINYC_TOKEN_PUNCT) return false;
+    switch (((const struct tinyc_token_punct *)la->token)->kind) {
+        case TINYC_TOKEN_PUNCT_ASSIGN:
+            return *kind = TINYC_AST_NONE, true;
+        case TINYC_TOKEN_PUNCT_STAR_A:
+            return *kind = TINYC_AST_MUL, true;
+        case TINYC_TOKEN_PUNCT_SLASH_A:
+            return *kind = TINYC_AST_DIV, true;
+        case TINYC_TOKEN_PUNCT_PERCENT_A:
+            return *kind = TINYC_AST_MOD, true;
+        case TINYC_TOKEN_PUNCT_PLUS_A:
+            return *kind = TINYC_AST_ADD, true;
+        case TINYC_TOKEN_PUNCT_MINUS_A:
+            return *kind = TINYC_AST_SUB, true;
+        case TINYC_TOKEN_PUNCT_LSHIFT_A:
+            return *kind = TINYC_AST_SHL, true;
+        case TINYC_TOKEN_PUNCT_RSHIFT_A:
+            return *kind = TINYC_AST_SHR, true;
+        case TINYC_TOKEN_PUNCT_AMP_A:
+            return *kind = TINYC_AST_AND, true;
+        case TINYC_TOKEN_PUNCT_HAT_A:
+            return *kind = TINYC_AST_XOR, true;
+        case TINYC_TOKEN_PUNCT_VERT_A:
+            return *kind = TINYC_AST_OR, true;
+        default:
+            return false;
+    }
+}
+
+/// Get kind of prefix operator. Returns false if la isn't it.
+static bool unary_op(const struct lookahead *la, enum tinyc_ast_kind *kind) {
+    if (!la->token || la->token->kind != TINYC_TOKEN_PUNCT) return false;
+    switch (((const struct tinyc_token_punct *)la->token)->kind) {
+        case TINYC_TOKEN_PUNCT_PPLUS:
+            return *kind = TINYC_AST_PRE_INC, true;
+        case TINYC_TOKEN_PUNCT_MMINUS:
+            return *kind = TINYC_AST_PRE_DEC, true;
+        case TINYC_TOKEN_PUNCT_AMP:
+            return *kind = TINYC_AST_ADDR, true;
+        case TINYC_TOKEN_PUNCT_STAR:
+            return *kind = TINYC_AST_DEREF, true;
+        case TINYC_TOKEN_PUNCT_PLUS:
+            return *kind = TINYC_AST_PLUS, true;
+        case TINYC_TOKEN_PUNCT_MINUS:
+            return *kind = TINYC_AST_NEG, true;
+        case TINYC_TOKEN_PUNCT_TILDE:
+            return *kind = TINYC_AST_NOT, true;
+        case TINYC_TOKEN_PUNCT_EXC:
+            return *kind = TINYC_AST_LNOT, true;
+        default:
+            return false;
+    }
+}
+
+static inline int digit_of(char c) {
+    if ('0' <= c && c <= '9') return c - '0';
+    if ('a' <= c && c <= 'f') return c - 'a' + 10;
+    if ('A' <= c && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/// Parse pp-number s as integer constant, and set its suffix to flags.
+/// Returns false if s isn't a valid integer constant.
+static bool parse_int(const char *s, uint64_t *value, uint32_t *flags) {
+    unsigned base = 10;
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    } else if (s[0] == '0') {
+        base = 8;
+    }
+
+    const char *digits = s;
+    uint64_t v = 0;
+    for (int d; (d = digit_of(*s)) >= 0 && (d < 10 || base == 16); ++s) {
+        if ((unsigned)d >= base || v > (UINT64_MAX - d) / base) return false;
+        v = v * base + d;
+    }
+    if (s == digits) return false;
+
+    *flags = 0;
+    for (; *s; ++s) {
+        const uint32_t longs = TINYC_AST_SPEC_LONG | TINYC_AST_SPEC_LONG_LONG;
+        if ((*s == 'u' || *s == 'U') && !(*flags & TINYC_AST_SPEC_UNSIGNED)) {
+            *flags |= TINYC_AST_SPEC_UNSIGNED;
+        } else if ((*s == 'l' || *s == 'L') && !(*flags & longs)) {
+            if (s[1] == s[0]) {
+                *flags |= TINYC_AST_SPEC_LONG_LONG;
+                ++s;
+            } else {
+                *flags |= TINYC_AST_SPEC_LONG;
+            }
+        } else {
+            return false;
+        }
+    }
+    *value = v;
+    return true;
+}
+
+/// Decode escape sequences in n characters of s, and append them to out.
+/// Returns false if failed to allocate memory.
+static bool unescape(const char *s, size_t n, struct tinyc_string *out) {
+    for (size_t i = 0; i < n; ++i) {
+        char c = s[i];
+        if (c == '\\' && i + 1 < n) {
+            c = s[++i];
+            switch (c) {
+                case 'a':
+                    c = '\a';
+                    break;
+                case 'b':
+                    c = '\b';
+                    break;
+                case 'f':
+                    c = '\f';
+                    break;
+                case 'n':
+                    c = '\n';
+                    break;
+                case 'r':
+                    c = '\r';
+                    break;
+                case 't':
+                    c = '\t';
+                    break;
+                case 'v':
+                    c = '\v';
+                    break;
+                case 'x': {
+                    unsigned v = 0;
+                    while (i + 1 < n && digit_of(s[i + 1]) >= 0) {
+                        v = v * 16 + digit_of(s[++i]);
+                    }
+                    c = (char)v;
+                    break;
+                }
+                default:
+                    if ('0' <= c && c <= '7') {
+                        unsigned v = c - '0';
+                        for (int k = 0; k < 2 && i + 1 < n && '0' <= s[i + 1] &&
+                                        s[i + 1] <= '7';
+                             ++k) {
+                            v = v * 8 + (s[++i] - '0');
+                        }
+                        c = (char)v;
+                    }
+                    break;
+            }
+        }
+        if (!tinyc_string_push(out, c)) return false;
+    }
+    return true;
+}
+
+static tinyc_ast_ref expr(struct parser *this);
+static tinyc_ast_ref assign(struct parser *this);
+static tinyc_ast_ref conditional(struct parser *this);
+static tinyc_ast_ref cast(struct parser *this);
+static tinyc_ast_ref type_name(struct parser *this);
+static tinyc_ast_ref statement(struct parser *this);
+
+static tinyc_ast_ref constant(struct parser *this) {
+    const struct lookahead *la = peek(this, 0);
+    const struct tinyc_span start = current(this);
+    const struct tinyc_string *s = la->token->kind == TINYC_TOKEN_CHAR
+        ? &((const struct tinyc_token_char *)la->token)->value
+        : &((const struct tinyc_token_pp_number *)la->token)->value;
+    uint64_t value = 0;
+    uint32_t flags = 0;
+    if (la->token->kind == TINYC_TOKEN_PP_NUMBER) {
+        if (!parse_int(s->cstr, &value, &flags)) {
+            const bool hex = s->cstr[0] == '0' &&
+                             (s->cstr[1] == 'x' || s->cstr[1] == 'X');
+            const bool is_float = strchr(s->cstr, '.') ||
+                                  strpbrk(s->cstr, hex ? "pP" : "eE");
+            fail(
+                this,
+                is_float ? "floating constant is not supported"
+                         : "invalid integer constant"
+            );
+            return 0;
+        }
+    } else {
+        struct tinyc_string chars;
+        if (!tinyc_string_init(&chars)) return fail(this, "out of memory");
+        if (!unescape(s->cstr, s->len, &chars)) {
+            tinyc_string_free(&chars);
+            return fail(this, "out of memory");
+        }
+        if (chars.len == 0) {
+            tinyc_string_free(&chars);
+            return fail(this, "empty character constant");
+        }
+
+        // Character constant has type int, and plain char is signed.
+        value = (uint64_t)(int64_t)(signed char)chars.cstr[0];
+        for (size_t i = 1; i < chars.len; ++i) {
+            value = value << 8 | (unsigned char)chars.cstr[i];
+        }
+        tinyc_string_free(&chars);
+    }
+    advance(this);
+    const tinyc_ast_ref ref = with(
+        this,
+        node0(this, TINYC_AST_INT, &start),
+        0,
+        flags
+    );
+    if (ref) this->ast->nodes[ref].value = value;
+    return ref;
+}
+
+/// Parse adjacent string literals as one string.
+static tinyc_ast_ref string(struct parser *this) {
+    const struct tinyc_span start = current(this);
+    struct tinyc_string content;
+    if (!tinyc_string_init(&content)) return fail(this, "out of memory");
+    for (const struct lookahead *la = peek(this, 0);
+         la->token && la->token->kind == TINYC_TOKEN_STRING;
+         la = peek(this, 0)) {
+        const struct tinyc_string *s = &(
+            (const struct tinyc_token_string *)la->token
+        )->value;
+        if (!unescape(s->cstr, s->len, &content)) {
+            tinyc_string_free(&content);
+            return fail(this, "out of memory");
+        }
+        advance(this);
+    }
+
+    uint32_t name;
+    const bool added = tinyc_ast_add_string(
+        this->ast,
+        content.cstr,
+        content.len,
+        &name
+    );
+    const size_t len = content.len;
+    tinyc_string_free(&content);
+    if (!added) return fail(this, "out of memory");
+    const tinyc_ast_ref ref = with(
+        this,
+        node0(this, TINYC_AST_STRING, &start),
+        name,
+        0
+    );
+    if (ref) this->ast->nodes[ref].value = len;
+    return ref;
+}
+
+static tinyc_ast_ref primary(struct parser *this) {
+    const struct lookahead *la = peek(this, 0);
+    const struct tinyc_span start = current(this);
+    if (!la->token) return fail(this, "expected expression");
+    uint32_t name;
+    switch (la->token->kind) {
+        case TINYC_TOKEN_IDENT:
+            if (!consume_ident(this, &name)) {
+                return fail(this, "expected expression");
+            }
+            return with(this, node0(this, TINYC_AST_IDENT, &start), name, 0);
+        case TINYC_TOKEN_PP_NUMBER:
+        case TINYC_TOKEN_CHAR:
+            return constant(this);
+        case TINYC_TOKEN_STRING:
+            return string(this);
+        default:
+            if (consume_punct(this, TINYC_TOKEN_PUNCT_LPAREN)) {
+                const tinyc_ast_ref ref = nested(this, expr);
+                expect_punct(this, TINYC_TOKEN_PUNCT_RPAREN, "expected ')'");
+                return this->failed ? 0 : ref;
+            }
+            return fail(this, "expected expression");
+    }
+}
+
+/// Parse member name after "." or "->", and create node of kind for it.
+static tinyc_ast_ref member(
+    struct parser *this,
+    enum tinyc_ast_kind kind,
+    tinyc_ast_ref object
+) {
+    uint32_t name;
+    if (!consume_ident(this, &name)) return fail(this, "expected member name");
+    const struct tinyc_span start = this->ast->spans[object];
+    return with(this, node1(this, kind, &start, object), name, 0);
+}
+
+static tinyc_ast_ref postfix(struct parser *this) {
+    tinyc_ast_ref ref = primary(this);
+    while (ref) {
+        const struct tinyc_span start = this->ast->spans[ref];
+        if (consume_punct(this, TINYC_TOKEN_PUNCT_LSQUARE)) {
+            const tinyc_ast_ref index = nested(this, expr);
+            expect_punct(this, TINYC_TOKEN_PUNCT_RSQUARE, "expected ']'");
+            ref = binary_node(this, TINYC_AST_INDEX, ref, index);
+        } else if (consume_punct(this, TINYC_TOKEN_PUNCT_LPAREN)) {
+            const size_t begin = this->stack_len;
+            push(this, ref);
+            if (!consume_punct(this, TINYC_TOKEN_PUNCT_RPAREN)) {
+                do {
+                    push(this, nested(this, assign));
+                } while (!this->failed &&
+                         consume_punct(this, TINYC_TOKEN_PUNCT_COMMA));
+                expect_punct(this, TINYC_TOKEN_PUNCT_RPAREN, "expected ')'");
+            }
+            ref = node(this, TINYC_AST_CALL, &start, begin);
+        } else if (consume_punct(this, TINYC_TOKEN_PUNCT_DOT)) {
+            ref = member(this, TINYC_AST_MEMBER, ref);
+        } else if (consume_punct(this, TINYC_TOKEN_PUNCT_ARROW)) {
+            ref = member(this, TINYC_AST_ARROW, ref);
+        } else if (consume_punct(this, TINYC_TOKEN_PUNCT_PPLUS)) {
+            ref = node1(this, TINYC_AST_POST_INC, &start, ref);
+        } else if (consume_punct(this, TINYC_TOKEN_PUNCT_MMINUS)) {
+            ref = node1(this, TINYC_AST_POST_DEC, &start, ref);
+        } else {
+            break;
+        }
+    }
+    return ref;
+}
+
+static tinyc_ast_ref unary(struct parser *this) {
+    const struct lookahead *la = peek(this, 0);
+    const struct tinyc_span start = current(this);
+    enum tinyc_ast_kind kind;
+    if (is_keyword(la, TINYC_TOKEN_KEYWORD_SIZEOF)) {
+        advance(this);
+        if (is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_LPAREN) &&
+            is_type_start(this, peek(this, 1))) {
+            advance(this);
+            const tinyc_ast_ref type = type_name(this);
+            expect_punct(this, TINYC_TOKEN_PUNCT_RPAREN, "expected ')'");
+            return node1(this, TINYC_AST_SIZEOF, &start, type);
+        }
+        return node1(this, TINYC_AST_SIZEOF, &start, nested(this, unary));
+    } else if (unary_op(la, &kind)) {
+        advance(this);
+        const bool prefix = kind == TINYC_AST_PRE_INC ||
+                            kind == TINYC_AST_PRE_DEC;
+        const tinyc_ast_ref operand = nested(this, prefix ? unary : cast);
+        return node1(this, kind, &start, operand);
+    }
+    return postfix(this);
+}
+
+static tinyc_ast_ref cast(struct parser *this) {
+    if (!is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_LPAREN) ||
+        !is_type_start(this, peek(this, 1))) {
+        return unary(this);
+    }
+    const struct tinyc_span start = current(this);
+    advance(this);
+    const tinyc_ast_ref type = type_name(this);
+    expect_punct(this, TINYC_TOKEN_PUNCT_RPAREN, "expected ')'");
+    if (is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_LCURLY)) {
+        return fail(this, "compound literal is not supported");
+    }
+    const tinyc_ast_ref operand = nested(this, cast);
+    return node2(this, TINYC_AST_CAST, &start, type, operand);
+}
+
+/// Parse binary operators whose precedence is at least min.
+static tinyc_ast_ref binary(struct parser *this, int min) {
+    tinyc_ast_ref lhs = cast(this);
+    enum tinyc_ast_kind kind;
+    int prec;
+    while (lhs && (prec = binary_op(peek(this, 0), &kind)) >= min && prec) {
+        advance(this);
+        const tinyc_ast_ref rhs = binary(this, prec + 1);
+        lhs = binary_node(this, kind, lhs, rhs);
+    }
+    return lhs;
+}
+
+static tinyc_ast_ref conditional(struct parser *this) {
+    const tinyc_ast_ref cond = binary(this, 1);
+    if (!cond || !consume_punct(this, TINYC_TOKEN_PUNCT_QUESTION)) return cond;
+    const struct tinyc_span start = this->ast->spans[cond];
+    const tinyc_ast_ref then = nested(this, expr);
+    expect_punct(this, TINYC_TOKEN_PUNCT_COLON, "expected ':'");
+    const tinyc_ast_ref otherwise = nested(this, conditional);
+    return node3(this, TINYC_AST_COND, &start, cond, then, otherwise);
+}
+
+static tinyc_ast_ref assign(struct parser *this) {
+    const tinyc_ast_ref lhs = conditional(this);
+    enum tinyc_ast_kind kind;
+    if (!lhs || !assign_op(peek(this, 0), &kind)) return lhs;
+    advance(this);
+    const tinyc_ast_ref rhs = nested(this, assign);
+    return with(
+        this,
+        binary_node(this, TINYC_AST_ASSIGN, lhs, rhs),
+        0,
+        kind
+    );
+}
+
+static tinyc_ast_ref expr(struct parser *this) {
+    tinyc_ast_ref lhs = assign(this);
+    while (lhs && consume_punct(this, TINYC_TOKEN_PUNCT_COMMA)) {
+        lhs = binary_node(this, TINYC_AST_COMMA, lhs, assign(this));
+    }
+    return lhs;
+}
+
+static tinyc_ast_ref specifiers(struct parser *this, uint32_t *storage);
+static tinyc_ast_ref declarator(
+    struct parser *this,
+    tinyc_ast_ref type,
+    uint32_t *name
+);
+
+static uint32_t qualifiers(struct parser *this) {
+    uint32_t flags = 0;
+    for (;;) {
+        const int k = peek(this, 0)->keyword;
+        if (k == NOT_KEYWORD || !(specifier_flags[k] & ~SPECIFIERS)) break;
+        flags |= specifier_flags[k];
+        advance(this);
+    }
+    return flags;
+}
+
+/// Parse members of struct, and push them.
+static bool fields(struct parser *this) {
+    const struct tinyc_span start = current(this);
+    if (!is_type_start(this, peek(this, 0))) {
+        return fail(this, "expected member declaration");
+    }
+    const tinyc_ast_ref base = specifiers(this, NULL);
+    if (consume_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON)) {
+        return push(this, node1(this, TINYC_AST_FIELD, &start, base));
+    }
+    do {
+        uint32_t name = 0;
+        tinyc_ast_ref type = base;
+        if (!is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_COLON)) {
+            type = declarator(this, base, &name);
+        }
+        tinyc_ast_ref width = 0;
+        if (consume_punct(this, TINYC_TOKEN_PUNCT_COLON)) {
+            width = conditional(this);
+        }
+        const tinyc_ast_ref field = node2(
+            this,
+            TINYC_AST_FIELD,
+            &start,
+            type,
+            width
+        );
+        push(this, with(this, field, name, 0));
+    } while (!this->failed && consume_punct(this, TINYC_TOKEN_PUNCT_COMMA));
+    return expect_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON, "expected ';'");
+}
+
+static tinyc_ast_ref struct_type(struct parser *this) {
+    const struct tinyc_span start = current(this);
+    uint32_t flags = is_keyword(peek(this, 0), TINYC_TOKEN_KEYWORD_UNION)
+        ? TINYC_AST_UNION
+        : 0;
+    advance(this);
+    uint32_t name = 0;
+    consume_ident(this, &name);
+
+    const size_t begin = this->stack_len;
+    if (consume_punct(this, TINYC_TOKEN_PUNCT_LCURLY)) {
+        flags |= TINYC_AST_COMPLETE;
+        while (!this->failed &&
+               !consume_punct(this, TINYC_TOKEN_PUNCT_RCURLY)) {
+            fields(this);
+        }
+    } else if (!name) {
+        fail(this, "expected '{'");
+    }
+    const tinyc_ast_ref ref = node(this, TINYC_AST_TYPE_STRUCT, &start, begin);
+    return with(this, ref, name, flags);
+}
+
+static tinyc_ast_ref enum_type(struct parser *this) {
+    const struct tinyc_span start = current(this);
+    advance(this);
+    uint32_t name = 0, flags = 0;
+    consume_ident(this, &name);
+
+    const size_t begin = this->stack_len;
+    if (consume_punct(this, TINYC_TOKEN_PUNCT_LCURLY)) {
+        flags |= TINYC_AST_COMPLETE;
+        do {
+            if (is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_RCURLY)) break;
+            const struct tinyc_span estart = current(this);
+            uint32_t ename;
+            if (!consume_ident(this, &ename)) {
+                fail(this, "expected enumerator");
+                break;
+            }
+            tinyc_ast_ref value = 0;
+            if (consume_punct(this, TINYC_TOKEN_PUNCT_ASSIGN)) {
+                value = conditional(this);
+            }
+            const tinyc_ast_ref enumerator = node1(
+                this,
+                TINYC_AST_ENUMERATOR,
+                &estart,
+                value
+            );
+            push(this, with(this, enumerator, ename, 0));
+            bind(this, ename, false);
+        } while (!this->failed && consume_punct(this, TINYC_TOKEN_PUNCT_COMMA));
+        expect_punct(this, TINYC_TOKEN_PUNCT_RCURLY, "expected '}'");
+    } else if (!name) {
+        fail(this, "expected '{'");
+    }
+    const tinyc_ast_ref ref = node(this, TINYC_AST_TYPE_ENUM, &start, begin);
+    return with(this, ref, name, flags);
+}
+
+/// Parse declaration specifiers, and set storage class to storage.
+/// If storage is NULL, storage class is not allowed.
+static tinyc_ast_ref specifiers(struct parser *this, uint32_t *storage) {
+    const struct tinyc_span start = current(this);
+    uint32_t flags = 0, store = 0;
+    tinyc_ast_ref type = 0;
+    for (;;) {
+        const struct lookahead *la = peek(this, 0);
+        const int k = la->keyword;
+        if (k == TINYC_TOKEN_KEYWORD_STRUCT || k == TINYC_TOKEN_KEYWORD_UNION ||
+            k == TINYC_TOKEN_KEYWORD_ENUM) {
+            if (type || (flags & SPECIFIERS)) break;
+            type = nested(
+                this,
+                k == TINYC_TOKEN_KEYWORD_ENUM ? enum_type : struct_type
+            );
+            if (!type) return 0;
+            continue;
+        } else if (k == NOT_KEYWORD) {
+            if (type || (flags & SPECIFIERS) || !is_typedef_name(this, la)) {
+                break;
+            }
+            uint32_t name;
+            consume_ident(this, &name);
+            type = node0(this, TINYC_AST_TYPE_NAME, &start);
+            with(this, type, name, 0);
+            if (!type) return 0;
+            continue;
+        }
+
+        uint32_t bit = specifier_flags[k];
+        const bool is_storage = storage_flags[k] ||
+                                k == TINYC_TOKEN_KEYWORD_AUTO ||
+                                k == TINYC_TOKEN_KEYWORD_REGISTER;
+        if (is_storage) {
+            if (!storage) return fail(this, "storage class is not allowed");
+            store |= storage_flags[k];
+        } else if (!bit) {
+            break;
+        } else if (bit == TINYC_AST_SPEC_LONG && (flags & bit)) {
+            if (flags & TINYC_AST_SPEC_LONG_LONG) {
+                return fail(this, "'long long long' is too long");
+            }
+            flags = (flags & ~bit) | TINYC_AST_SPEC_LONG_LONG;
+        } else if ((bit & SPECIFIERS) && (flags & bit)) {
+            return fail(this, "duplicate type specifier");
+        } else {
+            flags |= bit;
+        }
+        advance(this);
+    }
+
+    if (storage) *storage = store;
+    if (type) {
+        if (flags & SPECIFIERS) return fail(this, "invalid type specifiers");
+        this->ast->nodes[type].flags |= flags;
+        return type;
+    }
+    if (!(flags & SPECIFIERS)) flags |= TINYC_AST_SPEC_INT;
+    return with(this, node0(this, TINYC_AST_TYPE_BASE, &start), 0, flags);
+}
+
+/// Parse parameters of function returning type.
+static tinyc_ast_ref params(struct parser *this, tinyc_ast_ref type) {
+    const struct tinyc_span start = current(this);
+    advance(this);
+    if (!nest(this)) return 0;
+    const size_t begin = this->stack_len;
+    uint32_t flags = 0;
+    push(this, type);
+
+    // Names of parameters are in scope until end of declarator.
+    enter_scope(this);
+    if (is_keyword(peek(this, 0), TINYC_TOKEN_KEYWORD_VOID) &&
+        is_punct(peek(this, 1), TINYC_TOKEN_PUNCT_RPAREN)) {
+        advance(this);
+        flags = TINYC_AST_PROTOTYPE;
+    } else if (!is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_RPAREN)) {
+        flags = TINYC_AST_PROTOTYPE;
+        do {
+            if (consume_punct(this, TINYC_TOKEN_PUNCT_DDDOT)) {
+                flags |= TINYC_AST_VARIADIC;
+                break;
+            }
+            const struct tinyc_span pstart = current(this);
+            if (!is_type_start(this, peek(this, 0))) {
+                fail(this, "expected parameter declaration");
+                break;
+            }
+            uint32_t storage, name;
+            const tinyc_ast_ref base = specifiers(this, &storage);
+            const tinyc_ast_ref ptype = base ? declarator(this, base, &name)
+                                             : 0;
+            const tinyc_ast_ref param = node1(
+                this,
+                TINYC_AST_PARAM,
+                &pstart,
+                ptype
+            );
+            push(this, with(this, param, name, 0));
+            if (name) bind(this, name, false);
+        } while (!this->failed && consume_punct(this, TINYC_TOKEN_PUNCT_COMMA));
+    }
+    leave_scope(this);
+    expect_punct(this, TINYC_TOKEN_PUNCT_RPAREN, "expected ')'");
+    this->nesting--;
+    return with(this, node(this, TINYC_AST_TYPE_FUNC, &start, begin), 0, flags);
+}
+
+/// Parse array and function suffixes of declarator on type.
+static tinyc_ast_ref suffix(struct parser *this, tinyc_ast_ref type) {
+    const struct lookahead *la = peek(this, 0);
+    if (is_punct(la, TINYC_TOKEN_PUNCT_LPAREN)) return params(this, type);
+    if (!is_punct(la, TINYC_TOKEN_PUNCT_LSQUARE)) return type;
+
+    const struct tinyc_span start = current(this);
+    advance(this);
+    if (!nest(this)) return 0;
+    tinyc_ast_ref len = 0;
+    if (!is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_RSQUARE)) {
+        len = assign(this);
+    }
+    expect_punct(this, TINYC_TOKEN_PUNCT_RSQUARE, "expected ']'");
+    const tinyc_ast_ref element = this->failed ? 0 : suffix(this, type);
+    this->nesting--;
+    if (this->failed) return 0;
+    return node2(this, TINYC_AST_TYPE_ARRAY, &start, element, len);
+}
+
+/// Returns true if "(" at current token starts nested declarator rather
+/// than parameters.
+static bool is_nested(struct parser *this) {
+    const struct lookahead *la = peek(this, 1);
+    return is_punct(la, TINYC_TOKEN_PUNCT_STAR) ||
+           is_punct(la, TINYC_TOKEN_PUNCT_LPAREN) ||
+           (ident_of(la) && !is_typedef_name(this, la));
+}
+
+/// Parse declarator on type, and set declared name to name or 0 if it's
+/// abstract.
+///
+/// Nested declarator applies to type made by suffixes after it, e.g. in
+/// "int (*f)(void)" f is a pointer to function. So nested one is parsed on a
+/// placeholder node, which is overwritten by the type after suffixes.
+static tinyc_ast_ref declarator(
+    struct parser *this,
+    tinyc_ast_ref type,
+    uint32_t *name
+) {
+    *name = 0;
+    while (is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_STAR)) {
+        const struct tinyc_span start = current(this);
+        advance(this);
+        const uint32_t quals = qualifiers(this);
+        type = with(
+            this,
+            node1(this, TINYC_AST_TYPE_POINTER, &start, type),
+            0,
+            quals
+        );
+    }
+    if (!is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_LPAREN) ||
+        !is_nested(this)) {
+        consume_ident(this, name);
+        return suffix(this, type);
+    }
+
+    const struct tinyc_span start = current(this);
+    advance(this);
+    if (!nest(this)) return 0;
+    const tinyc_ast_ref hole = node0(this, TINYC_AST_NONE, &start);
+    const tinyc_ast_ref inner = unnest(this, declarator(this, hole, name));
+    expect_punct(this, TINYC_TOKEN_PUNCT_RPAREN, "expected ')'");
+    const tinyc_ast_ref outer = this->failed ? 0 : suffix(this, type);
+    if (!inner || !outer) return 0;
+    this->ast->nodes[hole] = this->ast->nodes[outer];
+    this->ast->spans[hole] = this->ast->spans[outer];
+    return inner;
+}
+
+static tinyc_ast_ref type_name(struct parser *this) {
+    uint32_t name;
+    const tinyc_ast_ref base = specifiers(this, NULL);
+    const tinyc_ast_ref type = base ? declarator(this, base, &name) : 0;
+    if (type && name) return fail(this, "unexpected identifier");
+    return type;
+}
+
+static tinyc_ast_ref initializer(struct parser *this) {
+    if (!is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_LCURLY)) return assign(this);
+
+    const struct tinyc_span start = current(this);
+    advance(this);
+    const size_t begin = this->stack_len;
+    while (!this->failed && !consume_punct(this, TINYC_TOKEN_PUNCT_RCURLY)) {
+        push(this, nested(this, initializer));
+        if (!consume_punct(this, TINYC_TOKEN_PUNCT_COMMA)) {
+            expect_punct(this, TINYC_TOKEN_PUNCT_RCURLY, "expected '}'");
+            break;
+        }
+    }
+    return node(this, TINYC_AST_INIT_LIST, &start, begin);
+}
+
+static tinyc_ast_ref block(struct parser *this);
+
+/// Parse body of function of type with its parameters in scope.
+static tinyc_ast_ref function_body(struct parser *this, tinyc_ast_ref type) {
+    if (!enter_scope(this)) return 0;
+    const struct tinyc_ast_node *node = &this->ast->nodes[type];
+    for (uint32_t i = 1; i < node->nchildren; ++i) {
+        const tinyc_ast_ref param = this->ast->refs[node->children + i];
+        const uint32_t name = this->ast->nodes[param].name;
+        if (name && !bind(this, name, false)) break;
+    }
+    const tinyc_ast_ref body = this->failed ? 0 : block(this);
+    leave_scope(this);
+    return body;
+}
+
+/// Parse declaration, and push declared nodes. Function definition is
+/// allowed if external.
+static bool declaration(struct parser *this, bool external) {
+    const struct tinyc_span start = current(this);
+    uint32_t storage;
+    const tinyc_ast_ref base = specifiers(this, &storage);
+    if (!base) return false;
+    if (consume_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON)) {
+        const tinyc_ast_ref decl = node1(this, TINYC_AST_DECL, &start, base);
+        return push(this, with(this, decl, 0, storage));
+    }
+
+    for (bool first = true;; first = false) {
+        uint32_t name;
+        const tinyc_ast_ref type = declarator(this, base, &name);
+        if (!type) return false;
+        if (!name) return fail(this, "expected identifier");
+        if (!bind(this, name, storage & TINYC_AST_STORAGE_TYPEDEF)) {
+            return false;
+        }
+
+        const bool is_func = this->ast->nodes[type].kind == TINYC_AST_TYPE_FUNC;
+        if (first && external && is_func &&
+            is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_LCURLY)) {
+            const tinyc_ast_ref body = function_body(this, type);
+            const tinyc_ast_ref func = node2(
+                this,
+                TINYC_AST_FUNC,
+                &start,
+                type,
+                body
+            );
+            return push(this, with(this, func, name, storage));
+        }
+
+        tinyc_ast_ref init = 0;
+        if (consume_punct(this, TINYC_TOKEN_PUNCT_ASSIGN)) {
+            init = initializer(this);
+        }
+        const tinyc_ast_ref decl = node2(
+            this,
+            TINYC_AST_DECL,
+            &start,
+            type,
+            init
+        );
+        if (!push(this, with(this, decl, name, storage))) return false;
+        if (!consume_punct(this, TINYC_TOKEN_PUNCT_COMMA)) break;
+    }
+    return expect_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON, "expected ';'");
+}
+
+/// Parse "( expression )" of if, switch and loops.
+static tinyc_ast_ref condition(struct parser *this) {
+    expect_punct(this, TINYC_TOKEN_PUNCT_LPAREN, "expected '('");
+    const tinyc_ast_ref cond = this->failed ? 0 : expr(this);
+    expect_punct(this, TINYC_TOKEN_PUNCT_RPAREN, "expected ')'");
+    return this->failed ? 0 : cond;
+}
+
+static tinyc_ast_ref for_statement(struct parser *this) {
+    const struct tinyc_span start = current(this);
+    advance(this);
+    expect_punct(this, TINYC_TOKEN_PUNCT_LPAREN, "expected '('");
+    if (!enter_scope(this)) return 0;
+
+    // Declarations in init are held by a block.
+    tinyc_ast_ref init = 0, cond = 0, step = 0;
+    if (is_type_start(this, peek(this, 0))) {
+        const struct tinyc_span istart = current(this);
+        const size_t begin = this->stack_len;
+        declaration(this, false);
+        init = node(this, TINYC_AST_BLOCK, &istart, begin);
+    } else if (!consume_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON)) {
+        init = expr(this);
+        expect_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON, "expected ';'");
+    }
+    if (!this->failed &&
+        !is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_SEMICOLON)) {
+        cond = expr(this);
+    }
+    expect_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON, "expected ';'");
+    if (!this->failed && !is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_RPAREN)) {
+        step = expr(this);
+    }
+    expect_punct(this, TINYC_TOKEN_PUNCT_RPAREN, "expected ')'");
+    const tinyc_ast_ref body = this->failed ? 0 : nested(this, statement);
+    leave_scope(this);
+    const size_t begin = this->stack_len;
+    push(this, init);
+    push(this, cond);
+    push(this, step);
+    push(this, body);
+    return node(this, TINYC_AST_FOR, &start, begin);
+}
+
+static tinyc_ast_ref statement(struct parser *this) {
+    const struct lookahead *la = peek(this, 0);
+    const struct tinyc_span start = current(this);
+    const int keyword = la->keyword;
+    tinyc_ast_ref a, b, c;
+    uint32_t name;
+    switch (keyword) {
+        case TINYC_TOKEN_KEYWORD_IF:
+            advance(this);
+            a = condition(this);
+            b = a ? nested(this, statement) : 0;
+            c = 0;
+            if (b && is_keyword(peek(this, 0), TINYC_TOKEN_KEYWORD_ELSE)) {
+                advance(this);
+                c = nested(this, statement);
+            }
+            return node3(this, TINYC_AST_IF, &start, a, b, c);
+        case TINYC_TOKEN_KEYWORD_SWITCH:
+        case TINYC_TOKEN_KEYWORD_WHILE:
+            advance(this);
+            a = condition(this);
+            b = a ? nested(this, statement) : 0;
+            return node2(
+                this,
+                keyword == TINYC_TOKEN_KEYWORD_SWITCH ? TINYC_AST_SWITCH
+                                                          : TINYC_AST_WHILE,
+                &start,
+                a,
+                b
+            );
+        case TINYC_TOKEN_KEYWORD_DO:
+            advance(this);
+            a = nested(this, statement);
+            if (a && !is_keyword(peek(this, 0), TINYC_TOKEN_KEYWORD_WHILE)) {
+                return fail(this, "expected 'while'");
+            }
+            advance(this);
+            b = a ? condition(this) : 0;
+            expect_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON, "expected ';'");
+            return node2(this, TINYC_AST_DO, &start, a, b);
+        case TINYC_TOKEN_KEYWORD_FOR:
+            return for_statement(this);
+        case TINYC_TOKEN_KEYWORD_CASE:
+            advance(this);
+            a = conditional(this);
+            expect_punct(this, TINYC_TOKEN_PUNCT_COLON, "expected ':'");
+            b = this->failed ? 0 : nested(this, statement);
+            return node2(this, TINYC_AST_CASE, &start, a, b);
+        case TINYC_TOKEN_KEYWORD_DEFAULT:
+            advance(this);
+            expect_punct(this, TINYC_TOKEN_PUNCT_COLON, "expected ':'");
+            a = this->failed ? 0 : nested(this, statement);
+            return node1(this, TINYC_AST_DEFAULT, &start, a);
+        case TINYC_TOKEN_KEYWORD_GOTO:
+            advance(this);
+            if (!consume_ident(this, &name)) {
+                return fail(this, "expected label");
+            }
+            expect_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON, "expected ';'");
+            return with(this, node0(this, TINYC_AST_GOTO, &start), name, 0);
+        case TINYC_TOKEN_KEYWORD_BREAK:
+        case TINYC_TOKEN_KEYWORD_CONTINUE:
+            advance(this);
+            expect_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON, "expected ';'");
+            return node0(
+                this,
+                keyword == TINYC_TOKEN_KEYWORD_BREAK ? TINYC_AST_BREAK
+                                                         : TINYC_AST_CONTINUE,
+                &start
+            );
+        case TINYC_TOKEN_KEYWORD_RETURN:
+            advance(this);
+            a = 0;
+            if (!is_punct(peek(this, 0), TINYC_TOKEN_PUNCT_SEMICOLON)) {
+                a = expr(this);
+            }
+            expect_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON, "expected ';'");
+            return node1(this, TINYC_AST_RETURN, &start, a);
+        default:
+            break;
+    }
+
+    if (is_punct(la, TINYC_TOKEN_PUNCT_LCURLY)) return block(this);
+    if (consume_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON)) {
+        return node0(this, TINYC_AST_BLOCK, &start);
+    }
+    if (ident_of(la) && is_punct(peek(this, 1), TINYC_TOKEN_PUNCT_COLON)) {
+        consume_ident(this, &name);
+        advance(this);
+        a = nested(this, statement);
+        return with(this, node1(this, TINYC_AST_LABEL, &start, a), name, 0);
+    }
+    a = expr(this);
+    expect_punct(this, TINYC_TOKEN_PUNCT_SEMICOLON, "expected ';'");
+    return this->failed ? 0 : a;
+}
+
+static tinyc_ast_ref block(struct parser *this) {
+    const struct tinyc_span start = current(this);
+    expect_punct(this, TINYC_TOKEN_PUNCT_LCURLY, "expected '{'");
+    if (!enter_scope(this)) return 0;
+    const size_t begin = this->stack_len;
+    while (!this->failed && !consume_punct(this, TINYC_TOKEN_PUNCT_RCURLY)) {
+        const struct lookahead *la = peek(this, 0);
+        if (!la->token) {
+            fail(this, "expected '}'");
+        } else if (is_type_start(this, la) &&
+                   !is_punct(peek(this, 1), TINYC_TOKEN_PUNCT_COLON)) {
+            declaration(this, false);
+        } else {
+            push(this, nested(this, statement));
+        }
+    }
+    leave_scope(this);
+    return node(this, TINYC_AST_BLOCK, &start, begin);
+}
+
+bool tinyc_parse(
+    struct tinyc_ast *ast,
+    struct tinyc_lexer *lexer,
+    struct tinyc_parse_error *error
+) {
+    struct parser this = {
+        .ast = ast,
+        .lexer = lexer,
+        .row = 0,
+        .first = NULL,
+        .next = NULL,
+        .head = 0,
+        .len = 0,
+        .last = {lexer->id, {0, 0}, {0, 0}},
+        .stack = tinyc_alloc(sizeof(tinyc_ast_ref) * DEFAULT_STACK_CAP),
+        .stack_len = 0,
+        .stack_cap = DEFAULT_STACK_CAP,
+        .nesting = 0,
+        .error = error,
+        .failed = false,
+    };
+    const bool ok = this.stack &&
+                    tinyc_ast_reserve(ast, lexer->len * NODES_PER_LINE) &&
+                    tinyc_symtab_init(&this.symbols);
+    if (!ok) {
+        tinyc_free(this.stack);
+        fail(&this, "out of memory");
+        return false;
+    }
+
+    const struct tinyc_span start = this.last;
+    while (!this.failed && peek(&this, 0)->token) {
+        if (consume_punct(&this, TINYC_TOKEN_PUNCT_SEMICOLON)) continue;
+        if (!is_type_start(&this, peek(&this, 0))) {
+            fail(&this, "expected declaration");
+            break;
+        }
+        declaration(&this, true);
+    }
+    ast->root = node(&this, TINYC_AST_UNIT, &start, 0);
+
+    tinyc_symtab_free(&this.symbols);
+    tinyc_free(this.stack);
+    return !this.failed;
+}
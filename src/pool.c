@@ -0,0 +1,235 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "tinyc/pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "tinyc/allocator.h"
+
+#define DEFAULT_CAP 64
+
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t current_key;  // Worker running on this thread.
+
+static void create_key(void) {
+    pthread_key_create(&current_key, NULL);
+}
+
+static bool push(
+    struct tinyc_pool_worker *worker,
+    const struct tinyc_pool_task *task
+) {
+    pthread_mutex_lock(&worker->lock);
+    if (worker->len == worker->cap) {
+        const size_t new_cap = worker->cap ? worker->cap * 2 : DEFAULT_CAP;
+        struct tinyc_pool_task *tasks = tinyc_alloc(sizeof(*tasks) * new_cap);
+        if (!tasks) {
+            pthread_mutex_unlock(&worker->lock);
+            return false;
+        }
+        for (size_t i = 0; i < worker->len; ++i) {
+            tasks[i] = worker->tasks[(worker->head + i) % worker->cap];
+        }
+        tinyc_free(worker->tasks);
+        worker->tasks = tasks;
+        worker->head = 0;
+        worker->cap = new_cap;
+    }
+    worker->tasks[(worker->head + worker->len++) % worker->cap] = *task;
+    pthread_mutex_unlock(&worker->lock);
+    return true;
+}
+
+/// Take newest task of worker's own queue.
+static bool pop_back(
+    struct tinyc_pool_worker *worker,
+    struct tinyc_pool_task *task
+) {
+    pthread_mutex_lock(&worker->lock);
+    const bool found = worker->len != 0;
+    if (found) {
+        worker->len--;
+        *task = worker->tasks[(worker->head + worker->len) % worker->cap];
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return found;
+}
+
+/// Take oldest task of other worker's queue.
+static bool pop_front(
+    struct tinyc_pool_worker *worker,
+    struct tinyc_pool_task *task
+) {
+    pthread_mutex_lock(&worker->lock);
+    const bool found = worker->len != 0;
+    if (found) {
+        *task = worker->tasks[worker->head];
+        worker->head = (worker->head + 1) % worker->cap;
+        worker->len--;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return found;
+}
+
+static bool steal(
+    struct tinyc_pool *pool,
+    const struct tinyc_pool_worker *self,
+    struct tinyc_pool_task *task
+) {
+    const size_t index = self - pool->workers;
+    for (size_t i = 1; i < pool->nworkers; ++i) {
+        struct tinyc_pool_worker *victim = &pool->workers[
+            (index + i) % pool->nworkers
+        ];
+        if (pop_front(victim, task)) return true;
+    }
+    return false;
+}
+
+static void *work(void *arg) {
+    struct tinyc_pool_worker *self = arg;
+    struct tinyc_pool *pool = self->pool;
+    pthread_setspecific(current_key, self);
+    for (;;) {
+        struct tinyc_pool_task task;
+        if (pop_back(self, &task) || steal(pool, self, &task)) {
+            pthread_mutex_lock(&pool->lock);
+            pool->queued--;
+            pthread_mutex_unlock(&pool->lock);
+            task.fn(task.arg);
+            pthread_mutex_lock(&pool->lock);
+            if (--pool->pending == 0) pthread_cond_broadcast(&pool->done);
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+
+        // Sleep until any task is queued. Task is counted just before it's
+        // pushed, so it may be found only after retrying.
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stop && pool->queued == 0) {
+            pool->sleeping++;
+            pthread_cond_wait(&pool->wake, &pool->lock);
+            pool->sleeping--;
+        }
+        const bool stop = pool->stop && pool->queued == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop) return NULL;
+        sched_yield();
+    }
+}
+
+size_t tinyc_pool_ncpus(void) {
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+}
+
+bool tinyc_pool_init(struct tinyc_pool *this, size_t nthreads) {
+    pthread_once(&key_once, create_key);
+    this->nworkers = 0;
+    this->next = 0;
+    this->pending = this->queued = this->sleeping = 0;
+    this->stop = false;
+    pthread_mutex_init(&this->lock, NULL);
+    pthread_cond_init(&this->wake, NULL);
+    pthread_cond_init(&this->done, NULL);
+
+    if (nthreads == 0) nthreads = 1;
+    this->workers = tinyc_alloc(sizeof(struct tinyc_pool_worker) * nthreads);
+    if (!this->workers) return false;
+    for (size_t i = 0; i < nthreads; ++i) {
+        struct tinyc_pool_worker *worker = &this->workers[i];
+        worker->pool = this;
+        worker->tasks = NULL;
+        worker->head = worker->len = worker->cap = 0;
+        pthread_mutex_init(&worker->lock, NULL);
+    }
+    // Workers must see all queues before starting.
+    this->nworkers = nthreads;
+    for (size_t i = 0; i < nthreads; ++i) {
+        struct tinyc_pool_worker *worker = &this->workers[i];
+        if (pthread_create(&worker->thread, NULL, work, worker) == 0) continue;
+
+        pthread_mutex_lock(&this->lock);
+        this->stop = true;
+        pthread_cond_broadcast(&this->wake);
+        pthread_mutex_unlock(&this->lock);
+        for (size_t j = 0; j < i; ++j) {
+            pthread_join(this->workers[j].thread, NULL);
+        }
+        for (size_t j = 0; j < nthreads; ++j) {
+            pthread_mutex_destroy(&this->workers[j].lock);
+        }
+        tinyc_free(this->workers);
+        this->workers = NULL;
+        this->nworkers = 0;
+        return false;
+    }
+    return true;
+}
+
+bool tinyc_pool_submit(struct tinyc_pool *this, tinyc_pool_fn *fn, void *arg) {
+    struct tinyc_pool_worker *worker = pthread_getspecific(current_key);
+    pthread_mutex_lock(&this->lock);
+    if (!worker || worker->pool != this) {
+        worker = &this->workers[this->next];
+        this->next = (this->next + 1) % this->nworkers;
+    }
+    this->pending++;
+    this->queued++;
+    pthread_mutex_unlock(&this->lock);
+
+    const struct tinyc_pool_task task = {fn, arg};
+    const bool ok = push(worker, &task);
+
+    pthread_mutex_lock(&this->lock);
+    if (!ok) {
+        this->queued--;
+        if (--this->pending == 0) pthread_cond_broadcast(&this->done);
+    } else if (this->sleeping) {
+        pthread_cond_broadcast(&this->wake);
+    }
+    pthread_mutex_unlock(&this->lock);
+    return ok;
+}
+
+void tinyc_pool_wait(struct tinyc_pool *this) {
+    pthread_mutex_lock(&this->lock);
+    while (this->pending != 0) pthread_cond_wait(&this->done, &this->lock);
+    pthread_mutex_unlock(&this->lock);
+}
+
+void tinyc_pool_free(struct tinyc_pool *this) {
+    pthread_mutex_lock(&this->lock);
+    this->stop = true;
+    pthread_cond_broadcast(&this->wake);
+    pthread_mutex_unlock(&this->lock);
+    for (size_t i = 0; i < this->nworkers; ++i) {
+        pthread_join(this->workers[i].thread, NULL);
+    }
+    for (size_t i = 0; i < this->nworkers; ++i) {
+        pthread_mutex_destroy(&this->workers[i].lock);
+        tinyc_free(this->workers[i].tasks);
+    }
+    tinyc_free(this->workers);
+    this->workers = NULL;
+    this->nworkers = 0;
+    pthread_mutex_destroy(&this->lock);
+    pthread_cond_destroy(&this->wake);
+    pthread_cond_destroy(&this->done);
+}
@@ -0,0 +1,877 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tinyc/pp_expr.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+#define DEFAULT_CAP 16
+#define DEFAULT_CACHE_CAP 64
+#define LOCAL_STACK_SIZE 32
+#define UINTMAX_BITS (sizeof(uintmax_t) * 8)
+
+// Operators of && and || and ?: are split into several ops so that whole
+// expression can be evaluated linearly. Operands which must not be evaluated
+// are still executed, but errors in them are ignored (C99 6.5.13, 6.5.14).
+enum op_kind {
+    OP_PUSH,     // Push value.
+    OP_IDENT,    // Push value of macro, or 0 if not a macro.
+    OP_DEFINED,  // Push 1 if macro is defined, otherwise 0.
+    OP_NEG,
+    OP_PLUS,
+    OP_NOT,
+    OP_LNOT,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_ADD,
+    OP_SUB,
+    OP_SHL,
+    OP_SHR,
+    OP_LT,
+    OP_GT,
+    OP_LE,
+    OP_GE,
+    OP_EQ,
+    OP_NE,
+    OP_AND,
+    OP_XOR,
+    OP_OR,
+    OP_LAND_LHS,   // Start right operand of &&.
+    OP_LAND,       // Finish &&.
+    OP_LOR_LHS,    // Start right operand of ||.
+    OP_LOR,        // Finish ||.
+    OP_COND_TEST,  // Start second operand of ?:.
+    OP_COND_MID,   // Start third operand of ?:.
+    OP_COND,       // Finish ?:.
+};
+
+struct tinyc_pp_expr_op {
+    enum op_kind kind;
+    union {
+        struct tinyc_pp_value value;  // For OP_PUSH.
+        struct tinyc_string name;     // For OP_IDENT and OP_DEFINED.
+    } as;
+};
+
+/// Change of stack depth caused by executing op.
+static inline int stack_effect(enum op_kind kind) {
+    switch (kind) {
+        case OP_PUSH:
+        case OP_IDENT:
+        case OP_DEFINED:
+            return 1;
+        case OP_NEG:
+        case OP_PLUS:
+        case OP_NOT:
+        case OP_LNOT:
+        case OP_LAND_LHS:
+        case OP_LOR_LHS:
+        case OP_COND_TEST:
+        case OP_COND_MID:
+            return 0;
+        case OP_COND:
+            return -2;
+        default:  // Binary operators
+            return -1;
+    }
+}
+
+struct parser {
+    struct tinyc_pp_expr *expr;
+    const struct tinyc_token *token;  // Current token, or NULL if no more.
+    const struct tinyc_token *last;
+    size_t depth;
+};
+
+static inline void advance(struct parser *this) {
+    if (this->token == this->last) {
+        this->token = NULL;
+    } else {
+        this->token = this->token->next;
+    }
+}
+
+static inline bool fail(
+    struct parser *this,
+    enum tinyc_pp_expr_status status,
+    const char *error
+) {
+    this->expr->status = status;
+    this->expr->error = error;
+    return false;
+}
+
+static inline bool is_punct(
+    const struct tinyc_token *token,
+    enum tinyc_token_punct_kind kind
+) {
+    return token && token->kind == TINYC_TOKEN_PUNCT &&
+           ((const struct tinyc_token_punct *)token)->kind == kind;
+}
+
+static bool emit(struct parser *this, struct tinyc_pp_expr_op *op) {
+    struct tinyc_pp_expr *expr = this->expr;
+    if (expr->len == expr->cap) {
+        const size_t new_cap = expr->cap ? expr->cap * 2 : DEFAULT_CAP;
+        struct tinyc_pp_expr_op *new_ops = tinyc_realloc(
+            expr->ops,
+            sizeof(struct tinyc_pp_expr_op) * new_cap
+        );
+        if (!new_ops) return fail(this, TINYC_PP_EXPR_ERROR, "out of memory");
+        expr->ops = new_ops;
+        expr->cap = new_cap;
+    }
+    expr->ops[expr->len++] = *op;
+    this->depth += stack_effect(op->kind);
+    if (expr->depth < this->depth) expr->depth = this->depth;
+    return true;
+}
+
+static inline bool emit_kind(struct parser *this, enum op_kind kind) {
+    struct tinyc_pp_expr_op op = {.kind = kind};
+    return emit(this, &op);
+}
+
+static bool emit_name(
+    struct parser *this,
+    enum op_kind kind,
+    const struct tinyc_string *name
+) {
+    struct tinyc_pp_expr_op op = {.kind = kind};
+    if (!tinyc_string_from_copy(&op.as.name, name->cstr)) {
+        return fail(this, TINYC_PP_EXPR_ERROR, "out of memory");
+    }
+    if (!emit(this, &op)) {
+        tinyc_string_free(&op.as.name);
+        return false;
+    }
+    return true;
+}
+
+static inline int digit_value(char c) {
+    if ('0' <= c && c <= '9') return c - '0';
+    if ('a' <= c && c <= 'f') return c - 'a' + 10;
+    if ('A' <= c && c <= 'F') return c - 'A' + 10;
+    return 16;
+}
+
+/// Parse integer suffix. Returns false if it's not valid suffix.
+static bool parse_suffix(const char *s, bool *is_unsigned) {
+    bool has_u = false, has_l = false;
+    *is_unsigned = false;
+    while (*s) {
+        if ((*s == 'u' || *s == 'U') && !has_u) {
+            has_u = true;
+            s++;
+        } else if ((*s == 'l' || *s == 'L') && !has_l) {
+            has_l = true;
+            if (s[1] == s[0]) s++;
+            s++;
+        } else {
+            return false;
+        }
+    }
+    *is_unsigned = has_u;
+    return true;
+}
+
+/// Parse pp-number as integer constant (C99 6.4.4.1).
+static bool parse_number(
+    struct parser *this,
+    const struct tinyc_string *number,
+    struct tinyc_pp_value *value
+) {
+    const char *s = number->cstr;
+    unsigned base = 10;
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+        if (digit_value(*s) >= 16) {
+            return fail(this, TINYC_PP_EXPR_ERROR, "invalid integer constant");
+        }
+    } else if (s[0] == '0') {
+        base = 8;
+    }
+
+    uintmax_t v = 0;
+    bool overflow = false;
+    for (; isxdigit((unsigned char)*s); s++) {
+        const unsigned d = digit_value(*s);
+        if (base == 10 && d >= 10) break;
+        if (d >= base) {
+            return fail(this, TINYC_PP_EXPR_ERROR, "invalid digit in constant");
+        }
+        if (v > (UINTMAX_MAX - d) / base) overflow = true;
+        v = v * base + d;
+    }
+    if (*s == '.' || *s == 'e' || *s == 'E' || *s == 'p' || *s == 'P') {
+        return fail(
+            this,
+            TINYC_PP_EXPR_ERROR,
+            "floating constant in preprocessor expression"
+        );
+    }
+
+    bool is_unsigned;
+    if (!parse_suffix(s, &is_unsigned)) {
+        return fail(this, TINYC_PP_EXPR_ERROR, "invalid integer suffix");
+    }
+    if (overflow) {
+        return fail(this, TINYC_PP_EXPR_ERROR, "integer constant is too large");
+    }
+    if (!is_unsigned && v > INTMAX_MAX) {
+        // Decimal constant never becomes unsigned implicitly.
+        if (base == 10) {
+            return fail(
+                this,
+                TINYC_PP_EXPR_ERROR,
+                "integer constant is too large for its type"
+            );
+        }
+        is_unsigned = true;
+    }
+    value->is_unsigned = is_unsigned;
+    value->value = v;
+    return true;
+}
+
+/// Decode a character at *s of character constant which ends at end, and
+/// advance *s past it.
+static unsigned char decode_char(const char **s, const char *end) {
+    unsigned char c = *(*s)++;
+    if (c != '\\' || *s == end) return c;
+    c = *(*s)++;
+    unsigned v = 0;
+    switch (c) {
+        case 'a':
+            return '\a';
+        case 'b':
+            return '\b';
+        case 'f':
+            return '\f';
+        case 'n':
+            return '\n';
+        case 'r':
+            return '\r';
+        case 't':
+            return '\t';
+        case 'v':
+            return '\v';
+        case 'x':
+            while (*s < end && digit_value(**s) < 16) {
+                v = v * 16 + digit_value(*(*s)++);
+            }
+            return v;
+        default:
+            if (c < '0' || '7' < c) return c;
+            v = c - '0';
+            for (int k = 0; k < 2 && *s < end && '0' <= **s && **s <= '7';
+                 ++k) {
+                v = v * 8 + (*(*s)++ - '0');
+            }
+            return v;
+    }
+}
+
+/// Parse character constant (C99 6.4.4.4). It has type int, and plain char
+/// is signed as in compiled code.
+static bool parse_char(
+    struct parser *this,
+    const struct tinyc_string *chars,
+    struct tinyc_pp_value *value
+) {
+    const char *s = chars->cstr, *end = chars->cstr + chars->len;
+    if (s == end) {
+        return fail(this, TINYC_PP_EXPR_ERROR, "empty character constant");
+    }
+    int v = (signed char)decode_char(&s, end);
+    while (s < end) v = (int)((unsigned)v << 8 | decode_char(&s, end));
+    value->is_unsigned = false;
+    value->value = (uintmax_t)(intmax_t)v;
+    return true;
+}
+
+static bool parse_cond(struct parser *this);
+
+static bool parse_defined(struct parser *this) {
+    advance(this);
+    const bool paren = is_punct(this->token, TINYC_TOKEN_PUNCT_LPAREN);
+    if (paren) advance(this);
+    if (!this->token || this->token->kind != TINYC_TOKEN_IDENT) {
+        return fail(
+            this,
+            TINYC_PP_EXPR_ERROR,
+            "operator \"defined\" requires an identifier"
+        );
+    }
+    const struct tinyc_token_ident *ident = (const void *)this->token;
+    if (!emit_name(this, OP_DEFINED, &ident->value)) return false;
+    advance(this);
+    if (paren) {
+        if (!is_punct(this->token, TINYC_TOKEN_PUNCT_RPAREN)) {
+            return fail(this, TINYC_PP_EXPR_ERROR, "missing ')' after defined");
+        }
+        advance(this);
+    }
+    return true;
+}
+
+static bool parse_primary(struct parser *this) {
+    const struct tinyc_token *token = this->token;
+    if (!token) {
+        return fail(this, TINYC_PP_EXPR_ERROR, "expected value in expression");
+    }
+
+    if (is_punct(token, TINYC_TOKEN_PUNCT_LPAREN)) {
+        advance(this);
+        if (!parse_cond(this)) return false;
+        if (!is_punct(this->token, TINYC_TOKEN_PUNCT_RPAREN)) {
+            return fail(this, TINYC_PP_EXPR_ERROR, "missing ')' in expression");
+        }
+        advance(this);
+        return true;
+    } else if (token->kind == TINYC_TOKEN_PP_NUMBER) {
+        const struct tinyc_token_pp_number *number = (const void *)token;
+        struct tinyc_pp_expr_op op = {.kind = OP_PUSH};
+        if (!parse_number(this, &number->value, &op.as.value)) return false;
+        advance(this);
+        return emit(this, &op);
+    } else if (token->kind == TINYC_TOKEN_CHAR) {
+        const struct tinyc_token_char *chars = (const void *)token;
+        struct tinyc_pp_expr_op op = {.kind = OP_PUSH};
+        if (!parse_char(this, &chars->value, &op.as.value)) return false;
+        advance(this);
+        return emit(this, &op);
+    } else if (token->kind == TINYC_TOKEN_IDENT) {
+        const struct tinyc_token_ident *ident = (const void *)token;
+        if (strcmp(ident->value.cstr, "defined") == 0) {
+            return parse_defined(this);
+        }
+        advance(this);
+        if (is_punct(this->token, TINYC_TOKEN_PUNCT_LPAREN)) {
+            return fail(
+                this,
+                TINYC_PP_EXPR_EXPAND,
+                "function-like macro invocation"
+            );
+        }
+        return emit_name(this, OP_IDENT, &ident->value);
+    } else {
+        return fail(this, TINYC_PP_EXPR_ERROR, "token is not a valid value");
+    }
+}
+
+static bool parse_unary(struct parser *this) {
+    enum op_kind kind;
+    if (is_punct(this->token, TINYC_TOKEN_PUNCT_MINUS)) {
+        kind = OP_NEG;
+    } else if (is_punct(this->token, TINYC_TOKEN_PUNCT_PLUS)) {
+        kind = OP_PLUS;
+    } else if (is_punct(this->token, TINYC_TOKEN_PUNCT_TILDE)) {
+        kind = OP_NOT;
+    } else if (is_punct(this->token, TINYC_TOKEN_PUNCT_EXC)) {
+        kind = OP_LNOT;
+    } else {
+        return parse_primary(this);
+    }
+    advance(this);
+    return parse_unary(this) && emit_kind(this, kind);
+}
+
+/// Get binary operator and its precedence, or 0 if token is not.
+static int binary_op(const struct tinyc_token *token, enum op_kind *kind) {
+    if (!token || token->kind != TINYC_TOKEN_PUNCT) return 0;
+    switch (((const struct tinyc_token_punct *)token)->kind) {
+        case TINYC_TOKEN_PUNCT_STAR:
+            return *kind = OP_MUL, 10;
+        case TINYC_TOKEN_PUNCT_SLASH:
+            return *kind = OP_DIV, 10;
+        case TINYC_TOKEN_PUNCT_PERCENT:
+            return *kind = OP_MOD, 10;
+        case TINYC_TOKEN_PUNCT_PLUS:
+            return *kind = OP_ADD, 9;
+        case TINYC_TOKEN_PUNCT_MINUS:
+            return *kind = OP_SUB, 9;
+        case TINYC_TOKEN_PUNCT_LSHIFT:
+            return *kind = OP_SHL, 8;
+        case TINYC_TOKEN_PUNCT_RSHIFT:
+            return *kind = OP_SHR, 8;
+        case TINYC_TOKEN_PUNCT_LT:
+            return *kind = OP_LT, 7;
+        case TINYC_TOKEN_PUNCT_GT:
+            return *kind = OP_GT, 7;
+        case TINYC_TOKEN_PUNCT_LE:
+            return *kind = OP_LE, 7;
+        case TINYC_TOKEN_PUNCT_GE:
+            return *kind = OP_GE, 7;
+        case TINYC_TOKEN_PUNCT_EQ:
+            return *kind = OP_EQ, 6;
+        case TINYC_TOKEN_PUNCT_NE:
+            return *kind = OP_NE, 6;
+        case TINYC_TOKEN_PUNCT_AMP:
+            return *kind = OP_AND, 5;
+        case TINYC_TOKEN_PUNCT_HAT:
+            return *kind = OP_XOR, 4;
+        case TINYC_TOKEN_PUNCT_VERT:
+            return *kind = OP_OR, 3;
+        case TINYC_TOKEN_PUNCT_AAMP:
+            return *kind = OP_LAND, 2;
+        case TINYC_TOKEN_PUNCT_VVERT:
+            return *kind = OP_LOR, 1;
+        default:
+            return 0;
+    }
+}
+
+static bool parse_binary(struct parser *this, int min_prec) {
+    if (!parse_unary(this)) return false;
+    enum op_kind kind;
+    int prec;
+    while ((prec = binary_op(this->token, &kind)) >= min_prec && prec > 0) {
+        advance(this);
+        if (kind == OP_LAND && !emit_kind(this, OP_LAND_LHS)) return false;
+        if (kind == OP_LOR && !emit_kind(this, OP_LOR_LHS)) return false;
+        if (!parse_binary(this, prec + 1)) return false;
+        if (!emit_kind(this, kind)) return false;
+    }
+    return true;
+}
+
+static bool parse_cond(struct parser *this) {
+    if (!parse_binary(this, 1)) return false;
+    if (!is_punct(this->token, TINYC_TOKEN_PUNCT_QUESTION)) return true;
+    advance(this);
+    if (!emit_kind(this, OP_COND_TEST)) return false;
+    if (!parse_cond(this)) return false;
+    if (!is_punct(this->token, TINYC_TOKEN_PUNCT_COLON)) {
+        return fail(this, TINYC_PP_EXPR_ERROR, "expected ':' in expression");
+    }
+    advance(this);
+    if (!emit_kind(this, OP_COND_MID)) return false;
+    if (!parse_cond(this)) return false;
+    return emit_kind(this, OP_COND);
+}
+
+enum tinyc_pp_expr_status tinyc_pp_expr_compile(
+    struct tinyc_pp_expr *this,
+    const struct tinyc_token *first,
+    const struct tinyc_token *last
+) {
+    this->ops = NULL;
+    this->len = this->cap = this->depth = 0;
+    this->status = TINYC_PP_EXPR_OK;
+    this->error = NULL;
+    memset(&this->span, 0, sizeof(this->span));
+
+    struct parser parser = {this, first, last, 0};
+    if (!first || !last) {
+        fail(&parser, TINYC_PP_EXPR_ERROR, "expected expression");
+        return this->status;
+    }
+    tinyc_span_add(&first->span, &last->span, &this->span);
+    if (parse_cond(&parser) && parser.token) {
+        fail(&parser, TINYC_PP_EXPR_ERROR, "missing binary operator");
+    }
+    return this->status;
+}
+
+struct evaluator {
+    struct tinyc_pp_value *stack;
+    size_t sp;
+    size_t unevaluated;  // Non-zero while executing unevaluated operand.
+    const char *error;
+};
+
+static inline struct tinyc_pp_value make_int(uintmax_t value) {
+    struct tinyc_pp_value v = {false, value};
+    return v;
+}
+
+static inline bool is_negative(struct tinyc_pp_value v) {
+    return !v.is_unsigned && (intmax_t)v.value < 0;
+}
+
+/// Report error, ignoring it if operand is not evaluated.
+static inline bool report(struct evaluator *this, const char *error) {
+    if (this->unevaluated) return true;
+    this->error = error;
+    return false;
+}
+
+static bool divide(
+    struct evaluator *this,
+    enum op_kind kind,
+    struct tinyc_pp_value lhs,
+    struct tinyc_pp_value rhs,
+    struct tinyc_pp_value *res
+) {
+    res->is_unsigned = lhs.is_unsigned || rhs.is_unsigned;
+    if (rhs.value == 0) {
+        res->value = 0;
+        return report(this, "division by zero in #if");
+    }
+    if (res->is_unsigned) {
+        res->value = kind == OP_DIV ? lhs.value / rhs.value
+                                    : lhs.value % rhs.value;
+    } else if ((intmax_t)lhs.value == INTMAX_MIN && (intmax_t)rhs.value == -1) {
+        res->value = kind == OP_DIV ? lhs.value : 0;
+        return report(this, "integer overflow in preprocessor expression");
+    } else {
+        const intmax_t l = lhs.value, r = rhs.value;
+        res->value = kind == OP_DIV ? l / r : l % r;
+    }
+    return true;
+}
+
+/// Shift lhs. Result has type of lhs (C99 6.5.7p3).
+static bool shift(
+    struct evaluator *this,
+    enum op_kind kind,
+    struct tinyc_pp_value lhs,
+    struct tinyc_pp_value rhs,
+    struct tinyc_pp_value *res
+) {
+    res->is_unsigned = lhs.is_unsigned;
+    res->value = 0;
+    if (is_negative(rhs) || rhs.value >= UINTMAX_BITS) {
+        return report(this, "shift count is out of range");
+    }
+    if (kind == OP_SHL) {
+        res->value = lhs.value << rhs.value;
+    } else if (is_negative(lhs)) {
+        res->value = ~(~lhs.value >> rhs.value);
+    } else {
+        res->value = lhs.value >> rhs.value;
+    }
+    return true;
+}
+
+static bool compare(
+    enum op_kind kind,
+    struct tinyc_pp_value lhs,
+    struct tinyc_pp_value rhs
+) {
+    if (lhs.is_unsigned || rhs.is_unsigned) {
+        const uintmax_t l = lhs.value, r = rhs.value;
+        switch (kind) {
+            case OP_LT:
+                return l < r;
+            case OP_GT:
+                return l > r;
+            case OP_LE:
+                return l <= r;
+            default:  // OP_GE
+                return l >= r;
+        }
+    } else {
+        const intmax_t l = lhs.value, r = rhs.value;
+        switch (kind) {
+            case OP_LT:
+                return l < r;
+            case OP_GT:
+                return l > r;
+            case OP_LE:
+                return l <= r;
+            default:  // OP_GE
+                return l >= r;
+        }
+    }
+}
+
+static bool binary(
+    struct evaluator *this,
+    enum op_kind kind,
+    struct tinyc_pp_value lhs,
+    struct tinyc_pp_value rhs,
+    struct tinyc_pp_value *res
+) {
+    // Usual arithmetic conversions. Signed overflow wraps around.
+    res->is_unsigned = lhs.is_unsigned || rhs.is_unsigned;
+    switch (kind) {
+        case OP_MUL:
+            res->value = lhs.value * rhs.value;
+            return true;
+        case OP_DIV:
+        case OP_MOD:
+            return divide(this, kind, lhs, rhs, res);
+        case OP_ADD:
+            res->value = lhs.value + rhs.value;
+            return true;
+        case OP_SUB:
+            res->value = lhs.value - rhs.value;
+            return true;
+        case OP_SHL:
+        case OP_SHR:
+            return shift(this, kind, lhs, rhs, res);
+        case OP_LT:
+        case OP_GT:
+        case OP_LE:
+        case OP_GE:
+            *res = make_int(compare(kind, lhs, rhs));
+            return true;
+        case OP_EQ:
+            *res = make_int(lhs.value == rhs.value);
+            return true;
+        case OP_NE:
+            *res = make_int(lhs.value != rhs.value);
+            return true;
+        case OP_AND:
+            res->value = lhs.value & rhs.value;
+            return true;
+        case OP_XOR:
+            res->value = lhs.value ^ rhs.value;
+            return true;
+        case OP_OR:
+            res->value = lhs.value | rhs.value;
+            return true;
+        case OP_LAND:
+            if (lhs.value == 0) this->unevaluated--;
+            *res = make_int(lhs.value != 0 && rhs.value != 0);
+            return true;
+        default:  // OP_LOR
+            if (lhs.value != 0) this->unevaluated--;
+            *res = make_int(lhs.value != 0 || rhs.value != 0);
+            return true;
+    }
+}
+
+static enum tinyc_pp_expr_status execute(
+    struct evaluator *this,
+    const struct tinyc_pp_expr_op *op,
+    tinyc_pp_expr_lookup lookup,
+    void *ctx
+) {
+    struct tinyc_pp_value *stack = this->stack;
+    struct tinyc_pp_value *top = this->sp ? &stack[this->sp - 1] : NULL;
+    struct tinyc_pp_value value;
+    switch (op->kind) {
+        case OP_PUSH:
+            stack[this->sp++] = op->as.value;
+            return TINYC_PP_EXPR_OK;
+        case OP_IDENT:
+            switch (lookup(ctx, &op->as.name, &value)) {
+                case TINYC_PP_MACRO_UNDEFINED:
+                    stack[this->sp++] = make_int(0);
+                    return TINYC_PP_EXPR_OK;
+                case TINYC_PP_MACRO_VALUE:
+                    stack[this->sp++] = value;
+                    return TINYC_PP_EXPR_OK;
+                default:  // TINYC_PP_MACRO_COMPLEX
+                    return TINYC_PP_EXPR_EXPAND;
+            }
+        case OP_DEFINED:
+            stack[this->sp++] = make_int(
+                lookup(ctx, &op->as.name, NULL) != TINYC_PP_MACRO_UNDEFINED
+            );
+            return TINYC_PP_EXPR_OK;
+        case OP_NEG:
+            top->value = -top->value;
+            return TINYC_PP_EXPR_OK;
+        case OP_PLUS:
+            return TINYC_PP_EXPR_OK;
+        case OP_NOT:
+            top->value = ~top->value;
+            return TINYC_PP_EXPR_OK;
+        case OP_LNOT:
+            *top = make_int(top->value == 0);
+            return TINYC_PP_EXPR_OK;
+        case OP_LAND_LHS:
+            if (top->value == 0) this->unevaluated++;
+            return TINYC_PP_EXPR_OK;
+        case OP_LOR_LHS:
+            if (top->value != 0) this->unevaluated++;
+            return TINYC_PP_EXPR_OK;
+        case OP_COND_TEST:
+            if (top->value == 0) this->unevaluated++;
+            return TINYC_PP_EXPR_OK;
+        case OP_COND_MID:
+            if (top[-1].value == 0) {
+                this->unevaluated--;
+            } else {
+                this->unevaluated++;
+            }
+            return TINYC_PP_EXPR_OK;
+        case OP_COND:
+            this->sp -= 2;
+            if (top[-2].value != 0) this->unevaluated--;
+            value = top[-2].value != 0 ? top[-1] : top[0];
+            value.is_unsigned = top[-1].is_unsigned || top[0].is_unsigned;
+            top[-2] = value;
+            return TINYC_PP_EXPR_OK;
+        default:  // Binary operators
+            this->sp--;
+            if (!binary(this, op->kind, top[-1], top[0], &value)) {
+                return TINYC_PP_EXPR_ERROR;
+            }
+            top[-1] = value;
+            return TINYC_PP_EXPR_OK;
+    }
+}
+
+enum tinyc_pp_expr_status tinyc_pp_expr_eval(
+    const struct tinyc_pp_expr *this,
+    tinyc_pp_expr_lookup lookup,
+    void *ctx,
+    struct tinyc_pp_value *result,
+    const char **error
+) {
+    if (this->status != TINYC_PP_EXPR_OK) {
+        *error = this->error;
+        return this->status;
+    }
+
+    struct tinyc_pp_value local[LOCAL_STACK_SIZE];
+    struct evaluator evaluator = {local, 0, 0, NULL};
+    if (this->depth > LOCAL_STACK_SIZE) {
+        evaluator.stack = tinyc_alloc(
+            sizeof(struct tinyc_pp_value) * this->depth
+        );
+        if (!evaluator.stack) {
+            *error = "out of memory";
+            return TINYC_PP_EXPR_ERROR;
+        }
+    }
+
+    enum tinyc_pp_expr_status status = TINYC_PP_EXPR_OK;
+    for (size_t i = 0; i < this->len && status == TINYC_PP_EXPR_OK; ++i) {
+        status = execute(&evaluator, &this->ops[i], lookup, ctx);
+    }
+    if (status == TINYC_PP_EXPR_OK) {
+        *result = evaluator.stack[0];
+    } else if (status == TINYC_PP_EXPR_ERROR) {
+        *error = evaluator.error;
+    } else {
+        *error = "macro must be expanded";
+    }
+
+    if (evaluator.stack != local) tinyc_free(evaluator.stack);
+    return status;
+}
+
+void tinyc_pp_expr_free(struct tinyc_pp_expr *this) {
+    for (size_t i = 0; i < this->len; ++i) {
+        const enum op_kind kind = this->ops[i].kind;
+        if (kind == OP_IDENT || kind == OP_DEFINED) {
+            tinyc_string_free(&this->ops[i].as.name);
+        }
+    }
+    tinyc_free(this->ops);
+    this->ops = NULL;
+    this->len = this->cap = 0;
+}
+
+static inline size_t hash_location(
+    tinyc_repo_id id,
+    const struct tinyc_position *position
+) {
+    uint64_t h = 14695981039346656037ULL;
+    h = (h ^ (uint64_t)id) * 1099511628211ULL;
+    h = (h ^ (uint64_t)position->row) * 1099511628211ULL;
+    h = (h ^ (uint64_t)position->offset) * 1099511628211ULL;
+    return h ^ (h >> 32);
+}
+
+static inline struct tinyc_pp_expr_cache_entry *find_slot(
+    struct tinyc_pp_expr_cache_entry *entries,
+    size_t cap,
+    tinyc_repo_id id,
+    const struct tinyc_position *position
+) {
+    size_t i = hash_location(id, position) & (cap - 1);
+    while (entries[i].used) {
+        const struct tinyc_pp_expr_cache_entry *e = &entries[i];
+        if (e->id == id && e->position.row == position->row &&
+            e->position.offset == position->offset) {
+            break;
+        }
+        i = (i + 1) & (cap - 1);
+    }
+    return &entries[i];
+}
+
+static bool grow(struct tinyc_pp_expr_cache *this) {
+    const size_t new_cap = this->cap * 2;
+    struct tinyc_pp_expr_cache_entry *entries = tinyc_calloc(
+        new_cap,
+        sizeof(struct tinyc_pp_expr_cache_entry)
+    );
+    if (!entries) return false;
+    for (size_t i = 0; i < this->cap; ++i) {
+        const struct tinyc_pp_expr_cache_entry *e = &this->entries[i];
+        if (!e->used) continue;
+        *find_slot(entries, new_cap, e->id, &e->position) = *e;
+    }
+    tinyc_free(this->entries);
+    this->entries = entries;
+    this->cap = new_cap;
+    return true;
+}
+
+bool tinyc_pp_expr_cache_init(struct tinyc_pp_expr_cache *this) {
+    this->len = 0;
+    this->cap = DEFAULT_CACHE_CAP;
+    this->entries = tinyc_calloc(
+        this->cap,
+        sizeof(struct tinyc_pp_expr_cache_entry)
+    );
+    return this->entries != NULL;
+}
+
+const struct tinyc_pp_expr *tinyc_pp_expr_cache_get(
+    struct tinyc_pp_expr_cache *this,
+    const struct tinyc_span *directive,
+    const struct tinyc_token *first,
+    const struct tinyc_token *last
+) {
+    struct tinyc_pp_expr_cache_entry *entry = find_slot(
+        this->entries,
+        this->cap,
+        directive->id,
+        &directive->start
+    );
+    if (entry->used) return &entry->expr;
+
+    if ((this->len + 1) * 4 > this->cap * 3) {
+        if (!grow(this)) return NULL;
+        entry = find_slot(
+            this->entries,
+            this->cap,
+            directive->id,
+            &directive->start
+        );
+    }
+    entry->used = true;
+    entry->id = directive->id;
+    entry->position = directive->start;
+    tinyc_pp_expr_compile(&entry->expr, first, last);
+    if (!first || !last) entry->expr.span = *directive;
+    this->len++;
+    return &entry->expr;
+}
+
+void tinyc_pp_expr_cache_free(struct tinyc_pp_expr_cache *this) {
+    for (size_t i = 0; i < this->cap; ++i) {
+        if (this->entries[i].used) tinyc_pp_expr_free(&this->entries[i].expr);
+    }
+    tinyc_free(this->entries);
+    this->entries = NULL;
+    this->len = this->cap = 0;
+}
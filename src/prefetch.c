@@ -0,0 +1,339 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "tinyc/prefetch.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/header_search.h"
+#include "tinyc/map.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+
+enum state {
+    STATE_QUEUED,
+    STATE_LOADING,
+    STATE_LOADED,
+    STATE_FAILED,
+    STATE_TAKEN,  // Registered into repository, or moved to caller.
+};
+
+struct tinyc_prefetch_entry {
+    enum state state;
+    const struct tinyc_string *path;  // Interned by header search.
+    struct tinyc_source source;       // Valid if loaded or taken.
+    struct timespec mtime;            // Valid if loaded.
+    long long size;                   // Valid if loaded.
+    tinyc_repo_id id;                 // Valid if taken into repository.
+    struct tinyc_prefetch_entry *next;  // Next entry in queue.
+};
+
+static bool load(struct tinyc_prefetch_entry *entry) {
+    FILE *fp = fopen(entry->path->cstr, "r");
+    if (!fp) return false;
+    struct stat st;
+    bool ok = fstat(fileno(fp), &st) == 0;
+    if (ok) {
+        entry->mtime = st.st_mtim;
+        entry->size = st.st_size;
+        ok = tinyc_source_from_fs(&entry->source, entry->path->cstr, fp);
+    }
+    fclose(fp);
+    return ok;
+}
+
+/// Create entry for path. this->lock must be held.
+static struct tinyc_prefetch_entry *create_entry(
+    struct tinyc_prefetch *this,
+    const struct tinyc_string *path,
+    enum state state
+) {
+    struct tinyc_prefetch_entry *entry = tinyc_alloc(
+        sizeof(struct tinyc_prefetch_entry)
+    );
+    if (!entry) return NULL;
+    entry->state = state;
+    entry->path = path;
+    entry->id = -1;
+    entry->next = NULL;
+    if (!tinyc_map_insert(&this->entries, path, entry)) {
+        tinyc_free(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+/// Queue path to load if not yet. this->lock must be held.
+static bool enqueue(
+    struct tinyc_prefetch *this,
+    const struct tinyc_string *path
+) {
+    if (tinyc_map_query(&this->entries, path, NULL)) return true;
+    struct tinyc_prefetch_entry *entry = create_entry(
+        this,
+        path,
+        STATE_QUEUED
+    );
+    if (!entry) return false;
+    if (this->tail) {
+        this->tail->next = entry;
+    } else {
+        this->head = entry;
+    }
+    this->tail = entry;
+    pthread_cond_signal(&this->queued);
+    return true;
+}
+
+/// Remove entry from queue. this->lock must be held.
+static void unqueue(
+    struct tinyc_prefetch *this,
+    struct tinyc_prefetch_entry *entry
+) {
+    struct tinyc_prefetch_entry *prev = NULL;
+    for (struct tinyc_prefetch_entry *it = this->head; it; it = it->next) {
+        if (it != entry) {
+            prev = it;
+            continue;
+        }
+        if (prev) {
+            prev->next = it->next;
+        } else {
+            this->head = it->next;
+        }
+        if (this->tail == it) this->tail = prev;
+        it->next = NULL;
+        return;
+    }
+}
+
+/// Load entry whose state is loading, and scan it before it can be taken.
+/// So headers it includes are already queued when it's taken.
+static void load_and_scan(
+    struct tinyc_prefetch *this,
+    struct tinyc_prefetch_entry *entry
+) {
+    const bool ok = load(entry);
+    struct tinyc_string base;
+    if (ok && tinyc_header_search_dirname(entry->path, &base)) {
+        tinyc_prefetch_scan(this, &entry->source, base.cstr);
+        tinyc_string_free(&base);
+    }
+
+    pthread_mutex_lock(&this->lock);
+    entry->state = ok ? STATE_LOADED : STATE_FAILED;
+    pthread_cond_broadcast(&this->loaded);
+    pthread_mutex_unlock(&this->lock);
+}
+
+static void *work(void *arg) {
+    struct tinyc_prefetch *this = arg;
+    pthread_mutex_lock(&this->lock);
+    for (;;) {
+        while (!this->head && !this->stop) {
+            pthread_cond_wait(&this->queued, &this->lock);
+        }
+        if (this->stop) break;
+
+        struct tinyc_prefetch_entry *entry = this->head;
+        unqueue(this, entry);
+        entry->state = STATE_LOADING;
+        pthread_mutex_unlock(&this->lock);
+        load_and_scan(this, entry);
+        pthread_mutex_lock(&this->lock);
+    }
+    pthread_mutex_unlock(&this->lock);
+    return NULL;
+}
+
+bool tinyc_prefetch_init(
+    struct tinyc_prefetch *this,
+    struct tinyc_header_search *search,
+    size_t nthreads
+) {
+    this->search = search;
+    this->head = this->tail = NULL;
+    this->stop = false;
+    this->nthreads = 0;
+    if (!tinyc_map_init(&this->entries)) return false;
+    pthread_mutex_init(&this->lock, NULL);
+    pthread_cond_init(&this->queued, NULL);
+    pthread_cond_init(&this->loaded, NULL);
+
+    this->threads = tinyc_alloc(sizeof(pthread_t) * nthreads);
+    if (!this->threads) return false;
+    for (size_t i = 0; i < nthreads; ++i) {
+        if (pthread_create(&this->threads[i], NULL, work, this) != 0) break;
+        this->nthreads++;
+    }
+    return this->nthreads == nthreads;
+}
+
+bool tinyc_prefetch_scan(
+    struct tinyc_prefetch *this,
+    const struct tinyc_source *source,
+    const char *base
+) {
+    for (const struct tinyc_source_line *line = source->lines; line;
+         line = line->next) {
+        bool is_std;
+        struct tinyc_string path;
+        const bool found = tinyc_header_search_parse_include(
+            &line->line,
+            &is_std,
+            &path
+        );
+        if (!found) continue;
+
+        pthread_mutex_lock(&this->lock);
+        const struct tinyc_string *resolved = tinyc_header_search_resolve(
+            this->search,
+            base,
+            is_std,
+            &path
+        );
+        const bool ok = !resolved || enqueue(this, resolved);
+        pthread_mutex_unlock(&this->lock);
+        tinyc_string_free(&path);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+tinyc_repo_id tinyc_prefetch_take(
+    struct tinyc_prefetch *this,
+    const char *base,
+    bool is_std,
+    const struct tinyc_string *path,
+    struct tinyc_repo *repo
+) {
+    pthread_mutex_lock(&this->lock);
+    const struct tinyc_string *resolved = tinyc_header_search_resolve(
+        this->search,
+        base,
+        is_std,
+        path
+    );
+    if (!resolved) {
+        pthread_mutex_unlock(&this->lock);
+        return -1;
+    }
+
+    void *value;
+    struct tinyc_prefetch_entry *entry = NULL;
+    if (tinyc_map_query(&this->entries, resolved, &value)) {
+        entry = value;
+        if (entry->state == STATE_QUEUED) {
+            unqueue(this, entry);
+            entry->state = STATE_LOADING;
+            pthread_mutex_unlock(&this->lock);
+            load_and_scan(this, entry);
+            pthread_mutex_lock(&this->lock);
+        }
+    } else {
+        entry = create_entry(this, resolved, STATE_LOADING);
+        if (!entry) {
+            pthread_mutex_unlock(&this->lock);
+            return -1;
+        }
+        pthread_mutex_unlock(&this->lock);
+        load_and_scan(this, entry);
+        pthread_mutex_lock(&this->lock);
+    }
+
+    while (entry->state == STATE_LOADING) {
+        pthread_cond_wait(&this->loaded, &this->lock);
+    }
+    if (entry->state == STATE_LOADED) {
+        entry->id = tinyc_repo_registory(repo, &entry->source);
+        if (entry->id >= 0) entry->state = STATE_TAKEN;
+    }
+    const tinyc_repo_id id = entry->id;
+    pthread_mutex_unlock(&this->lock);
+    return id;
+}
+
+bool tinyc_prefetch_take_source(
+    struct tinyc_prefetch *this,
+    const char *path,
+    struct tinyc_source *source,
+    struct timespec *mtime,
+    long long *size
+) {
+    struct tinyc_string key;
+    tinyc_string_from(&key, (char *)path);
+    pthread_mutex_lock(&this->lock);
+    void *value;
+    if (!tinyc_map_query(&this->entries, &key, &value)) {
+        pthread_mutex_unlock(&this->lock);
+        return false;
+    }
+    struct tinyc_prefetch_entry *entry = value;
+    if (entry->state == STATE_QUEUED) {
+        unqueue(this, entry);
+        entry->state = STATE_LOADING;
+        pthread_mutex_unlock(&this->lock);
+        load_and_scan(this, entry);
+        pthread_mutex_lock(&this->lock);
+    }
+    while (entry->state == STATE_LOADING) {
+        pthread_cond_wait(&this->loaded, &this->lock);
+    }
+    const bool ok = entry->state == STATE_LOADED;
+    if (ok) {
+        *source = entry->source;
+        *mtime = entry->mtime;
+        *size = entry->size;
+        entry->state = STATE_TAKEN;
+    }
+    pthread_mutex_unlock(&this->lock);
+    return ok;
+}
+
+bool tinyc_prefetch_revalidate(struct tinyc_prefetch *this) {
+    pthread_mutex_lock(&this->lock);
+    const bool ok = tinyc_header_search_revalidate(this->search);
+    pthread_mutex_unlock(&this->lock);
+    return ok;
+}
+
+void tinyc_prefetch_free(struct tinyc_prefetch *this) {
+    pthread_mutex_lock(&this->lock);
+    this->stop = true;
+    pthread_cond_broadcast(&this->queued);
+    pthread_mutex_unlock(&this->lock);
+    for (size_t i = 0; i < this->nthreads; ++i) {
+        pthread_join(this->threads[i], NULL);
+    }
+    tinyc_free(this->threads);
+
+    for (size_t i = 0; i < this->entries.cap; ++i) {
+        const struct tinyc_map_entry *e = &this->entries.entries[i];
+        if (!e->used) continue;
+        struct tinyc_prefetch_entry *entry = e->value;
+        if (entry->state == STATE_LOADED) tinyc_source_free(&entry->source);
+        tinyc_free(entry);
+    }
+    tinyc_map_free(&this->entries);
+    pthread_mutex_destroy(&this->lock);
+    pthread_cond_destroy(&this->queued);
+    pthread_cond_destroy(&this->loaded);
+}
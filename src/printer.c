@@ -0,0 +1,256 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tinyc/printer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/token.h"
+
+// Skip at most this number of lines by newlines instead of a line marker.
+#define MAX_NEWLINES 8
+
+/// Spelling of a token: open, body and close, each of open and close may be
+/// '\0' if not exists.
+struct spelling {
+    char open;
+    const char *body;
+    size_t len;
+    char close;
+};
+
+static bool spell(const struct tinyc_token *token, struct spelling *res) {
+    res->open = res->close = '\0';
+    switch (token->kind) {
+        case TINYC_TOKEN_PUNCT:
+            res->body = tinyc_token_punct_spelling(
+                ((const struct tinyc_token_punct *)token)->kind
+            );
+            res->len = strlen(res->body);
+            return true;
+        case TINYC_TOKEN_KEYWORD:
+            res->body = tinyc_token_keyword_spelling(
+                ((const struct tinyc_token_keyword *)token)->kind
+            );
+            res->len = strlen(res->body);
+            return true;
+        case TINYC_TOKEN_IDENT: {
+            const struct tinyc_token_ident *tk = (const void *)token;
+            res->body = tk->value.cstr;
+            res->len = tk->value.len;
+            return true;
+        }
+        case TINYC_TOKEN_PP_NUMBER: {
+            const struct tinyc_token_pp_number *tk = (const void *)token;
+            res->body = tk->value.cstr;
+            res->len = tk->value.len;
+            return true;
+        }
+        case TINYC_TOKEN_STRING: {
+            const struct tinyc_token_string *tk = (const void *)token;
+            res->open = res->close = '"';
+            res->body = tk->value.cstr;
+            res->len = tk->value.len;
+            return true;
+        }
+        case TINYC_TOKEN_CHAR: {
+            const struct tinyc_token_char *tk = (const void *)token;
+            res->open = res->close = '\'';
+            res->body = tk->value.cstr;
+            res->len = tk->value.len;
+            return true;
+        }
+        case TINYC_TOKEN_HEADER: {
+            const struct tinyc_token_header *tk = (const void *)token;
+            res->open = tk->is_std ? '<' : '"';
+            res->close = tk->is_std ? '>' : '"';
+            res->body = tk->path.cstr;
+            res->len = tk->path.len;
+            return true;
+        }
+        default:  // Integer and floating token doesn't hold its spelling.
+            return false;
+    }
+}
+
+static inline char first_char(const struct spelling *s) {
+    if (s->open) return s->open;
+    return s->len ? s->body[0] : '\0';
+}
+
+static inline char last_char(const struct spelling *s) {
+    if (s->close) return s->close;
+    return s->len ? s->body[s->len - 1] : '\0';
+}
+
+static inline bool is_word(enum tinyc_token_kind kind) {
+    return kind == TINYC_TOKEN_IDENT || kind == TINYC_TOKEN_KEYWORD ||
+           kind == TINYC_TOKEN_PP_NUMBER;
+}
+
+/// Returns true if prefix followed by c is a beginning of some punctuation.
+static bool extends_punct(const char *prefix, char c) {
+    const size_t len = strlen(prefix);
+    if (prefix[0] == '/' && len == 1 && (c == '/' || c == '*')) return true;
+    for (int kind = 0; kind <= TINYC_TOKEN_PUNCT_SSHARP; ++kind) {
+        const char *s = tinyc_token_punct_spelling(kind);
+        if (strncmp(s, prefix, len) == 0 && s[len] == c) return true;
+    }
+    return false;
+}
+
+/// Returns true if token written just after last token is lexed differently.
+static bool pastes(
+    const struct tinyc_printer *this,
+    enum tinyc_token_kind kind,
+    const struct spelling *s
+) {
+    const char c = first_char(s);
+    const char prev = this->prev_last;
+    if (is_word(this->prev_kind) && is_word(kind)) return true;
+    if (this->prev_kind == TINYC_TOKEN_PP_NUMBER) {
+        if (c == '.') return true;
+        if ((c == '+' || c == '-') && strchr("eEpP", prev)) return true;
+    }
+    if (prev == '.' && kind == TINYC_TOKEN_PP_NUMBER) return true;
+    if (this->prev_kind == TINYC_TOKEN_PUNCT && kind == TINYC_TOKEN_PUNCT) {
+        return extends_punct(tinyc_token_punct_spelling(this->prev_punct), c);
+    }
+    return false;
+}
+
+static bool flush(struct tinyc_printer *this) {
+    const size_t len = this->len;
+    this->len = 0;
+    return fwrite(this->buf, 1, len, this->fs) == len;
+}
+
+static inline bool put(struct tinyc_printer *this, const char *s, size_t n) {
+    if (TINYC_PRINTER_BUFSIZE - this->len < n) {
+        if (!flush(this)) return false;
+        if (n >= TINYC_PRINTER_BUFSIZE) return fwrite(s, 1, n, this->fs) == n;
+    }
+    memcpy(this->buf + this->len, s, n);
+    this->len += n;
+    return true;
+}
+
+static inline bool put_char(struct tinyc_printer *this, char c) {
+    if (this->len == TINYC_PRINTER_BUFSIZE && !flush(this)) return false;
+    this->buf[this->len++] = c;
+    return true;
+}
+
+static bool put_marker(
+    struct tinyc_printer *this,
+    tinyc_repo_id id,
+    size_t row
+) {
+    char num[32];
+    const int n = snprintf(num, sizeof(num), "# %zu \"", row + 1);
+    if (!put(this, num, n)) return false;
+
+    const struct tinyc_source *source = tinyc_repo_query(this->repo, id);
+    if (source) {
+        const struct tinyc_string *name = &source->name;
+        for (size_t i = 0; i < name->len; ++i) {
+            const char c = name->cstr[i];
+            if ((c == '"' || c == '\\') && !put_char(this, '\\')) return false;
+            if (!put_char(this, c)) return false;
+        }
+    }
+    return put(this, "\"\n", 2);
+}
+
+/// Move output to line of span, returns true if it's still on same line.
+static bool move_line(
+    struct tinyc_printer *this,
+    const struct tinyc_span *span,
+    bool *same_line
+) {
+    const size_t row = span->start.row;
+    *same_line = false;
+    if (this->id != span->id || row < this->row ||
+        row > this->row + MAX_NEWLINES) {
+        if (this->has_prev && !put_char(this, '\n')) return false;
+        if (!put_marker(this, span->id, row)) return false;
+    } else if (row > this->row) {
+        for (size_t i = this->row; i < row; ++i) {
+            if (!put_char(this, '\n')) return false;
+        }
+    } else {
+        *same_line = this->has_prev;
+        return true;
+    }
+    this->id = span->id;
+    this->row = row;
+    this->has_prev = false;
+    return true;
+}
+
+bool tinyc_printer_init(
+    struct tinyc_printer *this,
+    FILE *fs,
+    const struct tinyc_repo *repo
+) {
+    this->fs = fs;
+    this->repo = repo;
+    this->id = -1;
+    this->row = 0;
+    this->has_prev = false;
+    this->len = 0;
+    return true;
+}
+
+bool tinyc_printer_print(
+    struct tinyc_printer *this,
+    const struct tinyc_token *token
+) {
+    struct spelling s;
+    if (!spell(token, &s)) return false;
+
+    bool same_line;
+    if (!move_line(this, &token->span, &same_line)) return false;
+    if (same_line) {
+        const struct tinyc_position *start = &token->span.start;
+        const bool gap = start->row != this->prev_end.row ||
+                         start->offset > this->prev_end.offset + 1;
+        if ((gap || pastes(this, token->kind, &s)) && !put_char(this, ' ')) {
+            return false;
+        }
+    }
+
+    if (s.open && !put_char(this, s.open)) return false;
+    if (!put(this, s.body, s.len)) return false;
+    if (s.close && !put_char(this, s.close)) return false;
+
+    this->has_prev = true;
+    this->prev_kind = token->kind;
+    if (token->kind == TINYC_TOKEN_PUNCT) {
+        this->prev_punct = ((const struct tinyc_token_punct *)token)->kind;
+    }
+    this->prev_last = last_char(&s);
+    this->prev_end = token->span.end;
+    this->row = token->span.end.row;
+    return true;
+}
+
+bool tinyc_printer_finish(struct tinyc_printer *this) {
+    if (this->has_prev && !put_char(this, '\n')) return false;
+    this->has_prev = false;
+    return flush(this) && fflush(this->fs) == 0;
+}
@@ -12,15 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_REPO
+
 #include "tinyc/repo.h"
 
-#include <stdlib.h>
+#include "tinyc/allocator.h"
 
 static inline tinyc_repo_id create(
     struct tinyc_repo *this,
     const struct tinyc_source *source
 ) {
-    this->head = malloc(sizeof(struct tinyc_repo_entry));
+    this->head = tinyc_alloc(sizeof(struct tinyc_repo_entry));
     if (!this->head) return -1;
     this->head->id = this->next_id++;
     this->head->next = NULL;
@@ -32,7 +34,9 @@ static inline tinyc_repo_id append(
     struct tinyc_repo *this,
     const struct tinyc_source *source
 ) {
-    struct tinyc_repo_entry *entry = malloc(sizeof(struct tinyc_repo_entry));
+    struct tinyc_repo_entry *entry = tinyc_alloc(
+        sizeof(struct tinyc_repo_entry)
+    );
     if (!entry) return -1;
     entry->id = this->next_id++;
     entry->next = this->head;
@@ -67,3 +71,29 @@ const struct tinyc_source *tinyc_repo_query(
     }
     return NULL;
 }
+
+bool tinyc_repo_remove(
+    struct tinyc_repo *this,
+    tinyc_repo_id id,
+    struct tinyc_source *source
+) {
+    for (struct tinyc_repo_entry **it = &this->head; *it; it = &(*it)->next) {
+        if ((*it)->id != id) continue;
+        struct tinyc_repo_entry *entry = *it;
+        *it = entry->next;
+        *source = entry->source;
+        tinyc_free(entry);
+        return true;
+    }
+    return false;
+}
+
+void tinyc_repo_free(struct tinyc_repo *this) {
+    struct tinyc_repo_entry *it = this->head;
+    while (it) {
+        struct tinyc_repo_entry *next = it->next;
+        tinyc_free(it);
+        it = next;
+    }
+    this->head = NULL;
+}
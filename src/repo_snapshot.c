@@ -0,0 +1,251 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_REPO
+
+#include "tinyc/repo_snapshot.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+
+#define MAGIC "TRS\1"
+
+// File consists of header followed by each source in id order:
+//   u64 number of lines, name, then each line.
+// name and lines are written as u64 length followed by characters, which is
+// terminated with '\0' and padded to 8 bytes.
+struct header {
+    char magic[4];
+    uint32_t version;
+    uint64_t nsources;
+    uint64_t size;  // Size of whole file.
+};
+
+static inline uint64_t padded(uint64_t len) {
+    return (len + 1 + 7) & ~(uint64_t)7;
+}
+
+static bool write_u64(FILE *fp, uint64_t n) {
+    return fwrite(&n, sizeof(n), 1, fp) == 1;
+}
+
+static bool write_str(FILE *fp, const struct tinyc_string *s) {
+    static const char zeros[8];
+    if (!write_u64(fp, s->len)) return false;
+    if (fwrite(s->cstr, 1, s->len, fp) != s->len) return false;
+    const size_t pad = padded(s->len) - s->len;
+    return fwrite(zeros, 1, pad, fp) == pad;
+}
+
+static uint64_t source_size(const struct tinyc_source *source) {
+    uint64_t size = 2 * sizeof(uint64_t) + padded(source->name.len);
+    for (const struct tinyc_source_line *line = source->lines; line;
+         line = line->next) {
+        size += sizeof(uint64_t) + padded(line->line.len);
+    }
+    return size;
+}
+
+static bool write_source(FILE *fp, const struct tinyc_source *source) {
+    uint64_t nlines = 0;
+    for (const struct tinyc_source_line *line = source->lines; line;
+         line = line->next) {
+        nlines++;
+    }
+    if (!write_u64(fp, nlines) || !write_str(fp, &source->name)) return false;
+    for (const struct tinyc_source_line *line = source->lines; line;
+         line = line->next) {
+        if (!write_str(fp, &line->line)) return false;
+    }
+    return true;
+}
+
+static bool write_repo(FILE *fp, const struct tinyc_repo *repo) {
+    struct header header = {MAGIC, TINYC_REPO_SNAPSHOT_VERSION, 0, 0};
+    header.nsources = repo->next_id;
+    header.size = sizeof(header);
+    for (tinyc_repo_id id = 0; id < repo->next_id; ++id) {
+        const struct tinyc_source *source = tinyc_repo_query(repo, id);
+        if (!source) return false;
+        header.size += source_size(source);
+    }
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) return false;
+    for (tinyc_repo_id id = 0; id < repo->next_id; ++id) {
+        if (!write_source(fp, tinyc_repo_query(repo, id))) return false;
+    }
+    return true;
+}
+
+/// Reader of mapped file which fails once it reads beyond the end.
+struct reader {
+    const char *map;
+    uint64_t size, pos;
+};
+
+static bool read_u64(struct reader *reader, uint64_t *n) {
+    if (reader->size - reader->pos < sizeof(*n)) return false;
+    memcpy(n, reader->map + reader->pos, sizeof(*n));
+    reader->pos += sizeof(*n);
+    return true;
+}
+
+/// Read string as static string.
+static bool read_str(struct reader *reader, struct tinyc_string *s) {
+    uint64_t len;
+    if (!read_u64(reader, &len)) return false;
+    if (len >= reader->size || reader->size - reader->pos < padded(len)) {
+        return false;
+    }
+    const char *cstr = reader->map + reader->pos;
+    if (cstr[len] != '\0') return false;
+    s->cap = 0;
+    s->len = len;
+    s->cstr = (char *)cstr;
+    reader->pos += padded(len);
+    return true;
+}
+
+/// Read a source. Its lines are allocated as an array and set to lines.
+static bool read_source(
+    struct reader *reader,
+    struct tinyc_source *source,
+    struct tinyc_source_line **lines
+) {
+    uint64_t nlines;
+    *lines = NULL;
+    if (!read_u64(reader, &nlines) || !read_str(reader, &source->name)) {
+        return false;
+    }
+    if (nlines > (reader->size - reader->pos) / (2 * sizeof(uint64_t))) {
+        return false;
+    }
+
+    source->lines = NULL;
+    source->utf8 = false;  // Not validated yet.
+    if (nlines == 0) return true;
+    *lines = tinyc_alloc(sizeof(struct tinyc_source_line) * nlines);
+    if (!*lines) return false;
+    for (uint64_t i = 0; i < nlines; ++i) {
+        struct tinyc_source_line *line = &(*lines)[i];
+        if (!read_str(reader, &line->line)) return false;
+        line->next = i + 1 < nlines ? line + 1 : NULL;
+    }
+    source->lines = *lines;
+    return true;
+}
+
+static bool read_repo(
+    struct tinyc_repo_snapshot *this,
+    struct tinyc_repo *repo
+) {
+    struct header header;
+    if (this->size < sizeof(header)) return false;
+    memcpy(&header, this->map, sizeof(header));
+    if (memcmp(header.magic, MAGIC, 4) != 0 ||
+        header.version != TINYC_REPO_SNAPSHOT_VERSION ||
+        header.size != this->size ||
+        header.nsources > this->size / (2 * sizeof(uint64_t))) {
+        return false;
+    }
+
+    this->lines = tinyc_calloc(
+        header.nsources,
+        sizeof(struct tinyc_source_line *)
+    );
+    if (header.nsources && !this->lines) return false;
+    struct reader reader = {this->map, this->size, sizeof(header)};
+    for (uint64_t i = 0; i < header.nsources; ++i) {
+        struct tinyc_source source;
+        this->nsources++;
+        if (!read_source(&reader, &source, &this->lines[i])) return false;
+        if (tinyc_repo_registory(repo, &source) != (tinyc_repo_id)i) {
+            return false;
+        }
+    }
+    return reader.pos == reader.size;
+}
+
+bool tinyc_repo_snapshot_save(const struct tinyc_repo *repo, const char *path) {
+    // Write to temporary file, so readers never see partially written file.
+    struct tinyc_string tmp;
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%ld.tmp", (long)getpid());
+    if (!tinyc_string_from_copy(&tmp, path)) return false;
+    if (!tinyc_string_append(&tmp, suffix, strlen(suffix))) {
+        tinyc_string_free(&tmp);
+        return false;
+    }
+
+    FILE *fp = fopen(tmp.cstr, "wb");
+    bool ok = fp != NULL;
+    if (ok) ok = write_repo(fp, repo);
+    if (fp && fclose(fp) != 0) ok = false;
+    if (ok) ok = rename(tmp.cstr, path) == 0;
+    if (!ok) remove(tmp.cstr);
+    tinyc_string_free(&tmp);
+    return ok;
+}
+
+bool tinyc_repo_snapshot_load(
+    struct tinyc_repo_snapshot *this,
+    const char *path,
+    struct tinyc_repo *repo
+) {
+    this->map = NULL;
+    this->size = 0;
+    this->lines = NULL;
+    this->nsources = 0;
+    if (repo->next_id != 0) return false;
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    this->map = map;
+    this->size = st.st_size;
+
+    // On failure, sources already registered remain in repo, so they must
+    // not be used once snapshot is freed.
+    if (!read_repo(this, repo)) {
+        tinyc_repo_snapshot_free(this);
+        return false;
+    }
+    return true;
+}
+
+void tinyc_repo_snapshot_free(struct tinyc_repo_snapshot *this) {
+    for (size_t i = 0; i < this->nsources; ++i) tinyc_free(this->lines[i]);
+    tinyc_free(this->lines);
+    if (this->map) munmap(this->map, this->size);
+    this->map = NULL;
+    this->size = 0;
+    this->lines = NULL;
+    this->nsources = 0;
+}
@@ -0,0 +1,932 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "tinyc/session.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/ast.h"
+#include "tinyc/diag.h"
+#include "tinyc/diag_buffer.h"
+#include "tinyc/header_search.h"
+#include "tinyc/jit.h"
+#include "tinyc/lexer.h"
+#include "tinyc/map.h"
+#include "tinyc/parser.h"
+#include "tinyc/pool.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+#include "tinyc/token_cache.h"
+#include "tinyc/trace.h"
+
+// Maximum length of request line.
+#define MAX_REQUEST 4096
+
+// Initial capacity of superseded sources.
+#define DEFAULT_STALE_CAP 8
+
+static const struct tinyc_diag_kind invalid_encoding = {
+    TINYC_DIAG_WARN,
+    "invalid encoding",
+    "source is not encoded in UTF-8",
+};
+
+static const struct tinyc_diag_kind missing_header = {
+    TINYC_DIAG_ERROR,
+    "missing header",
+    "no such header found",
+};
+
+static const struct tinyc_diag_kind unreadable_header = {
+    TINYC_DIAG_ERROR,
+    "missing header",
+    "failed to read header %s",
+};
+
+static inline bool same_time(struct timespec a, struct timespec b) {
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+static uint64_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool read_source(const char *path, struct tinyc_source *source) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return false;
+    const bool ok = tinyc_source_from_fs(source, path, fp);
+    fclose(fp);
+    return ok;
+}
+
+/// Query source from repository of session.
+static const struct tinyc_source *query(
+    struct tinyc_session *this,
+    tinyc_repo_id id
+) {
+    pthread_mutex_lock(&this->lock);
+    const struct tinyc_source *source = tinyc_repo_query(&this->repo, id);
+    pthread_mutex_unlock(&this->lock);
+    return source;
+}
+
+/// Get entry of path, creating it if not exists. this->lock must be held.
+static struct tinyc_session_file *get_file(
+    struct tinyc_session *this,
+    const char *path
+) {
+    struct tinyc_string key;
+    tinyc_string_from(&key, (char *)path);
+    void *value;
+    if (tinyc_map_query(&this->files, &key, &value)) return value;
+
+    struct tinyc_session_file *file = tinyc_alloc(sizeof(*file));
+    if (!file || !tinyc_map_insert(&this->files, &key, file)) {
+        tinyc_free(file);
+        return NULL;
+    }
+    file->id = -1;
+    file->loading = false;
+    file->utf8 = true;
+    file->cost = (struct tinyc_session_cost){0, 0, 0, false, 0, 0};
+    return file;
+}
+
+/// Add cost of a visit to file at path.
+static void record(
+    struct tinyc_session *this,
+    const char *path,
+    uint64_t inclusive_ns,
+    uint64_t exclusive_ns
+) {
+    pthread_mutex_lock(&this->lock);
+    struct tinyc_session_file *file = get_file(this, path);
+    if (file) {
+        file->cost.inclusive_ns += inclusive_ns;
+        file->cost.exclusive_ns += exclusive_ns;
+    }
+    pthread_mutex_unlock(&this->lock);
+}
+
+/// Warn if source id of file at path isn't encoded in UTF-8.
+static void check_encoding(
+    struct tinyc_session *this,
+    tinyc_repo_id id,
+    const char *path,
+    struct tinyc_diag_buffer *diags
+) {
+    pthread_mutex_lock(&this->lock);
+    const struct tinyc_session_file *file = get_file(this, path);
+    const bool utf8 = !file || file->id != id || file->utf8;
+    const struct tinyc_position pos = utf8
+        ? (struct tinyc_position){0, 0}
+        : file->invalid;
+    pthread_mutex_unlock(&this->lock);
+    if (utf8) return;
+
+    const struct tinyc_span span = {id, pos, pos};
+    tinyc_diag_buffer_emit(diags, &invalid_encoding, &this->repo, &span);
+}
+
+/// Load includes of source recursively and record diagnostics into diags.
+/// visited holds already loaded paths. Add time spent on includes to
+/// elapsed.
+static bool load_includes(
+    struct tinyc_session *this,
+    tinyc_repo_id id,
+    const char *path,
+    struct tinyc_map *visited,
+    struct tinyc_diag_buffer *diags,
+    uint64_t *elapsed
+) {
+    struct tinyc_string name, base;
+    tinyc_string_from(&name, (char *)path);
+    if (!tinyc_header_search_dirname(&name, &base)) return false;
+
+    // Registered source is never modified, so it's read without lock.
+    bool ok = true;
+    size_t row = 0;
+    const struct tinyc_source *source = query(this, id);
+    for (const struct tinyc_source_line *line = source->lines; line;
+         line = line->next, ++row) {
+        bool is_std;
+        struct tinyc_string include;
+        const bool found = tinyc_header_search_parse_include(
+            &line->line,
+            &is_std,
+            &include
+        );
+        if (!found) continue;
+
+        pthread_mutex_lock(&this->lock);
+        const struct tinyc_string *resolved = tinyc_header_search_resolve(
+            &this->search,
+            base.cstr,
+            is_std,
+            &include
+        );
+        struct tinyc_session_file *file = resolved
+            ? get_file(this, resolved->cstr)
+            : NULL;
+        if (file) file->cost.includes++;
+        pthread_mutex_unlock(&this->lock);
+        tinyc_string_free(&include);
+        const struct tinyc_span span = {
+            id,
+            {row, 0},
+            {row, line->line.len - 1}
+        };
+        if (!resolved) {
+            tinyc_diag_buffer_emit(diags, &missing_header, &this->repo, &span);
+            ok = false;
+            continue;
+        }
+        if (tinyc_map_query(visited, resolved, NULL)) continue;
+        if (!tinyc_map_insert(visited, resolved, NULL)) {
+            ok = false;
+            break;
+        }
+
+        tinyc_trace_begin("include", resolved->cstr);
+        const uint64_t start = now();
+        uint64_t children = 0;
+        const tinyc_repo_id header = tinyc_session_load(this, resolved->cstr);
+        if (header < 0) {
+            tinyc_diag_buffer_emit(
+                diags,
+                &unreadable_header,
+                &this->repo,
+                &span,
+                resolved->cstr
+            );
+            ok = false;
+        } else {
+            check_encoding(this, header, resolved->cstr, diags);
+            const bool loaded = load_includes(
+                this,
+                header,
+                resolved->cstr,
+                visited,
+                diags,
+                &children
+            );
+            if (!loaded) ok = false;
+        }
+        const uint64_t inclusive = now() - start;
+        record(this, resolved->cstr, inclusive, inclusive - children);
+        *elapsed += inclusive;
+        tinyc_trace_end();
+    }
+    tinyc_string_free(&base);
+    return ok;
+}
+
+/// A file compiled by compile_file.
+struct job {
+    struct tinyc_session *session;
+    const char *path;
+    struct tinyc_diag_buffer diags;
+    bool readable;  // False if file itself can't be read.
+    bool ok;
+};
+
+static void compile(struct job *job) {
+    struct tinyc_session *this = job->session;
+    const uint64_t start = now();
+    const tinyc_repo_id id = tinyc_session_load(this, job->path);
+    job->readable = id >= 0;
+    job->ok = false;
+    if (!job->readable) return;
+    check_encoding(this, id, job->path, &job->diags);
+
+    struct tinyc_map visited;
+    struct tinyc_string name;
+    uint64_t children = 0;
+    tinyc_string_from(&name, (char *)job->path);
+    if (!tinyc_map_init(&visited)) return;
+    job->ok = tinyc_map_insert(&visited, &name, NULL) &&
+              load_includes(
+                  this,
+                  id,
+                  job->path,
+                  &visited,
+                  &job->diags,
+                  &children
+              );
+    tinyc_map_free(&visited);
+
+    const uint64_t inclusive = now() - start;
+    pthread_mutex_lock(&this->lock);
+    struct tinyc_session_file *file = get_file(this, job->path);
+    if (file) file->cost.includes++;
+    pthread_mutex_unlock(&this->lock);
+    record(this, job->path, inclusive, inclusive - children);
+}
+
+static void compile_file(void *arg) {
+    struct job *job = arg;
+    tinyc_trace_begin("compile", job->path);
+    compile(job);
+    tinyc_trace_end();
+}
+
+/// Write result of job to out, or json if set. Returns job->ok.
+static bool report(struct job *job, struct tinyc_diag_json *json, FILE *out) {
+    if (!job->readable) {
+        fprintf(out, "tinyc: error: failed to read %s\n", job->path);
+    }
+    if (json) {
+        tinyc_diag_buffer_merge_json(json, &job->diags, 1, false);
+    } else {
+        tinyc_diag_buffer_merge(out, &job->diags, 1, false);
+    }
+    return job->ok;
+}
+
+bool tinyc_session_init(struct tinyc_session *this) {
+    this->loaded = this->reused = this->prefetched = 0;
+    this->prefetching = false;
+    this->json = NULL;
+    this->token_cache = NULL;
+    this->active = 0;
+    this->stale = NULL;
+    this->stale_len = this->stale_cap = 0;
+    pthread_mutex_init(&this->lock, NULL);
+    pthread_cond_init(&this->ready, NULL);
+
+    // Session outlives allocator scoped to a request, and its worker threads
+    // don't see that allocator either.
+    const struct tinyc_allocator *scope = tinyc_allocator_scope(NULL);
+    const bool ok = tinyc_repo_init(&this->repo) &&
+                    tinyc_header_search_init(&this->search) &&
+                    tinyc_header_search_init(&this->prefetch_search) &&
+                    tinyc_map_init(&this->files);
+    tinyc_allocator_scope(scope);
+    return ok;
+}
+
+bool tinyc_session_add_dir(struct tinyc_session *this, const char *dir) {
+    const struct tinyc_allocator *scope = tinyc_allocator_scope(NULL);
+    pthread_mutex_lock(&this->lock);
+    const bool ok = tinyc_header_search_add_dir(&this->search, dir) &&
+                    tinyc_header_search_add_dir(&this->prefetch_search, dir);
+    pthread_mutex_unlock(&this->lock);
+    tinyc_allocator_scope(scope);
+    return ok;
+}
+
+bool tinyc_session_prefetch(struct tinyc_session *this, size_t nthreads) {
+    this->prefetching = true;
+    const struct tinyc_allocator *scope = tinyc_allocator_scope(NULL);
+    const bool ok = tinyc_prefetch_init(
+        &this->prefetch,
+        &this->prefetch_search,
+        nthreads
+    );
+    tinyc_allocator_scope(scope);
+    return ok;
+}
+
+/// Queue headers included from source at path to prefetcher.
+static void prefetch(
+    struct tinyc_session *this,
+    const struct tinyc_source *source,
+    const char *path
+) {
+    struct tinyc_string name, base;
+    tinyc_string_from(&name, (char *)path);
+    if (!tinyc_header_search_dirname(&name, &base)) return;
+    tinyc_prefetch_scan(&this->prefetch, source, base.cstr);
+    tinyc_string_free(&base);
+}
+
+/// Read file at path, taking it from prefetcher if it was read ahead and
+/// not modified since then. Set prefetched to true if so.
+static bool read_ahead(
+    struct tinyc_session *this,
+    const char *path,
+    const struct stat *st,
+    struct tinyc_source *source,
+    bool *prefetched
+) {
+    struct timespec mtime;
+    long long size;
+    *prefetched = false;
+    if (!this->prefetching) return read_source(path, source);
+    if (tinyc_prefetch_take_source(
+            &this->prefetch,
+            path,
+            source,
+            &mtime,
+            &size
+        )) {
+        if (same_time(mtime, st->st_mtim) && size == st->st_size) {
+            *prefetched = true;
+            return true;
+        }
+        tinyc_source_free(source);
+    }
+
+    // Headers of source read here are not queued yet.
+    if (!read_source(path, source)) return false;
+    prefetch(this, source, path);
+    return true;
+}
+
+/// Count tokens loaded from cache file at path. Lines are counted in source.
+/// Returns false if cache file can't be loaded.
+static bool count_cached(
+    const char *path,
+    uint64_t key,
+    const struct tinyc_source *source,
+    size_t *lines,
+    size_t *tokens
+) {
+    struct tinyc_token_cache cache;
+    struct tinyc_token *first;
+    if (!tinyc_token_cache_load(&cache, path, key, -1, &first)) return false;
+    for (const struct tinyc_source_line *line = source->lines; line;
+         line = line->next) {
+        ++*lines;
+    }
+    const struct tinyc_token *token = first;
+    if (token) {
+        do {
+            ++*tokens;
+            token = token->next;
+        } while (token != first);
+    }
+    tinyc_token_cache_free(&cache);
+    return true;
+}
+
+/// Count lines and tokens in source, whose content has key. If dir is not
+/// NULL, tokens are loaded from cache in dir, or saved into it once lexed.
+static void count(
+    const char *dir,
+    uint64_t key,
+    struct tinyc_source *source,
+    size_t *lines,
+    size_t *tokens
+) {
+    struct tinyc_string path;
+    const bool cached = dir && tinyc_token_cache_path(&path, dir, key);
+    *lines = *tokens = 0;
+    if (cached && count_cached(path.cstr, key, source, lines, tokens)) {
+        tinyc_string_free(&path);
+        return;
+    }
+
+    struct tinyc_lexer lexer;
+    if (!tinyc_lexer_init(&lexer, source, -1)) {
+        if (cached) tinyc_string_free(&path);
+        return;
+    }
+    *lines = lexer.len;
+    for (size_t row = 0; row < lexer.len; ++row) {
+        const struct tinyc_token *first = tinyc_lexer_tokens(&lexer, row);
+        const struct tinyc_token *token = first;
+        if (!token) continue;
+        do {
+            ++*tokens;
+            token = token->next;
+        } while (token != first);
+    }
+    if (cached) {
+        tinyc_token_cache_save_lexer(path.cstr, key, &lexer);
+        tinyc_string_free(&path);
+    }
+    tinyc_lexer_free(&lexer);
+}
+
+/// Release sources superseded while compiling. Called under lock.
+static void release_stale(struct tinyc_session *this) {
+    for (size_t i = 0; i < this->stale_len; ++i) {
+        struct tinyc_source source;
+        if (tinyc_repo_remove(&this->repo, this->stale[i], &source)) {
+            tinyc_source_free(&source);
+        }
+    }
+    this->stale_len = 0;
+}
+
+/// Release source of id replaced by a new one, or defer it until running
+/// compilations finish. Called under lock.
+static void supersede(struct tinyc_session *this, tinyc_repo_id id) {
+    if (this->active == 0) {
+        struct tinyc_source source;
+        if (tinyc_repo_remove(&this->repo, id, &source)) {
+            tinyc_source_free(&source);
+        }
+        return;
+    }
+    if (this->stale_len == this->stale_cap) {
+        const size_t new_cap =
+            this->stale_cap ? this->stale_cap * 2 : DEFAULT_STALE_CAP;
+        tinyc_repo_id *stale = tinyc_realloc(
+            this->stale,
+            sizeof(tinyc_repo_id) * new_cap
+        );
+        // Source is kept until session is freed.
+        if (!stale) return;
+        this->stale = stale;
+        this->stale_cap = new_cap;
+    }
+    this->stale[this->stale_len++] = id;
+}
+
+/// Mark compilation as running, so sources it uses are kept.
+static void begin(struct tinyc_session *this) {
+    pthread_mutex_lock(&this->lock);
+    this->active++;
+    pthread_mutex_unlock(&this->lock);
+}
+
+/// Mark compilation as finished, and release superseded sources if it's the
+/// last one.
+static void end(struct tinyc_session *this) {
+    pthread_mutex_lock(&this->lock);
+    if (--this->active == 0) release_stale(this);
+    pthread_mutex_unlock(&this->lock);
+}
+
+static tinyc_repo_id load(struct tinyc_session *this, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+
+    pthread_mutex_lock(&this->lock);
+    struct tinyc_session_file *file = get_file(this, path);
+    while (file && file->loading) pthread_cond_wait(&this->ready, &this->lock);
+    if (!file) {
+        pthread_mutex_unlock(&this->lock);
+        return -1;
+    }
+    if (file->id >= 0 && same_time(file->mtime, st.st_mtim) &&
+        file->size == st.st_size) {
+        this->reused++;
+        pthread_mutex_unlock(&this->lock);
+        return file->id;
+    }
+    file->loading = true;
+    pthread_mutex_unlock(&this->lock);
+
+    // Read file without lock, so other files can be loaded meanwhile.
+    struct tinyc_source source;
+    struct tinyc_position invalid = {0, 0};
+    bool prefetched;
+    const bool ok = read_ahead(this, path, &st, &source, &prefetched);
+    const uint64_t hash = ok ? tinyc_token_cache_key(&source) : 0;
+    const bool utf8 = !ok ||
+                      tinyc_source_validate(
+                          &source,
+                          &invalid.row,
+                          &invalid.offset
+                      );
+
+    pthread_mutex_lock(&this->lock);
+    tinyc_repo_id id = -1;
+    if (ok) {
+        this->loaded++;
+        if (prefetched) this->prefetched++;
+        if (file->id >= 0 && file->key == hash) {
+            // Only touched, keep old source.
+            tinyc_source_free(&source);
+            id = file->id;
+        } else {
+            id = tinyc_repo_registory(&this->repo, &source);
+            if (id < 0) tinyc_source_free(&source);
+        }
+    }
+    if (id >= 0) {
+        if (id != file->id) {
+            file->cost.counted = false;
+            if (file->id >= 0) supersede(this, file->id);
+        }
+        file->id = id;
+        file->mtime = st.st_mtim;
+        file->size = st.st_size;
+        file->key = hash;
+        file->utf8 = utf8;
+        file->invalid = invalid;
+    }
+    file->loading = false;
+    pthread_cond_broadcast(&this->ready);
+    pthread_mutex_unlock(&this->lock);
+    return id;
+}
+
+tinyc_repo_id tinyc_session_load(struct tinyc_session *this, const char *path) {
+    const struct tinyc_allocator *scope = tinyc_allocator_scope(NULL);
+    const tinyc_repo_id id = load(this, path);
+    tinyc_allocator_scope(scope);
+    return id;
+}
+
+bool tinyc_session_compile(
+    struct tinyc_session *this,
+    const char *path,
+    FILE *out
+) {
+    char *paths[] = {(char *)path};
+    return tinyc_session_compile_all(this, paths, 1, 1, out);
+}
+
+static bool compile_all(
+    struct tinyc_session *this,
+    char *const *paths,
+    size_t n,
+    size_t nthreads,
+    FILE *out
+) {
+    pthread_mutex_lock(&this->lock);
+    bool ok = tinyc_header_search_revalidate(&this->search);
+    pthread_mutex_unlock(&this->lock);
+    if (ok && this->prefetching) {
+        ok = tinyc_prefetch_revalidate(&this->prefetch);
+    }
+    if (!ok) return false;
+
+    struct job *jobs = tinyc_alloc(sizeof(struct job) * n);
+    if (!jobs) return false;
+    for (size_t i = 0; i < n; ++i) {
+        jobs[i].session = this;
+        jobs[i].path = paths[i];
+        jobs[i].readable = jobs[i].ok = false;
+        if (!tinyc_diag_buffer_init(&jobs[i].diags)) {
+            for (size_t j = 0; j < i; ++j) {
+                tinyc_diag_buffer_free(&jobs[j].diags);
+            }
+            tinyc_free(jobs);
+            return false;
+        }
+    }
+
+    // Files which couldn't be submitted to pool are compiled on this thread.
+    if (nthreads == 0) nthreads = tinyc_pool_ncpus();
+    if (nthreads > n) nthreads = n;
+    size_t submitted = 0;
+    struct tinyc_pool pool;
+    if (nthreads > 1 && tinyc_pool_init(&pool, nthreads)) {
+        while (submitted < n &&
+               tinyc_pool_submit(&pool, compile_file, &jobs[submitted])) {
+            submitted++;
+        }
+        tinyc_pool_wait(&pool);
+        tinyc_pool_free(&pool);
+    }
+    for (size_t i = submitted; i < n; ++i) compile_file(&jobs[i]);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (!report(&jobs[i], this->json, out)) ok = false;
+        tinyc_diag_buffer_free(&jobs[i].diags);
+    }
+    tinyc_free(jobs);
+    return ok;
+}
+
+bool tinyc_session_compile_all(
+    struct tinyc_session *this,
+    char *const *paths,
+    size_t n,
+    size_t nthreads,
+    FILE *out
+) {
+    const struct tinyc_allocator *scope = tinyc_allocator_scope(NULL);
+    begin(this);
+    const bool ok = compile_all(this, paths, n, nthreads, out);
+    end(this);
+    tinyc_allocator_scope(scope);
+    return ok;
+}
+
+static bool run(
+    struct tinyc_session *this,
+    const char *path,
+    int argc,
+    char **argv,
+    FILE *out,
+    int *status
+) {
+    const tinyc_repo_id id = load(this, path);
+    if (id < 0) {
+        fprintf(out, "tinyc: error: failed to read %s\n", path);
+        return false;
+    }
+
+    // Lexer doesn't modify source unless it's edited.
+    struct tinyc_source *source = (struct tinyc_source *)query(this, id);
+    struct tinyc_lexer lexer;
+    struct tinyc_ast ast;
+    struct tinyc_jit jit;
+    if (!tinyc_lexer_init(&lexer, source, id)) return false;
+    if (!tinyc_ast_init(&ast)) {
+        tinyc_lexer_free(&lexer);
+        return false;
+    }
+    if (!tinyc_jit_init(&jit)) {
+        tinyc_ast_free(&ast);
+        tinyc_lexer_free(&lexer);
+        return false;
+    }
+
+    struct tinyc_parse_error parse_error;
+    struct tinyc_jit_error jit_error;
+    bool ok = tinyc_parse(&ast, &lexer, &parse_error);
+    pthread_mutex_lock(&this->lock);
+    if (!ok) {
+        tinyc_diag_fs(
+            out,
+            TINYC_DIAG_ERROR,
+            &this->repo,
+            &parse_error.span,
+            "syntax error",
+            parse_error.message
+        );
+    } else if (!(ok = tinyc_jit_compile(&jit, &ast, &jit_error))) {
+        tinyc_diag_fs(
+            out,
+            TINYC_DIAG_ERROR,
+            &this->repo,
+            &jit_error.span,
+            "compile error",
+            jit_error.message
+        );
+    }
+    pthread_mutex_unlock(&this->lock);
+    if (ok && !tinyc_jit_run(&jit, argc, argv, status)) {
+        fprintf(out, "tinyc: error: %s doesn't define main\n", path);
+        ok = false;
+    }
+
+    tinyc_jit_free(&jit);
+    tinyc_ast_free(&ast);
+    tinyc_lexer_free(&lexer);
+    return ok;
+}
+
+bool tinyc_session_run(
+    struct tinyc_session *this,
+    const char *path,
+    int argc,
+    char **argv,
+    FILE *out,
+    int *status
+) {
+    const struct tinyc_allocator *scope = tinyc_allocator_scope(NULL);
+    begin(this);
+    const bool ok = run(this, path, argc, argv, out, status);
+    end(this);
+    tinyc_allocator_scope(scope);
+    return ok;
+}
+
+/// File in report.
+struct entry {
+    const char *path;
+    struct tinyc_session_file *file;
+};
+
+static int cmp_entry(const void *a, const void *b) {
+    const uint64_t x = ((const struct entry *)a)->file->cost.inclusive_ns;
+    const uint64_t y = ((const struct entry *)b)->file->cost.inclusive_ns;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static bool report_costs(
+    struct tinyc_session *this,
+    size_t limit,
+    FILE *out
+) {
+    pthread_mutex_lock(&this->lock);
+    struct entry *entries = tinyc_alloc(
+        sizeof(struct entry) * (this->files.len + 1)
+    );
+    if (!entries) {
+        pthread_mutex_unlock(&this->lock);
+        return false;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < this->files.cap; ++i) {
+        const struct tinyc_map_entry *e = &this->files.entries[i];
+        if (!e->used) continue;
+        entries[n++] = (struct entry){e->key.cstr, e->value};
+    }
+    qsort(entries, n, sizeof(struct entry), cmp_entry);
+
+    fprintf(
+        out,
+        "%12s %12s %8s %10s %8s %10s  %s\n",
+        "incl(us)",
+        "excl(us)",
+        "includes",
+        "bytes",
+        "lines",
+        "tokens",
+        "file"
+    );
+    for (size_t i = 0; i < n && i < limit; ++i) {
+        struct tinyc_session_file *file = entries[i].file;
+        struct tinyc_session_cost *cost = &file->cost;
+        if (file->id >= 0 && !cost->counted) {
+            // Lexer doesn't modify source unless it's edited.
+            struct tinyc_source *source =
+                (struct tinyc_source *)tinyc_repo_query(&this->repo, file->id);
+            count(
+                this->token_cache,
+                file->key,
+                source,
+                &cost->lines,
+                &cost->tokens
+            );
+            cost->counted = true;
+        }
+        fprintf(
+            out,
+            "%12llu %12llu %8zu %10lld %8zu %10zu  %s\n",
+            (unsigned long long)(cost->inclusive_ns / 1000),
+            (unsigned long long)(cost->exclusive_ns / 1000),
+            cost->includes,
+            file->id >= 0 ? file->size : 0,
+            cost->lines,
+            cost->tokens,
+            entries[i].path
+        );
+    }
+    pthread_mutex_unlock(&this->lock);
+    tinyc_free(entries);
+    return true;
+}
+
+bool tinyc_session_report(
+    struct tinyc_session *this,
+    size_t limit,
+    FILE *out
+) {
+    const struct tinyc_allocator *scope = tinyc_allocator_scope(NULL);
+    const bool ok = report_costs(this, limit, out);
+    tinyc_allocator_scope(scope);
+    return ok;
+}
+
+/// Read request line from connection. Returns false if connection is closed
+/// before newline or line is too long.
+static bool read_request(int fd, char *buf, size_t size) {
+    size_t len = 0;
+    while (len + 1 < size) {
+        const ssize_t n = read(fd, buf + len, 1);
+        if (n <= 0) return false;
+        if (buf[len] == '\n') {
+            buf[len] = '\0';
+            return true;
+        }
+        len++;
+    }
+    return false;
+}
+
+/// Handle a request. Set stop to true if shutdown is requested.
+static void handle(struct tinyc_session *this, int fd, bool *stop) {
+    char request[MAX_REQUEST];
+    FILE *out = fdopen(fd, "w");
+    if (!out) {
+        close(fd);
+        return;
+    }
+    if (!read_request(fd, request, sizeof(request))) {
+        fputs("error\n", out);
+    } else if (strcmp(request, "shutdown") == 0) {
+        *stop = true;
+        fputs("ok\n", out);
+    } else if (strncmp(request, "compile ", 8) == 0) {
+        const bool ok = tinyc_session_compile(this, request + 8, out);
+        fputs(ok ? "ok\n" : "error\n", out);
+    } else {
+        fputs("tinyc: error: unknown request\nerror\n", out);
+    }
+    fclose(out);
+}
+
+/// Remove socket at path left by server which is no longer running.
+/// Returns false if path exists and isn't such a socket.
+static bool remove_stale(const struct sockaddr_un *addr) {
+    struct stat st;
+    if (lstat(addr->sun_path, &st) != 0) return true;
+    if (!S_ISSOCK(st.st_mode)) return false;
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    const bool live =
+        connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) == 0;
+    close(fd);
+    return !live && unlink(addr->sun_path) == 0;
+}
+
+bool tinyc_session_serve(struct tinyc_session *this, const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return false;
+    strcpy(addr.sun_path, path);
+    if (!remove_stale(&addr)) return false;
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, 16) != 0) {
+        close(fd);
+        return false;
+    }
+
+    bool stop = false;
+    while (!stop) {
+        const int conn = accept(fd, NULL, NULL);
+        if (conn >= 0) handle(this, conn, &stop);
+    }
+    close(fd);
+    unlink(path);
+    return true;
+}
+
+void tinyc_session_free(struct tinyc_session *this) {
+    const struct tinyc_allocator *scope = tinyc_allocator_scope(NULL);
+    if (this->prefetching) tinyc_prefetch_free(&this->prefetch);
+    tinyc_header_search_free(&this->prefetch_search);
+    for (struct tinyc_repo_entry *it = this->repo.head; it; it = it->next) {
+        tinyc_source_free(&it->source);
+    }
+    tinyc_repo_free(&this->repo);
+    tinyc_header_search_free(&this->search);
+    for (size_t i = 0; i < this->files.cap; ++i) {
+        if (this->files.entries[i].used) {
+            tinyc_free(this->files.entries[i].value);
+        }
+    }
+    tinyc_map_free(&this->files);
+    tinyc_free(this->stale);
+    pthread_mutex_destroy(&this->lock);
+    pthread_cond_destroy(&this->ready);
+    tinyc_allocator_scope(scope);
+}
@@ -12,14 +12,18 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_SOURCE
+
 #include "tinyc/source.h"
 
 #include <stddef.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
+#include "tinyc/allocator.h"
 #include "tinyc/string.h"
+#include "tinyc/trace.h"
+#include "tinyc/utf8.h"
 
 /// Character reader read from either file stream or string.
 struct reader {
@@ -45,7 +49,9 @@ static inline struct tinyc_source_line *extract_line(
     struct reader *reader,
     char first
 ) {
-    struct tinyc_source_line *line = malloc(sizeof(struct tinyc_source_line));
+    struct tinyc_source_line *line = tinyc_alloc(
+        sizeof(struct tinyc_source_line)
+    );
     if (!line) return NULL;
     line->next = NULL;
     tinyc_string_init(&line->line);
@@ -70,10 +76,17 @@ static inline bool read_lines(
 ) {
     tinyc_string_from_copy(&this->name, name);
     struct tinyc_source_line *last_line = this->lines = NULL;
+    this->utf8 = true;
     char c;
     while ((c = read(reader)) != EOF) {
         struct tinyc_source_line *line = extract_line(reader, c);
         if (!line) return false;
+
+        // Line is validated while it's still in cache.
+        const struct tinyc_string *s = &line->line;
+        if (this->utf8 && tinyc_utf8_validate(s->cstr, s->len) != s->len) {
+            this->utf8 = false;
+        }
         if (last_line) {
             last_line->next = line;
             last_line = line;
@@ -99,7 +112,22 @@ bool tinyc_source_from_fs(
     FILE *fs
 ) {
     struct reader reader = {fs, NULL, 0, 0};
-    return read_lines(this, name, &reader);
+    tinyc_trace_begin("load", name);
+    const bool ok = read_lines(this, name, &reader);
+    tinyc_trace_end();
+    return ok;
+}
+
+void tinyc_source_free(struct tinyc_source *this) {
+    struct tinyc_source_line *line = this->lines;
+    while (line) {
+        struct tinyc_source_line *next = line->next;
+        tinyc_string_free(&line->line);
+        tinyc_free(line);
+        line = next;
+    }
+    this->lines = NULL;
+    tinyc_string_free(&this->name);
 }
 
 const struct tinyc_source_line *tinyc_source_at(
@@ -114,3 +142,239 @@ const struct tinyc_source_line *tinyc_source_at(
     }
     return line;
 }
+
+bool tinyc_source_validate(
+    const struct tinyc_source *this,
+    size_t *row,
+    size_t *offset
+) {
+    if (this->utf8) return true;
+    size_t n = 0;
+    for (const struct tinyc_source_line *line = this->lines; line;
+         line = line->next, ++n) {
+        const size_t valid = tinyc_utf8_validate(
+            line->line.cstr,
+            line->line.len
+        );
+        if (valid < line->line.len) {
+            *row = n;
+            *offset = valid;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool tinyc_source_index_init(
+    struct tinyc_source_index *this,
+    const struct tinyc_source *source
+) {
+    tinyc_trace_begin("index", source->name.cstr);
+    this->len = 0;
+    this->cap = 1;
+    for (struct tinyc_source_line *line = source->lines; line;
+         line = line->next) {
+        this->cap++;
+    }
+    this->lines = tinyc_alloc(sizeof(struct tinyc_source_line *) * this->cap);
+    if (this->lines) {
+        for (struct tinyc_source_line *line = source->lines; line;
+             line = line->next) {
+            this->lines[this->len++] = line;
+        }
+    }
+    tinyc_trace_end();
+    return this->lines;
+}
+
+void tinyc_source_index_free(struct tinyc_source_index *this) {
+    tinyc_free(this->lines);
+    this->lines = NULL;
+    this->len = this->cap = 0;
+}
+
+/// Make index be able to hold len lines.
+static bool reserve(struct tinyc_source_index *this, size_t len) {
+    if (len <= this->cap) return true;
+    const size_t cap = len > this->cap * 2 ? len : this->cap * 2;
+    struct tinyc_source_line **lines = tinyc_realloc(
+        this->lines,
+        sizeof(struct tinyc_source_line *) * cap
+    );
+    if (!lines) return false;
+    this->lines = lines;
+    this->cap = cap;
+    return true;
+}
+
+/// Replace removed entries from pos with inserted lines beginning at first.
+/// Index must have enough capacity.
+static void reindex(
+    struct tinyc_source_index *this,
+    size_t pos,
+    size_t removed,
+    struct tinyc_source_line *first,
+    size_t inserted
+) {
+    if (removed != inserted) {
+        memmove(
+            &this->lines[pos + inserted],
+            &this->lines[pos + removed],
+            sizeof(struct tinyc_source_line *) * (this->len - pos - removed)
+        );
+    }
+    for (size_t i = 0; i < inserted; ++i, first = first->next) {
+        this->lines[pos + i] = first;
+    }
+    this->len = this->len - removed + inserted;
+}
+
+/// Get line at row, from index if non-null.
+static struct tinyc_source_line *line_at(
+    struct tinyc_source *this,
+    const struct tinyc_source_index *index,
+    size_t row
+) {
+    if (index) return row < index->len ? index->lines[row] : NULL;
+    return (struct tinyc_source_line *)tinyc_source_at(this, row);
+}
+
+static struct tinyc_source_line *create_line(const char *s, size_t len) {
+    struct tinyc_source_line *line = tinyc_alloc(
+        sizeof(struct tinyc_source_line)
+    );
+    if (!line) return NULL;
+    line->next = NULL;
+    if (!tinyc_string_init(&line->line)) {
+        tinyc_free(line);
+        return NULL;
+    }
+    if (!tinyc_string_append(&line->line, s, len)) {
+        tinyc_string_free(&line->line);
+        tinyc_free(line);
+        return NULL;
+    }
+    return line;
+}
+
+/// Release line and its string.
+static void free_line(struct tinyc_source_line *line) {
+    tinyc_string_free(&line->line);
+    tinyc_free(line);
+}
+
+/// Release list of lines beginning at line.
+static void free_lines(struct tinyc_source_line *line) {
+    while (line) {
+        struct tinyc_source_line *next = line->next;
+        free_line(line);
+        line = next;
+    }
+}
+
+/// Create list of lines from s separated by '\n'.
+/// Set first and last line to head and tail, and number of lines to n.
+static bool split(
+    const char *s,
+    struct tinyc_source_line **head,
+    struct tinyc_source_line **tail,
+    size_t *n
+) {
+    *head = *tail = NULL;
+    *n = 0;
+    for (;;) {
+        const char *nl = strchr(s, '\n');
+        const size_t len = nl ? (size_t)(nl - s) : strlen(s);
+        struct tinyc_source_line *line = create_line(s, len);
+        if (!line) {
+            free_lines(*head);
+            return false;
+        }
+        if (*tail) {
+            (*tail)->next = line;
+        } else {
+            *head = line;
+        }
+        *tail = line;
+        ++*n;
+        if (!nl) return true;
+        s = nl + 1;
+    }
+}
+
+bool tinyc_source_edit(
+    struct tinyc_source *this,
+    struct tinyc_source_index *index,
+    size_t srow,
+    size_t soffset,
+    size_t erow,
+    size_t eoffset,
+    const char *text,
+    size_t *nlines
+) {
+    struct tinyc_source_line *first, *last;
+    size_t removed = erow - srow + 1;
+    if (!this->lines) {
+        if (srow || soffset || erow || eoffset) return false;
+        if (!(this->lines = create_line("", 0))) return false;
+        first = last = this->lines;
+        removed = 0;
+    } else {
+        first = line_at(this, index, srow);
+        last = line_at(this, index, erow);
+    }
+    if (!first || !last || srow > erow) return false;
+    if (soffset > first->line.len || eoffset > last->line.len) return false;
+    if (srow == erow && soffset > eoffset) return false;
+
+    // New content of lines from srow to erow.
+    struct tinyc_string content;
+    if (!tinyc_string_init(&content)) return false;
+    struct tinyc_source_line *head, *tail;
+    size_t n;
+    const bool ok = tinyc_string_append(&content, first->line.cstr, soffset) &&
+                    tinyc_string_append(&content, text, strlen(text)) &&
+                    tinyc_string_append(
+                        &content,
+                        last->line.cstr + eoffset,
+                        last->line.len - eoffset
+                    ) &&
+                    split(content.cstr, &head, &tail, &n);
+    if (ok && tinyc_utf8_validate(content.cstr, content.len) != content.len) {
+        this->utf8 = false;
+    }
+    tinyc_string_free(&content);
+    if (!ok) return false;
+    if (index && !reserve(index, index->len - removed + n)) {
+        free_lines(head);
+        return false;
+    }
+
+    // Drop lines after first until last.
+    struct tinyc_source_line *after = last->next;
+    if (first != last) {
+        struct tinyc_source_line *line = first->next;
+        for (;;) {
+            struct tinyc_source_line *next = line->next;
+            const bool end = line == last;
+            free_line(line);
+            if (end) break;
+            line = next;
+        }
+    }
+
+    // Keep first so that pointer to it remains valid, and replace its string.
+    tinyc_string_free(&first->line);
+    first->line = head->line;
+    first->next = head->next;
+    if (tail == head) {
+        first->next = after;
+    } else {
+        tail->next = after;
+    }
+    tinyc_free(head);
+
+    if (index) reindex(index, srow, removed, first, n);
+    *nlines = n;
+    return true;
+}
@@ -0,0 +1,114 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_SOURCE
+
+#include "tinyc/splice.h"
+
+#include "tinyc/allocator.h"
+#include "tinyc/source.h"
+#include "tinyc/span.h"
+#include "tinyc/string.h"
+
+/// Get length of line without carriage return at end, and whether it's
+/// followed by next line with backslash, which is excluded from length.
+static inline size_t content_len(const struct tinyc_string *line, bool *more) {
+    size_t len = line->len;
+    if (len && line->cstr[len - 1] == '\r') --len;
+    *more = len && line->cstr[len - 1] == '\\';
+    return *more ? len - 1 : len;
+}
+
+static bool push_point(struct tinyc_splice *this, size_t offset, size_t row) {
+    if (this->npoints == this->cap) {
+        const size_t cap = this->cap ? this->cap * 2 : 4;
+        struct tinyc_splice_point *points = tinyc_realloc(
+            this->points,
+            sizeof(struct tinyc_splice_point) * cap
+        );
+        if (!points) return false;
+        this->points = points;
+        this->cap = cap;
+    }
+    this->points[this->npoints++] = (struct tinyc_splice_point){offset, row};
+    return true;
+}
+
+void tinyc_splice_init(struct tinyc_splice *this) {
+    this->cstr = "";
+    this->len = this->row = this->nrows = 0;
+    this->buf.cap = this->buf.len = 0;
+    this->buf.cstr = NULL;
+    this->points = NULL;
+    this->npoints = this->cap = 0;
+}
+
+bool tinyc_splice_build(
+    struct tinyc_splice *this,
+    struct tinyc_source_line *const *lines,
+    size_t n,
+    size_t row
+) {
+    const struct tinyc_string *first = &lines[row]->line;
+    bool more;
+    size_t len = content_len(first, &more);
+    this->row = row;
+    this->nrows = 1;
+    this->npoints = 0;
+    if (len == first->len) {
+        this->cstr = first->cstr;
+        this->len = len;
+        return true;
+    }
+
+    if (this->buf.cap == 0 && !tinyc_string_init(&this->buf)) return false;
+    this->buf.len = 0;
+    if (!tinyc_string_append(&this->buf, first->cstr, len)) return false;
+    while (more && row + this->nrows < n) {
+        const size_t next = row + this->nrows++;
+        const struct tinyc_string *line = &lines[next]->line;
+        len = content_len(line, &more);
+        if (!push_point(this, this->buf.len, next)) return false;
+        if (!tinyc_string_append(&this->buf, line->cstr, len)) return false;
+    }
+    this->cstr = this->buf.cstr;
+    this->len = this->buf.len;
+    return true;
+}
+
+struct tinyc_position tinyc_splice_position(
+    const struct tinyc_splice *this,
+    size_t offset
+) {
+    // Find last point at or before offset.
+    size_t lo = 0, hi = this->npoints;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (this->points[mid].offset <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) return (struct tinyc_position){this->row, offset};
+    const struct tinyc_splice_point *point = &this->points[lo - 1];
+    return (struct tinyc_position){point->row, offset - point->offset};
+}
+
+void tinyc_splice_free(struct tinyc_splice *this) {
+    tinyc_string_free(&this->buf);
+    tinyc_free(this->points);
+    tinyc_splice_init(this);
+}
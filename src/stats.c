@@ -0,0 +1,138 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "tinyc/stats.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+static const char *const names[] = {
+    [TINYC_STATS_STRING] = "string",
+    [TINYC_STATS_SOURCE] = "source",
+    [TINYC_STATS_REPO] = "repo",
+    [TINYC_STATS_TOKEN] = "token",
+    [TINYC_STATS_DIAG] = "diag",
+    [TINYC_STATS_AST] = "ast",
+    [TINYC_STATS_OTHER] = "other",
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct tinyc_stats stats;
+static size_t live_bytes;  // Sum of live bytes of all subsystems.
+
+const char *tinyc_stats_subsystem_name(enum tinyc_stats_subsystem subsystem) {
+    return names[subsystem];
+}
+
+bool tinyc_stats_query(struct tinyc_stats *res) {
+#ifdef TINYC_STATS
+    pthread_mutex_lock(&lock);
+    *res = stats;
+    pthread_mutex_unlock(&lock);
+    return true;
+#else
+    (void)res;
+    return false;
+#endif
+}
+
+void tinyc_stats_reset(void) {
+    pthread_mutex_lock(&lock);
+    for (size_t i = 0; i < TINYC_STATS_COUNT; ++i) {
+        struct tinyc_stats_counter *counter = &stats.subsystems[i];
+        counter->allocs = counter->reallocs = counter->frees = 0;
+        counter->realloc_bytes = 0;
+        counter->peak_bytes = counter->live_bytes;
+    }
+    stats.peak_bytes = live_bytes;
+    pthread_mutex_unlock(&lock);
+}
+
+bool tinyc_stats_dump(FILE *fs) {
+    struct tinyc_stats res;
+    if (!tinyc_stats_query(&res)) return false;
+    fprintf(
+        fs,
+        "%-8s %10s %10s %10s %12s %12s %12s\n",
+        "",
+        "allocs",
+        "reallocs",
+        "frees",
+        "live",
+        "peak",
+        "realloc"
+    );
+    for (size_t i = 0; i < TINYC_STATS_COUNT; ++i) {
+        const struct tinyc_stats_counter *counter = &res.subsystems[i];
+        fprintf(
+            fs,
+            "%-8s %10zu %10zu %10zu %12zu %12zu %12zu\n",
+            names[i],
+            counter->allocs,
+            counter->reallocs,
+            counter->frees,
+            counter->live_bytes,
+            counter->peak_bytes,
+            counter->realloc_bytes
+        );
+    }
+    fprintf(fs, "peak total %zu bytes\n", res.peak_bytes);
+    return true;
+}
+
+/// Add delta to live bytes of counter and update peaks. lock must be held.
+static void grow(struct tinyc_stats_counter *counter, size_t delta) {
+    counter->live_bytes += delta;
+    if (counter->live_bytes > counter->peak_bytes) {
+        counter->peak_bytes = counter->live_bytes;
+    }
+    live_bytes += delta;
+    if (live_bytes > stats.peak_bytes) stats.peak_bytes = live_bytes;
+}
+
+void tinyc_stats_alloc(enum tinyc_stats_subsystem subsystem, size_t size) {
+    pthread_mutex_lock(&lock);
+    struct tinyc_stats_counter *counter = &stats.subsystems[subsystem];
+    counter->allocs++;
+    grow(counter, size);
+    pthread_mutex_unlock(&lock);
+}
+
+void tinyc_stats_realloc(
+    enum tinyc_stats_subsystem subsystem,
+    size_t old_size,
+    size_t size
+) {
+    pthread_mutex_lock(&lock);
+    struct tinyc_stats_counter *counter = &stats.subsystems[subsystem];
+    counter->reallocs++;
+    counter->realloc_bytes += size;
+    if (size >= old_size) {
+        grow(counter, size - old_size);
+    } else {
+        counter->live_bytes -= old_size - size;
+        live_bytes -= old_size - size;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void tinyc_stats_free(enum tinyc_stats_subsystem subsystem, size_t size) {
+    pthread_mutex_lock(&lock);
+    struct tinyc_stats_counter *counter = &stats.subsystems[subsystem];
+    counter->frees++;
+    counter->live_bytes -= size;
+    live_bytes -= size;
+    pthread_mutex_unlock(&lock);
+}
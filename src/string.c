@@ -12,11 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_STRING
+
 #include "tinyc/string.h"
 
-#include <stdlib.h>
 #include <string.h>
 
+#include "tinyc/allocator.h"
+
 #define DEFAULT_CAP 100
 
 static inline size_t min(size_t a, size_t b) {
@@ -27,21 +30,7 @@ static inline bool copy_alloc(struct tinyc_string *this) {
     const char *from = this->cstr;
     const size_t new_cap = this->len + 1 + DEFAULT_CAP;
 
-    char *new_cstr = malloc(sizeof(char) * new_cap);
-    if (!new_cstr) return false;
-
-    this->cstr = new_cstr;
-    this->cap = new_cap;
-
-    strcpy(this->cstr, from);
-    return true;
-}
-
-static inline bool extend(struct tinyc_string *this) {
-    const char *from = this->cstr;
-    const size_t new_cap = this->len + 1 + DEFAULT_CAP;
-
-    char *new_cstr = realloc(this->cstr, sizeof(char) * new_cap);
+    char *new_cstr = tinyc_alloc(sizeof(char) * new_cap);
     if (!new_cstr) return false;
 
     this->cstr = new_cstr;
@@ -59,7 +48,7 @@ static inline bool containable_len(size_t cap, size_t len) {
 bool tinyc_string_init(struct tinyc_string *this) {
     this->cap = DEFAULT_CAP;
     this->len = 0;
-    this->cstr = malloc(sizeof(char) * this->cap);
+    this->cstr = tinyc_alloc(sizeof(char) * this->cap);
     if (!this->cstr) return false;
     this->cstr[0] = '\0';
     return true;
@@ -75,20 +64,57 @@ bool tinyc_string_from(struct tinyc_string *this, char *from) {
 bool tinyc_string_from_copy(struct tinyc_string *this, const char *from) {
     this->len = strlen(from);
     this->cap = this->len + 1 + DEFAULT_CAP;
-    this->cstr = malloc(sizeof(char) * this->cap);
+    this->cstr = tinyc_alloc(sizeof(char) * this->cap);
     if (!this->cstr) return false;
     strncpy(this->cstr, from, this->cap);
     return true;
 }
 
-bool tinyc_string_push(struct tinyc_string *this, char c) {
+void tinyc_string_free(struct tinyc_string *this) {
+    if (this->cap != 0) tinyc_free(this->cstr);
+    this->cap = this->len = 0;
+    this->cstr = NULL;
+}
+
+/// Make string be able to hold n more characters without reallocation.
+static bool reserve(struct tinyc_string *this, size_t n) {
     if (this->cap == 0 && !copy_alloc(this)) return false;
-    if (!containable_len(this->cap, this->len) && !extend(this)) return false;
+    if (containable_len(this->cap, this->len + n)) return true;
+
+    size_t new_cap = this->cap * 2;
+    if (!containable_len(new_cap, this->len + n)) {
+        new_cap = this->len + n + 1 + DEFAULT_CAP;
+    }
+    char *new_cstr = tinyc_realloc(this->cstr, sizeof(char) * new_cap);
+    if (!new_cstr) return false;
+    this->cstr = new_cstr;
+    this->cap = new_cap;
+    return true;
+}
+
+bool tinyc_string_push(struct tinyc_string *this, char c) {
+    if (!reserve(this, 1)) return false;
     this->cstr[this->len++] = c;
     this->cstr[this->len] = '\0';
     return true;
 }
 
+bool tinyc_string_append(struct tinyc_string *this, const char *s, size_t n) {
+    if (!reserve(this, n)) return false;
+    memcpy(this->cstr + this->len, s, n);
+    this->len += n;
+    this->cstr[this->len] = '\0';
+    return true;
+}
+
+bool tinyc_string_fill(struct tinyc_string *this, char c, size_t n) {
+    if (!reserve(this, n)) return false;
+    memset(this->cstr + this->len, c, n);
+    this->len += n;
+    this->cstr[this->len] = '\0';
+    return true;
+}
+
 int tinyc_string_cmp(
     const struct tinyc_string *s1,
     const struct tinyc_string *s2
@@ -108,3 +134,13 @@ int tinyc_string_cmp(
         return 0;
     }
 }
+
+size_t tinyc_string_hash(const struct tinyc_string *this) {
+    // FNV-1a
+    size_t hash = (size_t)14695981039346656037ULL;
+    for (size_t i = 0; i < this->len; ++i) {
+        hash ^= (unsigned char)this->cstr[i];
+        hash *= (size_t)1099511628211ULL;
+    }
+    return hash;
+}
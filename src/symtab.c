@@ -0,0 +1,197 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "tinyc/symtab.h"
+
+#include <string.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/string.h"
+
+#define DEFAULT_CAP 64
+#define DEFAULT_SCOPES_CAP 16
+
+static inline uint32_t *find_slot(
+    const struct tinyc_symtab *this,
+    size_t hash,
+    enum tinyc_symtab_ns ns,
+    const struct tinyc_string *name
+) {
+    size_t i = hash & (this->cap - 1);
+    while (this->slots[i]) {
+        const struct tinyc_symtab_key *key = &this->keys[this->slots[i] - 1];
+        if (key->hash == hash && key->ns == ns && key->len == name->len &&
+            memcmp(this->names.cstr + key->name, name->cstr, name->len) == 0) {
+            break;
+        }
+        i = (i + 1) & (this->cap - 1);
+    }
+    return &this->slots[i];
+}
+
+static bool grow(struct tinyc_symtab *this) {
+    const size_t cap = this->cap * 2;
+    uint32_t *slots = tinyc_calloc(cap, sizeof(uint32_t));
+    if (!slots) return false;
+    for (size_t k = 0; k < this->nkeys; ++k) {
+        size_t i = this->keys[k].hash & (cap - 1);
+        while (slots[i]) i = (i + 1) & (cap - 1);
+        slots[i] = k + 1;
+    }
+    tinyc_free(this->slots);
+    this->slots = slots;
+    this->cap = cap;
+    return true;
+}
+
+/// Intern name in ns as new key.
+static bool add_key(
+    struct tinyc_symtab *this,
+    size_t hash,
+    enum tinyc_symtab_ns ns,
+    const struct tinyc_string *name
+) {
+    if (this->names.len > UINT32_MAX - name->len - 1) return false;
+    if (this->nkeys == this->keys_cap) {
+        const size_t cap = this->keys_cap * 2;
+        struct tinyc_symtab_key *keys = tinyc_realloc(
+            this->keys,
+            sizeof(struct tinyc_symtab_key) * cap
+        );
+        if (!keys) return false;
+        this->keys = keys;
+        this->keys_cap = cap;
+    }
+    struct tinyc_symtab_key *key = &this->keys[this->nkeys];
+    key->hash = hash;
+    key->name = this->names.len;
+    key->len = name->len;
+    key->ns = ns;
+    key->top = 0;
+    if (!tinyc_string_append(&this->names, name->cstr, name->len) ||
+        !tinyc_string_push(&this->names, '\0')) {
+        return false;
+    }
+    this->nkeys++;
+    return true;
+}
+
+bool tinyc_symtab_init(struct tinyc_symtab *this) {
+    this->cap = this->keys_cap = this->symbols_cap = DEFAULT_CAP;
+    this->scopes_cap = DEFAULT_SCOPES_CAP;
+    this->nkeys = this->len = this->depth = 0;
+    this->slots = tinyc_calloc(this->cap, sizeof(uint32_t));
+    this->keys = tinyc_alloc(sizeof(struct tinyc_symtab_key) * this->keys_cap);
+    this->symbols = tinyc_alloc(
+        sizeof(struct tinyc_symtab_symbol) * this->symbols_cap
+    );
+    this->scopes = tinyc_alloc(sizeof(size_t) * this->scopes_cap);
+    const bool ok = this->slots && this->keys && this->symbols &&
+                    this->scopes && tinyc_string_init(&this->names);
+    if (!ok) {
+        tinyc_free(this->slots);
+        tinyc_free(this->keys);
+        tinyc_free(this->symbols);
+        tinyc_free(this->scopes);
+    }
+    return ok;
+}
+
+bool tinyc_symtab_push(struct tinyc_symtab *this) {
+    if (this->depth == this->scopes_cap) {
+        const size_t cap = this->scopes_cap * 2;
+        size_t *scopes = tinyc_realloc(this->scopes, sizeof(size_t) * cap);
+        if (!scopes) return false;
+        this->scopes = scopes;
+        this->scopes_cap = cap;
+    }
+    this->scopes[this->depth++] = this->len;
+    return true;
+}
+
+void tinyc_symtab_pop(struct tinyc_symtab *this) {
+    if (this->depth == 0) return;
+    const size_t begin = this->scopes[--this->depth];
+    while (this->len > begin) {
+        const struct tinyc_symtab_symbol *symbol = &this->symbols[--this->len];
+        this->keys[symbol->key].top = symbol->shadowed;
+    }
+}
+
+bool tinyc_symtab_declare(
+    struct tinyc_symtab *this,
+    enum tinyc_symtab_ns ns,
+    const struct tinyc_string *name,
+    void *value
+) {
+    const size_t hash = tinyc_string_hash(name);
+    uint32_t *slot = find_slot(this, hash, ns, name);
+    if (!*slot) {
+        if ((this->nkeys + 1) * 4 > this->cap * 3) {
+            if (!grow(this)) return false;
+            slot = find_slot(this, hash, ns, name);
+        }
+        if (!add_key(this, hash, ns, name)) return false;
+        *slot = this->nkeys;
+    }
+
+    struct tinyc_symtab_key *key = &this->keys[*slot - 1];
+    if (key->top && this->symbols[key->top - 1].depth == this->depth) {
+        this->symbols[key->top - 1].value = value;
+        return true;
+    }
+    if (this->len >= UINT32_MAX) return false;
+    if (this->len == this->symbols_cap) {
+        const size_t cap = this->symbols_cap * 2;
+        struct tinyc_symtab_symbol *symbols = tinyc_realloc(
+            this->symbols,
+            sizeof(struct tinyc_symtab_symbol) * cap
+        );
+        if (!symbols) return false;
+        this->symbols = symbols;
+        this->symbols_cap = cap;
+    }
+    struct tinyc_symtab_symbol *symbol = &this->symbols[this->len++];
+    symbol->key = *slot - 1;
+    symbol->shadowed = key->top;
+    symbol->depth = this->depth;
+    symbol->value = value;
+    key->top = this->len;
+    return true;
+}
+
+const struct tinyc_symtab_symbol *tinyc_symtab_lookup(
+    const struct tinyc_symtab *this,
+    enum tinyc_symtab_ns ns,
+    const struct tinyc_string *name
+) {
+    const uint32_t *slot = find_slot(this, tinyc_string_hash(name), ns, name);
+    if (!*slot) return NULL;
+    const uint32_t top = this->keys[*slot - 1].top;
+    return top ? &this->symbols[top - 1] : NULL;
+}
+
+void tinyc_symtab_free(struct tinyc_symtab *this) {
+    tinyc_free(this->slots);
+    tinyc_free(this->keys);
+    tinyc_free(this->symbols);
+    tinyc_free(this->scopes);
+    tinyc_string_free(&this->names);
+    this->slots = NULL;
+    this->keys = NULL;
+    this->symbols = NULL;
+    this->scopes = NULL;
+    this->cap = this->nkeys = this->len = this->depth = 0;
+}
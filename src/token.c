@@ -12,9 +12,102 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_TOKEN
+
 #include "tinyc/token.h"
 
-#include <stdlib.h>
+#include "tinyc/allocator.h"
+
+static const char *const punct_spellings[] = {
+    [TINYC_TOKEN_PUNCT_LSQUARE] = "[",
+    [TINYC_TOKEN_PUNCT_RSQUARE] = "]",
+    [TINYC_TOKEN_PUNCT_LPAREN] = "(",
+    [TINYC_TOKEN_PUNCT_RPAREN] = ")",
+    [TINYC_TOKEN_PUNCT_LCURLY] = "{",
+    [TINYC_TOKEN_PUNCT_RCURLY] = "}",
+    [TINYC_TOKEN_PUNCT_DOT] = ".",
+    [TINYC_TOKEN_PUNCT_ARROW] = "->",
+    [TINYC_TOKEN_PUNCT_PPLUS] = "++",
+    [TINYC_TOKEN_PUNCT_MMINUS] = "--",
+    [TINYC_TOKEN_PUNCT_AMP] = "&",
+    [TINYC_TOKEN_PUNCT_STAR] = "*",
+    [TINYC_TOKEN_PUNCT_PLUS] = "+",
+    [TINYC_TOKEN_PUNCT_MINUS] = "-",
+    [TINYC_TOKEN_PUNCT_TILDE] = "~",
+    [TINYC_TOKEN_PUNCT_EXC] = "!",
+    [TINYC_TOKEN_PUNCT_SLASH] = "/",
+    [TINYC_TOKEN_PUNCT_PERCENT] = "%",
+    [TINYC_TOKEN_PUNCT_LSHIFT] = "<<",
+    [TINYC_TOKEN_PUNCT_RSHIFT] = ">>",
+    [TINYC_TOKEN_PUNCT_LT] = "<",
+    [TINYC_TOKEN_PUNCT_GT] = ">",
+    [TINYC_TOKEN_PUNCT_LE] = "<=",
+    [TINYC_TOKEN_PUNCT_GE] = ">=",
+    [TINYC_TOKEN_PUNCT_EQ] = "==",
+    [TINYC_TOKEN_PUNCT_NE] = "!=",
+    [TINYC_TOKEN_PUNCT_HAT] = "^",
+    [TINYC_TOKEN_PUNCT_VERT] = "|",
+    [TINYC_TOKEN_PUNCT_AAMP] = "&&",
+    [TINYC_TOKEN_PUNCT_VVERT] = "||",
+    [TINYC_TOKEN_PUNCT_QUESTION] = "?",
+    [TINYC_TOKEN_PUNCT_COLON] = ":",
+    [TINYC_TOKEN_PUNCT_SEMICOLON] = ";",
+    [TINYC_TOKEN_PUNCT_DDDOT] = "...",
+    [TINYC_TOKEN_PUNCT_ASSIGN] = "=",
+    [TINYC_TOKEN_PUNCT_STAR_A] = "*=",
+    [TINYC_TOKEN_PUNCT_SLASH_A] = "/=",
+    [TINYC_TOKEN_PUNCT_PERCENT_A] = "%=",
+    [TINYC_TOKEN_PUNCT_PLUS_A] = "+=",
+    [TINYC_TOKEN_PUNCT_MINUS_A] = "-=",
+    [TINYC_TOKEN_PUNCT_LSHIFT_A] = "<<=",
+    [TINYC_TOKEN_PUNCT_RSHIFT_A] = ">>=",
+    [TINYC_TOKEN_PUNCT_AMP_A] = "&=",
+    [TINYC_TOKEN_PUNCT_HAT_A] = "^=",
+    [TINYC_TOKEN_PUNCT_VERT_A] = "|=",
+    [TINYC_TOKEN_PUNCT_COMMA] = ",",
+    [TINYC_TOKEN_PUNCT_SHARP] = "#",
+    [TINYC_TOKEN_PUNCT_SSHARP] = "##",
+};
+
+static const char *const keyword_spellings[] = {
+    [TINYC_TOKEN_KEYWORD_AUTO] = "auto",
+    [TINYC_TOKEN_KEYWORD_BREAK] = "break",
+    [TINYC_TOKEN_KEYWORD_CASE] = "case",
+    [TINYC_TOKEN_KEYWORD_CHAR] = "char",
+    [TINYC_TOKEN_KEYWORD_CONST] = "const",
+    [TINYC_TOKEN_KEYWORD_CONTINUE] = "continue",
+    [TINYC_TOKEN_KEYWORD_DEFAULT] = "default",
+    [TINYC_TOKEN_KEYWORD_DO] = "do",
+    [TINYC_TOKEN_KEYWORD_DOUBLE] = "double",
+    [TINYC_TOKEN_KEYWORD_ELSE] = "else",
+    [TINYC_TOKEN_KEYWORD_ENUM] = "enum",
+    [TINYC_TOKEN_KEYWORD_EXTERN] = "extern",
+    [TINYC_TOKEN_KEYWORD_FLOAT] = "float",
+    [TINYC_TOKEN_KEYWORD_FOR] = "for",
+    [TINYC_TOKEN_KEYWORD_GOTO] = "goto",
+    [TINYC_TOKEN_KEYWORD_IF] = "if",
+    [TINYC_TOKEN_KEYWORD_INLINE] = "inline",
+    [TINYC_TOKEN_KEYWORD_INT] = "int",
+    [TINYC_TOKEN_KEYWORD_LONG] = "long",
+    [TINYC_TOKEN_KEYWORD_REGISTER] = "register",
+    [TINYC_TOKEN_KEYWORD_RESTRICT] = "restrict",
+    [TINYC_TOKEN_KEYWORD_RETURN] = "return",
+    [TINYC_TOKEN_KEYWORD_SHORT] = "short",
+    [TINYC_TOKEN_KEYWORD_SIGNED] = "signed",
+    [TINYC_TOKEN_KEYWORD_SIZEOF] = "sizeof",
+    [TINYC_TOKEN_KEYWORD_STATIC] = "static",
+    [TINYC_TOKEN_KEYWORD_STRUCT] = "struct",
+    [TINYC_TOKEN_KEYWORD_SWITCH] = "switch",
+    [TINYC_TOKEN_KEYWORD_TYPEDEF] = "typedef",
+    [TINYC_TOKEN_KEYWORD_UNION] = "union",
+    [TINYC_TOKEN_KEYWORD_UNSIGNED] = "unsigned",
+    [TINYC_TOKEN_KEYWORD_VOID] = "void",
+    [TINYC_TOKEN_KEYWORD_VOLATILE] = "volatile",
+    [TINYC_TOKEN_KEYWORD_WHILE] = "while",
+    [TINYC_TOKEN_KEYWORD__BOOL] = "_Bool",
+    [TINYC_TOKEN_KEYWORD__COMPLEX] = "_Complex",
+    [TINYC_TOKEN_KEYWORD__IMAGINARY] = "_Imaginary",
+};
 
 static void insert_between(
     struct tinyc_token *ld,
@@ -28,6 +121,14 @@ static void insert_between(
     rs->next = rd;
 }
 
+const char *tinyc_token_punct_spelling(enum tinyc_token_punct_kind kind) {
+    return punct_spellings[kind];
+}
+
+const char *tinyc_token_keyword_spelling(enum tinyc_token_keyword_kind kind) {
+    return keyword_spellings[kind];
+}
+
 struct tinyc_token *tinyc_token_insert(
     struct tinyc_token *it,
     struct tinyc_token *tokens
@@ -53,7 +154,9 @@ struct tinyc_token *tinyc_token_create_punct(
     const struct tinyc_span *span,
     enum tinyc_token_punct_kind kind
 ) {
-    struct tinyc_token_punct *tk = malloc(sizeof(struct tinyc_token_punct));
+    struct tinyc_token_punct *tk = tinyc_alloc(
+        sizeof(struct tinyc_token_punct)
+    );
     if (!tk) return NULL;
     tk->token.prev = tk->token.next = &tk->token;
     tk->token.span = *span;
@@ -66,7 +169,9 @@ struct tinyc_token *tinyc_token_create_ident(
     const struct tinyc_span *span,
     const struct tinyc_string *value
 ) {
-    struct tinyc_token_ident *tk = malloc(sizeof(struct tinyc_token_ident));
+    struct tinyc_token_ident *tk = tinyc_alloc(
+        sizeof(struct tinyc_token_ident)
+    );
     if (!tk) return NULL;
     tk->token.prev = tk->token.next = &tk->token;
     tk->token.span = *span;
@@ -79,7 +184,9 @@ struct tinyc_token *tinyc_token_create_keyword(
     const struct tinyc_span *span,
     enum tinyc_token_keyword_kind kind
 ) {
-    struct tinyc_token_keyword *tk = malloc(sizeof(struct tinyc_token_keyword));
+    struct tinyc_token_keyword *tk = tinyc_alloc(
+        sizeof(struct tinyc_token_keyword)
+    );
     if (!tk) return NULL;
     tk->token.prev = tk->token.next = &tk->token;
     tk->token.span = *span;
@@ -92,7 +199,9 @@ struct tinyc_token *tinyc_token_create_string(
     const struct tinyc_span *span,
     const struct tinyc_string *value
 ) {
-    struct tinyc_token_string *tk = malloc(sizeof(struct tinyc_token_string));
+    struct tinyc_token_string *tk = tinyc_alloc(
+        sizeof(struct tinyc_token_string)
+    );
     if (!tk) return NULL;
     tk->token.prev = tk->token.next = &tk->token;
     tk->token.span = *span;
@@ -101,11 +210,24 @@ struct tinyc_token *tinyc_token_create_string(
     return &tk->token;
 }
 
+struct tinyc_token *tinyc_token_create_char(
+    const struct tinyc_span *span,
+    const struct tinyc_string *value
+) {
+    struct tinyc_token_char *tk = tinyc_alloc(sizeof(struct tinyc_token_char));
+    if (!tk) return NULL;
+    tk->token.prev = tk->token.next = &tk->token;
+    tk->token.span = *span;
+    tk->token.kind = TINYC_TOKEN_CHAR;
+    tk->value = *value;
+    return &tk->token;
+}
+
 struct tinyc_token *tinyc_token_create_int(
     const struct tinyc_span *span,
     const struct tinyc_token_int_value *value
 ) {
-    struct tinyc_token_int *tk = malloc(sizeof(struct tinyc_token_int));
+    struct tinyc_token_int *tk = tinyc_alloc(sizeof(struct tinyc_token_int));
     if (!tk) return NULL;
     tk->token.prev = tk->token.next = &tk->token;
     tk->token.span = *span;
@@ -118,7 +240,9 @@ struct tinyc_token *tinyc_token_create_float(
     const struct tinyc_span *span,
     const struct tinyc_token_float_value *value
 ) {
-    struct tinyc_token_float *tk = malloc(sizeof(struct tinyc_token_float));
+    struct tinyc_token_float *tk = tinyc_alloc(
+        sizeof(struct tinyc_token_float)
+    );
     if (!tk) return NULL;
     tk->token.prev = tk->token.next = &tk->token;
     tk->token.span = *span;
@@ -131,7 +255,7 @@ struct tinyc_token *tinyc_token_create_pp_number(
     const struct tinyc_span *span,
     const struct tinyc_string *value
 ) {
-    struct tinyc_token_pp_number *tk = malloc(
+    struct tinyc_token_pp_number *tk = tinyc_alloc(
         sizeof(struct tinyc_token_pp_number)
     );
     if (!tk) return NULL;
@@ -147,7 +271,9 @@ struct tinyc_token *tinyc_token_create_header(
     bool is_std,
     const struct tinyc_string *path
 ) {
-    struct tinyc_token_header *tk = malloc(sizeof(struct tinyc_token_header));
+    struct tinyc_token_header *tk = tinyc_alloc(
+        sizeof(struct tinyc_token_header)
+    );
     if (!tk) return NULL;
     tk->token.prev = tk->token.next = &tk->token;
     tk->token.span = *span;
@@ -0,0 +1,541 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_TOKEN
+
+#include "tinyc/token_cache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/lexer.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+#define MAGIC "TKC\1"
+#define SUFFIX ".tok"
+
+struct header {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t ntokens;
+    uint64_t strings_size;  // Size of string table following records.
+};
+
+/// Token without links and repository id.
+struct record {
+    uint8_t kind;
+    uint8_t sub;  // Punctuation or keyword kind, or is_std of header.
+    uint16_t reserved;
+    uint32_t str;  // Offset of string value in string table.
+    uint32_t len;  // Length of string value.
+    uint32_t start_row, start_offset;
+    uint32_t end_row, end_offset;
+};
+
+/// Returns string value held by token, or NULL if it doesn't hold.
+static const struct tinyc_string *value_of(const struct tinyc_token *token) {
+    switch (token->kind) {
+        case TINYC_TOKEN_IDENT:
+            return &((const struct tinyc_token_ident *)token)->value;
+        case TINYC_TOKEN_STRING:
+            return &((const struct tinyc_token_string *)token)->value;
+        case TINYC_TOKEN_CHAR:
+            return &((const struct tinyc_token_char *)token)->value;
+        case TINYC_TOKEN_PP_NUMBER:
+            return &((const struct tinyc_token_pp_number *)token)->value;
+        case TINYC_TOKEN_HEADER:
+            return &((const struct tinyc_token_header *)token)->path;
+        default:
+            return NULL;
+    }
+}
+
+static uint8_t sub_of(const struct tinyc_token *token) {
+    switch (token->kind) {
+        case TINYC_TOKEN_PUNCT:
+            return ((const struct tinyc_token_punct *)token)->kind;
+        case TINYC_TOKEN_KEYWORD:
+            return ((const struct tinyc_token_keyword *)token)->kind;
+        case TINYC_TOKEN_HEADER:
+            return ((const struct tinyc_token_header *)token)->is_std;
+        default:
+            return 0;
+    }
+}
+
+static inline bool fits(size_t n) {
+    return n <= UINT32_MAX;
+}
+
+static bool encode(
+    const struct tinyc_token *token,
+    uint64_t str,
+    struct record *res
+) {
+    const struct tinyc_span *span = &token->span;
+    const struct tinyc_string *value = value_of(token);
+    if (!fits(str) || !fits(span->start.row) || !fits(span->start.offset) ||
+        !fits(span->end.row) || !fits(span->end.offset) ||
+        (value && !fits(value->len))) {
+        return false;
+    }
+    memset(res, 0, sizeof(*res));
+    res->kind = token->kind;
+    res->sub = sub_of(token);
+    res->str = str;
+    res->len = value ? value->len : 0;
+    res->start_row = span->start.row;
+    res->start_offset = span->start.offset;
+    res->end_row = span->end.row;
+    res->end_offset = span->end.offset;
+    return true;
+}
+
+/// Tokens to be saved, either from first to last, or all rows of lexer.
+struct stream {
+    const struct tinyc_token *first, *last;
+    struct tinyc_lexer *lexer;  // Walked instead of first and last if set.
+};
+
+/// Position in stream.
+struct cursor {
+    const struct stream *stream;
+    size_t row;                       // Next row of lexer.
+    const struct tinyc_token *last;   // Last token of current range.
+    const struct tinyc_token *token;  // Current token, or NULL at end.
+};
+
+/// Move cursor to first token of next row of lexer which has any.
+static void next_row(struct cursor *this) {
+    struct tinyc_lexer *lexer = this->stream->lexer;
+    this->token = NULL;
+    while (!this->token && this->row < lexer->len) {
+        this->token = tinyc_lexer_tokens(lexer, this->row++);
+    }
+    if (this->token) this->last = this->token->prev;
+}
+
+static void start(struct cursor *this, const struct stream *stream) {
+    this->stream = stream;
+    this->row = 0;
+    if (stream->lexer) {
+        next_row(this);
+    } else {
+        this->token = stream->first;
+        this->last = stream->last;
+    }
+}
+
+static void next(struct cursor *this) {
+    if (this->token != this->last) {
+        this->token = this->token->next;
+    } else if (this->stream->lexer) {
+        next_row(this);
+    } else {
+        this->token = NULL;
+    }
+}
+
+static bool write_tokens(FILE *fp, uint64_t key, const struct stream *stream) {
+    struct header header = {MAGIC, TINYC_TOKEN_CACHE_VERSION, key, 0, 0};
+    struct cursor c;
+    for (start(&c, stream); c.token; next(&c)) {
+        const struct tinyc_string *value = value_of(c.token);
+        header.ntokens++;
+        if (value) header.strings_size += value->len + 1;
+    }
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) return false;
+
+    uint64_t str = 0;
+    for (start(&c, stream); c.token; next(&c)) {
+        struct record record;
+        if (!encode(c.token, str, &record)) return false;
+        if (fwrite(&record, sizeof(record), 1, fp) != 1) return false;
+        if (value_of(c.token)) str += record.len + 1;
+    }
+
+    for (start(&c, stream); c.token; next(&c)) {
+        const struct tinyc_string *value = value_of(c.token);
+        if (value && fwrite(value->cstr, 1, value->len, fp) != value->len) {
+            return false;
+        }
+        if (value && fputc('\0', fp) == EOF) return false;
+    }
+    return true;
+}
+
+/// Returns true if record is valid in string table of size.
+static bool validate(
+    const struct record *record,
+    const char *strings,
+    uint64_t size
+) {
+    switch (record->kind) {
+        case TINYC_TOKEN_PUNCT:
+            return record->sub <= TINYC_TOKEN_PUNCT_SSHARP;
+        case TINYC_TOKEN_KEYWORD:
+            return record->sub <= TINYC_TOKEN_KEYWORD__IMAGINARY;
+        case TINYC_TOKEN_INT:
+        case TINYC_TOKEN_FLOAT:
+            return true;
+        case TINYC_TOKEN_IDENT:
+        case TINYC_TOKEN_STRING:
+        case TINYC_TOKEN_CHAR:
+        case TINYC_TOKEN_PP_NUMBER:
+        case TINYC_TOKEN_HEADER:
+            return (uint64_t)record->str + record->len < size &&
+                   strings[record->str + record->len] == '\0';
+        default:
+            return false;
+    }
+}
+
+/// Size of token of kind in block, rounded up so next token is aligned.
+static size_t size_of(uint8_t kind) {
+    size_t size;
+    switch (kind) {
+        case TINYC_TOKEN_PUNCT:
+            size = sizeof(struct tinyc_token_punct);
+            break;
+        case TINYC_TOKEN_KEYWORD:
+            size = sizeof(struct tinyc_token_keyword);
+            break;
+        case TINYC_TOKEN_INT:
+            size = sizeof(struct tinyc_token_int);
+            break;
+        case TINYC_TOKEN_FLOAT:
+            size = sizeof(struct tinyc_token_float);
+            break;
+        case TINYC_TOKEN_IDENT:
+            size = sizeof(struct tinyc_token_ident);
+            break;
+        case TINYC_TOKEN_STRING:
+            size = sizeof(struct tinyc_token_string);
+            break;
+        case TINYC_TOKEN_CHAR:
+            size = sizeof(struct tinyc_token_char);
+            break;
+        case TINYC_TOKEN_PP_NUMBER:
+            size = sizeof(struct tinyc_token_pp_number);
+            break;
+        default:  // TINYC_TOKEN_HEADER
+            size = sizeof(struct tinyc_token_header);
+            break;
+    }
+    const size_t align = sizeof(union {
+        void *p;
+        long long l;
+        double d;
+    });
+    return (size + align - 1) / align * align;
+}
+
+/// Construct token of record at token, which is zero filled.
+static void decode(
+    const struct record *record,
+    const char *strings,
+    tinyc_repo_id id,
+    struct tinyc_token *token
+) {
+    const struct tinyc_span span = {
+        id,
+        {record->start_row, record->start_offset},
+        {record->end_row,   record->end_offset  }
+    };
+    struct tinyc_string value;  // Static string in the mapping.
+    value.cap = 0;
+    value.len = record->len;
+    value.cstr = (char *)strings + record->str;
+    token->span = span;
+    token->kind = record->kind;
+    switch (record->kind) {
+        case TINYC_TOKEN_PUNCT:
+            ((struct tinyc_token_punct *)token)->kind = record->sub;
+            break;
+        case TINYC_TOKEN_KEYWORD:
+            ((struct tinyc_token_keyword *)token)->kind = record->sub;
+            break;
+        case TINYC_TOKEN_INT:
+        case TINYC_TOKEN_FLOAT:
+            break;
+        case TINYC_TOKEN_IDENT:
+            ((struct tinyc_token_ident *)token)->value = value;
+            break;
+        case TINYC_TOKEN_STRING:
+            ((struct tinyc_token_string *)token)->value = value;
+            break;
+        case TINYC_TOKEN_CHAR:
+            ((struct tinyc_token_char *)token)->value = value;
+            break;
+        case TINYC_TOKEN_PP_NUMBER:
+            ((struct tinyc_token_pp_number *)token)->value = value;
+            break;
+        default:  // TINYC_TOKEN_HEADER
+            ((struct tinyc_token_header *)token)->is_std = record->sub;
+            ((struct tinyc_token_header *)token)->path = value;
+            break;
+    }
+}
+
+/// Create tokens from mapped cache file in a single block, and set it to
+/// block.
+static bool read_tokens(
+    const char *map,
+    size_t size,
+    uint64_t key,
+    tinyc_repo_id id,
+    struct tinyc_token **tokens,
+    void **block
+) {
+    struct header header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, map, sizeof(header));
+    if (memcmp(header.magic, MAGIC, 4) != 0 ||
+        header.version != TINYC_TOKEN_CACHE_VERSION || header.key != key) {
+        return false;
+    }
+    const uint64_t body = size - sizeof(header);
+    if (header.ntokens > body / sizeof(struct record) ||
+        header.ntokens * sizeof(struct record) + header.strings_size != body) {
+        return false;
+    }
+
+    const struct record *records = (const void *)(map + sizeof(header));
+    const char *strings = (const char *)(records + header.ntokens);
+    size_t total = 0;
+    for (uint64_t i = 0; i < header.ntokens; ++i) {
+        if (!validate(&records[i], strings, header.strings_size)) return false;
+        total += size_of(records[i].kind);
+    }
+
+    *tokens = NULL;
+    *block = NULL;
+    if (header.ntokens == 0) return true;
+    char *at = tinyc_calloc(total, 1);
+    if (!at) return false;
+    *block = at;
+    for (uint64_t i = 0; i < header.ntokens; ++i) {
+        struct tinyc_token *token = (struct tinyc_token *)at;
+        decode(&records[i], strings, id, token);
+        token->prev = token->next = token;
+        if (*tokens) {
+            tinyc_token_insert((*tokens)->prev, token);
+        } else {
+            *tokens = token;
+        }
+        at += size_of(records[i].kind);
+    }
+    return true;
+}
+
+uint64_t tinyc_token_cache_key(const struct tinyc_source *source) {
+    // FNV-1a over version and lines separated by '\n'.
+    uint64_t hash = 14695981039346656037ULL;
+    hash ^= TINYC_TOKEN_CACHE_VERSION;
+    hash *= 1099511628211ULL;
+    for (const struct tinyc_source_line *line = source->lines; line;
+         line = line->next) {
+        for (size_t i = 0; i < line->line.len; ++i) {
+            hash ^= (unsigned char)line->line.cstr[i];
+            hash *= 1099511628211ULL;
+        }
+        hash ^= '\n';
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool tinyc_token_cache_path(
+    struct tinyc_string *res,
+    const char *dir,
+    uint64_t key
+) {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx" SUFFIX, (unsigned long long)key);
+    if (!tinyc_string_init(res)) return false;
+    if (!tinyc_string_append(res, dir, strlen(dir)) ||
+        !tinyc_string_append(res, name, strlen(name))) {
+        tinyc_string_free(res);
+        return false;
+    }
+    return true;
+}
+
+static bool save(const char *path, uint64_t key, const struct stream *stream) {
+    // Write to temporary file, so readers never see partially written file.
+    // Its name is unique, as other threads may save same key at once.
+    struct tinyc_string tmp;
+    const char suffix[] = ".XXXXXX";
+    if (!tinyc_string_from_copy(&tmp, path)) return false;
+    if (!tinyc_string_append(&tmp, suffix, strlen(suffix))) {
+        tinyc_string_free(&tmp);
+        return false;
+    }
+
+    const int fd = mkstemp(tmp.cstr);
+    if (fd < 0) {
+        tinyc_string_free(&tmp);
+        return false;
+    }
+    FILE *fp = fdopen(fd, "wb");
+    if (!fp) close(fd);
+    bool ok = fp != NULL;
+    if (ok) ok = write_tokens(fp, key, stream);
+    if (fp && fclose(fp) != 0) ok = false;
+    if (ok) ok = rename(tmp.cstr, path) == 0;
+    if (!ok) remove(tmp.cstr);
+    tinyc_string_free(&tmp);
+    return ok;
+}
+
+bool tinyc_token_cache_save(
+    const char *path,
+    uint64_t key,
+    const struct tinyc_token *first,
+    const struct tinyc_token *last
+) {
+    const struct stream stream = {first, last, NULL};
+    return save(path, key, &stream);
+}
+
+bool tinyc_token_cache_save_lexer(
+    const char *path,
+    uint64_t key,
+    struct tinyc_lexer *lexer
+) {
+    const struct stream stream = {NULL, NULL, lexer};
+    return save(path, key, &stream);
+}
+
+bool tinyc_token_cache_load(
+    struct tinyc_token_cache *this,
+    const char *path,
+    uint64_t key,
+    tinyc_repo_id id,
+    struct tinyc_token **tokens
+) {
+    this->map = this->tokens = NULL;
+    this->size = 0;
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (map == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    this->map = map;
+    this->size = st.st_size;
+
+    if (!read_tokens(map, this->size, key, id, tokens, &this->tokens)) {
+        tinyc_token_cache_free(this);
+        close(fd);
+        return false;
+    }
+    futimens(fd, NULL);  // Mark as recently used for eviction.
+    close(fd);
+    return true;
+}
+
+void tinyc_token_cache_free(struct tinyc_token_cache *this) {
+    if (this->map) munmap(this->map, this->size);
+    tinyc_free(this->tokens);
+    this->map = this->tokens = NULL;
+    this->size = 0;
+}
+
+struct cache_file {
+    char *path;
+    size_t size;
+    struct timespec used;
+};
+
+static int cmp_used(const void *lhs, const void *rhs) {
+    const struct cache_file *a = lhs, *b = rhs;
+    if (a->used.tv_sec != b->used.tv_sec) {
+        return a->used.tv_sec < b->used.tv_sec ? -1 : 1;
+    }
+    if (a->used.tv_nsec != b->used.tv_nsec) {
+        return a->used.tv_nsec < b->used.tv_nsec ? -1 : 1;
+    }
+    return strcmp(a->path, b->path);
+}
+
+static bool has_suffix(const char *name) {
+    const size_t len = strlen(name), n = strlen(SUFFIX);
+    return len > n && strcmp(name + len - n, SUFFIX) == 0;
+}
+
+bool tinyc_token_cache_evict(const char *dir, size_t max_size) {
+    DIR *d = opendir(dir);
+    if (!d) return false;
+
+    struct cache_file *files = NULL;
+    size_t len = 0, cap = 0, total = 0;
+    bool ok = true;
+    for (struct dirent *e = readdir(d); e && ok; e = readdir(d)) {
+        if (!has_suffix(e->d_name)) continue;
+        struct tinyc_string path;
+        if (!tinyc_string_from_copy(&path, dir) ||
+            !tinyc_string_push(&path, '/') ||
+            !tinyc_string_append(&path, e->d_name, strlen(e->d_name))) {
+            ok = false;
+            break;
+        }
+        struct stat st;
+        if (stat(path.cstr, &st) != 0 || !S_ISREG(st.st_mode)) {
+            tinyc_string_free(&path);
+            continue;
+        }
+        if (len == cap) {
+            const size_t new_cap = cap ? cap * 2 : 16;
+            void *new_files = tinyc_realloc(files, sizeof(*files) * new_cap);
+            if (!new_files) {
+                tinyc_string_free(&path);
+                ok = false;
+                break;
+            }
+            files = new_files;
+            cap = new_cap;
+        }
+        files[len++] = (struct cache_file){path.cstr, st.st_size, st.st_mtim};
+        total += st.st_size;
+    }
+    closedir(d);
+
+    if (ok) qsort(files, len, sizeof(*files), cmp_used);
+    for (size_t i = 0; i < len; ++i) {
+        if (ok && total > max_size && remove(files[i].path) == 0) {
+            total -= files[i].size;
+        }
+        tinyc_free(files[i].path);
+    }
+    tinyc_free(files);
+    return ok;
+}
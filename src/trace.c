@@ -0,0 +1,246 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "tinyc/trace.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Buffers are allocated by libc rather than tinyc_alloc, so that tracing
+// doesn't change allocations it observes.
+
+struct event {
+    uint64_t ns;       // Time from start of tracing.
+    const char *name;  // NULL if this is an end event.
+    char *detail;      // Owned, or NULL.
+};
+
+/// Events recorded by a thread. Kept while the thread lives, so that the
+/// thread can keep using it in later tracing.
+struct buffer {
+    size_t tid;
+    struct event *events;
+    size_t len, cap;
+    bool retired;         // True if thread has exited.
+    struct buffer *next;  // Next buffer in list of all buffers.
+};
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_key_t key;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static bool enabled;
+static uint64_t origin;
+static struct buffer *buffers;  // All buffers, guarded by lock.
+static size_t nbuffers;
+
+static uint64_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/// Mark buffer of exiting thread to be released at finish.
+static void retire(void *arg) {
+    struct buffer *buffer = arg;
+    pthread_mutex_lock(&lock);
+    buffer->retired = true;
+    pthread_mutex_unlock(&lock);
+}
+
+static void create_key(void) {
+    pthread_key_create(&key, retire);
+}
+
+/// Get buffer of this thread, creating if not exists.
+static struct buffer *get_buffer(void) {
+    struct buffer *buffer = pthread_getspecific(key);
+    if (buffer) return buffer;
+
+    buffer = malloc(sizeof(struct buffer));
+    if (!buffer) return NULL;
+    buffer->events = NULL;
+    buffer->len = buffer->cap = 0;
+    buffer->retired = false;
+    pthread_mutex_lock(&lock);
+    buffer->tid = ++nbuffers;
+    buffer->next = buffers;
+    buffers = buffer;
+    pthread_mutex_unlock(&lock);
+    pthread_setspecific(key, buffer);
+    return buffer;
+}
+
+static void record(const char *name, const char *detail) {
+    const uint64_t ns = now() - origin;
+    struct buffer *buffer = get_buffer();
+    if (!buffer) return;
+    if (buffer->len == buffer->cap) {
+        const size_t cap = buffer->cap ? buffer->cap * 2 : 256;
+        struct event *events = realloc(
+            buffer->events,
+            sizeof(struct event) * cap
+        );
+        if (!events) return;
+        buffer->events = events;
+        buffer->cap = cap;
+    }
+    struct event *event = &buffer->events[buffer->len++];
+    event->ns = ns;
+    event->name = name;
+    event->detail = NULL;
+    if (detail && (event->detail = malloc(strlen(detail) + 1))) {
+        strcpy(event->detail, detail);
+    }
+}
+
+bool tinyc_trace_start(void) {
+    pthread_once(&once, create_key);
+    if (enabled) return false;
+    origin = now();
+    enabled = true;
+    return true;
+}
+
+bool tinyc_trace_enabled(void) {
+    return enabled;
+}
+
+void tinyc_trace_begin(const char *name, const char *detail) {
+    if (enabled) record(name, detail);
+}
+
+void tinyc_trace_end(void) {
+    if (enabled) record(NULL, NULL);
+}
+
+/// Write s as JSON string.
+static void write_string(FILE *fs, const char *s) {
+    fputc('"', fs);
+    for (; *s; ++s) {
+        const unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', fs);
+            fputc(c, fs);
+        } else if (c < 0x20) {
+            fprintf(fs, "\\u%04x", c);
+        } else {
+            fputc(c, fs);
+        }
+    }
+    fputc('"', fs);
+}
+
+static void write_event(
+    FILE *fs,
+    const char *name,
+    char phase,
+    uint64_t ns,
+    size_t tid,
+    const char *detail,
+    bool *first
+) {
+    fputs(*first ? "\n" : ",\n", fs);
+    *first = false;
+    fprintf(
+        fs,
+        "{\"name\":\"%s\",\"cat\":\"tinyc\",\"ph\":\"%c\","
+        "\"ts\":%llu.%03u,\"pid\":1,\"tid\":%zu",
+        name,
+        phase,
+        (unsigned long long)(ns / 1000),
+        (unsigned)(ns % 1000),
+        tid
+    );
+    if (detail) {
+        fputs(",\"args\":{\"detail\":", fs);
+        write_string(fs, detail);
+        fputc('}', fs);
+    }
+    fputc('}', fs);
+}
+
+/// Write events of buffer. Phases not ended yet are ended at end.
+static bool write_events(
+    FILE *fs,
+    const struct buffer *buffer,
+    uint64_t end,
+    bool *first
+) {
+    // Stack of begin events to name end events.
+    const struct event **open = malloc(
+        sizeof(struct event *) * (buffer->len + 1)
+    );
+    if (!open) return false;
+    size_t depth = 0;
+    for (size_t i = 0; i < buffer->len; ++i) {
+        const struct event *event = &buffer->events[i];
+        if (event->name) {
+            open[depth++] = event;
+            write_event(
+                fs,
+                event->name,
+                'B',
+                event->ns,
+                buffer->tid,
+                event->detail,
+                first
+            );
+        } else if (depth) {
+            const char *name = open[--depth]->name;
+            write_event(fs, name, 'E', event->ns, buffer->tid, NULL, first);
+        }
+    }
+    while (depth) {
+        const char *name = open[--depth]->name;
+        write_event(fs, name, 'E', end, buffer->tid, NULL, first);
+    }
+    free(open);
+    return true;
+}
+
+bool tinyc_trace_finish(FILE *fs) {
+    if (!enabled) return false;
+    enabled = false;
+    const uint64_t end = now() - origin;
+
+    // Events are discarded, and buffers of exited threads are released.
+    pthread_mutex_lock(&lock);
+    bool ok = true, first = true;
+    fputs("{\"traceEvents\":[", fs);
+    for (struct buffer **it = &buffers; *it;) {
+        struct buffer *buffer = *it;
+        if (!write_events(fs, buffer, end, &first)) ok = false;
+        for (size_t i = 0; i < buffer->len; ++i) {
+            free(buffer->events[i].detail);
+        }
+        buffer->len = 0;
+        if (buffer->retired) {
+            *it = buffer->next;
+            free(buffer->events);
+            free(buffer);
+        } else {
+            it = &buffer->next;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fs);
+    return ok && !ferror(fs);
+}
@@ -0,0 +1,512 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#define TINYC_STATS_SUBSYSTEM TINYC_STATS_AST
+
+#include "tinyc/type.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/string.h"
+
+#define DEFAULT_CAP 256
+#define CHUNK_SIZE 16384
+
+struct tinyc_type_chunk {
+    struct tinyc_type_chunk *next;
+    size_t len, cap;  // In bytes.
+    void *data[];     // Aligned for any type in arena.
+};
+
+static const char *const kind_names[] = {
+    "void",
+    "_Bool",
+    "char",
+    "signed char",
+    "unsigned char",
+    "short",
+    "unsigned short",
+    "int",
+    "unsigned int",
+    "long",
+    "unsigned long",
+    "long long",
+    "unsigned long long",
+    "float",
+    "double",
+    "long double",
+    "pointer",
+    "array",
+    "function",
+    "struct",
+    "union",
+    "enum",
+};
+
+static const char *const qual_names[] = {
+    "const",
+    "volatile",
+    "restrict",
+};
+
+/// Allocate size bytes in arena.
+static void *allocate(struct tinyc_types *this, size_t size) {
+    size = (size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+    struct tinyc_type_chunk *chunk = this->chunks;
+    if (!chunk || chunk->cap - chunk->len < size) {
+        const size_t cap = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+        chunk = tinyc_alloc(sizeof(struct tinyc_type_chunk) + cap);
+        if (!chunk) return NULL;
+        chunk->next = this->chunks;
+        chunk->len = 0;
+        chunk->cap = cap;
+        this->chunks = chunk;
+    }
+    void *p = (char *)chunk->data + chunk->len;
+    chunk->len += size;
+    return p;
+}
+
+static inline size_t mix(size_t h, size_t x) {
+    return (h ^ x) * (size_t)0x100000001b3ULL;
+}
+
+/// Spread high bits into low bits used as index, as pointers are aligned.
+static inline size_t finish(size_t h) {
+    return h ^ (h >> (sizeof(size_t) * 4)) ^ (h >> 7);
+}
+
+static size_t hash_of(const struct tinyc_type *key) {
+    size_t h = mix(key->kind, key->flags);
+    h = mix(h, (size_t)(uintptr_t)key->unqual);
+    h = mix(h, (size_t)(uintptr_t)key->base);
+    h = mix(h, key->len);
+    if (key->kind == TINYC_TYPE_FUNCTION) {
+        for (size_t i = 0; i < key->len; ++i) {
+            h = mix(h, (size_t)(uintptr_t)key->params[i]);
+        }
+    }
+    return finish(h);
+}
+
+/// Returns true if type is the one key describes. Unqualified key has NULL
+/// as unqual.
+static bool same(const struct tinyc_type *type, const struct tinyc_type *key) {
+    if (type->hash != key->hash || type->kind != key->kind ||
+        type->flags != key->flags || type->base != key->base ||
+        type->len != key->len) {
+        return false;
+    }
+    if (type->unqual != (key->unqual ? key->unqual : type)) return false;
+    return key->kind != TINYC_TYPE_FUNCTION || key->len == 0 ||
+           memcmp(type->params, key->params, sizeof(*key->params) * key->len) ==
+               0;
+}
+
+static bool grow(struct tinyc_types *this) {
+    const size_t cap = this->cap * 2;
+    struct tinyc_type **table = tinyc_calloc(cap, sizeof(struct tinyc_type *));
+    if (!table) return false;
+    for (size_t i = 0; i < this->cap; ++i) {
+        struct tinyc_type *type = this->table[i];
+        if (!type) continue;
+        size_t j = type->hash & (cap - 1);
+        while (table[j]) j = (j + 1) & (cap - 1);
+        table[j] = type;
+    }
+    tinyc_free(this->table);
+    this->table = table;
+    this->cap = cap;
+    return true;
+}
+
+/// Get type described by key, creating it if not yet exists.
+static const struct tinyc_type *intern(
+    struct tinyc_types *this,
+    struct tinyc_type *key
+) {
+    key->hash = hash_of(key);
+    size_t i = key->hash & (this->cap - 1);
+    for (; this->table[i]; i = (i + 1) & (this->cap - 1)) {
+        if (same(this->table[i], key)) return this->table[i];
+    }
+    if ((this->len + 1) * 4 > this->cap * 3) {
+        if (!grow(this)) return NULL;
+        i = key->hash & (this->cap - 1);
+        while (this->table[i]) i = (i + 1) & (this->cap - 1);
+    }
+
+    struct tinyc_type *type = allocate(this, sizeof(struct tinyc_type));
+    if (!type) return NULL;
+    *type = *key;
+    if (!key->unqual) type->unqual = type;
+    if (key->kind == TINYC_TYPE_FUNCTION && key->len) {
+        const size_t size = sizeof(*key->params) * key->len;
+        const struct tinyc_type **params = allocate(this, size);
+        if (!params) return NULL;
+        memcpy(params, key->params, size);
+        type->params = params;
+    }
+    this->table[i] = type;
+    this->len++;
+    return type;
+}
+
+static void init_key(
+    struct tinyc_type *key,
+    enum tinyc_type_kind kind,
+    const struct tinyc_type *base,
+    size_t len
+) {
+    key->kind = kind;
+    key->flags = 0;
+    key->unqual = NULL;
+    key->base = base;
+    key->len = len;
+    key->params = NULL;
+}
+
+bool tinyc_types_init(struct tinyc_types *this) {
+    this->chunks = NULL;
+    this->len = this->ncomposites = 0;
+    this->cap = this->composites_cap = DEFAULT_CAP;
+    this->table = tinyc_calloc(this->cap, sizeof(struct tinyc_type *));
+    this->composites = tinyc_calloc(
+        this->composites_cap,
+        sizeof(struct tinyc_type_composite)
+    );
+    if (!this->table || !this->composites) {
+        tinyc_free(this->table);
+        tinyc_free(this->composites);
+        return false;
+    }
+    for (int kind = TINYC_TYPE_VOID; kind <= TINYC_TYPE_LDOUBLE; ++kind) {
+        struct tinyc_type key;
+        init_key(&key, kind, NULL, 0);
+        this->basic[kind] = intern(this, &key);
+        if (!this->basic[kind]) {
+            tinyc_types_free(this);
+            return false;
+        }
+    }
+    return true;
+}
+
+const struct tinyc_type *tinyc_type_basic(
+    const struct tinyc_types *this,
+    enum tinyc_type_kind kind
+) {
+    return this->basic[kind];
+}
+
+const struct tinyc_type *tinyc_type_qualified(
+    struct tinyc_types *this,
+    const struct tinyc_type *type,
+    uint32_t quals
+) {
+    // Qualifiers of array apply to its element.
+    if (type->kind == TINYC_TYPE_ARRAY) {
+        const struct tinyc_type *element = tinyc_type_qualified(
+            this,
+            type->base,
+            quals
+        );
+        return element ? tinyc_type_array(this, element, type->len) : NULL;
+    }
+
+    quals = (type->flags | quals) & TINYC_TYPE_QUALS;
+    if (quals == (type->flags & TINYC_TYPE_QUALS)) return type;
+    struct tinyc_type key = *type->unqual;
+    key.flags |= quals;
+    return intern(this, &key);
+}
+
+const struct tinyc_type *tinyc_type_pointer(
+    struct tinyc_types *this,
+    const struct tinyc_type *base
+) {
+    struct tinyc_type key;
+    init_key(&key, TINYC_TYPE_POINTER, base, 0);
+    return intern(this, &key);
+}
+
+const struct tinyc_type *tinyc_type_array(
+    struct tinyc_types *this,
+    const struct tinyc_type *element,
+    size_t len
+) {
+    struct tinyc_type key;
+    init_key(&key, TINYC_TYPE_ARRAY, element, len);
+    return intern(this, &key);
+}
+
+const struct tinyc_type *tinyc_type_function(
+    struct tinyc_types *this,
+    const struct tinyc_type *ret,
+    const struct tinyc_type *const *params,
+    size_t n,
+    uint32_t flags
+) {
+    struct tinyc_type key;
+    init_key(&key, TINYC_TYPE_FUNCTION, ret, n);
+    key.flags = flags & (TINYC_TYPE_PROTOTYPE | TINYC_TYPE_VARIADIC);
+    key.params = params;
+    return intern(this, &key);
+}
+
+const struct tinyc_type *tinyc_type_record(
+    struct tinyc_types *this,
+    enum tinyc_type_kind kind
+) {
+    struct tinyc_type *type = allocate(this, sizeof(struct tinyc_type));
+    if (!type) return NULL;
+    init_key(type, kind, NULL, 0);
+    type->unqual = type;
+    type->hash = finish(mix(kind, (size_t)(uintptr_t)type));
+    return type;
+}
+
+static struct tinyc_type_composite *find_composite(
+    struct tinyc_type_composite *composites,
+    size_t cap,
+    const struct tinyc_type *a,
+    const struct tinyc_type *b
+) {
+    size_t i = finish(mix(a->hash, b->hash)) & (cap - 1);
+    while (composites[i].a && (composites[i].a != a || composites[i].b != b)) {
+        i = (i + 1) & (cap - 1);
+    }
+    return &composites[i];
+}
+
+static bool cache_composite(
+    struct tinyc_types *this,
+    const struct tinyc_type *a,
+    const struct tinyc_type *b,
+    const struct tinyc_type *res
+) {
+    if ((this->ncomposites + 1) * 4 > this->composites_cap * 3) {
+        const size_t cap = this->composites_cap * 2;
+        struct tinyc_type_composite *composites = tinyc_calloc(
+            cap,
+            sizeof(struct tinyc_type_composite)
+        );
+        if (!composites) return false;
+        for (size_t i = 0; i < this->composites_cap; ++i) {
+            const struct tinyc_type_composite *e = &this->composites[i];
+            if (e->a) *find_composite(composites, cap, e->a, e->b) = *e;
+        }
+        tinyc_free(this->composites);
+        this->composites = composites;
+        this->composites_cap = cap;
+    }
+    struct tinyc_type_composite *e = find_composite(
+        this->composites,
+        this->composites_cap,
+        a,
+        b
+    );
+    e->a = a;
+    e->b = b;
+    e->res = res;
+    this->ncomposites++;
+    return true;
+}
+
+/// Get composite of functions a and b, whose return types have composite
+/// ret. Default argument promotions of parameters are not checked yet.
+static bool composite_function(
+    struct tinyc_types *this,
+    const struct tinyc_type *a,
+    const struct tinyc_type *b,
+    const struct tinyc_type *ret,
+    const struct tinyc_type **res
+) {
+    if (!(b->flags & TINYC_TYPE_PROTOTYPE)) {
+        const struct tinyc_type *tmp = a;
+        a = b;
+        b = tmp;
+    }
+    if (!(a->flags & TINYC_TYPE_PROTOTYPE)) {
+        // Ellipsis never matches parameters of unprototyped one (6.7.5.3p15).
+        if (b->flags & TINYC_TYPE_VARIADIC) {
+            *res = NULL;
+            return true;
+        }
+        *res = tinyc_type_function(this, ret, b->params, b->len, b->flags);
+        return *res != NULL;
+    }
+    *res = NULL;
+    if (a->len != b->len || a->flags != b->flags) return true;
+
+    const struct tinyc_type **params = tinyc_alloc(
+        sizeof(struct tinyc_type *) * (a->len ? a->len : 1)
+    );
+    if (!params) return false;
+    bool ok = true;
+    for (size_t i = 0; ok && i < a->len; ++i) {
+        ok = tinyc_type_composite(
+            this,
+            a->params[i]->unqual,
+            b->params[i]->unqual,
+            &params[i]
+        );
+        if (ok && !params[i]) {
+            tinyc_free(params);
+            return true;
+        }
+    }
+    if (ok) {
+        *res = tinyc_type_function(this, ret, params, a->len, a->flags);
+        ok = *res != NULL;
+    }
+    tinyc_free(params);
+    return ok;
+}
+
+/// Get composite of a and b, which have the same kind and qualifiers.
+static bool composite(
+    struct tinyc_types *this,
+    const struct tinyc_type *a,
+    const struct tinyc_type *b,
+    const struct tinyc_type **res
+) {
+    const struct tinyc_type *base;
+    if (a->flags & TINYC_TYPE_QUALS) {
+        if (!tinyc_type_composite(this, a->unqual, b->unqual, &base)) {
+            return false;
+        }
+        *res = base ? tinyc_type_qualified(this, base, a->flags) : NULL;
+        return !base || *res;
+    }
+
+    *res = NULL;
+    if (a->kind != TINYC_TYPE_POINTER && a->kind != TINYC_TYPE_ARRAY &&
+        a->kind != TINYC_TYPE_FUNCTION) {
+        return true;
+    }
+    if (!tinyc_type_composite(this, a->base, b->base, &base)) return false;
+    if (!base) return true;
+    switch (a->kind) {
+        case TINYC_TYPE_POINTER:
+            *res = tinyc_type_pointer(this, base);
+            return *res != NULL;
+        case TINYC_TYPE_ARRAY:
+            if (a->len != TINYC_TYPE_UNKNOWN_LEN &&
+                b->len != TINYC_TYPE_UNKNOWN_LEN && a->len != b->len) {
+                return true;
+            }
+            *res = tinyc_type_array(
+                this,
+                base,
+                a->len != TINYC_TYPE_UNKNOWN_LEN ? a->len : b->len
+            );
+            return *res != NULL;
+        default:
+            return composite_function(this, a, b, base, res);
+    }
+}
+
+bool tinyc_type_composite(
+    struct tinyc_types *this,
+    const struct tinyc_type *a,
+    const struct tinyc_type *b,
+    const struct tinyc_type **res
+) {
+    *res = a;
+    if (a == b) return true;
+    *res = NULL;
+    if (a->kind != b->kind ||
+        (a->flags & TINYC_TYPE_QUALS) != (b->flags & TINYC_TYPE_QUALS)) {
+        return true;
+    }
+
+    // Order pair so that cache is shared by both orders.
+    if ((uintptr_t)a > (uintptr_t)b) {
+        const struct tinyc_type *tmp = a;
+        a = b;
+        b = tmp;
+    }
+    const struct tinyc_type_composite *e = find_composite(
+        this->composites,
+        this->composites_cap,
+        a,
+        b
+    );
+    if (e->a) {
+        *res = e->res;
+        return true;
+    }
+    return composite(this, a, b, res) && cache_composite(this, a, b, *res);
+}
+
+static void put(struct tinyc_string *out, const char *s, bool *ok) {
+    if (*ok) *ok = tinyc_string_append(out, s, strlen(s));
+}
+
+static void dump(
+    const struct tinyc_type *type,
+    struct tinyc_string *out,
+    bool *ok
+) {
+    const bool derived = type->kind >= TINYC_TYPE_POINTER;
+    const bool paren = derived || (type->flags & TINYC_TYPE_QUALS);
+    if (paren) put(out, "(", ok);
+    for (size_t i = 0; i < sizeof(qual_names) / sizeof(*qual_names); ++i) {
+        if (!(type->flags & (1u << i))) continue;
+        put(out, qual_names[i], ok);
+        put(out, " ", ok);
+    }
+    put(out, kind_names[type->kind], ok);
+    if (type->base) {
+        put(out, " ", ok);
+        dump(type->base, out, ok);
+    }
+    if (type->kind == TINYC_TYPE_ARRAY && type->len != TINYC_TYPE_UNKNOWN_LEN) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), " %zu", type->len);
+        put(out, buf, ok);
+    } else if (type->kind == TINYC_TYPE_FUNCTION) {
+        for (size_t i = 0; i < type->len; ++i) {
+            put(out, " ", ok);
+            dump(type->params[i], out, ok);
+        }
+        if (type->flags & TINYC_TYPE_VARIADIC) put(out, " ...", ok);
+        if (!(type->flags & TINYC_TYPE_PROTOTYPE)) put(out, " ?", ok);
+    }
+    if (paren) put(out, ")", ok);
+}
+
+bool tinyc_type_dump(const struct tinyc_type *type, struct tinyc_string *out) {
+    bool ok = true;
+    dump(type, out, &ok);
+    return ok;
+}
+
+void tinyc_types_free(struct tinyc_types *this) {
+    for (struct tinyc_type_chunk *chunk = this->chunks; chunk;) {
+        struct tinyc_type_chunk *next = chunk->next;
+        tinyc_free(chunk);
+        chunk = next;
+    }
+    tinyc_free(this->table);
+    tinyc_free(this->composites);
+    this->chunks = NULL;
+    this->table = NULL;
+    this->composites = NULL;
+    this->len = this->cap = this->ncomposites = this->composites_cap = 0;
+}
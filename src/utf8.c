@@ -0,0 +1,161 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "tinyc/utf8.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// Get length of longest prefix of s which contains only ASCII characters.
+static size_t ascii_prefix(const unsigned char *s, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        if (_mm_movemask_epi8(v)) break;
+    }
+#endif
+    for (; i + 8 <= n; i += 8) {
+        uint64_t v;
+        memcpy(&v, s + i, sizeof(v));
+        if (v & 0x8080808080808080ULL) break;
+    }
+    while (i < n && s[i] < 0x80) ++i;
+    return i;
+}
+
+/// Get length of character encoded at s, or 0 if it's invalid.
+/// Overlong forms, surrogates and code points above U+10FFFF are invalid.
+static size_t sequence(const unsigned char *s, size_t n) {
+    const unsigned char c = s[0];
+    unsigned char lo = 0x80, hi = 0xbf;  // Range of second byte.
+    size_t len;
+    if (c < 0x80) {
+        return 1;
+    } else if (0xc2 <= c && c <= 0xdf) {
+        len = 2;
+    } else if (0xe0 <= c && c <= 0xef) {
+        len = 3;
+        if (c == 0xe0) lo = 0xa0;
+        if (c == 0xed) hi = 0x9f;
+    } else if (0xf0 <= c && c <= 0xf4) {
+        len = 4;
+        if (c == 0xf0) lo = 0x90;
+        if (c == 0xf4) hi = 0x8f;
+    } else {
+        return 0;
+    }
+
+    if (n < len || s[1] < lo || hi < s[1]) return 0;
+    for (size_t i = 2; i < len; ++i) {
+        if ((s[i] & 0xc0) != 0x80) return 0;
+    }
+    return len;
+}
+
+static uint32_t decode(const unsigned char *s, size_t len) {
+    static const unsigned char masks[] = {0, 0x7f, 0x1f, 0x0f, 0x07};
+    uint32_t c = s[0] & masks[len];
+    for (size_t i = 1; i < len; ++i) c = c << 6 | (s[i] & 0x3f);
+    return c;
+}
+
+/// Get number of columns character c takes in terminal.
+static size_t width(uint32_t c) {
+    static const uint32_t zero[][2] = {
+        {0x0300, 0x036f},
+        {0x200b, 0x200f},
+        {0xfe00, 0xfe0f},
+    };
+    static const uint32_t wide[][2] = {
+        {0x1100,  0x115f },
+        {0x2e80,  0x303e },
+        {0x3041,  0x33ff },
+        {0x3400,  0x4dbf },
+        {0x4e00,  0x9fff },
+        {0xa000,  0xa4cf },
+        {0xac00,  0xd7a3 },
+        {0xf900,  0xfaff },
+        {0xfe30,  0xfe4f },
+        {0xff00,  0xff60 },
+        {0xffe0,  0xffe6 },
+        {0x1f300, 0x1f64f},
+        {0x1f900, 0x1f9ff},
+        {0x20000, 0x3fffd},
+    };
+    if (c < 0x0300) return 1;
+    for (size_t i = 0; i < sizeof(zero) / sizeof(*zero); ++i) {
+        if (zero[i][0] <= c && c <= zero[i][1]) return 0;
+    }
+    for (size_t i = 0; i < sizeof(wide) / sizeof(*wide); ++i) {
+        if (wide[i][0] <= c && c <= wide[i][1]) return 2;
+    }
+    return 1;
+}
+
+size_t tinyc_utf8_validate(const char *s, size_t n) {
+    const unsigned char *u = (const unsigned char *)s;
+    size_t i = 0;
+    for (;;) {
+        i += ascii_prefix(u + i, n - i);
+        if (i == n) return n;
+        const size_t len = sequence(u + i, n - i);
+        if (len == 0) return i;
+        i += len;
+    }
+}
+
+size_t tinyc_utf8_advance(
+    const char *s,
+    size_t n,
+    size_t *offset,
+    size_t column
+) {
+    const unsigned char *u = (const unsigned char *)s + *offset;
+    if (*offset >= n) {
+        ++*offset;
+        return column + 1;
+    }
+    if (*u == '\t') {
+        ++*offset;
+        return (column / TINYC_UTF8_TAB_WIDTH + 1) * TINYC_UTF8_TAB_WIDTH;
+    }
+
+    const size_t len = sequence(u, n - *offset);
+    if (len <= 1) {
+        ++*offset;
+        return column + 1;
+    }
+    *offset += len;
+    return column + width(decode(u, len));
+}
+
+size_t tinyc_utf8_column(const char *s, size_t n, size_t offset) {
+    // Leading ASCII characters other than tab take one column each.
+    size_t i = ascii_prefix(
+        (const unsigned char *)s,
+        offset < n ? offset : n
+    );
+    const char *tab = memchr(s, '\t', i);
+    if (tab) i = tab - s;
+
+    size_t column = i;
+    while (i < offset) column = tinyc_utf8_advance(s, n, &i, column);
+    return column;
+}
@@ -0,0 +1,246 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tinyc/allocator.h>
+
+#include "tinyc/lexer.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+// Upper bounds of allocations. Each one is a little above what is currently
+// needed, so that going back to allocation per character fails.
+#define BUDGET_PER_LINE 2        // Line node and its string.
+#define BUDGET_PER_KB 1          // Growth of long lines.
+#define BUDGET_PER_TOKEN 2       // Token and copy of its spelling.
+#define BUDGET_PER_LEXED_LINE 1  // Growth of array of lines in lexer.
+#define BUDGET_PER_PUSH_MB 32    // Growth of string by pushing characters.
+
+/// Allocator counts every request of new memory, including growth.
+struct counter {
+    size_t allocs, frees;
+};
+
+static struct counter counter;
+
+#ifdef WRAP_LIBC
+// Calls to libc allocator are redirected here by linker, so allocations
+// bypassing tinyc_allocator are counted as well.
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static bool counting;
+
+void *__wrap_malloc(size_t size) {
+    if (counting) counter.allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    if (counting) counter.allocs++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    if (counting) counter.allocs++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr) {
+    if (counting && ptr) counter.frees++;
+    __real_free(ptr);
+}
+
+static void start(void) {
+    counter.allocs = counter.frees = 0;
+    counting = true;
+}
+
+/// Stop counting, returns number of allocations since start.
+static size_t stop(void) {
+    counting = false;
+    return counter.allocs;
+}
+#else
+static void *count_alloc(void *ctx, size_t size) {
+    ((struct counter *)ctx)->allocs++;
+    return malloc(size);
+}
+
+static void *count_realloc(void *ctx, void *ptr, size_t size) {
+    ((struct counter *)ctx)->allocs++;
+    return realloc(ptr, size);
+}
+
+static void count_free(void *ctx, void *ptr) {
+    if (ptr) ((struct counter *)ctx)->frees++;
+    free(ptr);
+}
+
+static const struct tinyc_allocator allocator = {
+    count_alloc,
+    count_realloc,
+    count_free,
+    &counter,
+};
+
+static void start(void) {
+    counter.allocs = counter.frees = 0;
+    tinyc_allocator_set(&allocator);
+}
+
+/// Stop counting, returns number of allocations since start.
+static size_t stop(void) {
+    tinyc_allocator_set(NULL);
+    return counter.allocs;
+}
+#endif
+
+/// Create content which has nlines lines of width characters.
+static char *corpus(size_t nlines, size_t width) {
+    char *content = malloc(nlines * (width + 1) + 1);
+    assert(content);
+    char *c = content;
+    for (size_t i = 0; i < nlines; ++i) {
+        for (size_t j = 0; j < width; ++j) {
+            *c++ = "int x = y + 1; "[(i + j) % 15];
+        }
+        *c++ = '\n';
+    }
+    *c = '\0';
+    return content;
+}
+
+static void source_str(void) {
+    const size_t nlines = 4096;
+    char *content = corpus(nlines, 32);
+    struct tinyc_source source;
+    start();
+    assert(tinyc_source_from_str(&source, "a.c", content));
+    const size_t allocs = stop();
+    assert(allocs <= 1 + nlines * BUDGET_PER_LINE);
+
+    start();
+    tinyc_source_free(&source);
+    stop();
+    assert(counter.frees == allocs);
+    free(content);
+}
+
+static void source_fs(void) {
+    const size_t nlines = 4, width = 64 * 1024;
+    char *content = corpus(nlines, width);
+    FILE *fp = tmpfile();
+    assert(fp && fputs(content, fp) >= 0);
+    rewind(fp);
+
+    struct tinyc_source source;
+    start();
+    assert(tinyc_source_from_fs(&source, "a.c", fp));
+    const size_t allocs = stop();
+    assert(allocs <= 1 + nlines * (width + 1) / 1024 * BUDGET_PER_KB);
+
+    tinyc_source_free(&source);
+    fclose(fp);
+    free(content);
+}
+
+static void token(void) {
+    const size_t ntokens = 1000;
+    const struct tinyc_span span = {0, {0, 0}, {0, 0}};
+    struct tinyc_string value;
+    tinyc_string_from(&value, "x");
+    struct tinyc_token *tokens[1000];
+    start();
+    for (size_t i = 0; i < ntokens; ++i) {
+        tokens[i] = i % 2 ? tinyc_token_create_ident(&span, &value)
+                          : tinyc_token_create_punct(
+                                &span,
+                                TINYC_TOKEN_PUNCT_PLUS
+                            );
+        assert(tokens[i]);
+    }
+    const size_t allocs = stop();
+    assert(allocs <= ntokens);
+    for (size_t i = 0; i < ntokens; ++i) tinyc_free(tokens[i]);
+}
+
+static void lexer(void) {
+    const size_t nlines = 1024;
+    char *content = corpus(nlines, 30);
+    struct tinyc_repo repo;
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    assert(tinyc_repo_init(&repo));
+    assert(tinyc_source_from_str(&source, "a.c", content));
+    const tinyc_repo_id id = tinyc_repo_registory(&repo, &source);
+    assert(id >= 0);
+
+    start();
+    assert(tinyc_lexer_init(&lexer, &source, id));
+    const size_t allocs = stop();
+    size_t ntokens = 0;
+    for (size_t row = 0; row < nlines; ++row) {
+        const struct tinyc_token *tokens = tinyc_lexer_tokens(&lexer, row);
+        if (!tokens) continue;
+        const struct tinyc_token *it = tokens;
+        do {
+            ntokens++;
+            it = it->next;
+        } while (it != tokens);
+    }
+    assert(ntokens > nlines);
+    assert(
+        allocs <= 2 + ntokens * BUDGET_PER_TOKEN
+                      + nlines * BUDGET_PER_LEXED_LINE
+    );
+
+    // One character edit lexes only that line again.
+    start();
+    assert(tinyc_lexer_edit(&lexer, 10, 0, 10, 1, "z"));
+    assert(stop() <= 40 * BUDGET_PER_TOKEN);
+
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+    tinyc_repo_free(&repo);
+    free(content);
+}
+
+static void string_push(void) {
+    const size_t n = 1024 * 1024;
+    struct tinyc_string s;
+    start();
+    assert(tinyc_string_init(&s));
+    for (size_t i = 0; i < n; ++i) assert(tinyc_string_push(&s, 'a'));
+    assert(stop() <= BUDGET_PER_PUSH_MB);
+    assert(s.len == n);
+    tinyc_string_free(&s);
+}
+
+int main(void) {
+    source_str();
+    source_fs();
+    token();
+    lexer();
+    string_push();
+}
@@ -0,0 +1,167 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tinyc/allocator.h>
+
+#include "tinyc/lexer.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+
+/// Allocator counts live allocations.
+struct counter {
+    size_t allocs, frees;
+};
+
+static void *count_alloc(void *ctx, size_t size) {
+    ((struct counter *)ctx)->allocs++;
+    return malloc(size);
+}
+
+static void *count_realloc(void *ctx, void *ptr, size_t size) {
+    if (!ptr) ((struct counter *)ctx)->allocs++;
+    return realloc(ptr, size);
+}
+
+static void count_free(void *ctx, void *ptr) {
+    ((struct counter *)ctx)->frees++;
+    free(ptr);
+}
+
+#define ALIGN 16
+
+/// Allocator bumps pointer in fixed buffer, and never release memory.
+struct arena {
+    char buf[1 << 20];
+    size_t used;
+};
+
+static void *arena_alloc(void *ctx, size_t size) {
+    struct arena *arena = ctx;
+    // Size is stored before allocated memory for realloc.
+    const size_t start = (arena->used + ALIGN - 1) / ALIGN * ALIGN;
+    if (start + ALIGN + size > sizeof(arena->buf)) return NULL;
+    memcpy(arena->buf + start, &size, sizeof(size_t));
+    arena->used = start + ALIGN + size;
+    return arena->buf + start + ALIGN;
+}
+
+static void *arena_realloc(void *ctx, void *ptr, size_t size) {
+    void *new_ptr = arena_alloc(ctx, size);
+    if (!ptr || !new_ptr) return new_ptr;
+    size_t old_size;
+    memcpy(&old_size, (char *)ptr - ALIGN, sizeof(size_t));
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    return new_ptr;
+}
+
+static void arena_free(void *ctx, void *ptr) {
+    (void)ctx;
+    (void)ptr;
+}
+
+static void work(void) {
+    struct tinyc_repo repo;
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    assert(tinyc_repo_init(&repo));
+    assert(tinyc_source_from_str(&source, "a.c", "int x;\nint y = 1;\n"));
+    const tinyc_repo_id id = tinyc_repo_registory(&repo, &source);
+    assert(id >= 0);
+    assert(tinyc_lexer_init(&lexer, &source, id));
+    assert(tinyc_lexer_edit(&lexer, 1, 4, 1, 5, "z\nint w"));
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+    tinyc_repo_free(&repo);
+}
+
+static void default_is_libc(void) {
+    assert(tinyc_allocator_set(NULL) == &tinyc_allocator_libc);
+    work();
+}
+
+static void count(void) {
+    struct counter counter = {0, 0};
+    const struct tinyc_allocator allocator = {
+        count_alloc,
+        count_realloc,
+        count_free,
+        &counter,
+    };
+    assert(tinyc_allocator_set(&allocator) == &tinyc_allocator_libc);
+    work();
+    assert(tinyc_allocator_set(NULL) == &allocator);
+    assert(counter.allocs > 0 && counter.allocs == counter.frees);
+}
+
+static void bump(void) {
+    static struct arena arena;
+    const struct tinyc_allocator allocator = {
+        arena_alloc,
+        arena_realloc,
+        arena_free,
+        &arena,
+    };
+    tinyc_allocator_set(&allocator);
+    for (size_t i = 0; i < 100; ++i) {
+        arena.used = 0;
+        work();
+    }
+    tinyc_allocator_set(NULL);
+    assert(arena.used > 0);
+
+    struct tinyc_string s;
+    assert(tinyc_string_from_copy(&s, "libc"));
+    assert(!(arena.buf <= s.cstr && s.cstr < arena.buf + sizeof(arena.buf)));
+    tinyc_string_free(&s);
+}
+
+static void *count_work(void *arg) {
+    (void)arg;
+    work();
+    return NULL;
+}
+
+static void scope(void) {
+    struct counter counter = {0, 0};
+    const struct tinyc_allocator allocator = {
+        count_alloc,
+        count_realloc,
+        count_free,
+        &counter,
+    };
+    assert(tinyc_allocator_scope(&allocator) == NULL);
+
+    // Other threads keep using allocator set for library.
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, count_work, NULL) == 0);
+    pthread_join(thread, NULL);
+    assert(counter.allocs == 0);
+
+    work();
+    assert(tinyc_allocator_scope(NULL) == &allocator);
+    assert(counter.allocs > 0 && counter.allocs == counter.frees);
+}
+
+int main(void) {
+    default_is_libc();
+    count();
+    bump();
+    scope();
+}
@@ -0,0 +1,392 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <tinyc/diag_buffer.h>
+
+#include "tinyc/diag.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+
+static struct tinyc_repo repo;
+static tinyc_repo_id id;
+
+static const struct tinyc_diag_kind what = {
+    TINYC_DIAG_ERROR,
+    "what",
+    "message",
+};
+static const struct tinyc_diag_kind w = {TINYC_DIAG_WARN, "w", "%s"};
+static const struct tinyc_diag_kind a = {TINYC_DIAG_ERROR, "a", "%s"};
+static const struct tinyc_diag_kind b = {TINYC_DIAG_ERROR, "b", "m"};
+static const struct tinyc_diag_kind c = {TINYC_DIAG_ERROR, "c", "m"};
+
+static void setup(void) {
+    struct tinyc_source source;
+    assert(tinyc_repo_init(&repo));
+    assert(tinyc_source_from_str(&source, "a.c", "int x\nint y\nint z\n"));
+    id = tinyc_repo_registory(&repo, &source);
+}
+
+static bool read_all(FILE *fp, char *buf, size_t size) {
+    const size_t len = ftell(fp);
+    rewind(fp);
+    if (len >= size || fread(buf, 1, len, fp) != len) return false;
+    buf[len] = '\0';
+    return true;
+}
+
+static void same_as_fs(void) {
+    struct tinyc_span span = {
+        id,
+        {1, 4},
+        {1, 4}
+    };
+    FILE *expect = tmpfile(), *actual = tmpfile();
+    assert(expect && actual);
+    tinyc_diag_fs(expect, TINYC_DIAG_ERROR, &repo, &span, "what", "message");
+
+    struct tinyc_diag_buffer buffer;
+    assert(tinyc_diag_buffer_init(&buffer));
+    assert(tinyc_diag_buffer_emit(&buffer, &what, &repo, &span));
+    assert(tinyc_diag_buffer_merge(actual, &buffer, 1, false));
+    assert(buffer.len == 0);
+
+    char s1[256], s2[256];
+    assert(read_all(expect, s1, sizeof(s1)));
+    assert(read_all(actual, s2, sizeof(s2)));
+    assert(strcmp(s1, s2) == 0);
+    assert(strcmp(s1, "a.c:1:4: error: what\n     1 | int y\n       |     ^ "
+                      "message\n") == 0);
+
+    tinyc_diag_buffer_free(&buffer);
+    fclose(expect);
+    fclose(actual);
+}
+
+static void emit(
+    struct tinyc_diag_buffer *buffer,
+    size_t row,
+    const char *message
+) {
+    struct tinyc_span span = {
+        id,
+        {row, 0},
+        {row, 2}
+    };
+    assert(tinyc_diag_buffer_emit(buffer, &w, &repo, &span, message));
+}
+
+static void merge_in_emitted_order(void) {
+    // Buffers are concatenated, regardless of source location.
+    struct tinyc_diag_buffer buffers[2];
+    assert(tinyc_diag_buffer_init(&buffers[0]));
+    assert(tinyc_diag_buffer_init(&buffers[1]));
+    emit(&buffers[1], 0, "x");
+    emit(&buffers[0], 2, "z");
+    emit(&buffers[0], 1, "y");
+
+    FILE *expect = tmpfile(), *actual = tmpfile();
+    assert(expect && actual);
+    struct tinyc_span x = {
+        id,
+        {0, 0},
+        {0, 2}
+    };
+    struct tinyc_span y = {
+        id,
+        {1, 0},
+        {1, 2}
+    };
+    struct tinyc_span z = {
+        id,
+        {2, 0},
+        {2, 2}
+    };
+    tinyc_diag_fs(expect, TINYC_DIAG_WARN, &repo, &z, "w", "z");
+    tinyc_diag_fs(expect, TINYC_DIAG_WARN, &repo, &y, "w", "y");
+    tinyc_diag_fs(expect, TINYC_DIAG_WARN, &repo, &x, "w", "x");
+    assert(tinyc_diag_buffer_merge(actual, buffers, 2, false));
+
+    char s1[1024], s2[1024];
+    assert(read_all(expect, s1, sizeof(s1)));
+    assert(read_all(actual, s2, sizeof(s2)));
+    assert(strcmp(s1, s2) == 0);
+
+    tinyc_diag_buffer_free(&buffers[0]);
+    tinyc_diag_buffer_free(&buffers[1]);
+    fclose(expect);
+    fclose(actual);
+}
+
+static void merge_in_source_order(void) {
+    // Emitted order in each buffer differs from source order.
+    struct tinyc_diag_buffer buffers[2];
+    assert(tinyc_diag_buffer_init(&buffers[0]));
+    assert(tinyc_diag_buffer_init(&buffers[1]));
+    emit(&buffers[1], 2, "z");
+    emit(&buffers[0], 1, "y1");
+    emit(&buffers[1], 0, "x");
+    emit(&buffers[1], 1, "y2");
+
+    FILE *expect = tmpfile(), *actual = tmpfile();
+    assert(expect && actual);
+    struct tinyc_span x = {
+        id,
+        {0, 0},
+        {0, 2}
+    };
+    struct tinyc_span y = {
+        id,
+        {1, 0},
+        {1, 2}
+    };
+    struct tinyc_span z = {
+        id,
+        {2, 0},
+        {2, 2}
+    };
+    tinyc_diag_fs(expect, TINYC_DIAG_WARN, &repo, &x, "w", "x");
+    tinyc_diag_fs(expect, TINYC_DIAG_WARN, &repo, &y, "w", "y1");
+    tinyc_diag_fs(expect, TINYC_DIAG_WARN, &repo, &y, "w", "y2");
+    tinyc_diag_fs(expect, TINYC_DIAG_WARN, &repo, &z, "w", "z");
+    assert(tinyc_diag_buffer_merge(actual, buffers, 2, true));
+
+    char s1[1024], s2[1024];
+    assert(read_all(expect, s1, sizeof(s1)));
+    assert(read_all(actual, s2, sizeof(s2)));
+    assert(strcmp(s1, s2) == 0);
+
+    tinyc_diag_buffer_free(&buffers[0]);
+    tinyc_diag_buffer_free(&buffers[1]);
+    fclose(expect);
+    fclose(actual);
+}
+
+static void render_lazily(void) {
+    struct tinyc_repo lazy;
+    struct tinyc_source source;
+    assert(tinyc_repo_init(&lazy));
+    struct tinyc_span span = {
+        0,
+        {0, 0},
+        {0, 0}
+    };
+
+    // Source doesn't exist when emitted, but is rendered after registered.
+    struct tinyc_diag_buffer buffer;
+    assert(tinyc_diag_buffer_init(&buffer));
+    assert(tinyc_diag_buffer_emit(&buffer, &what, &lazy, &span));
+    assert(tinyc_source_from_str(&source, "b.c", "x"));
+    assert(tinyc_repo_registory(&lazy, &source) == 0);
+
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_diag_buffer_merge(fp, &buffer, 1, false));
+    char s[256];
+    assert(read_all(fp, s, sizeof(s)));
+    assert(strncmp(s, "b.c:0:0: error: what\n", 21) == 0);
+
+    tinyc_diag_buffer_free(&buffer);
+    fclose(fp);
+}
+
+static void limits(void) {
+    struct tinyc_diag_buffer buffer;
+    assert(tinyc_diag_buffer_init(&buffer));
+    buffer.limits.max_errors = 3;
+    buffer.limits.max_per_kind = 2;
+    buffer.limits.dedup = true;
+    buffer.limits.suppress_warnings = true;
+
+    struct tinyc_span span1 = {
+        id,
+        {0, 0},
+        {0, 2}
+    };
+    struct tinyc_span span2 = {
+        id,
+        {1, 0},
+        {1, 2}
+    };
+    assert(tinyc_diag_buffer_emit(&buffer, &w, &repo, &span1, "m"));
+    assert(buffer.len == 0 && buffer.dropped == 1);
+
+    // Same kind at same location is dropped.
+    assert(tinyc_diag_buffer_emit(&buffer, &a, &repo, &span1, "m"));
+    assert(tinyc_diag_buffer_emit(&buffer, &a, &repo, &span1, "m"));
+    assert(buffer.len == 1 && buffer.dropped == 2);
+
+    // At most 2 diagnostics for each kind.
+    assert(tinyc_diag_buffer_emit(&buffer, &a, &repo, &span2, "m"));
+    assert(tinyc_diag_buffer_emit(&buffer, &a, &repo, &span2, "n"));
+    assert(buffer.len == 2 && buffer.dropped == 3);
+
+    // At most 3 errors.
+    assert(tinyc_diag_buffer_emit(&buffer, &b, &repo, &span1));
+    for (size_t i = 0; i < 100000; ++i) {
+        assert(tinyc_diag_buffer_emit(&buffer, &c, &repo, &span2));
+    }
+    assert(buffer.len == 3 && buffer.errors == 3);
+    assert(buffer.dropped == 100003);
+
+    tinyc_diag_buffer_free(&buffer);
+}
+
+static void format_args(void) {
+    static const struct tinyc_diag_kind kind = {
+        TINYC_DIAG_ERROR,
+        "call",
+        "%s expects %d arguments, got %d%%",
+    };
+    struct tinyc_span span = {
+        id,
+        {0, 0},
+        {0, 2}
+    };
+    struct tinyc_diag_buffer buffer;
+    assert(tinyc_diag_buffer_init(&buffer));
+
+    // String argument is copied, so it may be released after emitted.
+    char name[] = "f";
+    assert(tinyc_diag_buffer_emit(&buffer, &kind, &repo, &span, name, 2, 100));
+    name[0] = 'g';
+
+    FILE *fp = tmpfile();
+    char s[256];
+    assert(fp && tinyc_diag_buffer_merge(fp, &buffer, 1, false));
+    assert(read_all(fp, s, sizeof(s)));
+    assert(strstr(s, "^^^ f expects 2 arguments, got 100%\n"));
+    assert(buffer.strings.len == 0);
+
+    tinyc_diag_buffer_free(&buffer);
+    fclose(fp);
+}
+
+static bool render(
+    struct tinyc_string *buf,
+    struct tinyc_diag_cache *cache,
+    const struct tinyc_span *span
+) {
+    return tinyc_diag_render(
+        buf,
+        cache,
+        false,
+        TINYC_DIAG_ERROR,
+        &repo,
+        span,
+        "w",
+        "m"
+    );
+}
+
+static void cache_lines(void) {
+    struct tinyc_span spans[] = {
+        {id, {0, 0}, {0, 2}},
+        {id, {0, 4}, {0, 4}},
+        {id, {0, 4}, {2, 2}},
+        {id, {2, 0}, {2, 0}},
+    };
+    struct tinyc_diag_cache cache;
+    tinyc_diag_cache_init(&cache);
+    struct tinyc_string cached, plain;
+    assert(tinyc_string_init(&cached) && tinyc_string_init(&plain));
+    for (size_t i = 0; i < sizeof(spans) / sizeof(*spans); ++i) {
+        assert(render(&cached, &cache, &spans[i]));
+        assert(render(&plain, NULL, &spans[i]));
+    }
+    assert(strcmp(cached.cstr, plain.cstr) == 0);
+
+    // Only row 0 and 2 are looked up.
+    assert(cache.len == 2);
+    assert(cache.lines[0].row == 0 && cache.lines[1].row == 2);
+    const char *header = cache.lines[1].header.cstr;
+    assert(strcmp(header, "     2 | int z\n       | ") == 0);
+
+    tinyc_string_free(&cached);
+    tinyc_string_free(&plain);
+    tinyc_diag_cache_free(&cache);
+}
+
+static void cache_eviction(void) {
+    struct tinyc_source source;
+    const char *content = "l0\nl1\nl2\nl3\nl4\nl5\nl6\nl7\nl8\nl9\n";
+    assert(tinyc_source_from_str(&source, "c.c", content));
+    const tinyc_repo_id c = tinyc_repo_registory(&repo, &source);
+    struct tinyc_diag_cache cache;
+    tinyc_diag_cache_init(&cache);
+    struct tinyc_string cached, plain;
+    assert(tinyc_string_init(&cached) && tinyc_string_init(&plain));
+
+    // Fill cache, then start row is the oldest one when end row is loaded.
+    for (size_t row = 0; row < TINYC_DIAG_CACHE_SIZE; ++row) {
+        struct tinyc_span span = {c, {row, 0}, {row, 1}};
+        assert(render(&cached, &cache, &span));
+    }
+    cached.len = 0;
+    cached.cstr[0] = '\0';
+    struct tinyc_span span = {c, {0, 0}, {9, 1}};
+    assert(render(&cached, &cache, &span));
+    assert(render(&plain, NULL, &span));
+    assert(strcmp(cached.cstr, plain.cstr) == 0);
+    assert(strstr(cached.cstr, "     0 | l0\n"));
+    assert(strstr(cached.cstr, "     9 | l9\n"));
+
+    tinyc_string_free(&cached);
+    tinyc_string_free(&plain);
+    tinyc_diag_cache_free(&cache);
+}
+
+static void display_columns(void) {
+    struct tinyc_source source;
+    const char *content = "\tint \xc3\xa9 = \xe5\xad\x97;";
+    assert(tinyc_source_from_str(&source, "b.c", content));
+    const tinyc_repo_id b = tinyc_repo_registory(&repo, &source);
+    struct tinyc_span spans[] = {
+        {b, {0, 8}, {0, 8} },
+        {b, {0, 5}, {0, 10}},
+    };
+    const char *expects[] = {
+        "b.c:0:8: error: w\n"
+        "     0 |         int \xc3\xa9 = \xe5\xad\x97;\n"
+        "       |               ^ m\n",
+        "b.c:0:5: error: w\n"
+        "     0 |         int \xc3\xa9 = \xe5\xad\x97;\n"
+        "       |             ^^^^^^ m\n",
+    };
+
+    // Tab is expanded, and carets are placed by display column.
+    for (size_t i = 0; i < sizeof(spans) / sizeof(*spans); ++i) {
+        struct tinyc_string buf;
+        assert(tinyc_string_init(&buf));
+        assert(render(&buf, NULL, &spans[i]));
+        assert(strcmp(buf.cstr, expects[i]) == 0);
+        tinyc_string_free(&buf);
+    }
+}
+
+int main(void) {
+    setup();
+    same_as_fs();
+    merge_in_emitted_order();
+    merge_in_source_order();
+    render_lazily();
+    limits();
+    format_args();
+    cache_lines();
+    cache_eviction();
+    display_columns();
+}
@@ -0,0 +1,193 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <tinyc/diag_json.h>
+
+#include "tinyc/diag.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+
+static struct tinyc_repo repo;
+static tinyc_repo_id id;
+static struct tinyc_diag_json sink;
+
+static void setup(void) {
+    struct tinyc_source source;
+    assert(tinyc_repo_init(&repo));
+    assert(tinyc_source_from_str(&source, "dir/\"a\".c", "int x\nint y\n"));
+    id = tinyc_repo_registory(&repo, &source);
+}
+
+static bool output_is(FILE *fp, const char *expect) {
+    char buf[1024];
+    const size_t len = ftell(fp);
+    rewind(fp);
+    if (len >= sizeof(buf) || fread(buf, 1, len, fp) != len) return false;
+    buf[len] = '\0';
+    return strcmp(buf, expect) == 0;
+}
+
+static void json_lines(void) {
+    struct tinyc_span span1 = {
+        id,
+        {0, 4},
+        {0, 4}
+    };
+    struct tinyc_span span2 = {
+        id,
+        {0, 0},
+        {1, 2}
+    };
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_diag_json_init(&sink, fp, TINYC_DIAG_JSON_LINES));
+    assert(tinyc_diag_json_emit(
+        &sink,
+        TINYC_DIAG_ERROR,
+        &repo,
+        &span1,
+        "undeclared",
+        "x is\n\"undeclared\""
+    ));
+    assert(tinyc_diag_json_emit(
+        &sink,
+        TINYC_DIAG_INFO,
+        &repo,
+        &span2,
+        "note",
+        "tab\there\x01"
+    ));
+    assert(tinyc_diag_json_finish(&sink));
+    assert(output_is(
+        fp,
+        "{\"severity\":\"error\",\"file\":\"dir/\\\"a\\\".c\","
+        "\"start\":{\"row\":0,\"offset\":4},\"end\":{\"row\":0,\"offset\":4},"
+        "\"what\":\"undeclared\",\"message\":\"x is\\n\\\"undeclared\\\"\"}\n"
+        "{\"severity\":\"info\",\"file\":\"dir/\\\"a\\\".c\","
+        "\"start\":{\"row\":0,\"offset\":0},\"end\":{\"row\":1,\"offset\":2},"
+        "\"what\":\"note\",\"message\":\"tab\\there\\u0001\"}\n"
+    ));
+    fclose(fp);
+}
+
+static void sarif(void) {
+    struct tinyc_span span = {
+        id,
+        {1, 4},
+        {1, 4}
+    };
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_diag_json_init(&sink, fp, TINYC_DIAG_JSON_SARIF));
+    const enum tinyc_diag_severity w = TINYC_DIAG_WARN, i = TINYC_DIAG_INFO;
+    assert(tinyc_diag_json_emit(&sink, w, &repo, &span, "a", "m"));
+    assert(tinyc_diag_json_emit(&sink, i, &repo, &span, "b", "n"));
+    assert(tinyc_diag_json_finish(&sink));
+    assert(output_is(
+        fp,
+        "{\"version\":\"2.1.0\","
+        "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","
+        "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"tinyc\"}},"
+        "\"columnKind\":\"unicodeCodePoints\",\"results\":["
+        "{\"ruleId\":\"a\",\"level\":\"warning\",\"message\":{\"text\":\"m\"},"
+        "\"locations\":[{\"physicalLocation\":{"
+        "\"artifactLocation\":{\"uri\":\"dir/%22a%22.c\"},"
+        "\"region\":{\"startLine\":2,\"startColumn\":5,"
+        "\"endLine\":2,\"endColumn\":6}}}]},"
+        "{\"ruleId\":\"b\",\"level\":\"note\",\"message\":{\"text\":\"n\"},"
+        "\"locations\":[{\"physicalLocation\":{"
+        "\"artifactLocation\":{\"uri\":\"dir/%22a%22.c\"},"
+        "\"region\":{\"startLine\":2,\"startColumn\":5,"
+        "\"endLine\":2,\"endColumn\":6}}}]}"
+        "]}]}\n"
+    ));
+    fclose(fp);
+}
+
+static void encoding(void) {
+    struct tinyc_source source;
+    assert(tinyc_source_from_str(
+        &source,
+        "/tmp/caf\xc3\xa9 1.c",
+        "/* \xc3\xa9\xe5\xad\x97 */ int x;\n"
+    ));
+    struct tinyc_span span = {
+        tinyc_repo_registory(&repo, &source),
+        {0, 17},
+        {0, 19}
+    };
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_diag_json_init(&sink, fp, TINYC_DIAG_JSON_SARIF));
+    assert(tinyc_diag_json_emit(
+        &sink,
+        TINYC_DIAG_ERROR,
+        &repo,
+        &span,
+        "e",
+        "\xff\xc3 \xc3\xa9"
+    ));
+    assert(tinyc_diag_json_finish(&sink));
+    assert(output_is(
+        fp,
+        "{\"version\":\"2.1.0\","
+        "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","
+        "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"tinyc\"}},"
+        "\"columnKind\":\"unicodeCodePoints\",\"results\":["
+        "{\"ruleId\":\"e\",\"level\":\"error\","
+        "\"message\":{\"text\":\"\\ufffd\\ufffd \xc3\xa9\"},"
+        "\"locations\":[{\"physicalLocation\":{"
+        "\"artifactLocation\":{\"uri\":\"file:///tmp/caf%C3%A9%201.c\"},"
+        "\"region\":{\"startLine\":1,\"startColumn\":15,"
+        "\"endLine\":1,\"endColumn\":18}}}]}"
+        "]}]}\n"
+    ));
+    fclose(fp);
+}
+
+static void streaming(void) {
+    struct tinyc_span span = {
+        id,
+        {0, 0},
+        {0, 2}
+    };
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_diag_json_init(&sink, fp, TINYC_DIAG_JSON_LINES));
+    for (size_t i = 0; i < 10000; ++i) {
+        assert(tinyc_diag_json_emit(
+            &sink,
+            TINYC_DIAG_WARN,
+            &repo,
+            &span,
+            "w",
+            "m"
+        ));
+        assert(sink.len < TINYC_DIAG_JSON_BUFSIZE);
+    }
+    assert(tinyc_diag_json_finish(&sink) && sink.count == 10000);
+
+    rewind(fp);
+    size_t lines = 0;
+    for (int c = fgetc(fp); c != EOF; c = fgetc(fp)) lines += c == '\n';
+    assert(lines == 10000);
+    fclose(fp);
+}
+
+int main(void) {
+    setup();
+    json_lines();
+    sarif();
+    encoding();
+    streaming();
+}
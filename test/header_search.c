@@ -0,0 +1,172 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <tinyc/header_search.h>
+#include <unistd.h>
+
+#include "tinyc/string.h"
+
+static char root[] = "/tmp/tinyc-header-XXXXXX";
+
+static void touch(const char *path) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s/%s", root, path);
+    FILE *fp = fopen(buf, "w");
+    assert(fp);
+    fclose(fp);
+}
+
+static void make_dir(const char *path) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s/%s", root, path);
+    assert(mkdir(buf, 0700) == 0);
+}
+
+static void cleanup(void) {
+    char buf[256];
+    const char *files[] = {"inc/a.h", "inc/sys/b.h", "sys/c.h", "local/d.h"};
+    for (size_t i = 0; i < sizeof(files) / sizeof(*files); ++i) {
+        snprintf(buf, sizeof(buf), "%s/%s", root, files[i]);
+        remove(buf);
+    }
+    const char *dirs[] = {"inc/sys", "inc", "sys", "local", ""};
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(*dirs); ++i) {
+        snprintf(buf, sizeof(buf), "%s/%s", root, dirs[i]);
+        rmdir(buf);
+    }
+}
+
+static bool resolves_to(
+    struct tinyc_header_search *search,
+    const char *base,
+    bool is_std,
+    char *path,
+    const char *expect
+) {
+    struct tinyc_string s;
+    tinyc_string_from(&s, path);
+    const struct tinyc_string *res = tinyc_header_search_resolve(
+        search,
+        base,
+        is_std,
+        &s
+    );
+    if (!expect) return res == NULL;
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s/%s", root, expect);
+    return res && strcmp(res->cstr, buf) == 0;
+}
+
+static void resolve(void) {
+    make_dir("inc");
+    make_dir("inc/sys");
+    make_dir("sys");
+    make_dir("local");
+    touch("inc/a.h");
+    touch("inc/sys/b.h");
+    touch("sys/c.h");
+    touch("local/d.h");
+
+    char inc[256], sys[256], local[256];
+    snprintf(inc, sizeof(inc), "%s/inc", root);
+    snprintf(sys, sizeof(sys), "%s/sys", root);
+    snprintf(local, sizeof(local), "%s/local", root);
+
+    struct tinyc_header_search search;
+    assert(tinyc_header_search_init(&search));
+    assert(tinyc_header_search_add_dir(&search, inc));
+    assert(tinyc_header_search_add_dir(&search, sys));
+
+    assert(resolves_to(&search, NULL, true, "a.h", "inc/a.h"));
+    assert(resolves_to(&search, NULL, true, "sys/b.h", "inc/sys/b.h"));
+    assert(resolves_to(&search, NULL, true, "c.h", "sys/c.h"));
+    assert(resolves_to(&search, NULL, true, "d.h", NULL));
+    assert(resolves_to(&search, local, true, "d.h", NULL));
+    assert(resolves_to(&search, local, false, "d.h", "local/d.h"));
+    assert(resolves_to(&search, local, false, "a.h", "inc/a.h"));
+
+    // Both positive and negative results are cached.
+    const struct tinyc_string *a1, *a2;
+    struct tinyc_string a;
+    tinyc_string_from(&a, "a.h");
+    a1 = tinyc_header_search_resolve(&search, NULL, true, &a);
+    a2 = tinyc_header_search_resolve(&search, NULL, true, &a);
+    assert(a1 && a1 == a2);
+    touch("inc/e.h");
+    assert(resolves_to(&search, NULL, true, "e.h", NULL));
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s/inc/e.h", root);
+    remove(buf);
+
+    tinyc_header_search_free(&search);
+}
+
+static void revalidate(void) {
+    char inc[256], buf[256];
+    snprintf(inc, sizeof(inc), "%s/inc", root);
+    snprintf(buf, sizeof(buf), "%s/inc/f.h", root);
+
+    // Pin time of directory, so any change after listing is visible.
+    const struct timespec old[2] = {
+        {1000, 0},
+        {1000, 0}
+    };
+    assert(utimensat(AT_FDCWD, inc, old, 0) == 0);
+
+    struct tinyc_header_search search;
+    assert(tinyc_header_search_init(&search));
+    assert(tinyc_header_search_add_dir(&search, inc));
+    assert(resolves_to(&search, NULL, true, "a.h", "inc/a.h"));
+    assert(resolves_to(&search, NULL, true, "f.h", NULL));
+    struct tinyc_string path;
+    tinyc_string_from(&path, "a.h");
+    const struct tinyc_string *a = tinyc_header_search_resolve(
+        &search,
+        NULL,
+        true,
+        &path
+    );
+
+    // Nothing changed, so result is still cached.
+    touch("inc/f.h");
+    assert(utimensat(AT_FDCWD, inc, old, 0) == 0);
+    assert(tinyc_header_search_revalidate(&search));
+    assert(resolves_to(&search, NULL, true, "f.h", NULL));
+
+    // Directory is modified.
+    remove(buf);
+    touch("inc/f.h");
+    assert(tinyc_header_search_revalidate(&search));
+    assert(resolves_to(&search, NULL, true, "f.h", "inc/f.h"));
+    assert(strncmp(a->cstr, inc, strlen(inc)) == 0);  // Still valid.
+    remove(buf);
+
+    tinyc_header_search_free(&search);
+}
+
+int main(void) {
+    assert(mkdtemp(root));
+    resolve();
+    revalidate();
+    cleanup();
+}
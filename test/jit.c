@@ -0,0 +1,346 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tinyc/jit.h>
+
+#include "tinyc/ast.h"
+#include "tinyc/lexer.h"
+#include "tinyc/parser.h"
+#include "tinyc/source.h"
+
+/// Compiled content with everything it depends on.
+struct unit {
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    struct tinyc_ast ast;
+    struct tinyc_jit jit;
+};
+
+/// Compile content, and returns false and set error if jit failed.
+static bool compile(
+    struct unit *unit,
+    const char *content,
+    struct tinyc_jit_error *error
+) {
+    struct tinyc_parse_error parse_error;
+    assert(tinyc_source_from_str(&unit->source, "test.c", content));
+    assert(tinyc_lexer_init(&unit->lexer, &unit->source, 0));
+    assert(tinyc_ast_init(&unit->ast));
+    if (!tinyc_parse(&unit->ast, &unit->lexer, &parse_error)) {
+        fprintf(stderr, "%s: %s\n", content, parse_error.message);
+        assert(false);
+    }
+    assert(tinyc_jit_init(&unit->jit));
+    return tinyc_jit_compile(&unit->jit, &unit->ast, error);
+}
+
+static void unit_free(struct unit *unit) {
+    tinyc_jit_free(&unit->jit);
+    tinyc_ast_free(&unit->ast);
+    tinyc_lexer_free(&unit->lexer);
+    tinyc_source_free(&unit->source);
+}
+
+/// Compile and run content, and compare status of main with expect.
+static void run(const char *content, int expect) {
+    struct unit unit;
+    struct tinyc_jit_error error;
+    if (!compile(&unit, content, &error)) {
+        fprintf(stderr, "%s: %s\n", content, error.message);
+        assert(false);
+    }
+    char arg0[] = "test", arg1[] = "hello";
+    char *argv[] = {arg0, arg1, NULL};
+    int status;
+    assert(tinyc_jit_run(&unit.jit, 2, argv, &status));
+    if (status != expect) {
+        fprintf(stderr, "%s: expect %d, actual %d\n", content, expect, status);
+        assert(false);
+    }
+    unit_free(&unit);
+}
+
+/// Compile content which has an error with message at row and offset.
+static void error(
+    const char *content,
+    const char *message,
+    size_t row,
+    size_t offset
+) {
+    struct unit unit;
+    struct tinyc_jit_error error;
+    assert(!compile(&unit, content, &error));
+    assert(strcmp(error.message, message) == 0);
+    assert(error.span.start.row == row);
+    assert(error.span.start.offset == offset);
+    unit_free(&unit);
+}
+
+static void expressions(void) {
+    run("int main(void) { return 1 + 2 * 3 - 8 / 3 % 2; }", 7);
+    run("int main(void) { return -7 / 2 + (-7 % 2) * 10; }", -13);
+    run("int main(void) { return (1 << 4 | 3) ^ 0x5 & ~0; }", 22);
+    run("int main(void) { int a = 3; a += 4; a <<= 1; return a--; }", 14);
+    run("int main(void) { int a = 3, b = a++ + ++a; return b * 10 + a; }", 85);
+    run("int main(void) { return 1 < 2 && 2 > 3 || !0 ? 5 : 6; }", 5);
+    run("int main(void) { int a = 0; 0 && (a = 1); 1 || a++; return a; }", 0);
+    run("int main(void) { return (1, 2), sizeof(long) + sizeof 'a'; }", 12);
+
+    // Usual arithmetic conversions and narrowing.
+    run("int main(void) { unsigned u = -1; return u > 0 && -1 < 0; }", 1);
+    run("int main(void) { return (char)300 + (unsigned char)-1; }", 299);
+    run("int main(void) { long l = 1L << 40; return (int)(l >> 38); }", 4);
+    run("int main(void) { unsigned u = 7; return u / -1 == 0; }", 1);
+    run("int main(void) { short s = 70000; return s; }", 4464);
+    run("int main(void) { _Bool b = 256; return b + 1; }", 2);
+}
+
+static void statements(void) {
+    run(
+        "int main(void) {\n"
+        "    int sum = 0;\n"
+        "    for (int i = 0; i < 10; ++i) {\n"
+        "        if (i == 7) break;\n"
+        "        if (i % 2) continue;\n"
+        "        sum += i;\n"
+        "    }\n"
+        "    while (sum < 100) sum *= 2;\n"
+        "    do sum--; while (sum > 120);\n"
+        "    return sum;\n"
+        "}\n",
+        120
+    );
+    run(
+        "int f(int x) {\n"
+        "    switch (x) {\n"
+        "        case 1: return 10;\n"
+        "        case 2:\n"
+        "        case 3: x += 100;\n"
+        "        default: x += 1000; break;\n"
+        "        case -5: { switch (x) { case 1: return 0; } return 5; }\n"
+        "    }\n"
+        "    return x;\n"
+        "}\n"
+        "int main(void) { return f(1) + f(3) + f(4) + f(-5); }\n",
+        10 + 1103 + 1004 + 5
+    );
+    run(
+        "int main(void) {\n"
+        "    int i = 0;\n"
+        "again:\n"
+        "    if (++i < 5) goto again;\n"
+        "    goto done;\n"
+        "    i = 100;\n"
+        "done:\n"
+        "    return i;\n"
+        "}\n",
+        5
+    );
+}
+
+static void functions(void) {
+    run(
+        "int fib(int n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }\n"
+        "int main(void) { return fib(20) % 256; }\n",
+        6765 % 256
+    );
+    run(
+        "long f(int a, char b, short c, long d, unsigned e, int f) {\n"
+        "    return a - b * c + d + e - f;\n"
+        "}\n"
+        "int main(void) { return f(1, 2, 3, 4, 5, 6); }\n",
+        -2
+    );
+
+    // Declared before defined, and called through pointer.
+    run(
+        "int twice(int);\n"
+        "int apply(int (*f)(int), int x) { return f(f(x)); }\n"
+        "int main(void) { return apply(twice, 3) + (*twice)(1); }\n"
+        "int twice(int x) { return x * 2; }\n",
+        14
+    );
+
+    // Functions not defined in unit are in libc, and undeclared one returns
+    // int. Arguments of main are passed from caller.
+    run(
+        "unsigned long strlen(const char *s);\n"
+        "int main(int argc, char **argv) {\n"
+        "    return strlen(argv[1]) * 10 + argc + abs(-100);\n"
+        "}\n",
+        152
+    );
+}
+
+static void objects(void) {
+    run(
+        "int main(void) {\n"
+        "    int a[5] = {1, 2, 3};\n"
+        "    int *p = a + 1;\n"
+        "    *p = 10;\n"
+        "    p[2] = 20;\n"
+        "    return a[0] + a[1] + a[2] + a[3] + a[4] + (int)(&a[4] - p);\n"
+        "}\n",
+        1 + 10 + 3 + 20 + 0 + 3
+    );
+    run(
+        "int main(void) {\n"
+        "    char s[] = \"abc\";\n"
+        "    const char *t = \"xyz\";\n"
+        "    int m[2][3] = {{1, 2, 3}, {4, 5, 6}};\n"
+        "    return sizeof(s) + s[1] + t[2] - 'y' + m[1][2] * sizeof m;\n"
+        "}\n",
+        4 + 'b' + 'z' - 'y' + 6 * 24
+    );
+
+    // Objects without initializer still have their own slot in frame.
+    run("int main(void) { int i; i = 0; return i; }", 0);
+    run(
+        "int main(void) {\n"
+        "    int i, a[2];\n"
+        "    long l;\n"
+        "    a[0] = 1;\n"
+        "    a[1] = 2;\n"
+        "    l = 40;\n"
+        "    i = a[0] + a[1];\n"
+        "    return i + l;\n"
+        "}\n",
+        43
+    );
+
+    // Objects with static storage are initialized at compile time.
+    run(
+        "enum color { RED, GREEN = 5, BLUE };\n"
+        "typedef unsigned char byte;\n"
+        "int counter;\n"
+        "byte table[BLUE + 1] = {1, 2, 3};\n"
+        "char *name = \"tinyc\";\n"
+        "int next(void) { static int n = 10; return n++; }\n"
+        "int main(void) {\n"
+        "    counter += next() + next();\n"
+        "    return counter + sizeof table + table[2] + name[4];\n"
+        "}\n",
+        21 + 7 + 3 + 'c'
+    );
+}
+
+static void lookup(void) {
+    struct unit unit;
+    struct tinyc_jit_error error;
+    assert(compile(
+        &unit,
+        "int value = 42;\n"
+        "extern int other;\n"
+        "int square(int x) { return x * x; }\n",
+        &error
+    ));
+    int *value = tinyc_jit_lookup(&unit.jit, "value");
+    assert(value && *value == 42);
+    assert(tinyc_jit_lookup(&unit.jit, "square"));
+    assert(!tinyc_jit_lookup(&unit.jit, "other"));
+    assert(!tinyc_jit_lookup(&unit.jit, "missing"));
+
+    int status;
+    assert(!tinyc_jit_run(&unit.jit, 0, NULL, &status));
+    unit_free(&unit);
+}
+
+static void errors(void) {
+    error("int main(void) { return x; }", "undeclared identifier", 0, 24);
+    error("struct s { int a; } v;", "struct and union are not supported", 0, 0);
+    error(
+        "int main(void) { double d; }",
+        "floating types are not supported",
+        0,
+        17
+    );
+    error("int main(void) { break; }", "jump outside loop", 0, 17);
+    error("int main(void) { goto x; }", "undefined label", 0, 17);
+    error("int a[-1];", "array size is negative", 0, 5);
+    error("int main(void) { 1 = 2; }", "expression is not assignable", 0, 17);
+    error(
+        "int tinyc_undefined(void);\n"
+        "int main(void) { return tinyc_undefined(); }",
+        "undefined reference",
+        1,
+        24
+    );
+}
+
+static void conversions(void) {
+    const char *to_int = "pointer converted to integer without cast";
+    const char *to_pointer = "integer converted to pointer without cast";
+    error("int main(void) { int a[2]; return a; }", to_int, 0, 34);
+    error("int main(void) { int x = &x; return 0; }", to_int, 0, 25);
+    error("int main(void) { int *p; p = 1; return 0; }", to_pointer, 0, 29);
+    error(
+        "int f(int *p);\nint main(void) { return f(2); }",
+        to_pointer,
+        1,
+        26
+    );
+    error("int *p = 5;", to_pointer, 0, 9);
+
+    // Null pointer constant, cast and _Bool need no diagnostic.
+    run(
+        "int *g = 0;\n"
+        "int main(void) {\n"
+        "    int *p = 1 - 1;\n"
+        "    _Bool b = p;\n"
+        "    p = (int *)8;\n"
+        "    return b + (g == 0) + (int)(long)p;\n"
+        "}",
+        9
+    );
+}
+
+/// Make content of prefix, "0", n times of " + 1", and suffix.
+static char *sum(const char *prefix, size_t n, const char *suffix) {
+    char *s = malloc(strlen(prefix) + 2 + 4 * n + strlen(suffix));
+    assert(s);
+    strcpy(s, prefix);
+    strcat(s, "0");
+    for (size_t i = 0; i < n; ++i) strcat(s, " + 1");
+    strcat(s, suffix);
+    return s;
+}
+
+static void nesting(void) {
+    char *s = sum("int main(void) { return ", 1000, "; }");
+    run(s, 1000);
+    free(s);
+
+    // Long chain of operators isn't nested, as it's compiled by loop.
+    s = sum("int main(void) { return ", 20000, "; }");
+    run(s, 20000);
+    free(s);
+    s = sum("char a[", 20000, "]; int main(void) { return sizeof a; }");
+    run(s, 20000);
+    free(s);
+}
+
+int main(void) {
+    expressions();
+    statements();
+    functions();
+    objects();
+    lookup();
+    errors();
+    conversions();
+    nesting();
+}
@@ -0,0 +1,302 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <tinyc/lexer.h>
+
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+static const char *value_of(const struct tinyc_token *token) {
+    switch (token->kind) {
+        case TINYC_TOKEN_PUNCT:
+            return tinyc_token_punct_spelling(
+                ((const struct tinyc_token_punct *)token)->kind
+            );
+        case TINYC_TOKEN_IDENT:
+            return ((const struct tinyc_token_ident *)token)->value.cstr;
+        case TINYC_TOKEN_STRING:
+            return ((const struct tinyc_token_string *)token)->value.cstr;
+        case TINYC_TOKEN_CHAR:
+            return ((const struct tinyc_token_char *)token)->value.cstr;
+        case TINYC_TOKEN_PP_NUMBER:
+            return ((const struct tinyc_token_pp_number *)token)->value.cstr;
+        case TINYC_TOKEN_HEADER:
+            return ((const struct tinyc_token_header *)token)->path.cstr;
+        default:
+            return "";
+    }
+}
+
+static bool same_token(
+    const struct tinyc_token *t1,
+    const struct tinyc_token *t2
+) {
+    return t1->kind == t2->kind &&
+           t1->span.start.row == t2->span.start.row &&
+           t1->span.start.offset == t2->span.start.offset &&
+           t1->span.end.row == t2->span.end.row &&
+           t1->span.end.offset == t2->span.end.offset &&
+           strcmp(value_of(t1), value_of(t2)) == 0;
+}
+
+/// Returns true if lexer has the same tokens as lexing its source again.
+static bool same_as_fresh(struct tinyc_lexer *lexer) {
+    struct tinyc_lexer fresh;
+    assert(tinyc_lexer_init(&fresh, lexer->source, 0));
+    bool same = fresh.len == lexer->len;
+    for (size_t row = 0; same && row < fresh.len; ++row) {
+        const struct tinyc_token *t1 = tinyc_lexer_tokens(&fresh, row);
+        const struct tinyc_token *t2 = tinyc_lexer_tokens(lexer, row);
+        if (!t1 || !t2) {
+            same = t1 == t2;
+            continue;
+        }
+        const struct tinyc_token *it1 = t1, *it2 = t2;
+        do {
+            same = same && same_token(it1, it2);
+            it1 = it1->next;
+            it2 = it2->next;
+        } while (same && it1 != t1 && it2 != t2);
+        same = same && it1 == t1 && it2 == t2;
+    }
+    tinyc_lexer_free(&fresh);
+    return same;
+}
+
+static void check(
+    const struct tinyc_token **it,
+    enum tinyc_token_kind kind,
+    size_t offset,
+    const char *value
+) {
+    assert((*it)->kind == kind);
+    assert((*it)->span.start.offset == offset);
+    assert((*it)->span.end.offset == offset + strlen(value) - 1 ||
+           kind == TINYC_TOKEN_STRING || kind == TINYC_TOKEN_CHAR ||
+           kind == TINYC_TOKEN_HEADER);
+    assert(strcmp(value_of(*it), value) == 0);
+    *it = (*it)->next;
+}
+
+static void tokens(void) {
+    struct tinyc_source source;
+    assert(tinyc_source_from_str(
+        &source,
+        "a.c",
+        "#include <a.h>\n"
+        "x->y <<= 1.5e+3; // comment\n"
+        "\"s\\\"\" 'c' /* comment\n"
+        "comment */ a.b @"
+    ));
+    struct tinyc_lexer lexer;
+    assert(tinyc_lexer_init(&lexer, &source, 0));
+    assert(lexer.len == 4 && lexer.relexed == 4);
+
+    const struct tinyc_token *it = tinyc_lexer_tokens(&lexer, 0);
+    check(&it, TINYC_TOKEN_PUNCT, 0, "#");
+    check(&it, TINYC_TOKEN_IDENT, 1, "include");
+    check(&it, TINYC_TOKEN_HEADER, 9, "a.h");
+    assert(it == tinyc_lexer_tokens(&lexer, 0));
+
+    it = tinyc_lexer_tokens(&lexer, 1);
+    check(&it, TINYC_TOKEN_IDENT, 0, "x");
+    check(&it, TINYC_TOKEN_PUNCT, 1, "->");
+    check(&it, TINYC_TOKEN_IDENT, 3, "y");
+    check(&it, TINYC_TOKEN_PUNCT, 5, "<<=");
+    check(&it, TINYC_TOKEN_PP_NUMBER, 9, "1.5e+3");
+    check(&it, TINYC_TOKEN_PUNCT, 15, ";");
+    assert(it == tinyc_lexer_tokens(&lexer, 1));
+
+    it = tinyc_lexer_tokens(&lexer, 2);
+    check(&it, TINYC_TOKEN_STRING, 0, "s\\\"");
+    check(&it, TINYC_TOKEN_CHAR, 6, "c");
+    assert(it == tinyc_lexer_tokens(&lexer, 2));
+    assert(lexer.lines[3].state == TINYC_LEXER_COMMENT);
+
+    it = tinyc_lexer_tokens(&lexer, 3);
+    check(&it, TINYC_TOKEN_IDENT, 11, "a");
+    check(&it, TINYC_TOKEN_PUNCT, 12, ".");
+    check(&it, TINYC_TOKEN_IDENT, 13, "b");
+    assert(it == tinyc_lexer_tokens(&lexer, 3));
+
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+}
+
+static void create_source(struct tinyc_source *source, size_t nlines) {
+    struct tinyc_string content;
+    assert(tinyc_string_init(&content));
+    for (size_t i = 0; i < nlines; ++i) {
+        char line[64];
+        sprintf(line, "int x%zu = %zu;\n", i, i);
+        assert(tinyc_string_append(&content, line, strlen(line)));
+    }
+    assert(tinyc_source_from_str(source, "a.c", content.cstr));
+    tinyc_string_free(&content);
+}
+
+static void relex_edited_line(void) {
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    create_source(&source, 50000);
+    assert(tinyc_lexer_init(&lexer, &source, 0));
+
+    assert(tinyc_lexer_edit(&lexer, 25000, 4, 25000, 5, "y"));
+    assert(lexer.relexed == 1);
+    const struct tinyc_token *it = tinyc_lexer_tokens(&lexer, 25000);
+    check(&it, TINYC_TOKEN_IDENT, 0, "int");
+    check(&it, TINYC_TOKEN_IDENT, 4, "y25000");
+    assert(same_as_fresh(&lexer));
+
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+}
+
+static void relex_until_comment_closed(void) {
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    create_source(&source, 100);
+    assert(tinyc_lexer_init(&lexer, &source, 0));
+
+    // Opening comment changes all following lines.
+    assert(tinyc_lexer_edit(&lexer, 10, 0, 10, 0, "/*"));
+    assert(lexer.relexed == 90);
+    assert(!tinyc_lexer_tokens(&lexer, 50));
+    assert(same_as_fresh(&lexer));
+
+    // Closing it changes lines until end of the comment.
+    assert(tinyc_lexer_edit(&lexer, 20, 0, 20, 0, "*/"));
+    assert(lexer.relexed == 80);
+    assert(tinyc_lexer_edit(&lexer, 15, 0, 15, 0, "*/"));
+    assert(lexer.relexed == 6);
+    assert(same_as_fresh(&lexer));
+
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+}
+
+static void relex_inserted_lines(void) {
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    create_source(&source, 100);
+    assert(tinyc_lexer_init(&lexer, &source, 0));
+
+    assert(tinyc_lexer_edit(&lexer, 10, 0, 10, 0, "a\nb\nc\n"));
+    assert(lexer.len == 103 && lexer.relexed == 4);
+    const struct tinyc_token *it = tinyc_lexer_tokens(&lexer, 50);
+    assert(it->span.start.row == 50);
+    check(&it, TINYC_TOKEN_IDENT, 0, "int");
+    check(&it, TINYC_TOKEN_IDENT, 4, "x47");
+    assert(same_as_fresh(&lexer));
+
+    assert(tinyc_lexer_edit(&lexer, 5, 3, 60, 0, ""));
+    assert(lexer.len == 48 && lexer.relexed == 1);
+    assert(same_as_fresh(&lexer));
+
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+}
+
+static void edit_empty(void) {
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    assert(tinyc_source_from_str(&source, "a.c", ""));
+    assert(tinyc_lexer_init(&lexer, &source, 0));
+    assert(lexer.len == 0 && !tinyc_lexer_tokens(&lexer, 0));
+
+    assert(tinyc_lexer_edit(&lexer, 0, 0, 0, 0, "x\ny"));
+    assert(lexer.len == 2 && lexer.relexed == 2);
+    assert(same_as_fresh(&lexer));
+
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+}
+
+static void splices(void) {
+    struct tinyc_source source;
+    assert(tinyc_source_from_str(
+        &source,
+        "a.c",
+        "int ab\\\n"
+        "cd = 1;\r\n"
+        "#define X \\\r\n"
+        "  1\n"
+        "x\n"
+    ));
+    struct tinyc_lexer lexer;
+    assert(tinyc_lexer_init(&lexer, &source, 0));
+    assert(lexer.len == 5 && lexer.relexed == 5);
+
+    // Token across splice spans two rows.
+    const struct tinyc_token *it = tinyc_lexer_tokens(&lexer, 0);
+    check(&it, TINYC_TOKEN_IDENT, 0, "int");
+    assert(strcmp(value_of(it), "abcd") == 0);
+    assert(it->span.start.row == 0 && it->span.start.offset == 4);
+    assert(it->span.end.row == 1 && it->span.end.offset == 1);
+    it = it->next;
+    assert(it->span.start.row == 1 && it->span.start.offset == 3);
+    assert(lexer.lines[1].state == TINYC_LEXER_SPLICED);
+    assert(!tinyc_lexer_tokens(&lexer, 1));
+
+    it = tinyc_lexer_tokens(&lexer, 2);
+    check(&it, TINYC_TOKEN_PUNCT, 0, "#");
+    check(&it, TINYC_TOKEN_IDENT, 1, "define");
+    check(&it, TINYC_TOKEN_IDENT, 8, "X");
+    assert(it->span.start.row == 3 && it->span.start.offset == 2);
+
+    // Editing continuation lexes from beginning of logical line.
+    assert(tinyc_lexer_edit(&lexer, 1, 0, 1, 2, "ef"));
+    assert(lexer.relexed == 2);
+    it = tinyc_lexer_tokens(&lexer, 0)->next;
+    assert(strcmp(value_of(it), "abef") == 0);
+    assert(same_as_fresh(&lexer));
+
+    // Removing backslash splits logical line.
+    assert(tinyc_lexer_edit(&lexer, 0, 6, 0, 7, ""));
+    assert(lexer.relexed == 2);
+    it = tinyc_lexer_tokens(&lexer, 1);
+    check(&it, TINYC_TOKEN_IDENT, 0, "ef");
+    assert(same_as_fresh(&lexer));
+
+    // Adding backslash joins following line.
+    assert(tinyc_lexer_edit(&lexer, 3, 3, 3, 3, "\\"));
+    assert(lexer.relexed == 3);
+    it = tinyc_lexer_tokens(&lexer, 2)->prev;
+    assert(strcmp(value_of(it), "1x") == 0);
+    assert(it->span.end.row == 4 && it->span.end.offset == 0);
+    assert(same_as_fresh(&lexer));
+
+    // Spans across splice are moved with their lines.
+    assert(tinyc_lexer_edit(&lexer, 0, 0, 0, 0, "\n"));
+    it = tinyc_lexer_tokens(&lexer, 3)->prev;
+    assert(it->span.start.row == 4 && it->span.end.row == 5);
+    assert(same_as_fresh(&lexer));
+
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+}
+
+int main(void) {
+    tokens();
+    relex_edited_line();
+    relex_until_comment_closed();
+    relex_inserted_lines();
+    edit_empty();
+    splices();
+}
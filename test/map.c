@@ -0,0 +1,70 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <stdio.h>
+#include <tinyc/map.h>
+
+#include "tinyc/string.h"
+
+static void insert_query(void) {
+    struct tinyc_map map;
+    assert(tinyc_map_init(&map));
+
+    int v1, v2;
+    struct tinyc_string k1, k2, k3;
+    tinyc_string_from(&k1, "key1");
+    tinyc_string_from(&k2, "key2");
+    tinyc_string_from(&k3, "key3");
+    assert(tinyc_map_insert(&map, &k1, &v1));
+    assert(tinyc_map_insert(&map, &k2, &v2));
+
+    void *value;
+    assert(tinyc_map_query(&map, &k1, &value) && value == &v1);
+    assert(tinyc_map_query(&map, &k2, &value) && value == &v2);
+    assert(!tinyc_map_query(&map, &k3, &value));
+
+    assert(tinyc_map_insert(&map, &k1, &v2));
+    assert(tinyc_map_query(&map, &k1, &value) && value == &v2);
+    assert(map.len == 2);
+    tinyc_map_free(&map);
+}
+
+static void many_keys(void) {
+    struct tinyc_map map;
+    assert(tinyc_map_init(&map));
+
+    char buf[32];
+    for (size_t i = 0; i < 1000; ++i) {
+        struct tinyc_string key;
+        snprintf(buf, sizeof(buf), "key%zu", i);
+        tinyc_string_from(&key, buf);
+        assert(tinyc_map_insert(&map, &key, (void *)(i + 1)));
+    }
+    for (size_t i = 0; i < 1000; ++i) {
+        struct tinyc_string key;
+        void *value;
+        snprintf(buf, sizeof(buf), "key%zu", i);
+        tinyc_string_from(&key, buf);
+        assert(tinyc_map_query(&map, &key, &value));
+        assert(value == (void *)(i + 1));
+    }
+    assert(map.len == 1000);
+    tinyc_map_free(&map);
+}
+
+int main(void) {
+    insert_query();
+    many_keys();
+}
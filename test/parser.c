@@ -0,0 +1,285 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tinyc/parser.h>
+
+#include "tinyc/ast.h"
+#include "tinyc/lexer.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+
+/// Parse content, and compare dump of its tree with expect.
+static void parse(const char *content, const char *expect) {
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    struct tinyc_ast ast;
+    struct tinyc_parse_error error;
+    struct tinyc_string out;
+    assert(tinyc_source_from_str(&source, "test.c", content));
+    assert(tinyc_lexer_init(&lexer, &source, 0));
+    assert(tinyc_ast_init(&ast));
+    assert(tinyc_string_init(&out));
+    if (!tinyc_parse(&ast, &lexer, &error)) {
+        fprintf(stderr, "%s: %s\n", content, error.message);
+        assert(false);
+    }
+    assert(tinyc_ast_dump(&ast, ast.root, &out));
+    if (strcmp(out.cstr, expect) != 0) {
+        fprintf(stderr, "expect: %s\nactual: %s\n", expect, out.cstr);
+        assert(false);
+    }
+    tinyc_string_free(&out);
+    tinyc_ast_free(&ast);
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+}
+
+/// Parse content which has an error with message at row and offset.
+static void error(
+    const char *content,
+    const char *message,
+    size_t row,
+    size_t offset
+) {
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    struct tinyc_ast ast;
+    struct tinyc_parse_error error;
+    assert(tinyc_source_from_str(&source, "test.c", content));
+    assert(tinyc_lexer_init(&lexer, &source, 0));
+    assert(tinyc_ast_init(&ast));
+    assert(!tinyc_parse(&ast, &lexer, &error));
+    assert(strcmp(error.message, message) == 0);
+    assert(error.span.start.row == row);
+    assert(error.span.start.offset == offset);
+    tinyc_ast_free(&ast);
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+}
+
+static void ast(void) {
+    struct tinyc_ast ast;
+    struct tinyc_span span = {
+        0,
+        {0, 0},
+        {0, 1}
+    };
+    assert(tinyc_ast_init(&ast));
+    uint32_t name;
+    assert(tinyc_ast_add_string(&ast, "x", 1, &name) && name != 0);
+    const tinyc_ast_ref x = tinyc_ast_add(
+        &ast,
+        TINYC_AST_IDENT,
+        &span,
+        NULL,
+        0
+    );
+    const tinyc_ast_ref one = tinyc_ast_add(
+        &ast,
+        TINYC_AST_INT,
+        &span,
+        NULL,
+        0
+    );
+    assert(x && one);
+    ast.nodes[x].name = name;
+    ast.nodes[one].value = 1;
+    const tinyc_ast_ref children[] = {x, one};
+    const tinyc_ast_ref add = tinyc_ast_add(
+        &ast,
+        TINYC_AST_ADD,
+        &span,
+        children,
+        2
+    );
+    assert(add && tinyc_ast_child(&ast, add, 1) == one);
+    assert(strcmp(tinyc_ast_name(&ast, x), "x") == 0);
+
+    struct tinyc_string out;
+    assert(tinyc_string_init(&out));
+    assert(tinyc_ast_dump(&ast, add, &out));
+    assert(strcmp(out.cstr, "(+ (ident x) (int 1))") == 0);
+    tinyc_string_free(&out);
+    tinyc_ast_free(&ast);
+}
+
+static void declarations(void) {
+    parse(
+        "#include <stdio.h>\nstatic const unsigned long x = 1, *y;\n",
+        "(unit (decl x static (type const long unsigned) (int 1)) "
+        "(decl y static (pointer (type const long unsigned)) ()))"
+    );
+    parse(
+        "int (*f[2])(int a, ...);",
+        "(unit (decl f (array (pointer (function prototype ... (type int) "
+        "(param a (type int)))) (int 2)) ()))"
+    );
+    parse(
+        "typedef struct p { int x : 3, y; } P; P q = {1, {2}};",
+        "(unit (decl P typedef (struct p complete (field x (type int) (int 3)) "
+        "(field y (type int) ())) ()) "
+        "(decl q (type-name P) (init-list (int 1) (init-list (int 2)))))"
+    );
+    parse(
+        "enum e { A, B = 2 };",
+        "(unit (decl (enum e complete (enumerator A ()) "
+        "(enumerator B (int 2)))))"
+    );
+    parse(
+        "int main(void) { return 0; }",
+        "(unit (func main (function prototype (type int)) "
+        "(block (return (int 0)))))"
+    );
+}
+
+static void scopes(void) {
+    // Typedef name is shadowed by variable in inner scope, and parameter.
+    parse(
+        "typedef int T;\n"
+        "int f(int T) { return T * 2; }\n"
+        "int g(void) { T * p; { int T; T * 2; } T * q; }\n",
+        "(unit (decl T typedef (type int) ()) "
+        "(func f (function prototype (type int) (param T (type int))) "
+        "(block (return (* (ident T) (int 2))))) "
+        "(func g (function prototype (type int)) (block "
+        "(decl p (pointer (type-name T)) ()) "
+        "(block (decl T (type int) ()) (* (ident T) (int 2))) "
+        "(decl q (pointer (type-name T)) ()))))"
+    );
+}
+
+static void statements(void) {
+    parse(
+        "void f(int n) {\n"
+        "    for (int i = 0; i < n; i++) if (i) continue; else break;\n"
+        "    while (n) n -= 1;\n"
+        "    do ; while (0);\n"
+        "    switch (n) { case 1: default: goto end; }\n"
+        "end:\n"
+        "    return;\n"
+        "}\n",
+        "(unit (func f (function prototype (type void) (param n (type int))) "
+        "(block "
+        "(for (block (decl i (type int) (int 0))) (< (ident i) (ident n)) "
+        "(post++ (ident i)) (if (ident i) (continue) (break))) "
+        "(while (ident n) (= - (ident n) (int 1))) "
+        "(do (block) (int 0)) "
+        "(switch (ident n) (block (case (int 1) (default (goto end))))) "
+        "(label end (return ())))))"
+    );
+}
+
+static void expressions(void) {
+    parse(
+        "int x = a + b * c - d << 1 == e && f || g ? h : i;",
+        "(unit (decl x (type int) (?: (|| (&& (== (<< (- (+ (ident a) "
+        "(* (ident b) (ident c))) (ident d)) (int 1)) (ident e)) (ident f)) "
+        "(ident g)) (ident h) (ident i))))"
+    );
+    parse(
+        "int x = (long)-*p->q[0] + sizeof(int *) + sizeof x++;",
+        "(unit (decl x (type int) (+ (+ (cast (type long) (- (* (index "
+        "(-> q (ident p)) (int 0))))) (sizeof (pointer (type int)))) "
+        "(sizeof (post++ (ident x))))))"
+    );
+    parse(
+        "char *s = \"a\\n\" \"b\"; int c = '\\x41', n = 0x10u + 010LL;",
+        "(unit (decl s (pointer (type char)) (string \"a\nb\")) "
+        "(decl c (type int) (int 65)) "
+        "(decl n (type int) (+ (int 16 unsigned) (int 8 long long))))"
+    );
+    parse(
+        "int f(void) { a = b += f(1, 2), s.t; }",
+        "(unit (func f (function prototype (type int)) (block "
+        "(, (= (ident a) (= + (ident b) (call (ident f) (int 1) (int 2)))) "
+        "(. t (ident s))))))"
+    );
+}
+
+static void errors(void) {
+    error("int x = ;", "expected expression", 0, 8);
+    error("int f(void) {\n  return 1\n}", "expected ';'", 2, 0);
+    error("double d = 1.5;", "floating constant is not supported", 0, 11);
+    error("x;", "expected declaration", 0, 0);
+    error("int f(void) {", "expected '}'", 0, 12);
+}
+
+/// Make content of prefix, n times of open, body, n times of close, and
+/// suffix.
+static char *repeat(
+    const char *prefix,
+    const char *open,
+    const char *body,
+    const char *close,
+    const char *suffix,
+    size_t n
+) {
+    const size_t len = strlen(prefix) + strlen(body) + strlen(suffix) +
+                       (strlen(open) + strlen(close)) * n;
+    char *s = malloc(len + 1);
+    assert(s);
+    strcpy(s, prefix);
+    for (size_t i = 0; i < n; ++i) strcat(s, open);
+    strcat(s, body);
+    for (size_t i = 0; i < n; ++i) strcat(s, close);
+    strcat(s, suffix);
+    return s;
+}
+
+static void nesting(void) {
+    char *s = repeat("int x = ", "(", "1", ")", ";", 1000);
+    parse(s, "(unit (decl x (type int) (int 1)))");
+    free(s);
+
+    // Deeply nested constructs fail instead of overflowing stack.
+    s = repeat("int x = ", "(", "1", ")", ";", 20000);
+    error(s, "nesting too deep", 0, 8 + 1025);
+    free(s);
+    s = repeat("int x = ", "~", "1", "", ";", 20000);
+    error(s, "nesting too deep", 0, 8 + 1025);
+    free(s);
+    s = repeat("int x = ", "a = ", "1", "", ";", 20000);
+    error(s, "nesting too deep", 0, 8 + 4 * 1025);
+    free(s);
+    s = repeat("int f(void) ", "{", "", "}", "", 20000);
+    error(s, "nesting too deep", 0, 12 + 1025);
+    free(s);
+    s = repeat("int f(void) { ", "if (1) ", ";", "", " }", 20000);
+    error(s, "nesting too deep", 0, 14 + 7 * 1024);
+    free(s);
+    s = repeat("int ", "(", "x", ")", ";", 20000);
+    error(s, "nesting too deep", 0, 4 + 1025);
+    free(s);
+    s = repeat("int x", "[1]", "", "", ";", 20000);
+    error(s, "nesting too deep", 0, 5 + 3 * 1024 + 1);
+    free(s);
+    s = repeat("int x = ", "{", "1", "}", ";", 20000);
+    error(s, "nesting too deep", 0, 8 + 1025);
+    free(s);
+}
+
+int main(void) {
+    ast();
+    declarations();
+    scopes();
+    statements();
+    expressions();
+    errors();
+    nesting();
+}
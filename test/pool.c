@@ -0,0 +1,101 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <tinyc/pool.h>
+
+static struct tinyc_pool pool;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static size_t count;
+
+static void increment(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    count++;
+    pthread_mutex_unlock(&lock);
+}
+
+static void many_tasks(void) {
+    assert(tinyc_pool_init(&pool, 4));
+    count = 0;
+    for (size_t i = 0; i < 10000; ++i) {
+        assert(tinyc_pool_submit(&pool, increment, NULL));
+    }
+    tinyc_pool_wait(&pool);
+    assert(count == 10000);
+
+    // Pool can be reused after waiting.
+    assert(tinyc_pool_submit(&pool, increment, NULL));
+    tinyc_pool_wait(&pool);
+    assert(count == 10001);
+    tinyc_pool_free(&pool);
+}
+
+/// Submit arg children recursively, 4 levels in total.
+static void spawn(void *arg) {
+    const size_t depth = (size_t)arg;
+    increment(NULL);
+    if (depth == 3) return;
+    for (size_t i = 0; i < 4; ++i) {
+        assert(tinyc_pool_submit(&pool, spawn, (void *)(depth + 1)));
+    }
+}
+
+static void nested_tasks(void) {
+    assert(tinyc_pool_init(&pool, 3));
+    count = 0;
+    assert(tinyc_pool_submit(&pool, spawn, (void *)0));
+    tinyc_pool_wait(&pool);
+    assert(count == 1 + 4 + 16 + 64);
+    tinyc_pool_free(&pool);
+}
+
+/// Block until two of these are running at once.
+static void rendezvous(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    if (++count == 2) {
+        pthread_cond_broadcast(&cond);
+    } else {
+        while (count < 2) pthread_cond_wait(&cond, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void submit_pair(void *arg) {
+    (void)arg;
+    assert(tinyc_pool_submit(&pool, rendezvous, NULL));
+    assert(tinyc_pool_submit(&pool, rendezvous, NULL));
+}
+
+static void stealing(void) {
+    // Both tasks are queued to worker running submit_pair, so they can meet
+    // only if the other worker steals one of them.
+    assert(tinyc_pool_init(&pool, 2));
+    count = 0;
+    assert(tinyc_pool_submit(&pool, submit_pair, NULL));
+    tinyc_pool_wait(&pool);
+    assert(count == 2);
+    tinyc_pool_free(&pool);
+}
+
+int main(void) {
+    assert(tinyc_pool_ncpus() >= 1);
+    many_tasks();
+    nested_tasks();
+    stealing();
+}
@@ -0,0 +1,274 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+#include <tinyc/pp_expr.h>
+
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+static const struct {
+    const char *s;
+    enum tinyc_token_punct_kind kind;
+} puncts[] = {
+    {"(",  TINYC_TOKEN_PUNCT_LPAREN  },
+    {")",  TINYC_TOKEN_PUNCT_RPAREN  },
+    {"+",  TINYC_TOKEN_PUNCT_PLUS    },
+    {"-",  TINYC_TOKEN_PUNCT_MINUS   },
+    {"*",  TINYC_TOKEN_PUNCT_STAR    },
+    {"/",  TINYC_TOKEN_PUNCT_SLASH   },
+    {"<",  TINYC_TOKEN_PUNCT_LT      },
+    {">",  TINYC_TOKEN_PUNCT_GT      },
+    {">>", TINYC_TOKEN_PUNCT_RSHIFT  },
+    {"==", TINYC_TOKEN_PUNCT_EQ      },
+    {"!",  TINYC_TOKEN_PUNCT_EXC     },
+    {"&&", TINYC_TOKEN_PUNCT_AAMP    },
+    {"||", TINYC_TOKEN_PUNCT_VVERT   },
+    {"?",  TINYC_TOKEN_PUNCT_QUESTION},
+    {":",  TINYC_TOKEN_PUNCT_COLON   },
+};
+
+/// Create tokens from words separated by space. Returns last token.
+static struct tinyc_token *create_tokens(char *words) {
+    struct tinyc_token *last = NULL;
+    struct tinyc_span span = {0, {0, 0}, {0, 0}};
+    for (char *word = strtok(words, " "); word; word = strtok(NULL, " ")) {
+        struct tinyc_string s;
+        tinyc_string_from(&s, word);
+        struct tinyc_token *token = NULL;
+        if (isdigit((unsigned char)word[0])) {
+            token = tinyc_token_create_pp_number(&span, &s);
+        } else if (word[0] == '\'') {
+            // Characters inside quotes.
+            word[strlen(word) - 1] = '\0';
+            tinyc_string_from(&s, word + 1);
+            token = tinyc_token_create_char(&span, &s);
+        } else if (isalpha((unsigned char)word[0])) {
+            token = tinyc_token_create_ident(&span, &s);
+        } else {
+            for (size_t i = 0; i < sizeof(puncts) / sizeof(*puncts); ++i) {
+                if (strcmp(puncts[i].s, word) == 0) {
+                    token = tinyc_token_create_punct(&span, puncts[i].kind);
+                }
+            }
+        }
+        assert(token);
+        if (last) tinyc_token_insert(last, token);
+        last = token;
+    }
+    return last;
+}
+
+/// A is 2, B is 1u, F is complex, and others are not defined.
+static enum tinyc_pp_macro_kind lookup(
+    void *ctx,
+    const struct tinyc_string *name,
+    struct tinyc_pp_value *value
+) {
+    int *count = ctx;
+    (*count)++;
+    struct tinyc_pp_value v = {false, 0};
+    if (strcmp(name->cstr, "A") == 0) {
+        v.value = 2;
+    } else if (strcmp(name->cstr, "B") == 0) {
+        v.is_unsigned = true;
+        v.value = 1;
+    } else if (strcmp(name->cstr, "F") == 0) {
+        return TINYC_PP_MACRO_COMPLEX;
+    } else {
+        return TINYC_PP_MACRO_UNDEFINED;
+    }
+    if (value) *value = v;
+    return TINYC_PP_MACRO_VALUE;
+}
+
+static enum tinyc_pp_expr_status eval(
+    const char *expr,
+    struct tinyc_pp_value *result
+) {
+    char words[128];
+    strcpy(words, expr);
+    struct tinyc_token *last = create_tokens(words);
+
+    struct tinyc_pp_expr compiled;
+    enum tinyc_pp_expr_status status = tinyc_pp_expr_compile(
+        &compiled,
+        last->next,
+        last
+    );
+    if (status == TINYC_PP_EXPR_OK) {
+        int count = 0;
+        const char *error;
+        status = tinyc_pp_expr_eval(&compiled, lookup, &count, result, &error);
+    }
+    tinyc_pp_expr_free(&compiled);
+    return status;
+}
+
+static bool eval_signed(const char *expr, intmax_t expect) {
+    struct tinyc_pp_value v;
+    return eval(expr, &v) == TINYC_PP_EXPR_OK && !v.is_unsigned &&
+           (intmax_t)v.value == expect;
+}
+
+static bool eval_unsigned(const char *expr, uintmax_t expect) {
+    struct tinyc_pp_value v;
+    return eval(expr, &v) == TINYC_PP_EXPR_OK && v.is_unsigned &&
+           v.value == expect;
+}
+
+static void arithmetic(void) {
+    assert(eval_signed("1 + 2 * 3", 7));
+    assert(eval_signed("( 1 + 2 ) * 3", 9));
+    assert(eval_signed("10 - 2 - 3", 5));
+    assert(eval_signed("- 7 / 2", -3));
+    assert(eval_signed("- 8 >> 1", -4));
+    assert(eval_signed("0x10 + 010", 24));
+    assert(eval_signed("! 0 + ! 5", 1));
+}
+
+static void conversions(void) {
+    assert(eval_unsigned("0 - 1u", UINTMAX_MAX));
+    assert(eval_signed("- 1 < 0", 1));
+    assert(eval_signed("- 1 < 0u", 0));
+    assert(eval_unsigned("1 ? - 1 : 0u", UINTMAX_MAX));
+    assert(eval_unsigned("0xffffffffffffffff", UINTMAX_MAX));
+    assert(eval_signed("1u < 2", 1));
+    assert(eval_unsigned("B >> 0", 1));
+    assert(eval_signed("2 >> B", 1));
+}
+
+static void chars(void) {
+    assert(eval_signed("'A' == 65", 1));
+    assert(eval_signed("'\\n' + '\\x41' + '\\101' + '\\''", 10 + 65 + 65 + 39));
+    assert(eval_signed("'\\377'", -1));
+    assert(eval_signed("'\\0' < 1u", 1));
+    assert(eval_signed("'ab'", 'a' * 256 + 'b'));
+
+    struct tinyc_pp_value v;
+    assert(eval("''", &v) == TINYC_PP_EXPR_ERROR);
+}
+
+static void macros(void) {
+    assert(eval_signed("A * 3", 6));
+    assert(eval_signed("defined A && defined ( B )", 1));
+    assert(eval_signed("defined C || C", 0));
+    assert(eval_signed("C + 1", 1));
+
+    struct tinyc_pp_value v;
+    assert(eval("F + 1", &v) == TINYC_PP_EXPR_EXPAND);
+    assert(eval("G ( 1 )", &v) == TINYC_PP_EXPR_EXPAND);
+}
+
+static void unevaluated(void) {
+    assert(eval_signed("0 && 1 / 0", 0));
+    assert(eval_signed("1 || 1 / 0", 1));
+    assert(eval_signed("1 ? 2 : 1 / 0", 2));
+    assert(eval_signed("0 ? 1 / 0 : 3", 3));
+
+    struct tinyc_pp_value v;
+    assert(eval("1 && 1 / 0", &v) == TINYC_PP_EXPR_ERROR);
+    assert(eval("1 >> 64", &v) == TINYC_PP_EXPR_ERROR);
+}
+
+static void invalid(void) {
+    struct tinyc_pp_value v;
+    assert(eval("1 +", &v) == TINYC_PP_EXPR_ERROR);
+    assert(eval("( 1", &v) == TINYC_PP_EXPR_ERROR);
+    assert(eval("1 2", &v) == TINYC_PP_EXPR_ERROR);
+    assert(eval("1.0", &v) == TINYC_PP_EXPR_ERROR);
+    assert(eval("09", &v) == TINYC_PP_EXPR_ERROR);
+    assert(eval("18446744073709551615", &v) == TINYC_PP_EXPR_ERROR);
+    assert(eval("defined", &v) == TINYC_PP_EXPR_ERROR);
+
+    // Empty expression has no token.
+    struct tinyc_pp_expr compiled;
+    assert(tinyc_pp_expr_compile(&compiled, NULL, NULL) == TINYC_PP_EXPR_ERROR);
+    assert(strcmp(compiled.error, "expected expression") == 0);
+    tinyc_pp_expr_free(&compiled);
+}
+
+static void cache(void) {
+    struct tinyc_pp_expr_cache cache;
+    assert(tinyc_pp_expr_cache_init(&cache));
+
+    char words[] = "defined A && A > 1";
+    struct tinyc_token *last = create_tokens(words);
+    struct tinyc_span directive = {3, {10, 0}, {10, 2}};
+
+    const struct tinyc_pp_expr *e1 = tinyc_pp_expr_cache_get(
+        &cache,
+        &directive,
+        last->next,
+        last
+    );
+    assert(e1 && e1->status == TINYC_PP_EXPR_OK);
+    const size_t len = e1->len;
+
+    // Same location never compiles given tokens again.
+    char other[] = "0";
+    struct tinyc_token *dummy = create_tokens(other);
+    const struct tinyc_pp_expr *e2 = tinyc_pp_expr_cache_get(
+        &cache,
+        &directive,
+        dummy,
+        dummy
+    );
+    assert(e1 == e2);
+
+    struct tinyc_pp_value v;
+    const char *error;
+    int count = 0;
+    assert(tinyc_pp_expr_eval(e2, lookup, &count, &v, &error) ==
+           TINYC_PP_EXPR_OK);
+    assert(v.value == 1 && count == 2);
+
+    // Cache keeps entries across growth.
+    for (size_t i = 0; i < 200; ++i) {
+        struct tinyc_span span = {3, {i + 100, 0}, {i + 100, 2}};
+        assert(tinyc_pp_expr_cache_get(&cache, &span, dummy, dummy));
+    }
+    const struct tinyc_pp_expr *e3 = tinyc_pp_expr_cache_get(
+        &cache,
+        &directive,
+        dummy,
+        dummy
+    );
+    assert(e3 && e3->len == len);
+
+    // Empty expression is located at its directive.
+    struct tinyc_span empty = {3, {1, 0}, {1, 2}};
+    const struct tinyc_pp_expr *e4 = tinyc_pp_expr_cache_get(
+        &cache,
+        &empty,
+        NULL,
+        NULL
+    );
+    assert(e4 && e4->status == TINYC_PP_EXPR_ERROR);
+    assert(e4->span.start.row == 1 && e4->span.end.offset == 2);
+    tinyc_pp_expr_cache_free(&cache);
+}
+
+int main(void) {
+    arithmetic();
+    conversions();
+    chars();
+    macros();
+    unevaluated();
+    invalid();
+    cache();
+}
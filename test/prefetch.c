@@ -0,0 +1,173 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tinyc/prefetch.h>
+#include <unistd.h>
+
+#include "tinyc/header_search.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+
+static char root[] = "/tmp/tinyc-prefetch-XXXXXX";
+
+static void write_file(const char *name, const char *content) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s/%s", root, name);
+    FILE *fp = fopen(buf, "w");
+    assert(fp);
+    fputs(content, fp);
+    fclose(fp);
+}
+
+static void remove_file(const char *name) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s/%s", root, name);
+    remove(buf);
+}
+
+static tinyc_repo_id take(
+    struct tinyc_prefetch *prefetch,
+    struct tinyc_repo *repo,
+    bool is_std,
+    char *path
+) {
+    struct tinyc_string s;
+    tinyc_string_from(&s, path);
+    return tinyc_prefetch_take(prefetch, root, is_std, &s, repo);
+}
+
+static bool first_line_is(
+    const struct tinyc_repo *repo,
+    tinyc_repo_id id,
+    const char *expect
+) {
+    const struct tinyc_source *source = tinyc_repo_query(repo, id);
+    if (!source) return false;
+    const struct tinyc_source_line *line = tinyc_source_at(source, 0);
+    return line && strcmp(line->line.cstr, expect) == 0;
+}
+
+static void prefetch_tree(void) {
+    write_file("a.h", "#include <b.h>\n  #  include \"c.h\"\n");
+    write_file("b.h", "int b;\n");
+    write_file("c.h", "#include \"b.h\"\nint c;\n");
+
+    struct tinyc_header_search search;
+    assert(tinyc_header_search_init(&search));
+    assert(tinyc_header_search_add_dir(&search, root));
+
+    struct tinyc_prefetch prefetch;
+    assert(tinyc_prefetch_init(&prefetch, &search, 4));
+
+    struct tinyc_source main;
+    const char *content = "#include \"a.h\"\n#include <missing.h>\nint x;\n";
+    assert(tinyc_source_from_str(&main, "main.c", content));
+    assert(tinyc_prefetch_scan(&prefetch, &main, root));
+
+    struct tinyc_repo repo;
+    assert(tinyc_repo_init(&repo));
+    const tinyc_repo_id a = take(&prefetch, &repo, false, "a.h");
+    const tinyc_repo_id b = take(&prefetch, &repo, true, "b.h");
+    const tinyc_repo_id c = take(&prefetch, &repo, false, "c.h");
+    assert(a >= 0 && b >= 0 && c >= 0);
+    assert(first_line_is(&repo, a, "#include <b.h>"));
+    assert(first_line_is(&repo, b, "int b;"));
+    assert(first_line_is(&repo, c, "#include \"b.h\""));
+
+    // Same header is registered only once.
+    assert(take(&prefetch, &repo, false, "b.h") == b);
+    assert(take(&prefetch, &repo, true, "missing.h") < 0);
+
+    tinyc_prefetch_free(&prefetch);
+    tinyc_header_search_free(&search);
+    remove_file("a.h");
+    remove_file("b.h");
+    remove_file("c.h");
+}
+
+static void take_without_scan(void) {
+    write_file("d.h", "int d;\n");
+
+    struct tinyc_header_search search;
+    assert(tinyc_header_search_init(&search));
+    struct tinyc_prefetch prefetch;
+    assert(tinyc_prefetch_init(&prefetch, &search, 1));
+
+    struct tinyc_repo repo;
+    assert(tinyc_repo_init(&repo));
+    const tinyc_repo_id d = take(&prefetch, &repo, false, "d.h");
+    assert(d >= 0 && first_line_is(&repo, d, "int d;"));
+
+    tinyc_prefetch_free(&prefetch);
+    tinyc_header_search_free(&search);
+    remove_file("d.h");
+}
+
+static void take_source(void) {
+    write_file("e.h", "#include \"f.h\"\n");
+    write_file("f.h", "int f;\n");
+
+    struct tinyc_header_search search;
+    assert(tinyc_header_search_init(&search));
+    struct tinyc_prefetch prefetch;
+    assert(tinyc_prefetch_init(&prefetch, &search, 0));
+
+    struct tinyc_source main, source;
+    struct timespec mtime;
+    long long size;
+    char e[256], f[256];
+    snprintf(e, sizeof(e), "%s/e.h", root);
+    snprintf(f, sizeof(f), "%s/f.h", root);
+    assert(tinyc_source_from_str(&main, "main.c", "#include \"e.h\"\n"));
+    assert(tinyc_prefetch_scan(&prefetch, &main, root));
+
+    // Without workers, queued header is loaded and scanned when taken.
+    assert(tinyc_prefetch_take_source(&prefetch, e, &source, &mtime, &size));
+    tinyc_source_free(&source);
+    assert(tinyc_prefetch_take_source(&prefetch, f, &source, &mtime, &size));
+    assert(size == 7);
+    assert(strcmp(tinyc_source_at(&source, 0)->line.cstr, "int f;") == 0);
+    tinyc_source_free(&source);
+
+    // Each header is taken once, and unknown one is never loaded.
+    assert(!tinyc_prefetch_take_source(&prefetch, f, &source, &mtime, &size));
+    assert(!tinyc_prefetch_take_source(
+        &prefetch,
+        "x.h",
+        &source,
+        &mtime,
+        &size
+    ));
+
+    tinyc_source_free(&main);
+    tinyc_prefetch_free(&prefetch);
+    tinyc_header_search_free(&search);
+    remove_file("e.h");
+    remove_file("f.h");
+}
+
+int main(void) {
+    assert(mkdtemp(root));
+    prefetch_tree();
+    take_without_scan();
+    take_source();
+    rmdir(root);
+}
@@ -0,0 +1,182 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <tinyc/printer.h>
+
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+static struct tinyc_printer printer;
+
+static inline struct tinyc_span span_at(
+    tinyc_repo_id id,
+    size_t row,
+    size_t offset,
+    size_t len
+) {
+    struct tinyc_span span = {
+        id,
+        {row, offset          },
+        {row, offset + len - 1}
+    };
+    return span;
+}
+
+static struct tinyc_token *ident(
+    tinyc_repo_id id,
+    size_t row,
+    size_t offset,
+    char *name
+) {
+    struct tinyc_span span = span_at(id, row, offset, strlen(name));
+    struct tinyc_string s;
+    tinyc_string_from(&s, name);
+    return tinyc_token_create_ident(&span, &s);
+}
+
+static struct tinyc_token *punct(
+    tinyc_repo_id id,
+    size_t row,
+    size_t offset,
+    enum tinyc_token_punct_kind kind
+) {
+    const char *spelling = tinyc_token_punct_spelling(kind);
+    struct tinyc_span span = span_at(id, row, offset, strlen(spelling));
+    return tinyc_token_create_punct(&span, kind);
+}
+
+static inline void print(struct tinyc_token *token) {
+    assert(tinyc_printer_print(&printer, token));
+}
+
+static bool output_is(FILE *fp, const char *expect) {
+    char buf[256];
+    const size_t len = ftell(fp);
+    rewind(fp);
+    if (fread(buf, 1, len, fp) != len) return false;
+    buf[len] = '\0';
+    return strcmp(buf, expect) == 0;
+}
+
+static void spelling(void) {
+    const char *arrow = tinyc_token_punct_spelling(TINYC_TOKEN_PUNCT_ARROW);
+    const char *ssharp = tinyc_token_punct_spelling(TINYC_TOKEN_PUNCT_SSHARP);
+    const char *int_ = tinyc_token_keyword_spelling(TINYC_TOKEN_KEYWORD_INT);
+    const char *bool_ = tinyc_token_keyword_spelling(TINYC_TOKEN_KEYWORD__BOOL);
+    assert(strcmp(arrow, "->") == 0);
+    assert(strcmp(ssharp, "##") == 0);
+    assert(strcmp(int_, "int") == 0);
+    assert(strcmp(bool_, "_Bool") == 0);
+}
+
+static void single_line(void) {
+    struct tinyc_repo repo;
+    struct tinyc_source source;
+    tinyc_repo_init(&repo);
+    tinyc_source_from_str(&source, "a.c", "x = y+z;");
+    const tinyc_repo_id id = tinyc_repo_registory(&repo, &source);
+
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_printer_init(&printer, fp, &repo));
+    print(ident(id, 0, 0, "x"));
+    print(punct(id, 0, 2, TINYC_TOKEN_PUNCT_ASSIGN));
+    print(ident(id, 0, 4, "y"));
+    print(punct(id, 0, 5, TINYC_TOKEN_PUNCT_PLUS));
+    print(ident(id, 0, 6, "z"));
+    print(punct(id, 0, 7, TINYC_TOKEN_PUNCT_SEMICOLON));
+    assert(tinyc_printer_finish(&printer));
+    assert(output_is(fp, "# 1 \"a.c\"\nx = y+z;\n"));
+    fclose(fp);
+}
+
+static void line_markers(void) {
+    struct tinyc_repo repo;
+    struct tinyc_source s1, s2;
+    tinyc_repo_init(&repo);
+    tinyc_source_from_str(&s1, "a.c", "");
+    tinyc_source_from_str(&s2, "b.h", "");
+    const tinyc_repo_id a = tinyc_repo_registory(&repo, &s1);
+    const tinyc_repo_id b = tinyc_repo_registory(&repo, &s2);
+
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_printer_init(&printer, fp, &repo));
+    print(ident(a, 0, 0, "a"));
+    print(ident(a, 2, 4, "b"));
+    print(ident(b, 0, 0, "c"));
+    print(ident(a, 40, 0, "d"));
+    assert(tinyc_printer_finish(&printer));
+    assert(output_is(
+        fp,
+        "# 1 \"a.c\"\na\n\nb\n# 1 \"b.h\"\nc\n# 41 \"a.c\"\nd\n"
+    ));
+    fclose(fp);
+}
+
+static void avoid_paste(void) {
+    struct tinyc_repo repo;
+    struct tinyc_source source;
+    tinyc_repo_init(&repo);
+    tinyc_source_from_str(&source, "a.c", "");
+    const tinyc_repo_id id = tinyc_repo_registory(&repo, &source);
+
+    // Adjacent spans which would be lexed as other tokens if no space exists.
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_printer_init(&printer, fp, &repo));
+    print(punct(id, 0, 0, TINYC_TOKEN_PUNCT_PLUS));
+    print(punct(id, 0, 1, TINYC_TOKEN_PUNCT_PLUS));
+    print(punct(id, 0, 2, TINYC_TOKEN_PUNCT_MINUS));
+    print(punct(id, 0, 3, TINYC_TOKEN_PUNCT_GT));
+    print(ident(id, 0, 4, "a"));
+    print(ident(id, 0, 5, "b"));
+    print(punct(id, 0, 6, TINYC_TOKEN_PUNCT_LPAREN));
+    print(punct(id, 0, 7, TINYC_TOKEN_PUNCT_RPAREN));
+    assert(tinyc_printer_finish(&printer));
+    assert(output_is(fp, "# 1 \"a.c\"\n+ +- >a b()\n"));
+    fclose(fp);
+}
+
+static void quoted(void) {
+    struct tinyc_repo repo;
+    struct tinyc_source source;
+    tinyc_repo_init(&repo);
+    tinyc_source_from_str(&source, "dir\\\"x\".c", "");
+    const tinyc_repo_id id = tinyc_repo_registory(&repo, &source);
+
+    struct tinyc_string s, path;
+    tinyc_string_from(&s, "hi\\n");
+    tinyc_string_from(&path, "stdio.h");
+    struct tinyc_span span1 = span_at(id, 0, 0, 9);
+    struct tinyc_span span2 = span_at(id, 0, 10, 6);
+
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_printer_init(&printer, fp, &repo));
+    print(tinyc_token_create_header(&span1, true, &path));
+    print(tinyc_token_create_string(&span2, &s));
+    assert(tinyc_printer_finish(&printer));
+    assert(output_is(fp, "# 1 \"dir\\\\\\\"x\\\".c\"\n<stdio.h> \"hi\\n\"\n"));
+    fclose(fp);
+}
+
+int main(void) {
+    spelling();
+    single_line();
+    line_markers();
+    avoid_paste();
+    quoted();
+}
@@ -48,6 +48,37 @@ static void register_query(void) {
     assert(tinyc_repo_query(&repo, id2 + 1) == NULL);
 }
 
+static void remove_source(void) {
+    struct tinyc_repo repo;
+    struct tinyc_source source1, source2, source3, removed;
+    assert(tinyc_repo_init(&repo));
+    tinyc_source_from_str(&source1, "name1", "content1");
+    tinyc_source_from_str(&source2, "name2", "content2");
+    tinyc_source_from_str(&source3, "name3", "content3");
+    tinyc_repo_id id1 = tinyc_repo_registory(&repo, &source1);
+    tinyc_repo_id id2 = tinyc_repo_registory(&repo, &source2);
+    tinyc_repo_id id3 = tinyc_repo_registory(&repo, &source3);
+
+    // Entries before and after removed one are kept.
+    assert(tinyc_repo_remove(&repo, id2, &removed));
+    assert(removed.lines == source2.lines);
+    assert(tinyc_repo_query(&repo, id2) == NULL);
+    assert(!tinyc_repo_remove(&repo, id2, &removed));
+    assert(query_expect(&repo, id1, &source1));
+    assert(query_expect(&repo, id3, &source3));
+
+    // Head can be removed, and ids aren't reused.
+    assert(tinyc_repo_remove(&repo, id3, &removed));
+    assert(tinyc_repo_registory(&repo, &source2) > id3);
+    assert(query_expect(&repo, id1, &source1));
+
+    tinyc_repo_free(&repo);
+    tinyc_source_free(&source1);
+    tinyc_source_free(&source2);
+    tinyc_source_free(&source3);
+}
+
 int main(void) {
     register_query();
+    remove_source();
 }
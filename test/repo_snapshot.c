@@ -0,0 +1,141 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <tinyc/repo_snapshot.h>
+#include <unistd.h>
+
+#include "tinyc/diag.h"
+#include "tinyc/printer.h"
+#include "tinyc/repo.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+static char root[] = "/tmp/tinyc-snapshot-XXXXXX";
+static char path[256];
+static struct tinyc_printer printer;
+
+static void setup(struct tinyc_repo *repo) {
+    struct tinyc_source s1, s2, s3;
+    assert(tinyc_repo_init(repo));
+    assert(tinyc_source_from_str(&s1, "prelude.h", "int a;\n\nint b;\n"));
+    assert(tinyc_source_from_str(&s2, "sys/\"x\".h", "x"));
+    assert(tinyc_source_from_str(&s3, "empty.h", ""));
+    assert(tinyc_repo_registory(repo, &s1) == 0);
+    assert(tinyc_repo_registory(repo, &s2) == 1);
+    assert(tinyc_repo_registory(repo, &s3) == 2);
+}
+
+/// Print some tokens and diagnostics with repo into buf.
+static void output(const struct tinyc_repo *repo, char *buf, size_t size) {
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_printer_init(&printer, fp, repo));
+    struct tinyc_span spans[] = {
+        {0, {0, 4}, {0, 4}},
+        {1, {0, 0}, {0, 0}},
+        {0, {2, 4}, {2, 4}},
+    };
+    for (size_t i = 0; i < sizeof(spans) / sizeof(*spans); ++i) {
+        struct tinyc_string s;
+        tinyc_string_from(&s, "v");
+        assert(tinyc_printer_print(
+            &printer,
+            tinyc_token_create_ident(&spans[i], &s)
+        ));
+    }
+    assert(tinyc_printer_finish(&printer));
+    struct tinyc_span lines = {
+        0,
+        {0, 0},
+        {2, 5}
+    };
+    tinyc_diag_fs(fp, TINYC_DIAG_ERROR, repo, &spans[1], "w", "m");
+    tinyc_diag_fs(fp, TINYC_DIAG_WARN, repo, &lines, "w", "m");
+
+    const size_t len = ftell(fp);
+    rewind(fp);
+    assert(len < size && fread(buf, 1, len, fp) == len);
+    buf[len] = '\0';
+    fclose(fp);
+}
+
+static void same_output(void) {
+    struct tinyc_repo original, restored;
+    setup(&original);
+    assert(tinyc_repo_snapshot_save(&original, path));
+
+    struct tinyc_repo_snapshot snapshot;
+    assert(tinyc_repo_init(&restored));
+    assert(tinyc_repo_snapshot_load(&snapshot, path, &restored));
+    assert(restored.next_id == 3);
+    const struct tinyc_source *empty = tinyc_repo_query(&restored, 2);
+    assert(empty && strcmp(empty->name.cstr, "empty.h") == 0);
+    assert(empty->lines == NULL);
+
+    char expect[1024], actual[1024];
+    output(&original, expect, sizeof(expect));
+    output(&restored, actual, sizeof(actual));
+    assert(strcmp(expect, actual) == 0);
+
+    // Sources registered after snapshot get following ids.
+    struct tinyc_source source;
+    assert(tinyc_source_from_str(&source, "main.c", "int main;"));
+    assert(tinyc_repo_registory(&restored, &source) == 3);
+
+    tinyc_repo_snapshot_free(&snapshot);
+}
+
+static void rejected(void) {
+    struct tinyc_repo repo, nonempty;
+    struct tinyc_repo_snapshot snapshot;
+    setup(&nonempty);
+    assert(tinyc_repo_snapshot_save(&nonempty, path));
+
+    // Repository must be empty.
+    assert(!tinyc_repo_snapshot_load(&snapshot, path, &nonempty));
+
+    // Truncated file.
+    struct stat st;
+    assert(stat(path, &st) == 0);
+    assert(truncate(path, st.st_size - 8) == 0);
+    assert(tinyc_repo_init(&repo));
+    assert(!tinyc_repo_snapshot_load(&snapshot, path, &repo));
+    assert(snapshot.map == NULL);
+
+    // Other version.
+    assert(tinyc_repo_snapshot_save(&nonempty, path));
+    FILE *fp = fopen(path, "r+b");
+    assert(fp && fseek(fp, 4, SEEK_SET) == 0 && fputc(0xff, fp) != EOF);
+    fclose(fp);
+    assert(tinyc_repo_init(&repo));
+    assert(!tinyc_repo_snapshot_load(&snapshot, path, &repo));
+
+    remove(path);
+    assert(!tinyc_repo_snapshot_load(&snapshot, path, &repo));
+}
+
+int main(void) {
+    assert(mkdtemp(root));
+    snprintf(path, sizeof(path), "%s/prelude.snap", root);
+    same_output();
+    rejected();
+    rmdir(root);
+}
@@ -0,0 +1,608 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <tinyc/session.h>
+#include <unistd.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/diag_json.h"
+#include "tinyc/map.h"
+#include "tinyc/repo.h"
+#include "tinyc/string.h"
+#include "tinyc/token_cache.h"
+
+static char root[] = "/tmp/tinyc-session-XXXXXX";
+
+static void write_file(const char *name, const char *content) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", root, name);
+    FILE *fp = fopen(path, "w");
+    assert(fp && fputs(content, fp) >= 0);
+    fclose(fp);
+}
+
+/// Set modification time of file, so change is visible in any resolution.
+static void set_mtime(const char *name, time_t sec) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", root, name);
+    const struct timespec times[2] = {
+        {sec, 0},
+        {sec, 0}
+    };
+    assert(utimensat(AT_FDCWD, path, times, 0) == 0);
+}
+
+static bool compile(
+    struct tinyc_session *session,
+    const char *name,
+    char *out,
+    size_t size
+) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", root, name);
+    FILE *fp = tmpfile();
+    assert(fp);
+    const bool ok = tinyc_session_compile(session, path, fp);
+    const size_t len = ftell(fp);
+    rewind(fp);
+    assert(len < size && fread(out, 1, len, fp) == len);
+    out[len] = '\0';
+    fclose(fp);
+    return ok;
+}
+
+static void warm(void) {
+    write_file("a.h", "#include \"b.h\"\nint a;\n");
+    write_file("b.h", "#include \"a.h\"\nint b;\n");
+    write_file("main.c", "#include \"a.h\"\n#include \"b.h\"\nint main;\n");
+    write_file("bad.c", "#include \"a.h\"\n #include <none.h>\n");
+    set_mtime("a.h", 1000);
+
+    struct tinyc_session session;
+    char out[1024];
+    assert(tinyc_session_init(&session));
+    assert(compile(&session, "main.c", out, sizeof(out)));
+    assert(strcmp(out, "") == 0);
+    assert(session.loaded == 3 && session.reused == 0);
+
+    // Headers already loaded are reused.
+    assert(!compile(&session, "bad.c", out, sizeof(out)));
+    assert(strstr(out, "error: missing header") != NULL);
+    assert(strstr(out, "     1 |  #include <none.h>") != NULL);
+    assert(session.loaded == 4 && session.reused == 2);
+
+    // Touched file keeps its source, changed file gets new one.
+    char path[256];
+    snprintf(path, sizeof(path), "%s/a.h", root);
+    const tinyc_repo_id a = tinyc_session_load(&session, path);
+    set_mtime("a.h", 2000);
+    assert(tinyc_session_load(&session, path) == a);
+    write_file("a.h", "#include \"b.h\"\nint a, c;\n");
+    set_mtime("a.h", 3000);
+    assert(tinyc_session_load(&session, path) > a);
+    assert(session.repo.next_id == 5);
+    assert(tinyc_repo_query(&session.repo, a) == NULL);
+
+    tinyc_session_free(&session);
+}
+
+static size_t count_sources(const struct tinyc_repo *repo) {
+    size_t n = 0;
+    for (struct tinyc_repo_entry *it = repo->head; it; it = it->next) n++;
+    return n;
+}
+
+static void edits(void) {
+    struct tinyc_session session;
+    char out[1024], content[64];
+    assert(tinyc_session_init(&session));
+
+    // Each save registers new source, and old one is released.
+    for (int i = 0; i < 100; ++i) {
+        snprintf(content, sizeof(content), "int x%d;\n", i);
+        write_file("edit.c", content);
+        set_mtime("edit.c", 1000 + i);
+        assert(compile(&session, "edit.c", out, sizeof(out)));
+        assert(count_sources(&session.repo) == 1);
+    }
+    assert(session.repo.next_id == 100 && session.stale_len == 0);
+
+    // Source replaced while compiling is released when compilation ends.
+    char path[256];
+    snprintf(path, sizeof(path), "%s/edit.c", root);
+    const tinyc_repo_id old = tinyc_session_load(&session, path);
+    session.active++;
+    write_file("edit.c", "int y;\n");
+    set_mtime("edit.c", 2000);
+    assert(tinyc_session_load(&session, path) > old);
+    assert(tinyc_repo_query(&session.repo, old) != NULL);
+    session.active--;
+    assert(compile(&session, "edit.c", out, sizeof(out)));
+    assert(tinyc_repo_query(&session.repo, old) == NULL);
+    assert(count_sources(&session.repo) == 1);
+
+    tinyc_session_free(&session);
+}
+
+static void prefetch_headers(void) {
+    write_file("a.h", "#include \"b.h\"\nint a;\n");
+    write_file("b.h", "#include \"a.h\"\nint b;\n");
+    write_file("main.c", "#include \"a.h\"\n#include \"b.h\"\nint main;\n");
+
+    // Headers are taken from prefetcher, as they're queued before reached.
+    struct tinyc_session session;
+    char out[1024];
+    assert(tinyc_session_init(&session));
+    assert(tinyc_session_prefetch(&session, 2));
+    assert(compile(&session, "main.c", out, sizeof(out)));
+    assert(strcmp(out, "") == 0);
+    assert(session.loaded == 3 && session.prefetched == 2);
+
+    // Header changed after it's taken is read again.
+    write_file("a.h", "#include <none.h>\n");
+    set_mtime("a.h", 4000);
+    assert(!compile(&session, "main.c", out, sizeof(out)));
+    assert(strstr(out, "a.h:0:0: error: missing header"));
+    assert(session.loaded == 4 && session.prefetched == 2);
+    tinyc_session_free(&session);
+}
+
+static void *serve(void *arg) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/sock", root);
+    assert(tinyc_session_serve(arg, path));
+    return NULL;
+}
+
+static void request(const char *line, char *out, size_t size) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/sock", root);
+
+    // Server may not be listening yet.
+    int fd = -1;
+    for (int i = 0; i < 1000 && fd < 0; ++i) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        assert(fd >= 0);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+            nanosleep(&(struct timespec){0, 1000000}, NULL);
+        }
+    }
+    assert(fd >= 0);
+    assert(write(fd, line, strlen(line)) == (ssize_t)strlen(line));
+
+    size_t len = 0;
+    ssize_t n;
+    while ((n = read(fd, out + len, size - len - 1)) > 0) len += n;
+    out[len] = '\0';
+    close(fd);
+}
+
+/// Leave socket at path as if server crashed.
+static void bind_stale(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    assert(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    close(fd);
+}
+
+static void server(void) {
+    struct tinyc_session session;
+    pthread_t thread;
+    char path[256];
+    assert(tinyc_session_init(&session));
+
+    // Regular file is never replaced.
+    write_file("sock", "notes\n");
+    snprintf(path, sizeof(path), "%s/sock", root);
+    assert(!tinyc_session_serve(&session, path));
+    struct stat st;
+    assert(stat(path, &st) == 0 && S_ISREG(st.st_mode));
+    remove(path);
+
+    // Stale socket is replaced.
+    bind_stale(path);
+    assert(pthread_create(&thread, NULL, serve, &session) == 0);
+
+    char line[512], out[1024];
+    snprintf(line, sizeof(line), "compile %s/main.c\n", root);
+    request(line, out, sizeof(out));
+    assert(strcmp(out, "ok\n") == 0);
+
+    // Socket of live server is kept.
+    struct tinyc_session other;
+    assert(tinyc_session_init(&other));
+    assert(!tinyc_session_serve(&other, path));
+    tinyc_session_free(&other);
+    request(line, out, sizeof(out));
+    assert(strcmp(out, "ok\n") == 0);
+    snprintf(line, sizeof(line), "compile %s/bad.c\n", root);
+    request(line, out, sizeof(out));
+    assert(strstr(out, "missing header") && strstr(out, "\nerror\n"));
+    request("shutdown\n", out, sizeof(out));
+    assert(strcmp(out, "ok\n") == 0);
+
+    assert(pthread_join(thread, NULL) == 0);
+    assert(session.loaded == 4 && session.reused == 5);
+    tinyc_session_free(&session);
+}
+
+static void parallel(void) {
+    char names[16][32];
+    char paths[16][256];
+    char *inputs[17];
+    for (size_t i = 0; i < 16; ++i) {
+        snprintf(names[i], sizeof(names[i]), "tu%zu.c", i);
+        snprintf(paths[i], sizeof(paths[i]), "%s/%s", root, names[i]);
+        write_file(names[i], i % 4 ? "#include \"a.h\"\n" : "#include <x>\n");
+        inputs[i] = paths[i];
+    }
+    char missing[256];
+    snprintf(missing, sizeof(missing), "%s/missing.c", root);
+    inputs[16] = missing;
+
+    // Output is same regardless of number of threads.
+    char expect[8192], actual[8192];
+    for (size_t nthreads = 1; nthreads <= 8; nthreads *= 2) {
+        struct tinyc_session session;
+        assert(tinyc_session_init(&session));
+        FILE *fp = tmpfile();
+        assert(fp);
+        assert(!tinyc_session_compile_all(&session, inputs, 17, nthreads, fp));
+        const size_t len = ftell(fp);
+        rewind(fp);
+        assert(len < sizeof(actual) && fread(actual, 1, len, fp) == len);
+        actual[len] = '\0';
+        fclose(fp);
+
+        // Shared headers are loaded once.
+        assert(session.loaded == 16 + 2);
+        if (nthreads == 1) {
+            strcpy(expect, actual);
+            assert(strstr(expect, "tu0.c:0:0: error: missing header"));
+            assert(strstr(expect, "failed to read"));
+        }
+        assert(strcmp(expect, actual) == 0);
+        tinyc_session_free(&session);
+    }
+    for (size_t i = 0; i < 16; ++i) remove(paths[i]);
+}
+
+static const struct tinyc_session_file *file_of(
+    struct tinyc_session *session,
+    const char *name
+) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", root, name);
+    struct tinyc_string key;
+    tinyc_string_from(&key, path);
+    void *value;
+    assert(tinyc_map_query(&session->files, &key, &value));
+    return value;
+}
+
+static const struct tinyc_session_cost *cost_of(
+    struct tinyc_session *session,
+    const char *name
+) {
+    return &file_of(session, name)->cost;
+}
+
+static void cost(void) {
+    write_file("a.h", "#include \"b.h\"\nint a;\n");
+    write_file("b.h", "#include \"a.h\"\nint b;\n");
+    write_file("main.c", "#include \"a.h\"\n#include \"b.h\"\nint main;\n");
+    write_file("bad.c", "#include \"a.h\"\n #include <none.h>\n");
+
+    struct tinyc_session session;
+    char out[1024];
+    assert(tinyc_session_init(&session));
+    assert(compile(&session, "main.c", out, sizeof(out)));
+    assert(!compile(&session, "bad.c", out, sizeof(out)));
+
+    // Every include directive counts, even if the header is skipped.
+    const struct tinyc_session_cost *a = cost_of(&session, "a.h");
+    const struct tinyc_session_cost *b = cost_of(&session, "b.h");
+    const struct tinyc_session_cost *main = cost_of(&session, "main.c");
+    assert(a->includes == 4 && b->includes == 3 && main->includes == 1);
+    assert(main->inclusive_ns >= main->exclusive_ns);
+
+    // Lines and tokens are counted only when reported.
+    assert(!main->counted && main->lines == 0);
+    assert(!a->counted && a->lines == 0);
+
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_session_report(&session, 2, fp));
+    const size_t len = ftell(fp);
+    rewind(fp);
+    assert(len < sizeof(out) && fread(out, 1, len, fp) == len);
+    out[len] = '\0';
+    fclose(fp);
+    assert(strstr(out, "incl(us)"));
+    size_t nlines = 0;
+    for (const char *c = out; *c; ++c) nlines += *c == '\n';
+    assert(nlines == 3);
+
+    fp = tmpfile();
+    assert(fp && tinyc_session_report(&session, SIZE_MAX, fp));
+    fclose(fp);
+    assert(main->counted && main->lines == 3 && main->tokens == 9);
+    assert(a->counted && a->lines == 2 && a->tokens == 6);
+
+    tinyc_session_free(&session);
+}
+
+static void cached_cost(void) {
+    write_file("cached.c", "int x;\nint y;\n");
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%s/cache", root);
+    assert(mkdir(dir, 0700) == 0);
+
+    // First report lexes file and saves its tokens.
+    struct tinyc_session session;
+    char out[1024];
+    assert(tinyc_session_init(&session));
+    session.token_cache = dir;
+    assert(compile(&session, "cached.c", out, sizeof(out)));
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_session_report(&session, SIZE_MAX, fp));
+    fclose(fp);
+    const struct tinyc_session_cost *cost = cost_of(&session, "cached.c");
+    assert(cost->lines == 2 && cost->tokens == 6);
+    struct tinyc_string path;
+    const uint64_t key = file_of(&session, "cached.c")->key;
+    assert(tinyc_token_cache_path(&path, dir, key));
+    assert(access(path.cstr, F_OK) == 0);
+    tinyc_session_free(&session);
+
+    // Next session loads tokens from cache instead of lexing, so emptied
+    // cache file is trusted.
+    assert(tinyc_token_cache_save(path.cstr, key, NULL, NULL));
+    assert(tinyc_session_init(&session));
+    session.token_cache = dir;
+    assert(compile(&session, "cached.c", out, sizeof(out)));
+    fp = tmpfile();
+    assert(fp && tinyc_session_report(&session, SIZE_MAX, fp));
+    fclose(fp);
+    cost = cost_of(&session, "cached.c");
+    assert(cost->lines == 2 && cost->tokens == 0);
+    tinyc_session_free(&session);
+
+    assert(tinyc_token_cache_evict(dir, 0));
+    assert(rmdir(dir) == 0);
+    tinyc_string_free(&path);
+}
+
+static void encoding(void) {
+    write_file("latin1.h", "int caf\xe9;\n");
+    write_file("enc.c", "#include \"latin1.h\"\nint x;\n");
+
+    // Invalid encoding is only warned.
+    struct tinyc_session session;
+    char out[1024];
+    assert(tinyc_session_init(&session));
+    assert(compile(&session, "enc.c", out, sizeof(out)));
+    assert(strstr(out, "latin1.h:0:7: warning: invalid encoding"));
+    assert(!strstr(out, "enc.c"));
+
+    // Same diagnostic is written as JSON, and nothing to out.
+    static struct tinyc_diag_json json;
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_diag_json_init(&json, fp, TINYC_DIAG_JSON_LINES));
+    session.json = &json;
+    assert(compile(&session, "enc.c", out, sizeof(out)) && !*out);
+    assert(tinyc_diag_json_finish(&json) && json.count == 1);
+    const size_t len = ftell(fp);
+    rewind(fp);
+    assert(len < sizeof(out) && fread(out, 1, len, fp) == len);
+    out[len] = '\0';
+    fclose(fp);
+    assert(strstr(out, "{\"severity\":\"warning\",\"file\":"));
+    assert(strstr(out, "latin1.h\",\"start\":{\"row\":0,\"offset\":7}"));
+    assert(strstr(out, "\"what\":\"invalid encoding\""));
+    tinyc_session_free(&session);
+}
+
+static void shared_header(void) {
+    char names[8][32];
+    char paths[8][256];
+    char *inputs[8];
+    write_file("shared.h", "int caf\xe9;\n");
+    for (size_t i = 0; i < 8; ++i) {
+        snprintf(names[i], sizeof(names[i]), "s%zu.c", i);
+        snprintf(paths[i], sizeof(paths[i]), "%s/%s", root, names[i]);
+        write_file(names[i], "#include \"shared.h\"\n#include <none.h>\n");
+        inputs[i] = paths[i];
+    }
+
+    // Diagnostics of each file are in emitted order, whichever file loaded
+    // shared header first.
+    char outs[2][8192];
+    const size_t nthreads[] = {1, 4};
+    for (size_t i = 0; i < 2; ++i) {
+        struct tinyc_session session;
+        assert(tinyc_session_init(&session));
+        FILE *fp = tmpfile();
+        assert(fp);
+        assert(!tinyc_session_compile_all(
+            &session,
+            inputs,
+            8,
+            nthreads[i],
+            fp
+        ));
+        const size_t len = ftell(fp);
+        rewind(fp);
+        assert(len < sizeof(outs[i]) && fread(outs[i], 1, len, fp) == len);
+        outs[i][len] = '\0';
+        fclose(fp);
+        tinyc_session_free(&session);
+    }
+    assert(strcmp(outs[0], outs[1]) == 0);
+    const char *it = outs[0];
+    for (size_t i = 0; i < 8; ++i) {
+        char error[512];
+        snprintf(error, sizeof(error), "%s:1:0: error: missing", paths[i]);
+        it = strstr(it, "shared.h:0:7: warning: invalid encoding");
+        assert(it && (it = strstr(it, error)));
+    }
+    for (size_t i = 0; i < 8; ++i) remove(paths[i]);
+}
+
+static void run(void) {
+    write_file("run.c", "int main(int argc, char **argv) { return argc; }\n");
+    write_file("syntax.c", "int main(void) { return }\n");
+
+    struct tinyc_session session;
+    char path[256];
+    char arg0[] = "run.c", arg1[] = "x";
+    char *argv[] = {arg0, arg1, NULL};
+    int status = -1;
+    assert(tinyc_session_init(&session));
+    snprintf(path, sizeof(path), "%s/run.c", root);
+    assert(tinyc_session_run(&session, path, 2, argv, stderr, &status));
+    assert(status == 2);
+
+    FILE *fp = tmpfile();
+    char out[1024];
+    assert(fp);
+    snprintf(path, sizeof(path), "%s/syntax.c", root);
+    assert(!tinyc_session_run(&session, path, 1, argv, fp, &status));
+    const size_t len = ftell(fp);
+    rewind(fp);
+    assert(len < sizeof(out) && fread(out, 1, len, fp) == len);
+    out[len] = '\0';
+    fclose(fp);
+    assert(strstr(out, "syntax.c:0:24: error: syntax error"));
+    tinyc_session_free(&session);
+}
+
+/// Allocator counts allocations made while it's scoped.
+struct counter {
+    size_t allocs, frees;
+};
+
+static void *count_alloc(void *ctx, size_t size) {
+    ((struct counter *)ctx)->allocs++;
+    return malloc(size);
+}
+
+static void *count_realloc(void *ctx, void *ptr, size_t size) {
+    if (!ptr) ((struct counter *)ctx)->allocs++;
+    return realloc(ptr, size);
+}
+
+static void count_free(void *ctx, void *ptr) {
+    ((struct counter *)ctx)->frees++;
+    free(ptr);
+}
+
+static void request_scope(void) {
+    write_file("scope.c", "int a;\n");
+    write_file("scope_bad.c", "#include <none.h>\n");
+
+    struct tinyc_session session;
+    char out[1024];
+    assert(tinyc_session_init(&session));
+    struct counter counter = {0, 0};
+    const struct tinyc_allocator allocator = {
+        count_alloc,
+        count_realloc,
+        count_free,
+        &counter,
+    };
+
+    // Session doesn't allocate from allocator scoped to request, even on its
+    // worker threads, so it survives the request.
+    assert(tinyc_allocator_scope(&allocator) == NULL);
+    char paths[2][256];
+    char *argv[] = {paths[0], paths[1]};
+    snprintf(paths[0], sizeof(paths[0]), "%s/scope.c", root);
+    snprintf(paths[1], sizeof(paths[1]), "%s/scope_bad.c", root);
+    FILE *fp = tmpfile();
+    assert(fp);
+    assert(!tinyc_session_compile_all(&session, argv, 2, 2, fp));
+    fclose(fp);
+    assert(counter.allocs == 0);
+
+    struct tinyc_string s;
+    assert(tinyc_string_from_copy(&s, "request"));
+    tinyc_string_free(&s);
+    assert(tinyc_allocator_scope(NULL) == &allocator);
+    assert(counter.allocs == 1 && counter.frees == 1);
+
+    assert(compile(&session, "scope.c", out, sizeof(out)));
+    tinyc_session_free(&session);
+}
+
+static void cleanup(void) {
+    const char *files[] = {
+        "a.h",
+        "b.h",
+        "main.c",
+        "bad.c",
+        "latin1.h",
+        "enc.c",
+        "run.c",
+        "syntax.c",
+        "shared.h",
+        "scope.c",
+        "scope_bad.c",
+        "edit.c",
+        "cached.c",
+    };
+    char path[256];
+    for (size_t i = 0; i < sizeof(files) / sizeof(*files); ++i) {
+        snprintf(path, sizeof(path), "%s/%s", root, files[i]);
+        remove(path);
+    }
+    rmdir(root);
+}
+
+int main(void) {
+    signal(SIGPIPE, SIG_IGN);
+    assert(mkdtemp(root));
+    warm();
+    edits();
+    server();
+    parallel();
+    cost();
+    cached_cost();
+    prefetch_headers();
+    encoding();
+    shared_header();
+    run();
+    request_scope();
+    cleanup();
+}
@@ -92,6 +92,74 @@ static void lines_at(void) {
     assert(!line4);
 }
 
+static void edit(void) {
+    struct tinyc_source source;
+    struct tinyc_source_index index;
+    size_t n;
+    assert(tinyc_source_from_str(&source, "name", "line1\nline2\nline3"));
+    assert(tinyc_source_index_init(&index, &source));
+    const struct tinyc_source_line *line2 = index.lines[1];
+
+    // Replace within a line.
+    assert(tinyc_source_edit(&source, &index, 1, 0, 1, 4, "LINE", &n));
+    assert(n == 1 && index.lines[1] == line2);
+    assert(check_lines(&source, 3, (char *[3]){"line1", "LINE2", "line3"}));
+
+    // Split a line, then join lines.
+    assert(tinyc_source_edit(&source, &index, 0, 4, 0, 4, "\nx\n", &n));
+    assert(n == 3 && index.len == 5);
+    assert(check_lines(
+        &source,
+        5,
+        (char *[5]){"line", "x", "1", "LINE2", "line3"}
+    ));
+    assert(tinyc_source_edit(&source, &index, 0, 2, 3, 2, "", &n));
+    assert(n == 1 && index.len == 2);
+    assert(check_lines(&source, 2, (char *[2]){"liNE2", "line3"}));
+    assert(strcmp(index.lines[1]->line.cstr, "line3") == 0);
+
+    // Out of range.
+    assert(!tinyc_source_edit(&source, &index, 2, 0, 2, 0, "", &n));
+    assert(!tinyc_source_edit(&source, &index, 1, 6, 1, 6, "", &n));
+    assert(!tinyc_source_edit(&source, NULL, 1, 3, 1, 2, "", &n));
+
+    // Without index.
+    assert(tinyc_source_edit(&source, NULL, 1, 5, 1, 5, "\nline4", &n));
+    assert(check_lines(&source, 3, (char *[3]){"liNE2", "line3", "line4"}));
+
+    tinyc_source_index_free(&index);
+    tinyc_source_free(&source);
+}
+
+static void edit_empty(void) {
+    struct tinyc_source source;
+    size_t n;
+    assert(tinyc_source_from_str(&source, "name", ""));
+    assert(tinyc_source_edit(&source, NULL, 0, 0, 0, 0, "a\nb", &n));
+    assert(n == 2);
+    assert(check_lines(&source, 2, (char *[2]){"a", "b"}));
+    tinyc_source_free(&source);
+}
+
+static void validate(void) {
+    struct tinyc_source source;
+    size_t row, offset;
+    assert(tinyc_source_from_str(&source, "name", "a\n\xc3\xa9\n"));
+    assert(source.utf8 && tinyc_source_validate(&source, &row, &offset));
+
+    // Edit can break encoding.
+    size_t n;
+    assert(tinyc_source_edit(&source, NULL, 1, 2, 1, 2, "\xe9", &n));
+    assert(!source.utf8 && !tinyc_source_validate(&source, &row, &offset));
+    assert(row == 1 && offset == 2);
+    tinyc_source_free(&source);
+
+    assert(tinyc_source_from_str(&source, "name", "a\nb\xc3\xa9\xc3\n"));
+    assert(!tinyc_source_validate(&source, &row, &offset));
+    assert(row == 1 && offset == 3);
+    tinyc_source_free(&source);
+}
+
 int main(void) {
     init_from_str();
     init_from_file();
@@ -99,4 +167,7 @@ int main(void) {
     empty_source();
     with_empty_line();
     lines_at();
+    edit();
+    edit_empty();
+    validate();
 }
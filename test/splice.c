@@ -0,0 +1,88 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <assert.h>
+#include <string.h>
+#include <tinyc/splice.h>
+
+#include "tinyc/source.h"
+#include "tinyc/span.h"
+
+static struct tinyc_source source;
+static struct tinyc_source_index lines;
+
+static void load(const char *content) {
+    assert(tinyc_source_from_str(&source, "a.c", content));
+    assert(tinyc_source_index_init(&lines, &source));
+}
+
+static void unload(void) {
+    tinyc_source_index_free(&lines);
+    tinyc_source_free(&source);
+}
+
+static bool at(
+    const struct tinyc_splice *splice,
+    size_t offset,
+    size_t row,
+    size_t physical
+) {
+    const struct tinyc_position pos = tinyc_splice_position(splice, offset);
+    return pos.row == row && pos.offset == physical;
+}
+
+static void no_splice(void) {
+    struct tinyc_splice splice;
+    tinyc_splice_init(&splice);
+    load("int x;\nint y;\n");
+
+    // Physical line is used as is.
+    assert(tinyc_splice_build(&splice, lines.lines, lines.len, 1));
+    assert(splice.cstr == lines.lines[1]->line.cstr);
+    assert(splice.len == 6 && splice.row == 1 && splice.nrows == 1);
+    assert(splice.npoints == 0 && splice.buf.cap == 0);
+    assert(at(&splice, 4, 1, 4));
+
+    unload();
+    tinyc_splice_free(&splice);
+}
+
+static void joined(void) {
+    struct tinyc_splice splice;
+    tinyc_splice_init(&splice);
+    load("a\\\nbc\\\r\n\\\nd\r\ne\\");
+
+    assert(tinyc_splice_build(&splice, lines.lines, lines.len, 0));
+    assert(strcmp(splice.cstr, "abcd") == 0 && splice.len == 4);
+    assert(splice.row == 0 && splice.nrows == 4 && splice.npoints == 3);
+    assert(at(&splice, 0, 0, 0));
+    assert(at(&splice, 1, 1, 0));
+    assert(at(&splice, 2, 1, 1));
+    assert(at(&splice, 3, 3, 0));  // Empty line 2 is skipped.
+    assert(at(&splice, 4, 3, 1));
+
+    // Backslash at end of source is dropped.
+    assert(tinyc_splice_build(&splice, lines.lines, lines.len, 4));
+    assert(strcmp(splice.cstr, "e") == 0);
+    assert(splice.nrows == 1 && splice.npoints == 0);
+
+    unload();
+    tinyc_splice_free(&splice);
+}
+
+int main(void) {
+    no_splice();
+    joined();
+}
@@ -0,0 +1,107 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <tinyc/stats.h>
+
+#include "tinyc/allocator.h"
+#include "tinyc/source.h"
+#include "tinyc/span.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+#ifdef TINYC_STATS
+static const struct tinyc_stats_counter *counter(
+    const struct tinyc_stats *stats,
+    enum tinyc_stats_subsystem subsystem
+) {
+    return &stats->subsystems[subsystem];
+}
+
+static void count_subsystems(void) {
+    struct tinyc_stats stats;
+    tinyc_stats_reset();
+
+    struct tinyc_source source;
+    assert(tinyc_source_from_str(&source, "a.c", "a\nb\n"));
+    assert(tinyc_stats_query(&stats));
+    assert(counter(&stats, TINYC_STATS_SOURCE)->allocs == 2);
+    assert(counter(&stats, TINYC_STATS_STRING)->allocs == 3);
+    assert(counter(&stats, TINYC_STATS_SOURCE)->live_bytes > 0);
+
+    tinyc_source_free(&source);
+    assert(tinyc_stats_query(&stats));
+    assert(counter(&stats, TINYC_STATS_SOURCE)->frees == 2);
+    assert(counter(&stats, TINYC_STATS_SOURCE)->live_bytes == 0);
+    assert(counter(&stats, TINYC_STATS_STRING)->live_bytes == 0);
+    assert(counter(&stats, TINYC_STATS_STRING)->peak_bytes > 0);
+    assert(stats.peak_bytes > 0);
+
+    struct tinyc_span span = {
+        0,
+        {0, 0},
+        {0, 0}
+    };
+    struct tinyc_token *token = tinyc_token_create_punct(
+        &span,
+        TINYC_TOKEN_PUNCT_DOT
+    );
+    assert(tinyc_stats_query(&stats));
+    assert(counter(&stats, TINYC_STATS_TOKEN)->allocs == 1);
+    assert(counter(&stats, TINYC_STATS_TOKEN)->live_bytes ==
+           sizeof(struct tinyc_token_punct));
+    tinyc_free(token);
+}
+
+static void count_reallocs(void) {
+    struct tinyc_stats stats;
+    struct tinyc_string s;
+    tinyc_stats_reset();
+    assert(tinyc_string_init(&s));
+    assert(tinyc_string_fill(&s, 'a', 1000));
+    assert(tinyc_stats_query(&stats));
+    const struct tinyc_stats_counter *string = counter(
+        &stats,
+        TINYC_STATS_STRING
+    );
+    assert(string->allocs == 1 && string->reallocs == 1);
+    assert(string->live_bytes == s.cap && string->realloc_bytes == s.cap);
+    tinyc_string_free(&s);
+}
+
+static void dump(void) {
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_stats_dump(fp));
+    assert(ftell(fp) > 0);
+    fclose(fp);
+}
+#else
+static void disabled(void) {
+    struct tinyc_stats stats;
+    assert(!tinyc_stats_query(&stats));
+    assert(!tinyc_stats_dump(stdout));
+}
+#endif
+
+int main(void) {
+#ifdef TINYC_STATS
+    count_subsystems();
+    count_reallocs();
+    dump();
+#else
+    disabled();
+#endif
+}
@@ -62,6 +62,23 @@ static void push_extend(void) {
     assert(s.cstr[count] == '\0');
 }
 
+static void fill(void) {
+    struct tinyc_string s;
+    tinyc_string_init(&s);
+    const size_t init_cap = s.cap;
+
+    tinyc_string_push(&s, 'a');
+    tinyc_string_fill(&s, '^', init_cap);
+    tinyc_string_fill(&s, ' ', 0);
+
+    assert(s.len == init_cap + 1);
+    assert(s.cstr[0] == 'a');
+    for (size_t i = 1; i <= init_cap; i++) {
+        assert(s.cstr[i] == '^');
+    }
+    assert(s.cstr[init_cap + 1] == '\0');
+}
+
 static void cmp_less(void) {
     struct tinyc_string s1, s2;
     tinyc_string_from(&s1, "aaa");
@@ -87,6 +104,7 @@ int main(void) {
     from_str();
     push();
     push_extend();
+    fill();
     cmp_less();
     cmp_greater();
     cmp_equal();
@@ -0,0 +1,105 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <tinyc/symtab.h>
+
+#include "tinyc/string.h"
+
+static void *lookup(
+    const struct tinyc_symtab *symtab,
+    enum tinyc_symtab_ns ns,
+    char *name
+) {
+    struct tinyc_string key;
+    tinyc_string_from(&key, name);
+    const struct tinyc_symtab_symbol *symbol = tinyc_symtab_lookup(
+        symtab,
+        ns,
+        &key
+    );
+    return symbol ? symbol->value : NULL;
+}
+
+static void declare(
+    struct tinyc_symtab *symtab,
+    enum tinyc_symtab_ns ns,
+    char *name,
+    void *value
+) {
+    struct tinyc_string key;
+    tinyc_string_from(&key, name);
+    assert(tinyc_symtab_declare(symtab, ns, &key, value));
+}
+
+static void shadow(void) {
+    int a, b, c, d;
+    struct tinyc_symtab symtab;
+    assert(tinyc_symtab_init(&symtab));
+    declare(&symtab, TINYC_SYMTAB_ORDINARY, "x", &a);
+    declare(&symtab, TINYC_SYMTAB_TAG, "x", &b);
+
+    // Inner scope shadows outer one until it's left.
+    assert(tinyc_symtab_push(&symtab));
+    declare(&symtab, TINYC_SYMTAB_ORDINARY, "x", &c);
+    declare(&symtab, TINYC_SYMTAB_ORDINARY, "y", &d);
+    assert(lookup(&symtab, TINYC_SYMTAB_ORDINARY, "x") == &c);
+    assert(lookup(&symtab, TINYC_SYMTAB_TAG, "x") == &b);
+    assert(lookup(&symtab, TINYC_SYMTAB_ORDINARY, "y") == &d);
+    declare(&symtab, TINYC_SYMTAB_ORDINARY, "x", &d);
+    assert(lookup(&symtab, TINYC_SYMTAB_ORDINARY, "x") == &d);
+    assert(symtab.len == 4);
+    tinyc_symtab_pop(&symtab);
+
+    assert(lookup(&symtab, TINYC_SYMTAB_ORDINARY, "x") == &a);
+    assert(lookup(&symtab, TINYC_SYMTAB_ORDINARY, "y") == NULL);
+    assert(lookup(&symtab, TINYC_SYMTAB_LABEL, "x") == NULL);
+    assert(symtab.len == 2);
+
+    // File scope is never left.
+    tinyc_symtab_pop(&symtab);
+    assert(lookup(&symtab, TINYC_SYMTAB_ORDINARY, "x") == &a);
+    tinyc_symtab_free(&symtab);
+}
+
+static void deep(void) {
+    static int values[10000];
+    struct tinyc_symtab symtab;
+    assert(tinyc_symtab_init(&symtab));
+    char name[32];
+    for (size_t i = 0; i < 10000; ++i) {
+        assert(tinyc_symtab_push(&symtab));
+        snprintf(name, sizeof(name), "v%zu", i % 100);
+        declare(&symtab, TINYC_SYMTAB_ORDINARY, name, &values[i]);
+    }
+
+    // Keys are shared by all scopes.
+    assert(symtab.nkeys == 100 && symtab.depth == 10000);
+    assert(lookup(&symtab, TINYC_SYMTAB_ORDINARY, "v0") == &values[9900]);
+    for (size_t i = 10000; i-- > 0;) {
+        snprintf(name, sizeof(name), "v%zu", i % 100);
+        assert(lookup(&symtab, TINYC_SYMTAB_ORDINARY, name) == &values[i]);
+        tinyc_symtab_pop(&symtab);
+    }
+    assert(symtab.len == 0);
+    assert(lookup(&symtab, TINYC_SYMTAB_ORDINARY, "v0") == NULL);
+    tinyc_symtab_free(&symtab);
+}
+
+int main(void) {
+    shadow();
+    deep();
+}
@@ -0,0 +1,301 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <tinyc/token_cache.h>
+#include <unistd.h>
+
+#include "tinyc/lexer.h"
+#include "tinyc/source.h"
+#include "tinyc/string.h"
+#include "tinyc/token.h"
+
+static char root[] = "/tmp/tinyc-token-cache-XXXXXX";
+
+static struct tinyc_token *tokens(void) {
+    struct tinyc_span span = {
+        0,
+        {3, 1},
+        {3, 5}
+    };
+    struct tinyc_string ident, str, path;
+    tinyc_string_from(&ident, "value");
+    tinyc_string_from(&str, "a\\\"b");
+    tinyc_string_from(&path, "stdio.h");
+
+    struct tinyc_token *first = tinyc_token_create_header(&span, true, &path);
+    span.start.row = span.end.row = 4;
+    tinyc_token_insert(
+        first->prev,
+        tinyc_token_create_keyword(&span, TINYC_TOKEN_KEYWORD_INT)
+    );
+    span.start.offset = 4;
+    tinyc_token_insert(first->prev, tinyc_token_create_ident(&span, &ident));
+    tinyc_token_insert(
+        first->prev,
+        tinyc_token_create_punct(&span, TINYC_TOKEN_PUNCT_ASSIGN)
+    );
+    span.end.row = 5;
+    tinyc_token_insert(first->prev, tinyc_token_create_string(&span, &str));
+    return first;
+}
+
+static bool same_token(
+    const struct tinyc_token *t1,
+    const struct tinyc_token *t2
+) {
+    if (t1->kind != t2->kind ||
+        t1->span.start.row != t2->span.start.row ||
+        t1->span.start.offset != t2->span.start.offset ||
+        t1->span.end.row != t2->span.end.row ||
+        t1->span.end.offset != t2->span.end.offset) {
+        return false;
+    }
+    switch (t1->kind) {
+        case TINYC_TOKEN_PUNCT:
+            return ((const struct tinyc_token_punct *)t1)->kind ==
+                   ((const struct tinyc_token_punct *)t2)->kind;
+        case TINYC_TOKEN_KEYWORD:
+            return ((const struct tinyc_token_keyword *)t1)->kind ==
+                   ((const struct tinyc_token_keyword *)t2)->kind;
+        case TINYC_TOKEN_IDENT:
+            return strcmp(
+                       ((const struct tinyc_token_ident *)t1)->value.cstr,
+                       ((const struct tinyc_token_ident *)t2)->value.cstr
+                   ) == 0;
+        case TINYC_TOKEN_STRING:
+            return strcmp(
+                       ((const struct tinyc_token_string *)t1)->value.cstr,
+                       ((const struct tinyc_token_string *)t2)->value.cstr
+                   ) == 0;
+        case TINYC_TOKEN_HEADER: {
+            const struct tinyc_token_header *h1 = (const void *)t1;
+            const struct tinyc_token_header *h2 = (const void *)t2;
+            return h1->is_std == h2->is_std &&
+                   strcmp(h1->path.cstr, h2->path.cstr) == 0;
+        }
+        default:
+            return true;
+    }
+}
+
+static void round_trip(void) {
+    struct tinyc_source s1, s2;
+    assert(tinyc_source_from_str(&s1, "a.h", "int value = \"\";"));
+    assert(tinyc_source_from_str(&s2, "b.h", "int value = \"\"; "));
+    const uint64_t key = tinyc_token_cache_key(&s1);
+    assert(key != tinyc_token_cache_key(&s2));
+
+    struct tinyc_string path;
+    assert(tinyc_token_cache_path(&path, root, key));
+    struct tinyc_token *saved = tokens();
+    assert(tinyc_token_cache_save(path.cstr, key, saved, saved->prev));
+
+    struct tinyc_token_cache cache;
+    struct tinyc_token *loaded;
+    assert(tinyc_token_cache_load(&cache, path.cstr, key, 7, &loaded));
+    const struct tinyc_token *t1 = saved, *t2 = loaded;
+    do {
+        assert(t2->span.id == 7);
+        assert(same_token(t1, t2));
+        t1 = t1->next;
+        t2 = t2->next;
+    } while (t1 != saved);
+    assert(t2 == loaded);
+
+    // Loaded strings point into the mapping.
+    const struct tinyc_token_ident *ident = (const void *)loaded->next->next;
+    assert(ident->value.cap == 0);
+    assert((char *)ident->value.cstr > (char *)cache.map);
+    assert((char *)ident->value.cstr < (char *)cache.map + cache.size);
+
+    // Tokens are placed in single block in order.
+    assert((void *)loaded == cache.tokens);
+    for (const struct tinyc_token *t = loaded; t->next != loaded; t = t->next) {
+        assert((const char *)t < (const char *)t->next);
+    }
+    tinyc_token_cache_free(&cache);
+
+    // Other key is rejected.
+    assert(!tinyc_token_cache_load(&cache, path.cstr, key + 1, 7, &loaded));
+    assert(cache.map == NULL);
+
+    // Empty token list.
+    assert(tinyc_token_cache_save(path.cstr, key, NULL, NULL));
+    assert(tinyc_token_cache_load(&cache, path.cstr, key, 0, &loaded));
+    assert(loaded == NULL);
+    tinyc_token_cache_free(&cache);
+
+    remove(path.cstr);
+    tinyc_string_free(&path);
+}
+
+static void broken(void) {
+    struct tinyc_string path;
+    assert(tinyc_token_cache_path(&path, root, 1));
+    struct tinyc_token *saved = tokens();
+    assert(tinyc_token_cache_save(path.cstr, 1, saved, saved->prev));
+
+    // Truncated file.
+    struct stat st;
+    assert(stat(path.cstr, &st) == 0);
+    assert(truncate(path.cstr, st.st_size - 1) == 0);
+    struct tinyc_token_cache cache;
+    struct tinyc_token *loaded;
+    assert(!tinyc_token_cache_load(&cache, path.cstr, 1, 0, &loaded));
+
+    // String not terminated.
+    assert(tinyc_token_cache_save(path.cstr, 1, saved, saved->prev));
+    FILE *fp = fopen(path.cstr, "r+b");
+    assert(fp && fseek(fp, -1, SEEK_END) == 0 && fputc('x', fp) != EOF);
+    fclose(fp);
+    assert(!tinyc_token_cache_load(&cache, path.cstr, 1, 0, &loaded));
+
+    // Missing file.
+    remove(path.cstr);
+    assert(!tinyc_token_cache_load(&cache, path.cstr, 1, 0, &loaded));
+    tinyc_string_free(&path);
+}
+
+static void lexer_rows(void) {
+    struct tinyc_source source;
+    struct tinyc_lexer lexer;
+    assert(tinyc_source_from_str(&source, "c.h", "int a;\n\n#x <y.h>\n b"));
+    assert(tinyc_lexer_init(&lexer, &source, 0));
+    const uint64_t key = tinyc_token_cache_key(&source);
+    struct tinyc_string path;
+    assert(tinyc_token_cache_path(&path, root, key));
+    assert(tinyc_token_cache_save_lexer(path.cstr, key, &lexer));
+
+    // Tokens of all rows are saved in order, skipping empty rows.
+    struct tinyc_token_cache cache;
+    struct tinyc_token *loaded;
+    assert(tinyc_token_cache_load(&cache, path.cstr, key, 0, &loaded));
+    const struct tinyc_token *t2 = loaded;
+    size_t n = 0;
+    for (size_t row = 0; row < lexer.len; ++row) {
+        const struct tinyc_token *first = tinyc_lexer_tokens(&lexer, row);
+        const struct tinyc_token *t1 = first;
+        if (!t1) continue;
+        do {
+            assert(same_token(t1, t2));
+            t1 = t1->next;
+            t2 = t2->next;
+            n++;
+        } while (t1 != first);
+    }
+    assert(n > 0 && t2 == loaded);
+    tinyc_token_cache_free(&cache);
+
+    remove(path.cstr);
+    tinyc_string_free(&path);
+    tinyc_lexer_free(&lexer);
+    tinyc_source_free(&source);
+}
+
+static void *save_same(void *arg) {
+    const char *path = arg;
+    struct tinyc_token *saved = tokens();
+    for (size_t i = 0; i < 100; ++i) {
+        assert(tinyc_token_cache_save(path, 2, saved, saved->prev));
+    }
+    return NULL;
+}
+
+static void concurrent(void) {
+    struct tinyc_string path;
+    assert(tinyc_token_cache_path(&path, root, 2));
+
+    // Threads saving same key never share temporary file.
+    pthread_t threads[4];
+    for (size_t i = 0; i < 4; ++i) {
+        assert(pthread_create(&threads[i], NULL, save_same, path.cstr) == 0);
+    }
+    for (size_t i = 0; i < 4; ++i) pthread_join(threads[i], NULL);
+
+    struct tinyc_token_cache cache;
+    struct tinyc_token *loaded;
+    assert(tinyc_token_cache_load(&cache, path.cstr, 2, 0, &loaded));
+    tinyc_token_cache_free(&cache);
+
+    // No temporary file is left.
+    DIR *dir = opendir(root);
+    size_t files = 0;
+    assert(dir);
+    for (struct dirent *e = readdir(dir); e; e = readdir(dir)) {
+        files += e->d_name[0] != '.';
+    }
+    closedir(dir);
+    assert(files == 1);
+
+    remove(path.cstr);
+    tinyc_string_free(&path);
+}
+
+static void set_used(const char *path, time_t sec) {
+    struct timespec times[2] = {
+        {sec, 0},
+        {sec, 0}
+    };
+    assert(utimensat(AT_FDCWD, path, times, 0) == 0);
+}
+
+static void evict(void) {
+    struct tinyc_string paths[3];
+    struct tinyc_token *saved = tokens();
+    for (uint64_t i = 0; i < 3; ++i) {
+        assert(tinyc_token_cache_path(&paths[i], root, i));
+        assert(tinyc_token_cache_save(paths[i].cstr, i, saved, saved->prev));
+        set_used(paths[i].cstr, 1000 + i);
+    }
+    struct stat st;
+    assert(stat(paths[0].cstr, &st) == 0);
+    const size_t size = st.st_size;
+
+    // Loading file 0 makes file 1 least recently used.
+    struct tinyc_token_cache cache;
+    struct tinyc_token *loaded;
+    assert(tinyc_token_cache_load(&cache, paths[0].cstr, 0, 0, &loaded));
+    tinyc_token_cache_free(&cache);
+
+    assert(tinyc_token_cache_evict(root, size * 2));
+    assert(access(paths[0].cstr, F_OK) == 0);
+    assert(access(paths[1].cstr, F_OK) != 0);
+    assert(access(paths[2].cstr, F_OK) == 0);
+
+    assert(tinyc_token_cache_evict(root, 0));
+    for (size_t i = 0; i < 3; ++i) {
+        assert(access(paths[i].cstr, F_OK) != 0);
+        tinyc_string_free(&paths[i]);
+    }
+}
+
+int main(void) {
+    assert(mkdtemp(root));
+    round_trip();
+    broken();
+    lexer_rows();
+    concurrent();
+    evict();
+    rmdir(root);
+}
@@ -0,0 +1,93 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <tinyc/trace.h>
+
+static bool read_all(FILE *fp, char *buf, size_t size) {
+    const size_t len = ftell(fp);
+    rewind(fp);
+    if (len >= size || fread(buf, 1, len, fp) != len) return false;
+    buf[len] = '\0';
+    return true;
+}
+
+static size_t count(const char *s, const char *pattern) {
+    size_t n = 0;
+    for (; (s = strstr(s, pattern)); ++s) ++n;
+    return n;
+}
+
+static void disabled(void) {
+    assert(!tinyc_trace_enabled());
+    tinyc_trace_begin("ignored", NULL);
+    tinyc_trace_end();
+    FILE *fp = tmpfile();
+    assert(fp && !tinyc_trace_finish(fp));
+    assert(ftell(fp) == 0);
+    fclose(fp);
+}
+
+static void *work(void *arg) {
+    tinyc_trace_begin("thread", arg);
+    tinyc_trace_end();
+    return NULL;
+}
+
+static void nested_and_threads(void) {
+    assert(tinyc_trace_start());
+    assert(!tinyc_trace_start());
+    tinyc_trace_begin("outer", "a \"quoted\" name");
+    tinyc_trace_begin("inner", NULL);
+    tinyc_trace_end();
+    tinyc_trace_end();
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, work, "t") == 0);
+    pthread_join(thread, NULL);
+    tinyc_trace_begin("unclosed", NULL);
+
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_trace_finish(fp));
+    char s[4096];
+    assert(read_all(fp, s, sizeof(s)));
+    assert(strncmp(s, "{\"traceEvents\":[", 16) == 0);
+    assert(count(s, "\"ph\":\"B\"") == 4 && count(s, "\"ph\":\"E\"") == 4);
+    assert(count(s, "\"name\":\"unclosed\"") == 2);
+    assert(strstr(s, "\"detail\":\"a \\\"quoted\\\" name\""));
+    assert(strstr(s, "\"tid\":1") && strstr(s, "\"tid\":2"));
+    assert(!tinyc_trace_enabled());
+    fclose(fp);
+}
+
+static void restart(void) {
+    assert(tinyc_trace_start());
+    tinyc_trace_begin("again", NULL);
+    tinyc_trace_end();
+    FILE *fp = tmpfile();
+    assert(fp && tinyc_trace_finish(fp));
+    char s[4096];
+    assert(read_all(fp, s, sizeof(s)));
+    assert(count(s, "\"ph\":") == 2 && strstr(s, "\"name\":\"again\""));
+    fclose(fp);
+}
+
+int main(void) {
+    disabled();
+    nested_and_threads();
+    restart();
+}
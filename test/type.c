@@ -0,0 +1,188 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <assert.h>
+#include <string.h>
+#include <tinyc/type.h>
+
+#include "tinyc/string.h"
+
+static void expect_dump(const struct tinyc_type *type, const char *expect) {
+    struct tinyc_string out;
+    assert(tinyc_string_init(&out));
+    assert(tinyc_type_dump(type, &out));
+    assert(strcmp(out.cstr, expect) == 0);
+    tinyc_string_free(&out);
+}
+
+static void intern(void) {
+    struct tinyc_types types;
+    assert(tinyc_types_init(&types));
+    const struct tinyc_type *i = tinyc_type_basic(&types, TINYC_TYPE_INT);
+    const struct tinyc_type *c = tinyc_type_basic(&types, TINYC_TYPE_CHAR);
+
+    // Same derivation gives the same type.
+    const struct tinyc_type *cc = tinyc_type_qualified(
+        &types,
+        c,
+        TINYC_TYPE_CONST
+    );
+    const struct tinyc_type *p1 = tinyc_type_pointer(&types, cc);
+    const struct tinyc_type *p2 = tinyc_type_pointer(
+        &types,
+        tinyc_type_qualified(&types, c, TINYC_TYPE_CONST)
+    );
+    assert(p1 && p1 == p2 && p1 != tinyc_type_pointer(&types, c));
+    assert(cc->unqual == c && tinyc_type_qualified(&types, cc, 0) == cc);
+    assert(tinyc_type_qualified(&types, cc, TINYC_TYPE_CONST) == cc);
+
+    const struct tinyc_type *params[] = {i, p1};
+    const struct tinyc_type *f1 = tinyc_type_function(
+        &types,
+        i,
+        params,
+        2,
+        TINYC_TYPE_PROTOTYPE | TINYC_TYPE_VARIADIC
+    );
+    const size_t len = types.len;
+    params[0] = tinyc_type_basic(&types, TINYC_TYPE_INT);
+    const struct tinyc_type *f2 = tinyc_type_function(
+        &types,
+        i,
+        params,
+        2,
+        TINYC_TYPE_PROTOTYPE | TINYC_TYPE_VARIADIC
+    );
+    assert(f1 == f2 && types.len == len);
+    expect_dump(f1, "(function int int (pointer (const char)) ...)");
+
+    // Qualifiers of array apply to element.
+    const struct tinyc_type *a = tinyc_type_array(&types, i, 4);
+    const struct tinyc_type *ca = tinyc_type_qualified(
+        &types,
+        a,
+        TINYC_TYPE_CONST
+    );
+    expect_dump(ca, "(array (const int) 4)");
+
+    // Each record is distinct.
+    const struct tinyc_type *s1 = tinyc_type_record(&types, TINYC_TYPE_STRUCT);
+    const struct tinyc_type *s2 = tinyc_type_record(&types, TINYC_TYPE_STRUCT);
+    assert(s1 && s2 && s1 != s2);
+    assert(
+        tinyc_type_qualified(&types, s1, TINYC_TYPE_VOLATILE) ==
+        tinyc_type_qualified(&types, s1, TINYC_TYPE_VOLATILE)
+    );
+    assert(
+        tinyc_type_qualified(&types, s1, TINYC_TYPE_VOLATILE) !=
+        tinyc_type_qualified(&types, s2, TINYC_TYPE_VOLATILE)
+    );
+    tinyc_types_free(&types);
+}
+
+static void composite(void) {
+    struct tinyc_types types;
+    assert(tinyc_types_init(&types));
+    const struct tinyc_type *i = tinyc_type_basic(&types, TINYC_TYPE_INT);
+    const struct tinyc_type *l = tinyc_type_basic(&types, TINYC_TYPE_LONG);
+    const struct tinyc_type *res;
+
+    // Known length wins.
+    const struct tinyc_type *a3 = tinyc_type_array(&types, i, 3);
+    const struct tinyc_type *a = tinyc_type_array(
+        &types,
+        i,
+        TINYC_TYPE_UNKNOWN_LEN
+    );
+    const struct tinyc_type *pa3 = tinyc_type_pointer(&types, a3);
+    const struct tinyc_type *pa = tinyc_type_pointer(&types, a);
+    assert(tinyc_type_composite(&types, pa, pa3, &res) && res == pa3);
+    assert(types.ncomposites == 2);
+    assert(tinyc_type_composite(&types, pa3, pa, &res) && res == pa3);
+    assert(types.ncomposites == 2);
+    const struct tinyc_type *a4 = tinyc_type_array(&types, i, 4);
+    assert(tinyc_type_composite(&types, a3, a4, &res) && !res);
+    assert(tinyc_type_composite(&types, i, l, &res) && !res);
+
+    // Prototype gives parameters to function without it.
+    const struct tinyc_type *params[] = {a};
+    const struct tinyc_type *f1 = tinyc_type_function(&types, i, NULL, 0, 0);
+    const struct tinyc_type *f2 = tinyc_type_function(
+        &types,
+        i,
+        params,
+        1,
+        TINYC_TYPE_PROTOTYPE
+    );
+    assert(tinyc_type_composite(&types, f1, f2, &res) && res == f2);
+    params[0] = a3;
+    const struct tinyc_type *f3 = tinyc_type_function(
+        &types,
+        i,
+        params,
+        1,
+        TINYC_TYPE_PROTOTYPE
+    );
+    assert(tinyc_type_composite(&types, f2, f3, &res) && res == f3);
+
+    // Unprototyped function is incompatible with variadic one.
+    const struct tinyc_type *f6 = tinyc_type_function(
+        &types,
+        i,
+        params,
+        1,
+        TINYC_TYPE_PROTOTYPE | TINYC_TYPE_VARIADIC
+    );
+    assert(tinyc_type_composite(&types, f1, f6, &res) && !res);
+    assert(tinyc_type_composite(&types, f6, f1, &res) && !res);
+
+    // Qualifiers of parameters are ignored.
+    const struct tinyc_type *p = tinyc_type_pointer(&types, i);
+    params[0] = tinyc_type_qualified(&types, p, TINYC_TYPE_CONST);
+    const struct tinyc_type *f4 = tinyc_type_function(
+        &types,
+        i,
+        params,
+        1,
+        TINYC_TYPE_PROTOTYPE
+    );
+    params[0] = p;
+    const struct tinyc_type *f5 = tinyc_type_function(
+        &types,
+        i,
+        params,
+        1,
+        TINYC_TYPE_PROTOTYPE
+    );
+    assert(tinyc_type_composite(&types, f4, f5, &res) && res == f5);
+    expect_dump(f4, "(function int (const pointer int))");
+
+    // Qualifiers must match.
+    const struct tinyc_type *ci = tinyc_type_qualified(
+        &types,
+        i,
+        TINYC_TYPE_CONST
+    );
+    assert(tinyc_type_composite(&types, ci, i, &res) && !res);
+    const struct tinyc_type *s = tinyc_type_record(&types, TINYC_TYPE_STRUCT);
+    const struct tinyc_type *t = tinyc_type_record(&types, TINYC_TYPE_STRUCT);
+    assert(tinyc_type_composite(&types, s, t, &res) && !res);
+    tinyc_types_free(&types);
+}
+
+int main(void) {
+    intern();
+    composite();
+}
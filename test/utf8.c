@@ -0,0 +1,82 @@
+// Copyright 2024 pogyomo
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <assert.h>
+#include <string.h>
+#include <tinyc/utf8.h>
+
+static size_t validate(const char *s) {
+    return tinyc_utf8_validate(s, strlen(s));
+}
+
+static size_t column(const char *s, size_t offset) {
+    return tinyc_utf8_column(s, strlen(s), offset);
+}
+
+static void valid(void) {
+    assert(validate("") == 0);
+    assert(validate("int main(void) { return 0; }") == 28);
+    assert(validate("\xc3\xa9") == 2);
+    assert(validate("\xe5\xad\x97") == 3);
+    assert(validate("\xf0\x9f\x98\x80") == 4);
+    assert(validate("\xf4\x8f\xbf\xbf") == 4);
+    assert(validate("\xed\x9f\xbf") == 3);
+}
+
+static void invalid(void) {
+    assert(validate("\x80") == 0);
+    assert(validate("\xc0\xaf") == 0);          // Overlong.
+    assert(validate("\xe0\x80\xaf") == 0);      // Overlong.
+    assert(validate("\xed\xa0\x80") == 0);      // Surrogate.
+    assert(validate("\xf4\x90\x80\x80") == 0);  // Above U+10FFFF.
+    assert(validate("\xf5\x80\x80\x80") == 0);
+    assert(validate("a\xe5\xad") == 1);         // Truncated.
+    assert(validate("\xe5" "a" "\x97") == 0);
+
+    // Invalid byte is found after a long run of ASCII.
+    char s[64];
+    memset(s, 'a', sizeof(s));
+    for (size_t i = 0; i < 40; ++i) {
+        s[i] = '\xff';
+        assert(tinyc_utf8_validate(s, sizeof(s)) == i);
+        s[i] = 'a';
+    }
+    assert(tinyc_utf8_validate(s, sizeof(s)) == sizeof(s));
+}
+
+static void columns(void) {
+    assert(column("int x;", 4) == 4);
+    assert(column("\tx", 1) == 8);
+    assert(column("abc\tx", 4) == 8);
+    assert(column("abcdefgh\tx", 9) == 16);
+    assert(column("\xc3\xa9x", 2) == 1);
+    assert(column("\xe5\xad\x97x", 3) == 2);
+    assert(column("e\xcc\x81x", 3) == 1);  // Combining acute accent.
+    assert(column("\xffx", 1) == 1);
+    assert(column("ab", 4) == 4);          // Beyond end of line.
+
+    const char *s = "\xe5\xad\x97\t";
+    size_t offset = 0;
+    assert(tinyc_utf8_advance(s, strlen(s), &offset, 0) == 2);
+    assert(offset == 3);
+    assert(tinyc_utf8_advance(s, strlen(s), &offset, 2) == 8);
+    assert(offset == 4);
+}
+
+int main(void) {
+    valid();
+    invalid();
+    columns();
+}